@@ -65,6 +65,46 @@
  */
 #define CONFIG_CS104_MAX_CLIENT_CONNECTIONS 5
 
+/**
+ * Maximum number of event (priority) classes of the CS104 server event queue. Events are assigned to the classes by
+ * type ID and COT (CS104_Slave_addEventClassMapping). 1 -> only a single event queue (FIFO) per redundancy group
+ */
+#define CONFIG_CS104_SLAVE_EVENT_CLASSES 4
+
+/**
+ * Maximum number of cyclic (periodic or background scan) groups of the CS104 server
+ * (CS104_Slave_addCyclicGroup). 0 -> no support for cyclic groups
+ */
+#define CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS 8
+
+/**
+ * Maximum number of stations (common addresses) for which the CS101 point cache tracks the state of the
+ * general interrogation. Station interrogations of additional stations are ignored by the GI tracking
+ * (the points themselves are still stored).
+ */
+#define CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS 32
+
+/**
+ * Compile library with support for replication of the event queue(s) to a standby server (only CS104 server).
+ * Requires CONFIG_USE_THREADS = 1. 0 (default) -> no replication code in the event queue operations
+ */
+#define CONFIG_CS104_SLAVE_QUEUE_REPLICATION 0
+
+/**
+ * Size of the output buffer of each CS104 server connection. The buffer stores the part of the messages
+ * that cannot be written immediately when the TCP send buffer is full. Has to be large enough for at least
+ * one I message (255 bytes) and a few S/U messages.
+ */
+#define CONFIG_CS104_SLAVE_OUTPUT_BUFFER_SIZE 1024
+
+/**
+ * Length of the TCP listen queue of the CS104 server. Connection requests that arrive while the queue is full are
+ * dropped by the operating system and retried by the client after the SYN retransmission timeout (usually 1 s or more).
+ * Should be large enough for all clients that reconnect at the same time (e.g. after a network outage). The operating
+ * system may limit the value (e.g. net.core.somaxconn on Linux).
+ */
+#define CONFIG_CS104_SLAVE_LISTEN_BACKLOG 1024
+
 /* activate TCP keep alive mechanism. 1 -> activate */
 #define CONFIG_ACTIVATE_TCP_KEEPALIVE 0
 
@@ -77,5 +117,30 @@
 /* number of not missing keepalive responses until socket is considered dead */
 #define CONFIG_TCP_KEEPALIVE_CNT 2
 
+/**
+ * Static memory profile. 1 -> take all memory of the library from static block pools instead of the heap
+ *
+ * The pools are sized at compile time with CONFIG_LIB60870_STATIC_MEMORY_POOL_<n>_BLOCK_SIZE and
+ * CONFIG_LIB60870_STATIC_MEMORY_POOL_<n>_BLOCKS (n = 0..3). The usage and the number of failed
+ * allocations can be checked at runtime with Lib60870_getMemoryPoolStatistics. The default block size
+ * of the largest pool is derived from CONFIG_CS104_MESSAGE_QUEUE_SIZE and CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE
+ * (the queue sizes passed to CS104_Slave_create must not be larger).
+ */
+#define CONFIG_LIB60870_STATIC_MEMORY 0
+
+/**
+ * Compile the library with trace points on the protocol hot paths (queue operations, sending and receiving
+ * of I/S messages, timeouts, connection events, callback handlers). 1 -> trace points compiled in.
+ *
+ * Tracing is disabled at runtime by default (a trace point costs a single check of a flag). It is enabled
+ * with Lib60870_startTracing (ring buffer) or Lib60870_setTraceHandler (custom sink).
+ */
+#define CONFIG_LIB60870_TRACING 1
+
+/**
+ * Additionally emit the trace points as Linux USDT probe (provider "lib60870", probe "trace").
+ * Requires sys/sdt.h (systemtap-sdt-dev). 1 -> enable USDT probes
+ */
+#define CONFIG_LIB60870_TRACING_USDT 0
 
 #endif /* CONFIG_LIB60870_CONFIG_H_ */
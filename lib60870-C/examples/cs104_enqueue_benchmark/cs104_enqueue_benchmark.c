@@ -0,0 +1,97 @@
+/*
+ * Compare the time to enqueue ASDUs into the CS104 server event queues with
+ * CS104_Slave_enqueueASDU (one call per ASDU) and CS104_Slave_enqueueASDUs (batch).
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cs104_slave.h"
+
+#include "hal_time.h"
+
+#define BATCH_SIZE 200
+#define NUMBER_OF_BATCHES 500
+#define NUMBER_OF_GROUPS 3
+
+static CS104_Slave
+createServer(void)
+{
+    int i;
+
+    CS104_Slave slave = CS104_Slave_create(10000, 100);
+
+    CS104_Slave_setLocalPort(slave, 2405);
+    CS104_Slave_setServerMode(slave, CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS);
+
+    for (i = 0; i < NUMBER_OF_GROUPS; i++) {
+        char groupName[20];
+
+        sprintf(groupName, "group%i", i);
+
+        CS104_Slave_addRedundancyGroup(slave, CS104_RedundancyGroup_create(groupName));
+    }
+
+    CS104_Slave_start(slave);
+
+    return slave;
+}
+
+int
+main(int argc, char** argv)
+{
+    int i, j;
+
+    CS104_Slave slave = createServer();
+
+    if (CS104_Slave_isRunning(slave) == false) {
+        printf("Starting server failed!\n");
+        CS104_Slave_destroy(slave);
+        return -1;
+    }
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    CS101_ASDU asdus[BATCH_SIZE];
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        asdus[i] = CS101_ASDU_create(alParams, false, CS101_COT_PERIODIC, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 110 + i, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdus[i], io);
+
+        InformationObject_destroy(io);
+    }
+
+    uint64_t startTime = Hal_getMonotonicTimeInNs();
+
+    for (j = 0; j < NUMBER_OF_BATCHES; j++) {
+        for (i = 0; i < BATCH_SIZE; i++)
+            CS104_Slave_enqueueASDU(slave, asdus[i]);
+    }
+
+    uint64_t singleTime = Hal_getMonotonicTimeInNs() - startTime;
+
+    startTime = Hal_getMonotonicTimeInNs();
+
+    for (j = 0; j < NUMBER_OF_BATCHES; j++)
+        CS104_Slave_enqueueASDUs(slave, asdus, BATCH_SIZE);
+
+    uint64_t batchTime = Hal_getMonotonicTimeInNs() - startTime;
+
+    int numberOfAsdus = BATCH_SIZE * NUMBER_OF_BATCHES;
+
+    printf("%i ASDUs to %i redundancy groups\n", numberOfAsdus, NUMBER_OF_GROUPS);
+    printf("  CS104_Slave_enqueueASDU:  %8.1f ns/ASDU\n", (double) singleTime / numberOfAsdus);
+    printf("  CS104_Slave_enqueueASDUs: %8.1f ns/ASDU (batch size %i)\n", (double) batchTime / numberOfAsdus, BATCH_SIZE);
+
+    for (i = 0; i < BATCH_SIZE; i++)
+        CS101_ASDU_destroy(asdus[i]);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    return 0;
+}
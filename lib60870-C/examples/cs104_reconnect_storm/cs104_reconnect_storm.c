@@ -0,0 +1,151 @@
+/*
+ * Measure the time from TCP connect to STARTDT_CON when many clients connect to a
+ * CS104 server at the same time (e.g. after a WAN outage).
+ *
+ * NOTE: The server accepts up to CONFIG_CS104_MAX_CLIENT_CONNECTIONS clients. Additional
+ * clients are counted as rejected.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cs104_slave.h"
+
+#include "hal_time.h"
+#include "hal_thread.h"
+#include "hal_socket.h"
+
+#define NUMBER_OF_CLIENTS 500
+#define NUMBER_OF_ROUNDS 5
+#define STARTDT_CON_TIMEOUT_MS 5000
+
+static uint8_t startDtAct[] = { 0x68, 0x04, 0x07, 0x00, 0x00, 0x00 };
+
+typedef struct {
+    Socket socket;
+    uint64_t connectTime;
+    uint64_t latency;
+    bool finished;
+    bool confirmed;
+} Client;
+
+static Client clients[NUMBER_OF_CLIENTS];
+
+static bool
+isStartDtCon(uint8_t* buf)
+{
+    return ((buf[0] == 0x68) && (buf[1] == 0x04) && (buf[2] == 0x0b));
+}
+
+int
+main(int argc, char** argv)
+{
+    int i, round;
+
+    int numberOfClients = NUMBER_OF_CLIENTS;
+
+    if (argc > 1)
+        numberOfClients = atoi(argv[1]);
+
+    if ((numberOfClients < 1) || (numberOfClients > NUMBER_OF_CLIENTS))
+        numberOfClients = NUMBER_OF_CLIENTS;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 2405);
+    CS104_Slave_setServerMode(slave, CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP);
+
+    CS104_Slave_start(slave);
+
+    if (CS104_Slave_isRunning(slave) == false) {
+        printf("Starting server failed!\n");
+        CS104_Slave_destroy(slave);
+        return -1;
+    }
+
+    for (round = 0; round < NUMBER_OF_ROUNDS; round++) {
+
+        int confirmed = 0;
+        int rejected = 0;
+        uint64_t latencySum = 0;
+        uint64_t maxLatency = 0;
+
+        /* all clients connect at the same time */
+        for (i = 0; i < numberOfClients; i++) {
+            clients[i].socket = TcpSocket_create();
+            clients[i].finished = false;
+            clients[i].confirmed = false;
+            clients[i].connectTime = Hal_getMonotonicTimeInNs();
+
+            if ((clients[i].socket == NULL) || (Socket_connect(clients[i].socket, "127.0.0.1", 2405) == false)) {
+                clients[i].finished = true;
+                continue;
+            }
+
+            Socket_write(clients[i].socket, startDtAct, sizeof(startDtAct));
+        }
+
+        uint64_t timeout = Hal_getTimeInMs() + STARTDT_CON_TIMEOUT_MS;
+
+        int finished = 0;
+
+        while ((finished < numberOfClients) && (Hal_getTimeInMs() < timeout)) {
+
+            finished = 0;
+
+            for (i = 0; i < numberOfClients; i++) {
+                if (clients[i].finished == false) {
+                    uint8_t buf[6];
+
+                    int readBytes = Socket_read(clients[i].socket, buf, sizeof(buf));
+
+                    if ((readBytes == 6) && isStartDtCon(buf)) {
+                        clients[i].latency = Hal_getMonotonicTimeInNs() - clients[i].connectTime;
+                        clients[i].confirmed = true;
+                        clients[i].finished = true;
+                    }
+                    else if (readBytes < 0)
+                        clients[i].finished = true;
+                }
+
+                if (clients[i].finished)
+                    finished++;
+            }
+
+            Thread_sleep(1);
+        }
+
+        for (i = 0; i < numberOfClients; i++) {
+            if (clients[i].confirmed) {
+                confirmed++;
+                latencySum += clients[i].latency;
+
+                if (clients[i].latency > maxLatency)
+                    maxLatency = clients[i].latency;
+            }
+            else
+                rejected++;
+
+            if (clients[i].socket)
+                Socket_destroy(clients[i].socket);
+        }
+
+        printf("round %i: %i confirmed, %i rejected/failed", round + 1, confirmed, rejected);
+
+        if (confirmed > 0)
+            printf(", connect to STARTDT_CON avg %.1f us max %.1f us", (double) latencySum / confirmed / 1000.0,
+                    (double) maxLatency / 1000.0);
+
+        printf("\n");
+
+        /* wait until the server has released the connections */
+        while (CS104_Slave_getOpenConnections(slave) > 0)
+            Thread_sleep(10);
+    }
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    return 0;
+}
@@ -128,6 +128,10 @@ SerialPort_readByte(SerialPort self);
 /**
  * \brief Write the number of bytes from the buffer to the serial interface
  *
+ * The function doesn't block. It neither waits until the data is transmitted nor for the minimum
+ * line idle time (33 bit times) after the previous data. The caller has to check
+ * \ref SerialPort_getTimeToIdle before writing the next data.
+ *
  * \param buffer the buffer containing the data to write
  * \param startPos start position in the buffer of the data to write
  * \param numberOfBytes number of bytes to write
@@ -137,6 +141,18 @@ SerialPort_readByte(SerialPort self);
 int
 SerialPort_write(SerialPort self, uint8_t* buffer, int startPos, int numberOfBytes);
 
+/**
+ * \brief Get the time until the next data can be written without violating the minimum line idle time
+ *
+ * The time is calculated from the baud rate and the character format (start bit, data bits, parity, stop bits)
+ * of the data written before. The time until the written data is completely transmitted is the
+ * returned time minus 33 bit times.
+ *
+ * \return the time in us, or 0 when the line is idle
+ */
+int
+SerialPort_getTimeToIdle(SerialPort self);
+
 /**
  * \brief Get the error code of the last operation
  */
@@ -85,11 +85,21 @@ Handleset_reset(HandleSet self);
 void
 Handleset_addSocket(HandleSet self, const Socket sock);
 
+/**
+ * \brief add a socket to an existing handle set to wait until the socket is ready for writing
+ *
+ * \param self the HandleSet instance
+ * \param sock the socket to add
+ */
+void
+Handleset_addSocketForWrite(HandleSet self, const Socket sock);
+
 /**
  * \brief wait for a socket to become ready
  *
  * This function is corresponding to the BSD socket select function.
- * It returns the number of sockets on which data is pending or 0 if no data is pending
+ * It returns the number of sockets on which data is pending (or that are ready for writing
+ * when added with \ref Handleset_addSocketForWrite) or 0 if no data is pending
  * on any of the monitored connections. The function will return after "timeout" ms if no
  * data is pending.
  * The function shall return -1 if a socket error occures.
@@ -103,6 +113,44 @@ Handleset_addSocket(HandleSet self, const Socket sock);
 int
 Handleset_waitReady(HandleSet self, unsigned int timeoutMs);
 
+/**
+ * \brief Enable the wake-up of \ref Handleset_waitReady by other threads
+ *
+ * Creates an internal handle that is monitored by \ref Handleset_waitReady in addition to
+ * the added sockets. It is not removed by \ref Handleset_reset.
+ *
+ * \param self the HandleSet instance
+ *
+ * \return true when the wake-up is enabled, false when not supported by the platform
+ */
+bool
+Handleset_enableWakeUp(HandleSet self);
+
+/**
+ * \brief Interrupt a call of \ref Handleset_waitReady
+ *
+ * Can be called by any thread. When no thread is waiting the next call of \ref Handleset_waitReady
+ * returns immediately. The wake-up is not counted in the return value of \ref Handleset_waitReady.
+ * Has no effect when the wake-up is not enabled (see \ref Handleset_enableWakeUp).
+ *
+ * \param self the HandleSet instance
+ */
+void
+Handleset_wakeUp(HandleSet self);
+
+/**
+ * \brief Get the descriptor that becomes readable after \ref Handleset_wakeUp
+ *
+ * Allows to monitor the wake-up by an external event loop. The wake-up is reset by the
+ * next call of \ref Handleset_waitReady.
+ *
+ * \param self the HandleSet instance
+ *
+ * \return the descriptor, or -1 when the wake-up is not enabled
+ */
+int
+Handleset_getWakeUpDescriptor(HandleSet self);
+
 /**
  * \brief destroy the HandleSet instance
  *
@@ -158,6 +206,47 @@ ServerSocket_accept(ServerSocket self);
 void
 Socket_activateTcpKeepAlive(Socket self, int idleTime, int interval, int count);
 
+/**
+ * \brief Key material of one direction of a TLS 1.2 AES-GCM session (used for kernel TLS)
+ */
+typedef struct {
+    int keyLength;                    /**< 16 (AES-128-GCM) or 32 (AES-256-GCM) */
+    uint8_t key[32];                  /**< the write key of the direction */
+    uint8_t salt[4];                  /**< implicit part of the nonce (write IV) */
+    uint8_t iv[8];                    /**< explicit part of the nonce of the next record */
+    uint8_t recordSequenceNumber[8];  /**< sequence number of the next record */
+} SocketTlsCryptoInfo;
+
+/**
+ * \brief Hand over the record encryption (or decryption) of an established TLS 1.2 session to the kernel
+ *
+ * After a successful call the socket sends (or receives) TLS application data records when the
+ * application writes (reads) plain data.
+ *
+ * Implementation of this function is OPTIONAL. Platforms without kernel TLS support return false.
+ *
+ * \param self the client or connection socket instance
+ * \param transmit true to set the parameters of the transmit direction, false for the receive direction
+ * \param cryptoInfo the key material of the direction
+ *
+ * \return true when the kernel took over the direction, false otherwise (the caller has to continue with user space TLS)
+ */
+bool
+Socket_setKernelTls(Socket self, bool transmit, SocketTlsCryptoInfo* cryptoInfo);
+
+/**
+ * \brief Get the operating system handle (file descriptor) of the socket
+ *
+ * Can be used to integrate the socket into an external event loop (e.g. epoll).
+ * A server socket can be passed by casting it to \ref Socket.
+ *
+ * \param self the client, connection or server socket instance
+ *
+ * \return the file descriptor of the socket
+ */
+int
+Socket_getFileDescriptor(Socket self);
+
 /**
  * \brief set the maximum number of pending connection in the queue
  *
@@ -241,6 +330,39 @@ Socket_connect(Socket self, const char* address, int port);
 int
 Socket_read(Socket self, uint8_t* buf, int size);
 
+/**
+ * \brief Enable or disable receive time stamps provided by the operating system
+ *
+ * When enabled, \ref Socket_readWithTimestamp returns the time when the network stack received the data
+ * instead of the time of the read call. The time stamp is taken from the same clock as \ref Hal_getTimeInNs.
+ *
+ * Implementation of this function is OPTIONAL. Platforms without receive time stamps return false.
+ *
+ * \param self the client or connection socket instance
+ * \param enable true to enable receive time stamps
+ *
+ * \return true when the operating system provides receive time stamps, false otherwise
+ */
+bool
+Socket_setReceiveTimestamps(Socket self, bool enable);
+
+/**
+ * \brief read from socket to local buffer (non-blocking) and get the receive time stamp of the data
+ *
+ * Same as \ref Socket_read. Additionally the receive time of the first read byte is stored in timestamp
+ * (nanoseconds since the UNIX epoch). When no receive time stamp is provided by the operating system the
+ * time of the read call (\ref Hal_getTimeInNs) is used.
+ *
+ * \param self the client or connection socket instance
+ * \param buf the buffer where the read bytes are copied to
+ * \param size the maximum number of bytes to read (size of the provided buffer)
+ * \param timestamp the receive time stamp is stored here (only when bytes have been read)
+ *
+ * \return the number of bytes read or -1 if an error occurred
+ */
+int
+Socket_readWithTimestamp(Socket self, uint8_t* buf, int size, uint64_t* timestamp);
+
 /**
  * \brief send a message through the socket
  *
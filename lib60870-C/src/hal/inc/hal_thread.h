@@ -23,6 +23,7 @@
 #define THREAD_HAL_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -65,12 +66,47 @@ typedef void* (*ThreadExecutionFunction) (void*);
 Thread
 Thread_create(ThreadExecutionFunction function, void* parameter, bool autodestroy);
 
+/**
+ * \brief Optional scheduling and resource attributes for a thread
+ *
+ * Every field that is set to 0 (or NULL) keeps the platform default. Attributes that are
+ * not supported by the platform are ignored.
+ */
+typedef struct sThreadAttributes* ThreadAttributes;
+
+struct sThreadAttributes {
+    int stackSize;         /* stack size in bytes (0 = platform default) */
+    uint32_t cpuAffinity;  /* bit mask of the CPUs the thread is allowed to run on (0 = no restriction) */
+    int priority;          /* real-time (SCHED_FIFO) priority 1-99 (0 = default scheduling policy) */
+    const char* name;      /* thread name (at most 15 characters are used, NULL = no name) */
+};
+
+/**
+ * \brief Create a new Thread instance with the given attributes
+ *
+ * The attributes are applied when the thread is started by \ref Thread_start. When the
+ * real-time priority cannot be set (e.g. missing privileges) the thread is started with the
+ * default scheduling policy instead.
+ *
+ * \param function the entry point of the thread
+ * \param parameter a parameter that is passed to the threads start function
+ * \param autodestroy the thread is automatically destroyed if the ThreadExecutionFunction has finished.
+ * \param attributes the thread attributes (will be copied) or NULL to use the platform defaults
+ *
+ * \return the newly created Thread instance
+ */
+Thread
+Thread_createEx(ThreadExecutionFunction function, void* parameter, bool autodestroy, ThreadAttributes attributes);
+
 /**
  * \brief Start a Thread.
  *
  * This function invokes the start function of the thread. The thread terminates when
  * the start function returns.
  *
+ * NOTE: When a thread created with autodestroy cannot be started the Thread instance is
+ * released immediately and must not be used anymore.
+ *
  * \param thread the Thread instance to start
  */
 void
@@ -90,6 +126,14 @@ Thread_destroy(Thread thread);
 void
 Thread_sleep(int millies);
 
+/**
+ * \brief Get the identifier of the calling thread
+ *
+ * \return the identifier of the calling thread (never 0)
+ */
+uint64_t
+Thread_getCurrentThreadId(void);
+
 Semaphore
 Semaphore_create(int initialValue);
 
@@ -97,6 +141,16 @@ Semaphore_create(int initialValue);
 void
 Semaphore_wait(Semaphore self);
 
+/**
+ * \brief Wait until the semaphore value is greater than zero or the timeout expires
+ *
+ * \param timeoutInMs maximum time to wait in ms
+ *
+ * \return true when the semaphore value was decreased, false on timeout
+ */
+bool
+Semaphore_waitTimeout(Semaphore self, int timeoutInMs);
+
 void
 Semaphore_post(Semaphore self);
 
@@ -55,6 +55,28 @@ extern "C" {
 uint64_t
 Hal_getTimeInMs(void);
 
+/**
+ * Get the system time in nanoseconds.
+ *
+ * The time value returned as 64-bit unsigned integer should represent the nanoseconds
+ * since the UNIX epoch (1970/01/01 00:00 UTC). The resolution depends on the platform.
+ *
+ * \return the system time with nanosecond resolution.
+ */
+uint64_t
+Hal_getTimeInNs(void);
+
+/**
+ * Get a monotonic time stamp in nanoseconds.
+ *
+ * The time value has no relation to the system time and is not affected by changes of the system time.
+ * It is intended for time measurements (e.g. trace time stamps). The resolution depends on the platform.
+ *
+ * \return the monotonic time in nanoseconds
+ */
+uint64_t
+Hal_getMonotonicTimeInNs(void);
+
 /*! @} */
 
 /*! @} */
@@ -37,6 +37,8 @@ extern "C" {
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 typedef void
 (*MemoryExceptionHandler) (void* parameter);
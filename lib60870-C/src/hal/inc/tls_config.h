@@ -117,6 +117,24 @@ TLSConfiguration_addCACertificateFromFile(TLSConfiguration self, const char* fil
 void
 TLSConfiguration_setRenegotiationTime(TLSConfiguration self, int timeInMs);
 
+/**
+ * \brief Enable kernel TLS (kTLS) offload of the record layer (disabled by default)
+ *
+ * When enabled the negotiated keys of a TLS 1.2 session with an AES-GCM cipher suite
+ * are installed into the kernel after the handshake. Application data is then
+ * encrypted/decrypted by the kernel and the socket can be written without an
+ * additional copy in user space. When the session uses another cipher suite or
+ * the platform doesn't support kernel TLS the TLS library continues to handle
+ * the record layer.
+ *
+ * NOTE: Session renegotiation is not possible after the transmit direction has
+ * been offloaded. The renegotiation timeout is ignored for these connections.
+ *
+ * \param enable true to enable kernel TLS offload, false otherwise
+ */
+void
+TLSConfiguration_setKernelTlsOffload(TLSConfiguration self, bool enable);
+
 void
 TLSConfiguration_destroy(TLSConfiguration self);
 
@@ -98,9 +98,12 @@ TLSSocket_read(TLSSocket self, uint8_t* buf, int size);
  *
  * Implementation of this function is MANDATORY
  *
+ * The function doesn't block. When the socket cannot take the data, 0 is returned and the
+ * same data has to be passed again with the next call (more data can follow it).
+ *
  * \param self client, connection or server socket instance
  *
- * \return number of bytes transmitted of -1 in case of an error
+ * \return number of bytes transmitted, 0 when the socket is busy, or -1 in case of an error
  */
 int
 TLSSocket_write(TLSSocket self, uint8_t* buf, int size);
@@ -19,7 +19,16 @@
  *  See COPYING file for the complete license text.
  */
 
+#include <string.h>
+#include <stdint.h>
+
 #include "lib_memory.h"
+#include "lib60870_config.h"
+#include "iec60870_common.h"
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY
+#define CONFIG_LIB60870_STATIC_MEMORY 0
+#endif
 
 static MemoryExceptionHandler exceptionHandler = NULL;
 static void* exceptionHandlerParameter = NULL;
@@ -38,6 +47,338 @@ Memory_installExceptionHandler(MemoryExceptionHandler handler, void* parameter)
     exceptionHandlerParameter = parameter;
 }
 
+#if (CONFIG_LIB60870_STATIC_MEMORY == 1)
+
+/*
+ * Static memory profile: all memory is taken from fixed size block pools with
+ * compile time capacity. Each request is served from the smallest pool with a
+ * large enough block size. When that pool is exhausted the next larger pool is
+ * used and the exhaustion counter of the smaller pool is incremented.
+ */
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY_POOL_0_BLOCK_SIZE
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_0_BLOCK_SIZE 64
+#endif
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY_POOL_0_BLOCKS
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_0_BLOCKS 256
+#endif
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY_POOL_1_BLOCK_SIZE
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_1_BLOCK_SIZE 512
+#endif
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY_POOL_1_BLOCKS
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_1_BLOCKS 64
+#endif
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY_POOL_2_BLOCK_SIZE
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_2_BLOCK_SIZE 4096
+#endif
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY_POOL_2_BLOCKS
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_2_BLOCKS 16
+#endif
+
+/*
+ * The largest pool has to hold the event queue buffers of the CS 104 slave
+ * (one entry: 256 bytes ASDU + entry header of at most 32 bytes)
+ */
+#define STATIC_MEMORY_QUEUE_ENTRY_SIZE (256 + 32)
+
+#if ((CONFIG_CS104_MESSAGE_QUEUE_SIZE) > (CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE))
+#define STATIC_MEMORY_QUEUE_BUFFER_SIZE ((CONFIG_CS104_MESSAGE_QUEUE_SIZE) * STATIC_MEMORY_QUEUE_ENTRY_SIZE)
+#else
+#define STATIC_MEMORY_QUEUE_BUFFER_SIZE ((CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE) * STATIC_MEMORY_QUEUE_ENTRY_SIZE)
+#endif
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCK_SIZE
+#if (STATIC_MEMORY_QUEUE_BUFFER_SIZE > 32768)
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCK_SIZE STATIC_MEMORY_QUEUE_BUFFER_SIZE
+#else
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCK_SIZE 32768
+#endif
+#endif
+
+#if (CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCK_SIZE < STATIC_MEMORY_QUEUE_BUFFER_SIZE)
+#error "CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCK_SIZE is too small for the configured message queue sizes"
+#endif
+
+#ifndef CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCKS
+#define CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCKS 16
+#endif
+
+#define NUMBER_OF_MEMORY_POOLS 4
+
+typedef union {
+    uint64_t u64;
+    double d;
+    void* ptr;
+} MemoryPoolWord;
+
+#define POOL_WORDS(blockSize) (((blockSize) + sizeof(MemoryPoolWord) - 1) / sizeof(MemoryPoolWord))
+
+static MemoryPoolWord pool0Memory[POOL_WORDS(CONFIG_LIB60870_STATIC_MEMORY_POOL_0_BLOCK_SIZE) * CONFIG_LIB60870_STATIC_MEMORY_POOL_0_BLOCKS];
+static MemoryPoolWord pool1Memory[POOL_WORDS(CONFIG_LIB60870_STATIC_MEMORY_POOL_1_BLOCK_SIZE) * CONFIG_LIB60870_STATIC_MEMORY_POOL_1_BLOCKS];
+static MemoryPoolWord pool2Memory[POOL_WORDS(CONFIG_LIB60870_STATIC_MEMORY_POOL_2_BLOCK_SIZE) * CONFIG_LIB60870_STATIC_MEMORY_POOL_2_BLOCKS];
+static MemoryPoolWord pool3Memory[POOL_WORDS(CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCK_SIZE) * CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCKS];
+
+struct sMemoryPool {
+    MemoryPoolWord* memory;
+    size_t blockSize; /* rounded up to a multiple of the word size */
+    int capacity;
+
+    void* freeList; /* the first word of a free block points to the next free block */
+
+    int used;
+    int maxUsed;
+    uint32_t exhaustionCount;
+};
+
+static struct sMemoryPool pools[NUMBER_OF_MEMORY_POOLS] = {
+    { pool0Memory, POOL_WORDS(CONFIG_LIB60870_STATIC_MEMORY_POOL_0_BLOCK_SIZE) * sizeof(MemoryPoolWord), CONFIG_LIB60870_STATIC_MEMORY_POOL_0_BLOCKS, NULL, 0, 0, 0 },
+    { pool1Memory, POOL_WORDS(CONFIG_LIB60870_STATIC_MEMORY_POOL_1_BLOCK_SIZE) * sizeof(MemoryPoolWord), CONFIG_LIB60870_STATIC_MEMORY_POOL_1_BLOCKS, NULL, 0, 0, 0 },
+    { pool2Memory, POOL_WORDS(CONFIG_LIB60870_STATIC_MEMORY_POOL_2_BLOCK_SIZE) * sizeof(MemoryPoolWord), CONFIG_LIB60870_STATIC_MEMORY_POOL_2_BLOCKS, NULL, 0, 0, 0 },
+    { pool3Memory, POOL_WORDS(CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCK_SIZE) * sizeof(MemoryPoolWord), CONFIG_LIB60870_STATIC_MEMORY_POOL_3_BLOCKS, NULL, 0, 0, 0 }
+};
+
+static bool poolsInitialized = false;
+
+/*
+ * The pools cannot be protected by a Semaphore because semaphores are allocated from the pools.
+ * A statically initialized platform mutex is used instead.
+ */
+#if (CONFIG_USE_THREADS == 1)
+
+#if defined(_WIN32)
+#include <windows.h>
+
+static SRWLOCK poolLock = SRWLOCK_INIT;
+
+#define POOL_LOCK() AcquireSRWLockExclusive(&poolLock)
+#define POOL_UNLOCK() ReleaseSRWLockExclusive(&poolLock)
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+static pthread_mutex_t poolLock;
+static pthread_once_t poolLockInitialized = PTHREAD_ONCE_INIT;
+
+static void
+initializePoolLock(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+
+#if defined(_POSIX_THREAD_PRIO_INHERIT) && (_POSIX_THREAD_PRIO_INHERIT > 0)
+    /* a lock holder with lower (real-time) priority can continue while a thread with higher priority waits */
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+#endif
+
+    pthread_mutex_init(&poolLock, &attr);
+
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void
+lockPools(void)
+{
+    pthread_once(&poolLockInitialized, initializePoolLock);
+
+    pthread_mutex_lock(&poolLock);
+}
+
+#define POOL_LOCK() lockPools()
+#define POOL_UNLOCK() pthread_mutex_unlock(&poolLock)
+#endif
+
+#else /* (CONFIG_USE_THREADS == 1) */
+
+#define POOL_LOCK()
+#define POOL_UNLOCK()
+
+#endif /* (CONFIG_USE_THREADS == 1) */
+
+static void
+initializePools(void)
+{
+    int i;
+
+    for (i = 0; i < NUMBER_OF_MEMORY_POOLS; i++) {
+        struct sMemoryPool* pool = &(pools[i]);
+
+        uint8_t* block = (uint8_t*) pool->memory;
+        int j;
+
+        pool->freeList = NULL;
+
+        /* build the free list in reverse order so that the first block is used first */
+        for (j = pool->capacity - 1; j >= 0; j--) {
+            void** freeBlock = (void**) (block + (j * pool->blockSize));
+
+            *freeBlock = pool->freeList;
+            pool->freeList = freeBlock;
+        }
+    }
+
+    poolsInitialized = true;
+}
+
+static struct sMemoryPool*
+getPoolOfBlock(void* ptr)
+{
+    int i;
+
+    for (i = 0; i < NUMBER_OF_MEMORY_POOLS; i++) {
+        uint8_t* start = (uint8_t*) pools[i].memory;
+        uint8_t* end = start + (pools[i].blockSize * pools[i].capacity);
+
+        if (((uint8_t*) ptr >= start) && ((uint8_t*) ptr < end))
+            return &(pools[i]);
+    }
+
+    return NULL;
+}
+
+static void*
+allocateBlock(size_t size)
+{
+    void* block = NULL;
+    int i;
+
+    POOL_LOCK();
+
+    if (poolsInitialized == false)
+        initializePools();
+
+    for (i = 0; i < NUMBER_OF_MEMORY_POOLS; i++) {
+        struct sMemoryPool* pool = &(pools[i]);
+
+        if (pool->blockSize < size)
+            continue;
+
+        if (pool->freeList) {
+            block = pool->freeList;
+            pool->freeList = *((void**) block);
+
+            pool->used++;
+
+            if (pool->used > pool->maxUsed)
+                pool->maxUsed = pool->used;
+
+            break;
+        }
+        else
+            pool->exhaustionCount++;
+    }
+
+    POOL_UNLOCK();
+
+    return block;
+}
+
+static void
+releaseBlock(void* ptr)
+{
+    POOL_LOCK();
+
+    struct sMemoryPool* pool = getPoolOfBlock(ptr);
+
+    if (pool) {
+        *((void**) ptr) = pool->freeList;
+        pool->freeList = ptr;
+        pool->used--;
+    }
+
+    POOL_UNLOCK();
+}
+
+void*
+Memory_malloc(size_t size)
+{
+    void* memory = allocateBlock(size);
+
+    if (memory == NULL)
+        noMemoryAvailableHandler();
+
+    return memory;
+}
+
+void*
+Memory_calloc(size_t nmemb, size_t size)
+{
+    void* memory = NULL;
+
+    if ((size == 0) || (nmemb <= ((size_t) -1) / size))
+        memory = allocateBlock(nmemb * size);
+
+    if (memory == NULL)
+        noMemoryAvailableHandler();
+    else
+        memset(memory, 0, nmemb * size);
+
+    return memory;
+}
+
+void *
+Memory_realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return Memory_malloc(size);
+
+    struct sMemoryPool* pool = getPoolOfBlock(ptr);
+
+    if (pool == NULL)
+        return NULL;
+
+    if (size <= pool->blockSize)
+        return ptr;
+
+    void* memory = Memory_malloc(size);
+
+    if (memory) {
+        memcpy(memory, ptr, pool->blockSize);
+        releaseBlock(ptr);
+    }
+
+    return memory;
+}
+
+void
+Memory_free(void* memb)
+{
+    if (memb)
+        releaseBlock(memb);
+}
+
+int
+Lib60870_getNumberOfMemoryPools(void)
+{
+    return NUMBER_OF_MEMORY_POOLS;
+}
+
+bool
+Lib60870_getMemoryPoolStatistics(int poolIndex, Lib60870MemoryPoolStatistics* statistics)
+{
+    if ((poolIndex < 0) || (poolIndex >= NUMBER_OF_MEMORY_POOLS))
+        return false;
+
+    POOL_LOCK();
+
+    statistics->blockSize = (int) pools[poolIndex].blockSize;
+    statistics->capacity = pools[poolIndex].capacity;
+    statistics->used = pools[poolIndex].used;
+    statistics->maxUsed = pools[poolIndex].maxUsed;
+    statistics->exhaustionCount = pools[poolIndex].exhaustionCount;
+
+    POOL_UNLOCK();
+
+    return true;
+}
+
+#else /* (CONFIG_LIB60870_STATIC_MEMORY == 1) */
+
 void*
 Memory_malloc(size_t size)
 {
@@ -79,3 +420,19 @@ Memory_free(void* memb)
     free(memb);
 }
 
+int
+Lib60870_getNumberOfMemoryPools(void)
+{
+    return 0;
+}
+
+bool
+Lib60870_getMemoryPoolStatistics(int poolIndex, Lib60870MemoryPoolStatistics* statistics)
+{
+    (void) poolIndex;
+    (void) statistics;
+
+    return false;
+}
+
+#endif /* (CONFIG_LIB60870_STATIC_MEMORY == 1) */
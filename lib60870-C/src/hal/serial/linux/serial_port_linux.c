@@ -41,6 +41,7 @@ struct sSerialPort {
     char parity;
     uint8_t stopBits;
     uint64_t lastSentTime;
+    uint64_t transmitEndTime; /* monotonic time (ns) when the written data is completely transmitted */
     struct timeval timeout;
     SerialPortError lastError;
 };
@@ -58,6 +59,7 @@ SerialPort_create(const char* interfaceName, int baudRate, uint8_t dataBits, cha
         self->stopBits = stopBits;
         self->parity = parity;
         self->lastSentTime = 0;
+        self->transmitEndTime = 0;
         self->timeout.tv_sec = 0;
         self->timeout.tv_usec = 100000; /* 100 ms */
         strncpy(self->interfaceName, interfaceName, 100);
@@ -218,7 +220,8 @@ SerialPort_getBaudRate(SerialPort self)
 void
 SerialPort_discardInBuffer(SerialPort self)
 {
-    tcflush(self->fd, TCIOFLUSH);
+    /* keep the output queue - written frames can still be in transmission */
+    tcflush(self->fd, TCIFLUSH);
 }
 
 void
@@ -260,18 +263,55 @@ SerialPort_readByte(SerialPort self)
     }
 }
 
+/* bit time in ns */
+static uint64_t
+getBitTime(SerialPort self)
+{
+    int baudRate = (self->baudRate > 0) ? self->baudRate : 9600;
+
+    return 1000000000ULL / baudRate;
+}
+
 int
-SerialPort_write(SerialPort self, uint8_t* buffer, int startPos, int bufSize)
+SerialPort_getTimeToIdle(SerialPort self)
 {
-    //TODO assure minimum line idle time
+    uint64_t currentTime = Hal_getMonotonicTimeInNs();
 
+    /* minimum line idle time of 33 bit times after the last character */
+    uint64_t lineIdleTime = self->transmitEndTime + getBitTime(self) * 33;
+
+    if (currentTime >= lineIdleTime)
+        return 0;
+
+    return (int) ((lineIdleTime - currentTime + 999) / 1000);
+}
+
+int
+SerialPort_write(SerialPort self, uint8_t* buffer, int startPos, int bufSize)
+{
     self->lastError = SERIAL_PORT_ERROR_NONE;
 
+    /* the data is transmitted by the driver - don't wait for completion (tcdrain). The caller has
+     * to check the minimum line idle time before (SerialPort_getTimeToIdle) */
     ssize_t result = write(self->fd, buffer + startPos, bufSize);
 
-    tcdrain(self->fd);
+    if (result < 0) {
+        self->lastError = SERIAL_PORT_ERROR_UNKNOWN;
+        return -1;
+    }
+
+    /* start bit + data bits + parity bit + stop bits */
+    int bitsPerCharacter = 1 + self->dataBits + self->stopBits + ((self->parity == 'N') ? 0 : 1);
+
+    /* the data is queued behind the data that is not yet transmitted */
+    uint64_t transmitStartTime = Hal_getMonotonicTimeInNs();
+
+    if (self->transmitEndTime > transmitStartTime)
+        transmitStartTime = self->transmitEndTime;
+
+    self->transmitEndTime = transmitStartTime + getBitTime(self) * ((uint64_t) result * bitsPerCharacter);
 
     self->lastSentTime = Hal_getTimeInMs();
 
-    return result;
+    return (int) result;
 }
@@ -35,6 +35,7 @@
 #include <netinet/tcp.h> // required for TCP keepalive
 
 #include "hal_thread.h"
+#include "hal_time.h"
 #include "lib_memory.h"
 
 #ifndef DEBUG_SOCKET
@@ -53,7 +54,9 @@ struct sServerSocket {
 
 struct sHandleSet {
    fd_set handles;
+   fd_set writeHandles;
    int maxHandle;
+   int wakeUpFds[2]; /* pipe to interrupt Handleset_waitReady (-1 = wake-up not enabled) */
 };
 
 HandleSet
@@ -63,7 +66,10 @@ Handleset_new(void)
 
    if (result != NULL) {
        FD_ZERO(&result->handles);
+       FD_ZERO(&result->writeHandles);
        result->maxHandle = -1;
+       result->wakeUpFds[0] = -1;
+       result->wakeUpFds[1] = -1;
    }
    return result;
 }
@@ -72,6 +78,7 @@ void
 Handleset_reset(HandleSet self)
 {
     FD_ZERO(&self->handles);
+    FD_ZERO(&self->writeHandles);
     self->maxHandle = -1;
 }
 
@@ -79,7 +86,8 @@ Handleset_reset(HandleSet self)
 void
 Handleset_addSocket(HandleSet self, const Socket sock)
 {
-   if (self != NULL && sock != NULL && sock->fd != -1) {
+   /* select cannot monitor descriptors >= FD_SETSIZE */
+   if (self != NULL && sock != NULL && sock->fd != -1 && sock->fd < FD_SETSIZE) {
        FD_SET(sock->fd, &self->handles);
        if (sock->fd > self->maxHandle) {
            self->maxHandle = sock->fd;
@@ -87,17 +95,98 @@ Handleset_addSocket(HandleSet self, const Socket sock)
    }
 }
 
+void
+Handleset_addSocketForWrite(HandleSet self, const Socket sock)
+{
+   /* select cannot monitor descriptors >= FD_SETSIZE */
+   if (self != NULL && sock != NULL && sock->fd != -1 && sock->fd < FD_SETSIZE) {
+       FD_SET(sock->fd, &self->writeHandles);
+       if (sock->fd > self->maxHandle) {
+           self->maxHandle = sock->fd;
+       }
+   }
+}
+
+bool
+Handleset_enableWakeUp(HandleSet self)
+{
+    if (self == NULL)
+        return false;
+
+    if (self->wakeUpFds[0] != -1)
+        return true;
+
+    if (pipe(self->wakeUpFds) != 0) {
+        self->wakeUpFds[0] = -1;
+        self->wakeUpFds[1] = -1;
+
+        return false;
+    }
+
+    if (self->wakeUpFds[0] >= FD_SETSIZE) {
+        close(self->wakeUpFds[0]);
+        close(self->wakeUpFds[1]);
+
+        self->wakeUpFds[0] = -1;
+        self->wakeUpFds[1] = -1;
+
+        return false;
+    }
+
+    fcntl(self->wakeUpFds[0], F_SETFL, fcntl(self->wakeUpFds[0], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(self->wakeUpFds[1], F_SETFL, fcntl(self->wakeUpFds[1], F_GETFL, 0) | O_NONBLOCK);
+
+    return true;
+}
+
+void
+Handleset_wakeUp(HandleSet self)
+{
+    if ((self != NULL) && (self->wakeUpFds[1] != -1)) {
+        uint8_t wakeUpByte = 0;
+
+        /* pipe full -> a wake-up is already pending */
+        if (write(self->wakeUpFds[1], &wakeUpByte, 1) < 0)
+            return;
+    }
+}
+
+int
+Handleset_getWakeUpDescriptor(HandleSet self)
+{
+    return self->wakeUpFds[0];
+}
+
 int
 Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 {
    int result;
 
-   if (self != NULL && self->maxHandle >= 0) {
+   if ((self != NULL) && ((self->maxHandle >= 0) || (self->wakeUpFds[0] != -1))) {
        struct timeval timeout;
+       int maxHandle = self->maxHandle;
+
+       if (self->wakeUpFds[0] != -1) {
+           FD_SET(self->wakeUpFds[0], &self->handles);
+
+           if (self->wakeUpFds[0] > maxHandle)
+               maxHandle = self->wakeUpFds[0];
+       }
 
        timeout.tv_sec = timeoutMs / 1000;
        timeout.tv_usec = (timeoutMs % 1000) * 1000;
-       result = select(self->maxHandle + 1, &self->handles, NULL, NULL, &timeout);
+       result = select(maxHandle + 1, &self->handles, &self->writeHandles, NULL, &timeout);
+
+       if ((result > 0) && (self->wakeUpFds[0] != -1) && FD_ISSET(self->wakeUpFds[0], &self->handles)) {
+           uint8_t buf[16];
+
+           /* the wake-up is not counted as ready socket */
+           while (read(self->wakeUpFds[0], buf, sizeof(buf)) > 0);
+
+           FD_CLR(self->wakeUpFds[0], &self->handles);
+
+           result--;
+       }
    } else {
        result = -1;
    }
@@ -108,9 +197,31 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 void
 Handleset_destroy(HandleSet self)
 {
+   if (self->wakeUpFds[0] != -1) {
+       close(self->wakeUpFds[0]);
+       close(self->wakeUpFds[1]);
+   }
+
    GLOBAL_FREEMEM(self);
 }
 
+int
+Socket_getFileDescriptor(Socket self)
+{
+    return self->fd;
+}
+
+bool
+Socket_setKernelTls(Socket self, bool transmit, SocketTlsCryptoInfo* cryptoInfo)
+{
+    /* kernel TLS is not supported by this platform */
+    (void) self;
+    (void) transmit;
+    (void) cryptoInfo;
+
+    return false;
+}
+
 #if (CONFIG_ACTIVATE_TCP_KEEPALIVE == 1)
 static void
 activateKeepAlive(int sd)
@@ -436,6 +547,27 @@ Socket_read(Socket self, uint8_t* buf, int size)
     return read_bytes;
 }
 
+bool
+Socket_setReceiveTimestamps(Socket self, bool enable)
+{
+    /* receive time stamps are not supported by this platform */
+    (void) self;
+    (void) enable;
+
+    return false;
+}
+
+int
+Socket_readWithTimestamp(Socket self, uint8_t* buf, int size, uint64_t* timestamp)
+{
+    int readBytes = Socket_read(self, buf, size);
+
+    if (readBytes > 0)
+        *timestamp = Hal_getTimeInNs();
+
+    return readBytes;
+}
+
 int
 Socket_write(Socket self, uint8_t* buf, int size)
 {
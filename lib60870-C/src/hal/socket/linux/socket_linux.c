@@ -24,6 +24,8 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <sys/select.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <string.h>
@@ -32,8 +34,14 @@
 #include <fcntl.h>
 #include <netinet/tcp.h> /* required for TCP keepalive */
 #include <linux/version.h>
+#include <linux/net_tstamp.h> /* required for SO_TIMESTAMPING */
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,13,0))
+#include <linux/tls.h> /* required for kernel TLS */
+#endif
 
 #include "hal_thread.h"
+#include "hal_time.h"
 #include "lib_memory.h"
 
 #ifndef DEBUG_SOCKET
@@ -43,6 +51,7 @@
 struct sSocket {
     int fd;
     uint32_t connectTimeout;
+    bool receiveTimestamps;
 };
 
 struct sServerSocket {
@@ -51,8 +60,10 @@ struct sServerSocket {
 };
 
 struct sHandleSet {
-   fd_set handles;
-   int maxHandle;
+   struct pollfd* fds;
+   int numberOfFds;
+   int maxNumberOfFds;
+   int wakeUpFd; /* eventfd to interrupt Handleset_waitReady (-1 = wake-up not enabled) */
 };
 
 HandleSet
@@ -61,8 +72,10 @@ Handleset_new(void)
    HandleSet result = (HandleSet) GLOBAL_MALLOC(sizeof(struct sHandleSet));
 
    if (result != NULL) {
-       FD_ZERO(&result->handles);
-       result->maxHandle = -1;
+       result->fds = NULL;
+       result->numberOfFds = 0;
+       result->maxNumberOfFds = 0;
+       result->wakeUpFd = -1;
    }
    return result;
 }
@@ -70,19 +83,94 @@ Handleset_new(void)
 void
 Handleset_reset(HandleSet self)
 {
-    FD_ZERO(&self->handles);
-    self->maxHandle = -1;
+    self->numberOfFds = 0;
+}
+
+static bool
+reserveFds(HandleSet self, int numberOfFds)
+{
+    if (numberOfFds > self->maxNumberOfFds) {
+        int maxNumberOfFds = (self->maxNumberOfFds > 0) ? (self->maxNumberOfFds * 2) : 4;
+
+        while (maxNumberOfFds < numberOfFds)
+            maxNumberOfFds = maxNumberOfFds * 2;
+
+        struct pollfd* fds = (struct pollfd*) GLOBAL_REALLOC(self->fds, maxNumberOfFds * sizeof(struct pollfd));
+
+        if (fds == NULL)
+            return false;
+
+        self->fds = fds;
+        self->maxNumberOfFds = maxNumberOfFds;
+    }
+
+    return true;
+}
+
+/* poll has no limit for the descriptor numbers (select is limited to FD_SETSIZE) */
+static void
+addFd(HandleSet self, int fd, short events)
+{
+    int i;
+
+    for (i = 0; i < self->numberOfFds; i++) {
+        if (self->fds[i].fd == fd) {
+            self->fds[i].events |= events;
+            return;
+        }
+    }
+
+    if (reserveFds(self, self->numberOfFds + 1)) {
+        self->fds[self->numberOfFds].fd = fd;
+        self->fds[self->numberOfFds].events = events;
+        self->numberOfFds++;
+    }
 }
 
 void
 Handleset_addSocket(HandleSet self, const Socket sock)
 {
-   if (self != NULL && sock != NULL && sock->fd != -1) {
-       FD_SET(sock->fd, &self->handles);
-       if (sock->fd > self->maxHandle) {
-           self->maxHandle = sock->fd;
-       }
-   }
+   if (self != NULL && sock != NULL && sock->fd != -1)
+       addFd(self, sock->fd, POLLIN);
+}
+
+void
+Handleset_addSocketForWrite(HandleSet self, const Socket sock)
+{
+   if (self != NULL && sock != NULL && sock->fd != -1)
+       addFd(self, sock->fd, POLLOUT);
+}
+
+bool
+Handleset_enableWakeUp(HandleSet self)
+{
+    if (self == NULL)
+        return false;
+
+    if (self->wakeUpFd != -1)
+        return true;
+
+    self->wakeUpFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    return (self->wakeUpFd != -1);
+}
+
+void
+Handleset_wakeUp(HandleSet self)
+{
+    if ((self != NULL) && (self->wakeUpFd != -1)) {
+        uint64_t value = 1;
+
+        /* counter overflow -> a wake-up is already pending */
+        if (write(self->wakeUpFd, &value, sizeof(value)) < 0)
+            return;
+    }
+}
+
+int
+Handleset_getWakeUpDescriptor(HandleSet self)
+{
+    return self->wakeUpFd;
 }
 
 int
@@ -90,12 +178,31 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 {
    int result;
 
-   if ((self != NULL) && (self->maxHandle >= 0)) {
-       struct timeval timeout;
+   if ((self != NULL) && ((self->numberOfFds > 0) || (self->wakeUpFd != -1))) {
+       int numberOfFds = self->numberOfFds;
+
+       if (self->wakeUpFd != -1) {
+           if (reserveFds(self, numberOfFds + 1) == false)
+               return -1;
+
+           self->fds[numberOfFds].fd = self->wakeUpFd;
+           self->fds[numberOfFds].events = POLLIN;
+           numberOfFds++;
+       }
 
-       timeout.tv_sec = timeoutMs / 1000;
-       timeout.tv_usec = (timeoutMs % 1000) * 1000;
-       result = select(self->maxHandle + 1, &self->handles, NULL, NULL, &timeout);
+       result = poll(self->fds, numberOfFds, (int) timeoutMs);
+
+       if ((result > 0) && (self->wakeUpFd != -1) && (self->fds[self->numberOfFds].revents != 0)) {
+           uint64_t value;
+
+           /* the wake-up is not counted as ready socket */
+           if (read(self->wakeUpFd, &value, sizeof(value)) < 0) {
+               if (DEBUG_SOCKET)
+                   printf("Failed to reset the wake-up of the handle set\n");
+           }
+
+           result--;
+       }
    } else {
        result = -1;
    }
@@ -106,6 +213,10 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 void
 Handleset_destroy(HandleSet self)
 {
+   if (self->wakeUpFd != -1)
+       close(self->wakeUpFd);
+
+   GLOBAL_FREEMEM(self->fds);
    GLOBAL_FREEMEM(self);
 }
 
@@ -146,6 +257,82 @@ Socket_activateTcpKeepAlive(Socket self, int idleTime, int interval, int count)
 #endif /* SO_KEEPALIVE */
 }
 
+int
+Socket_getFileDescriptor(Socket self)
+{
+    return self->fd;
+}
+
+bool
+Socket_setKernelTls(Socket self, bool transmit, SocketTlsCryptoInfo* cryptoInfo)
+{
+#if defined(TLS_TX) && defined(TCP_ULP)
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+    /* attach the TLS upper layer protocol (fails with EEXIST when already attached) */
+    if (setsockopt(self->fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+        if (errno != EEXIST) {
+            if (DEBUG_SOCKET)
+                printf("SOCKET: kernel TLS not available (errno: %i)\n", errno);
+
+            return false;
+        }
+    }
+
+    int direction = transmit ? TLS_TX : TLS_RX;
+    int ret = -1;
+
+    if (cryptoInfo->keyLength == TLS_CIPHER_AES_GCM_128_KEY_SIZE) {
+        struct tls12_crypto_info_aes_gcm_128 info;
+
+        memset(&info, 0, sizeof(info));
+
+        info.info.version = TLS_1_2_VERSION;
+        info.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+        memcpy(info.key, cryptoInfo->key, TLS_CIPHER_AES_GCM_128_KEY_SIZE);
+        memcpy(info.salt, cryptoInfo->salt, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+        memcpy(info.iv, cryptoInfo->iv, TLS_CIPHER_AES_GCM_128_IV_SIZE);
+        memcpy(info.rec_seq, cryptoInfo->recordSequenceNumber, TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE);
+
+        ret = setsockopt(self->fd, SOL_TLS, direction, &info, sizeof(info));
+    }
+#if defined(TLS_CIPHER_AES_GCM_256)
+    else if (cryptoInfo->keyLength == TLS_CIPHER_AES_GCM_256_KEY_SIZE) {
+        struct tls12_crypto_info_aes_gcm_256 info;
+
+        memset(&info, 0, sizeof(info));
+
+        info.info.version = TLS_1_2_VERSION;
+        info.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+        memcpy(info.key, cryptoInfo->key, TLS_CIPHER_AES_GCM_256_KEY_SIZE);
+        memcpy(info.salt, cryptoInfo->salt, TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+        memcpy(info.iv, cryptoInfo->iv, TLS_CIPHER_AES_GCM_256_IV_SIZE);
+        memcpy(info.rec_seq, cryptoInfo->recordSequenceNumber, TLS_CIPHER_AES_GCM_256_REC_SEQ_SIZE);
+
+        ret = setsockopt(self->fd, SOL_TLS, direction, &info, sizeof(info));
+    }
+#endif
+
+    if (ret != 0) {
+        if (DEBUG_SOCKET)
+            printf("SOCKET: failed to set kernel TLS parameters (errno: %i)\n", errno);
+
+        return false;
+    }
+
+    return true;
+#else
+    (void) self;
+    (void) transmit;
+    (void) cryptoInfo;
+
+    return false;
+#endif
+}
+
 static bool
 prepareServerAddress(const char* address, int port, struct sockaddr_in* sockaddr)
 {
@@ -261,6 +448,9 @@ ServerSocket_accept(ServerSocket self)
         conSocket = TcpSocket_create();
         conSocket->fd = fd;
 
+        /* accepted sockets don't inherit O_NONBLOCK on Linux - writes must not block when the send buffer is full */
+        setSocketNonBlocking(conSocket);
+
         activateTcpNoDelay(conSocket);
     }
 
@@ -319,6 +509,7 @@ TcpSocket_create()
 
     self->fd = -1;
     self->connectTimeout = 5000;
+    self->receiveTimestamps = false;
 
     return self;
 }
@@ -509,6 +700,122 @@ Socket_read(Socket self, uint8_t* buf, int size)
     return read_bytes;
 }
 
+bool
+Socket_setReceiveTimestamps(Socket self, bool enable)
+{
+    self->receiveTimestamps = false;
+
+    if (self->fd == -1)
+        return false;
+
+#ifdef SO_TIMESTAMPING
+    /* software time stamps only - hardware time stamps use the PHC of the adapter, not CLOCK_REALTIME */
+    int flags = enable ? (SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE) : 0;
+
+    if (setsockopt(self->fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        self->receiveTimestamps = enable;
+        return true;
+    }
+#endif
+
+#ifdef SO_TIMESTAMPNS
+    int optVal = enable ? 1 : 0;
+
+    if (setsockopt(self->fd, SOL_SOCKET, SO_TIMESTAMPNS, &optVal, sizeof(optVal)) == 0) {
+        self->receiveTimestamps = enable;
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+static uint64_t
+getTimestampFromControlMessages(struct msghdr* msg)
+{
+    struct cmsghdr* cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+
+        if (cmsg->cmsg_level != SOL_SOCKET)
+            continue;
+
+#ifdef SCM_TIMESTAMPING
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            /* ts[0] = software time stamp (CLOCK_REALTIME), ts[2] = raw hardware time stamp (not used) */
+            struct timespec ts[3];
+
+            memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+
+            if (ts[0].tv_sec != 0 || ts[0].tv_nsec != 0)
+                return ((uint64_t) ts[0].tv_sec) * 1000000000LL + ts[0].tv_nsec;
+        }
+#endif
+
+#ifdef SCM_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+
+            return ((uint64_t) ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+        }
+#endif
+    }
+
+    return 0;
+}
+
+int
+Socket_readWithTimestamp(Socket self, uint8_t* buf, int size, uint64_t* timestamp)
+{
+    if (self->receiveTimestamps == false) {
+        int readBytes = Socket_read(self, buf, size);
+
+        if (readBytes > 0)
+            *timestamp = Hal_getTimeInNs();
+
+        return readBytes;
+    }
+
+    if (self->fd == -1)
+        return -1;
+
+    struct iovec iov;
+    struct msghdr msg;
+    char control[256];
+
+    iov.iov_base = buf;
+    iov.iov_len = size;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int read_bytes = recvmsg(self->fd, &msg, MSG_DONTWAIT);
+
+    if (read_bytes == 0)
+        return -1;
+
+    if (read_bytes == -1) {
+        if (errno == EAGAIN)
+            return 0;
+        else
+            return -1;
+    }
+
+    uint64_t receiveTime = getTimestampFromControlMessages(&msg);
+
+    if (receiveTime == 0)
+        receiveTime = Hal_getTimeInNs();
+
+    *timestamp = receiveTime;
+
+    return read_bytes;
+}
+
 int
 Socket_write(Socket self, uint8_t* buf, int size)
 {
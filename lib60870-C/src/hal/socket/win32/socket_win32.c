@@ -28,6 +28,7 @@
 #pragma comment (lib, "Ws2_32.lib")
 
 #include "hal_socket.h"
+#include "hal_time.h"
 #include "lib_memory.h"
 #include "lib60870_config.h"
 #include <stdio.h>
@@ -56,9 +57,17 @@ struct sServerSocket {
 
 struct sHandleSet {
    fd_set handles;
+   fd_set writeHandles;
    SOCKET maxHandle;
+   SOCKET wakeUpSocket; /* UDP socket connected to itself to interrupt Handleset_waitReady */
 };
 
+static bool wsaStartupCalled = false;
+static int socketCount = 0;
+
+static bool wsaStartUp();
+static void wsaShutdown();
+
 HandleSet
 Handleset_new(void)
 {
@@ -66,7 +75,9 @@ Handleset_new(void)
 
    if (result != NULL) {
        FD_ZERO(&result->handles);
+       FD_ZERO(&result->writeHandles);
        result->maxHandle = INVALID_SOCKET;
+       result->wakeUpSocket = INVALID_SOCKET;
    }
    return result;
 }
@@ -75,6 +86,7 @@ void
 Handleset_reset(HandleSet self)
 {
     FD_ZERO(&self->handles);
+    FD_ZERO(&self->writeHandles);
     self->maxHandle = INVALID_SOCKET;
 }
 
@@ -89,17 +101,51 @@ Handleset_addSocket(HandleSet self, const Socket sock)
    }
 }
 
+void
+Handleset_addSocketForWrite(HandleSet self, const Socket sock)
+{
+   if (self != NULL && sock != NULL && sock->fd != INVALID_SOCKET) {
+       FD_SET(sock->fd, &self->writeHandles);
+
+       if ((sock->fd > self->maxHandle) || (self->maxHandle == INVALID_SOCKET))
+           self->maxHandle = sock->fd;
+   }
+}
+
+int
+Handleset_getWakeUpDescriptor(HandleSet self)
+{
+    if (self->wakeUpSocket == INVALID_SOCKET)
+        return -1;
+
+    return (int) self->wakeUpSocket;
+}
+
 int
 Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 {
    int result;
 
-   if (self != NULL && self->maxHandle != INVALID_SOCKET) {
+   if (self != NULL && ((self->maxHandle != INVALID_SOCKET) || (self->wakeUpSocket != INVALID_SOCKET))) {
        struct timeval timeout;
 
+       if (self->wakeUpSocket != INVALID_SOCKET)
+           FD_SET(self->wakeUpSocket, &self->handles);
+
        timeout.tv_sec = timeoutMs / 1000;
        timeout.tv_usec = (timeoutMs % 1000) * 1000;
-       result = select(self->maxHandle + 1, &self->handles, NULL, NULL, &timeout);
+       result = select(0, &self->handles, &self->writeHandles, NULL, &timeout);
+
+       if ((result > 0) && (self->wakeUpSocket != INVALID_SOCKET) && FD_ISSET(self->wakeUpSocket, &self->handles)) {
+           char buf[16];
+
+           /* the wake-up is not counted as ready socket */
+           while (recv(self->wakeUpSocket, buf, sizeof(buf), 0) > 0);
+
+           FD_CLR(self->wakeUpSocket, &self->handles);
+
+           result--;
+       }
    } else {
        result = -1;
    }
@@ -110,12 +156,16 @@ Handleset_waitReady(HandleSet self, unsigned int timeoutMs)
 void
 Handleset_destroy(HandleSet self)
 {
+   if (self->wakeUpSocket != INVALID_SOCKET) {
+       closesocket(self->wakeUpSocket);
+
+       socketCount--;
+       wsaShutdown();
+   }
+
    GLOBAL_FREEMEM(self);
 }
 
-static bool wsaStartupCalled = false;
-static int socketCount = 0;
-
 void
 Socket_activateTcpKeepAlive(Socket self, int idleTime, int interval, int count)
 {
@@ -135,6 +185,23 @@ Socket_activateTcpKeepAlive(Socket self, int idleTime, int interval, int count)
      }
 }
 
+int
+Socket_getFileDescriptor(Socket self)
+{
+    return (int) self->fd;
+}
+
+bool
+Socket_setKernelTls(Socket self, bool transmit, SocketTlsCryptoInfo* cryptoInfo)
+{
+    /* kernel TLS is not supported by this platform */
+    (void) self;
+    (void) transmit;
+    (void) cryptoInfo;
+
+    return false;
+}
+
 static void
 setSocketNonBlocking(Socket self)
 {
@@ -207,6 +274,62 @@ static void wsaShutdown()
 	}
 }
 
+bool
+Handleset_enableWakeUp(HandleSet self)
+{
+    if (self == NULL)
+        return false;
+
+    if (self->wakeUpSocket != INVALID_SOCKET)
+        return true;
+
+    if (wsaStartUp() == false)
+        return false;
+
+    SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if (sock == INVALID_SOCKET) {
+        wsaShutdown();
+        return false;
+    }
+
+    struct sockaddr_in addr;
+    int addrLen = sizeof(addr);
+
+    memset((char *) &addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    /* the socket sends the wake-up datagrams to itself */
+    if ((bind(sock, (struct sockaddr*) &addr, sizeof(addr)) == SOCKET_ERROR) ||
+            (getsockname(sock, (struct sockaddr*) &addr, &addrLen) == SOCKET_ERROR) ||
+            (connect(sock, (struct sockaddr*) &addr, addrLen) == SOCKET_ERROR))
+    {
+        closesocket(sock);
+        wsaShutdown();
+        return false;
+    }
+
+    u_long mode = 1;
+    ioctlsocket(sock, FIONBIO, &mode);
+
+    self->wakeUpSocket = sock;
+    socketCount++;
+
+    return true;
+}
+
+void
+Handleset_wakeUp(HandleSet self)
+{
+    if ((self != NULL) && (self->wakeUpSocket != INVALID_SOCKET)) {
+        char wakeUpByte = 0;
+
+        send(self->wakeUpSocket, &wakeUpByte, 1, 0);
+    }
+}
+
 ServerSocket
 TcpServerSocket_create(const char* address, int port)
 {
@@ -491,6 +614,27 @@ Socket_read(Socket self, uint8_t* buf, int size)
     return bytes_read;
 }
 
+bool
+Socket_setReceiveTimestamps(Socket self, bool enable)
+{
+    /* receive time stamps are not supported by this platform */
+    (void) self;
+    (void) enable;
+
+    return false;
+}
+
+int
+Socket_readWithTimestamp(Socket self, uint8_t* buf, int size, uint64_t* timestamp)
+{
+    int readBytes = Socket_read(self, buf, size);
+
+    if (readBytes > 0)
+        *timestamp = Hal_getTimeInNs();
+
+    return readBytes;
+}
+
 int
 Socket_write(Socket self, uint8_t* buf, int size)
 {
@@ -19,7 +19,9 @@
  *  See COPYING file for the complete license text.
  */
 
+#include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
 #include <unistd.h>
 #include "hal_thread.h"
@@ -31,6 +33,9 @@ struct sThread {
    pthread_t pthread;
    int state;
    bool autodestroy;
+
+   bool hasAttributes;
+   struct sThreadAttributes attributes;
 };
 
 Semaphore
@@ -50,6 +55,21 @@ Semaphore_wait(Semaphore self)
     sem_wait((sem_t*) self);
 }
 
+/* sem_timedwait is not available on all BSD systems (e.g. macOS) */
+bool
+Semaphore_waitTimeout(Semaphore self, int timeoutInMs)
+{
+    while (sem_trywait((sem_t*) self) != 0) {
+        if (timeoutInMs <= 0)
+            return false;
+
+        usleep(1000);
+        timeoutInMs--;
+    }
+
+    return true;
+}
+
 void
 Semaphore_post(Semaphore self)
 {
@@ -72,11 +92,72 @@ Thread_create(ThreadExecutionFunction function, void* parameter, bool autodestro
         thread->function = function;
         thread->state = 0;
         thread->autodestroy = autodestroy;
+        thread->hasAttributes = false;
    }
 
    return thread;
 }
 
+Thread
+Thread_createEx(ThreadExecutionFunction function, void* parameter, bool autodestroy, ThreadAttributes attributes)
+{
+    Thread thread = Thread_create(function, parameter, autodestroy);
+
+    if ((thread != NULL) && (attributes != NULL)) {
+        thread->hasAttributes = true;
+        thread->attributes = *attributes;
+
+        /* CPU affinity and thread names are not portable across the BSDs -> ignored */
+        thread->attributes.cpuAffinity = 0;
+        thread->attributes.name = NULL;
+    }
+
+    return thread;
+}
+
+static int
+createPThread(Thread thread, void* (*startRoutine)(void*), void* arg)
+{
+    if (thread->hasAttributes == false)
+        return pthread_create(&thread->pthread, NULL, startRoutine, arg);
+
+    pthread_attr_t attr;
+    int result;
+
+    pthread_attr_init(&attr);
+
+    if (thread->attributes.stackSize > 0) {
+        size_t stackSize = (size_t) thread->attributes.stackSize;
+
+        if (stackSize < (size_t) PTHREAD_STACK_MIN)
+            stackSize = PTHREAD_STACK_MIN;
+
+        pthread_attr_setstacksize(&attr, stackSize);
+    }
+
+    if (thread->attributes.priority > 0) {
+        struct sched_param param;
+
+        param.sched_priority = thread->attributes.priority;
+
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    result = pthread_create(&thread->pthread, &attr, startRoutine, arg);
+
+    if ((result != 0) && (thread->attributes.priority > 0)) {
+        /* no permission for real-time scheduling -> fall back to default policy */
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        result = pthread_create(&thread->pthread, &attr, startRoutine, arg);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    return result;
+}
+
 static void*
 destroyAutomaticThread(void* parameter)
 {
@@ -92,14 +173,25 @@ destroyAutomaticThread(void* parameter)
 void
 Thread_start(Thread thread)
 {
+   int result;
+
    if (thread->autodestroy == true) {
-       pthread_create(&thread->pthread, NULL, destroyAutomaticThread, thread);
-       pthread_detach(thread->pthread);
+       result = createPThread(thread, destroyAutomaticThread, thread);
+
+       if (result == 0)
+           pthread_detach(thread->pthread);
+       else {
+           /* nobody else holds a reference to an automatically destroyed thread */
+           GLOBAL_FREEMEM(thread);
+           return;
+       }
    }
    else
-       pthread_create(&thread->pthread, NULL, thread->function, thread->parameter);
+       result = createPThread(thread, thread->function, thread->parameter);
 
-   thread->state = 1;
+   /* the thread is only joined when it was created */
+   if (result == 0)
+       thread->state = 1;
 }
 
 void
@@ -117,3 +209,9 @@ Thread_sleep(int millies)
 {
    usleep(millies * 1000);
 }
+
+uint64_t
+Thread_getCurrentThreadId(void)
+{
+    return (uint64_t) (uintptr_t) pthread_self();
+}
@@ -19,8 +19,17 @@
  *  See COPYING file for the complete license text.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for pthread_attr_setaffinity_np and pthread_setname_np */
+#endif
+
+#include <errno.h>
+#include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "hal_thread.h"
 #include "lib_memory.h"
@@ -32,6 +41,10 @@ struct sThread {
 	pthread_t pthread;
 	int state;
 	bool autodestroy;
+
+	bool hasAttributes;
+	struct sThreadAttributes attributes;
+	char name[16];
 };
 
 Semaphore
@@ -51,6 +64,29 @@ Semaphore_wait(Semaphore self)
     sem_wait((sem_t*) self);
 }
 
+bool
+Semaphore_waitTimeout(Semaphore self, int timeoutInMs)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    deadline.tv_sec += timeoutInMs / 1000;
+    deadline.tv_nsec += (long) (timeoutInMs % 1000) * 1000000L;
+
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (sem_timedwait((sem_t*) self, &deadline) != 0) {
+        if (errno != EINTR)
+            return false;
+    }
+
+    return true;
+}
+
 void
 Semaphore_post(Semaphore self)
 {
@@ -74,16 +110,120 @@ Thread_create(ThreadExecutionFunction function, void* parameter, bool autodestro
         thread->function = function;
         thread->state = 0;
         thread->autodestroy = autodestroy;
+        thread->hasAttributes = false;
+        thread->name[0] = 0;
 	}
 
 	return thread;
 }
 
+Thread
+Thread_createEx(ThreadExecutionFunction function, void* parameter, bool autodestroy, ThreadAttributes attributes)
+{
+    Thread thread = Thread_create(function, parameter, autodestroy);
+
+    if ((thread != NULL) && (attributes != NULL)) {
+        thread->hasAttributes = true;
+        thread->attributes = *attributes;
+
+        if (attributes->name) {
+            strncpy(thread->name, attributes->name, sizeof(thread->name) - 1);
+            thread->name[sizeof(thread->name) - 1] = 0;
+        }
+
+        thread->attributes.name = NULL;
+    }
+
+    return thread;
+}
+
+static int
+createPThread(Thread thread, void* (*startRoutine)(void*), void* arg)
+{
+    if (thread->hasAttributes == false)
+        return pthread_create(&thread->pthread, NULL, startRoutine, arg);
+
+    pthread_attr_t attr;
+    int result;
+
+    pthread_attr_init(&attr);
+
+    if (thread->attributes.stackSize > 0) {
+        size_t stackSize = (size_t) thread->attributes.stackSize;
+
+        if (stackSize < (size_t) PTHREAD_STACK_MIN)
+            stackSize = PTHREAD_STACK_MIN;
+
+        pthread_attr_setstacksize(&attr, stackSize);
+    }
+
+#ifdef __GLIBC__
+    if (thread->attributes.cpuAffinity != 0) {
+        cpu_set_t cpuSet;
+        int cpu;
+
+        CPU_ZERO(&cpuSet);
+
+        for (cpu = 0; cpu < 32; cpu++) {
+            if (thread->attributes.cpuAffinity & (1U << cpu))
+                CPU_SET(cpu, &cpuSet);
+        }
+
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuSet);
+    }
+#endif
+
+    if (thread->attributes.priority > 0) {
+        struct sched_param param;
+
+        param.sched_priority = thread->attributes.priority;
+
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    result = pthread_create(&thread->pthread, &attr, startRoutine, arg);
+
+    if ((result != 0) && (thread->attributes.priority > 0)) {
+        /* no permission for real-time scheduling -> fall back to default policy */
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        result = pthread_create(&thread->pthread, &attr, startRoutine, arg);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    return result;
+}
+
+static void
+setThreadName(Thread thread)
+{
+#ifdef __GLIBC__
+    if (thread->name[0] != 0)
+        pthread_setname_np(pthread_self(), thread->name);
+#else
+    (void) thread;
+#endif
+}
+
+static void*
+threadRunner(void* parameter)
+{
+    Thread thread = (Thread) parameter;
+
+    setThreadName(thread);
+
+    return thread->function(thread->parameter);
+}
+
 static void*
 destroyAutomaticThread(void* parameter)
 {
     Thread thread = (Thread) parameter;
 
+	setThreadName(thread);
+
 	thread->function(thread->parameter);
 
 	GLOBAL_FREEMEM(thread);
@@ -94,14 +234,25 @@ destroyAutomaticThread(void* parameter)
 void
 Thread_start(Thread thread)
 {
+	int result;
+
 	if (thread->autodestroy == true) {
-		pthread_create(&thread->pthread, NULL, destroyAutomaticThread, thread);
-		pthread_detach(thread->pthread);
+		result = createPThread(thread, destroyAutomaticThread, thread);
+
+		if (result == 0)
+			pthread_detach(thread->pthread);
+		else {
+			/* nobody else holds a reference to an automatically destroyed thread */
+			GLOBAL_FREEMEM(thread);
+			return;
+		}
 	}
 	else
-		pthread_create(&thread->pthread, NULL, thread->function, thread->parameter);
+		result = createPThread(thread, threadRunner, thread);
 
-	thread->state = 1;
+	/* the thread is only joined when it was created */
+	if (result == 0)
+		thread->state = 1;
 }
 
 void
@@ -120,3 +271,9 @@ Thread_sleep(int millies)
 	usleep(millies * 1000);
 }
 
+uint64_t
+Thread_getCurrentThreadId(void)
+{
+    return (uint64_t) (uintptr_t) pthread_self();
+}
+
@@ -56,8 +56,16 @@ threadRunner(LPVOID parameter)
 
 Thread
 Thread_create(ThreadExecutionFunction function, void* parameter, bool autodestroy)
+{
+	return Thread_createEx(function, parameter, autodestroy, NULL);
+}
+
+Thread
+Thread_createEx(ThreadExecutionFunction function, void* parameter, bool autodestroy, ThreadAttributes attributes)
 {
 	DWORD threadId;
+	SIZE_T stackSize = 0;
+	DWORD flags = CREATE_SUSPENDED;
 	Thread thread = (Thread) GLOBAL_MALLOC(sizeof(struct sThread));
 
 	thread->parameter = parameter;
@@ -65,10 +73,36 @@ Thread_create(ThreadExecutionFunction function, void* parameter, bool autodestro
 	thread->state = 0;
 	thread->autodestroy = autodestroy;
 
+	if (attributes && (attributes->stackSize > 0)) {
+		stackSize = (SIZE_T) attributes->stackSize;
+		flags |= STACK_SIZE_PARAM_IS_A_RESERVATION;
+	}
+
 	if (autodestroy == true)
-		thread->handle = CreateThread(0, 0, destroyAutomaticThreadRunner, thread, CREATE_SUSPENDED, &threadId);
+		thread->handle = CreateThread(0, stackSize, destroyAutomaticThreadRunner, thread, flags, &threadId);
 	else
-		thread->handle = CreateThread(0, 0, threadRunner, thread, CREATE_SUSPENDED, &threadId);
+		thread->handle = CreateThread(0, stackSize, threadRunner, thread, flags, &threadId);
+
+	if (attributes && thread->handle) {
+		if (attributes->cpuAffinity != 0)
+			SetThreadAffinityMask(thread->handle, (DWORD_PTR) attributes->cpuAffinity);
+
+		/* thread names are not supported by all windows versions -> ignored */
+
+		/* map the real-time priority range 1-99 to the windows thread priorities above normal */
+		if (attributes->priority > 0) {
+			int priority;
+
+			if (attributes->priority < 25)
+				priority = THREAD_PRIORITY_ABOVE_NORMAL;
+			else if (attributes->priority < 75)
+				priority = THREAD_PRIORITY_HIGHEST;
+			else
+				priority = THREAD_PRIORITY_TIME_CRITICAL;
+
+			SetThreadPriority(thread->handle, priority);
+		}
+	}
 
 	return thread;
 }
@@ -76,8 +110,14 @@ Thread_create(ThreadExecutionFunction function, void* parameter, bool autodestro
 void
 Thread_start(Thread thread)
 {
-	thread->state = 1;
-	ResumeThread(thread->handle);
+	if (thread->handle) {
+		thread->state = 1;
+		ResumeThread(thread->handle);
+	}
+	else if (thread->autodestroy) {
+		/* nobody else holds a reference to an automatically destroyed thread */
+		GLOBAL_FREEMEM(thread);
+	}
 }
 
 void
@@ -97,10 +137,16 @@ Thread_sleep(int millies)
 	Sleep(millies);
 }
 
+uint64_t
+Thread_getCurrentThreadId(void)
+{
+    return (uint64_t) GetCurrentThreadId();
+}
+
 Semaphore
 Semaphore_create(int initialValue)
 {
-    HANDLE self = CreateSemaphore(NULL, 1, 1, NULL);
+    HANDLE self = CreateSemaphore(NULL, initialValue, MAXLONG, NULL);
 
     return self;
 }
@@ -112,6 +158,12 @@ Semaphore_wait(Semaphore self)
     WaitForSingleObject((HANDLE) self, INFINITE);
 }
 
+bool
+Semaphore_waitTimeout(Semaphore self, int timeoutInMs)
+{
+    return (WaitForSingleObject((HANDLE) self, (DWORD) timeoutInMs) == WAIT_OBJECT_0);
+}
+
 void
 Semaphore_post(Semaphore self)
 {
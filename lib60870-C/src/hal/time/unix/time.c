@@ -34,6 +34,26 @@ Hal_getTimeInMs()
 
 	return ((uint64_t) tp.tv_sec) * 1000LL + (tp.tv_nsec / 1000000);
 }
+
+uint64_t
+Hal_getTimeInNs()
+{
+	struct timespec tp;
+
+	clock_gettime(CLOCK_REALTIME, &tp);
+
+	return ((uint64_t) tp.tv_sec) * 1000000000LL + tp.tv_nsec;
+}
+
+uint64_t
+Hal_getMonotonicTimeInNs()
+{
+	struct timespec tp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+
+	return ((uint64_t) tp.tv_sec) * 1000000000LL + tp.tv_nsec;
+}
 #else
 
 #include <sys/time.h>
@@ -48,5 +68,24 @@ Hal_getTimeInMs()
     return ((uint64_t) now.tv_sec * 1000LL) + (now.tv_usec / 1000);
 }
 
-#endif
+uint64_t
+Hal_getTimeInNs()
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+
+    return ((uint64_t) now.tv_sec * 1000000000LL) + ((uint64_t) now.tv_usec * 1000LL);
+}
+
+uint64_t
+Hal_getMonotonicTimeInNs()
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+
+    return ((uint64_t) now.tv_sec * 1000000000LL) + ((uint64_t) now.tv_usec * 1000LL);
+}
 
+#endif
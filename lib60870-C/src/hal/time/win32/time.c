@@ -41,3 +41,33 @@ Hal_getTimeInMs()
 
 	return (now / 10000LL) - DIFF_TO_UNIXTIME;
 }
+
+uint64_t
+Hal_getTimeInNs()
+{
+	FILETIME ft;
+	uint64_t now;
+
+	static const uint64_t DIFF_TO_UNIXTIME = 116444736000000000LL;
+
+	GetSystemTimeAsFileTime(&ft);
+
+	now = (LONGLONG)ft.dwLowDateTime + ((LONGLONG)(ft.dwHighDateTime) << 32LL);
+
+	return (now - DIFF_TO_UNIXTIME) * 100LL;
+}
+
+uint64_t
+Hal_getMonotonicTimeInNs()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t) ((counter.QuadPart / frequency.QuadPart) * 1000000000LL +
+			((counter.QuadPart % frequency.QuadPart) * 1000000000LL) / frequency.QuadPart);
+}
@@ -39,12 +39,16 @@
 #define MBEDTLS_CIPHER_MODE_CBC
 #define MBEDTLS_PKCS1_V15
 #define MBEDTLS_KEY_EXCHANGE_RSA_ENABLED
+#define MBEDTLS_SSL_PROTO_TLS1_2
 #define MBEDTLS_SSL_PROTO_TLS1_1
 #define MBEDTLS_SSL_PROTO_TLS1
 #define MBEDTLS_SSL_RENEGOTIATION
 
 #define MBEDTLS_TLS_DEFAULT_ALLOW_SHA1_IN_CERTIFICATES
 
+/* required to hand over the TLS 1.2 AES-GCM record layer to the kernel (kTLS) */
+#define MBEDTLS_SSL_EXPORT_KEYS
+
 /* mbed TLS modules */
 #define MBEDTLS_AES_C
 #define MBEDTLS_ASN1_PARSE_C
@@ -54,6 +58,7 @@
 #define MBEDTLS_CTR_DRBG_C
 /* #define MBEDTLS_DES_C */
 #define MBEDTLS_ENTROPY_C
+#define MBEDTLS_GCM_C
 #define MBEDTLS_MD_C
 #define MBEDTLS_MD5_C
 #define MBEDTLS_NET_C
@@ -52,6 +52,9 @@ struct sTLSConfiguration {
 
     /* TLS session renegotioation time in milliseconds */
     int renegotiationTimeInMs;
+
+    /* install session keys into the kernel when possible */
+    bool kernelTlsOffload;
 };
 
 struct sTLSSocket {
@@ -62,6 +65,17 @@ struct sTLSSocket {
     bool storePeerCert;
     uint8_t* peerCert;
     int peerCertLength;
+
+    /* key material exported by the handshake (client key, server key, client salt, server salt) */
+    uint8_t keyBlock[2 * 32 + 2 * 4];
+    int keyLength;
+
+    /* record layer of the direction is handled by the kernel */
+    bool kernelTlsTx;
+    bool kernelTlsRx;
+
+    /* size of the data of a record that is not yet completely sent (has to be passed again to mbedtls_ssl_write) */
+    int pendingWriteLength;
 };
 
 static bool
@@ -181,6 +195,8 @@ TLSConfiguration_create()
         /* default behavior is to allow all certificates that are signed by the CA */
         self->chainValidation = true;
         self->allowOnlyKnownCertificates = false;
+
+        self->kernelTlsOffload = false;
     }
 
     return self;
@@ -312,6 +328,12 @@ TLSConfiguration_setRenegotiationTime(TLSConfiguration self, int timeInMs)
     self->renegotiationTimeInMs = timeInMs;
 }
 
+void
+TLSConfiguration_setKernelTlsOffload(TLSConfiguration self, bool enable)
+{
+    self->kernelTlsOffload = enable;
+}
+
 void
 TLSConfiguration_destroy(TLSConfiguration self)
 {
@@ -348,6 +370,91 @@ readFunction(void* ctx, unsigned char* buf, size_t len)
     return ret;
 }
 
+static int
+writeFunction(void* ctx, const unsigned char* buf, size_t len)
+{
+    int ret = Socket_write((Socket) ctx, (uint8_t*) buf, (int) len);
+
+    /* send buffer of the non-blocking socket is full */
+    if ((ret == 0) && (len > 0)) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+
+    return ret;
+}
+
+#if defined(MBEDTLS_SSL_EXPORT_KEYS)
+static int
+exportKeys(void* parameter, const unsigned char* masterSecret, const unsigned char* keyBlock,
+        size_t macLength, size_t keyLength, size_t ivLength)
+{
+    TLSSocket self = (TLSSocket) parameter;
+
+    (void) masterSecret;
+    (void) ivLength;
+
+    /* only AEAD cipher suites (no MAC key) with AES-128/256 can be offloaded */
+    if ((macLength == 0) && ((keyLength == 16) || (keyLength == 32))) {
+
+        /* key block: client write key, server write key, client write IV, server write IV
+         * (for GCM only the first 4 bytes of the IVs (implicit nonce) are used) */
+        memcpy(self->keyBlock, keyBlock, 2 * keyLength + 2 * 4);
+        self->keyLength = (int) keyLength;
+    }
+    else
+        self->keyLength = 0;
+
+    return 0;
+}
+
+static void
+installKernelTlsKeys(TLSSocket self)
+{
+    if (self->keyLength == 0)
+        return;
+
+    if (strcmp(mbedtls_ssl_get_version(&(self->ssl)), "TLSv1.2") != 0)
+        return;
+
+    if (strstr(mbedtls_ssl_get_ciphersuite(&(self->ssl)), "-GCM-") == NULL)
+        return;
+
+    bool isServer = (self->conf.endpoint == MBEDTLS_SSL_IS_SERVER);
+
+    uint8_t* clientKey = self->keyBlock;
+    uint8_t* serverKey = self->keyBlock + self->keyLength;
+    uint8_t* clientSalt = self->keyBlock + 2 * self->keyLength;
+    uint8_t* serverSalt = clientSalt + 4;
+
+    SocketTlsCryptoInfo info;
+
+    info.keyLength = self->keyLength;
+
+    /* transmit direction */
+    memcpy(info.key, isServer ? serverKey : clientKey, self->keyLength);
+    memcpy(info.salt, isServer ? serverSalt : clientSalt, 4);
+    memcpy(info.recordSequenceNumber, self->ssl.out_ctr, 8);
+    memcpy(info.iv, self->ssl.out_ctr, 8);
+
+    self->kernelTlsTx = Socket_setKernelTls(self->socket, true, &info);
+
+    /* receive direction - only possible when no received data is buffered by mbedtls */
+    if (self->kernelTlsTx && (self->ssl.in_left == 0) && (mbedtls_ssl_get_bytes_avail(&(self->ssl)) == 0)) {
+        memcpy(info.key, isServer ? clientKey : serverKey, self->keyLength);
+        memcpy(info.salt, isServer ? clientSalt : serverSalt, 4);
+        memcpy(info.recordSequenceNumber, self->ssl.in_ctr, 8);
+        memcpy(info.iv, self->ssl.in_ctr, 8);
+
+        self->kernelTlsRx = Socket_setKernelTls(self->socket, false, &info);
+    }
+
+    DEBUG_PRINT("TLS", "kernel TLS offload (tx: %i rx: %i)\n", self->kernelTlsTx, self->kernelTlsRx);
+
+    memset(&info, 0, sizeof(info));
+    memset(self->keyBlock, 0, sizeof(self->keyBlock));
+}
+#endif /* defined(MBEDTLS_SSL_EXPORT_KEYS) */
+
 TLSSocket
 TLSSocket_create(Socket socket, TLSConfiguration configuration, bool storeClientCert)
 {
@@ -365,6 +472,11 @@ TLSSocket_create(Socket socket, TLSConfiguration configuration, bool storeClient
 
         mbedtls_ssl_conf_verify(&(self->conf), verifyCertificate, (void*) self);
 
+#if defined(MBEDTLS_SSL_EXPORT_KEYS)
+        if (configuration->kernelTlsOffload)
+            mbedtls_ssl_conf_export_keys_cb(&(self->conf), exportKeys, (void*) self);
+#endif
+
         int ret;
 
         mbedtls_ssl_conf_ca_chain( &(self->conf), &(configuration->cacerts), NULL );
@@ -379,7 +491,7 @@ TLSSocket_create(Socket socket, TLSConfiguration configuration, bool storeClient
         if (ret != 0)
             DEBUG_PRINT("TLS", "mbedtls_ssl_setup returned %d\n", ret);
 
-        mbedtls_ssl_set_bio(&(self->ssl), socket, (mbedtls_ssl_send_t*) Socket_write,
+        mbedtls_ssl_set_bio(&(self->ssl), socket, (mbedtls_ssl_send_t*) writeFunction,
                 (mbedtls_ssl_recv_t*) readFunction, NULL);
 
         while( (ret = mbedtls_ssl_handshake(&(self->ssl)) ) != 0 )
@@ -396,6 +508,11 @@ TLSSocket_create(Socket socket, TLSConfiguration configuration, bool storeClient
                 return NULL;
             }
         }
+
+#if defined(MBEDTLS_SSL_EXPORT_KEYS)
+        if (configuration->kernelTlsOffload)
+            installKernelTlsKeys(self);
+#endif
     }
 
     return self;
@@ -413,6 +530,10 @@ TLSSocket_getPeerCertificate(TLSSocket self, int* certSize)
 bool
 TLSSocket_performHandshake(TLSSocket self)
 {
+    /* the session keys are owned by the kernel */
+    if (self->kernelTlsTx)
+        return false;
+
     if (mbedtls_ssl_renegotiate(&(self->ssl)) == 0)
         return true;
     else
@@ -422,6 +543,10 @@ TLSSocket_performHandshake(TLSSocket self)
 int
 TLSSocket_read(TLSSocket self, uint8_t* buf, int size)
 {
+    /* records are decrypted by the kernel (non-application data records cause an error) */
+    if (self->kernelTlsRx)
+        return Socket_read(self->socket, buf, size);
+
     int ret = mbedtls_ssl_read(&(self->ssl), buf, size);
 
     if ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE))
@@ -454,19 +579,34 @@ TLSSocket_write(TLSSocket self, uint8_t* buf, int size)
     int ret;
     int len = size;
 
-    while ((ret = mbedtls_ssl_write(&(self->ssl), buf, len)) <= 0)
+    /* records are encrypted by the kernel */
+    if (self->kernelTlsTx)
+        return Socket_write(self->socket, buf, size);
+
+    /* the record of the previous call is still in the output buffer of mbedtls -> the same data has
+     * to be passed again. Otherwise mbedtls only sends the old record and reports the new data as written */
+    if ((self->pendingWriteLength > 0) && (len > self->pendingWriteLength))
+        len = self->pendingWriteLength;
+
+    ret = mbedtls_ssl_write(&(self->ssl), buf, len);
+
+    if ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE)) {
+        self->pendingWriteLength = len;
+        return 0;
+    }
+
+    self->pendingWriteLength = 0;
+
+    if (ret == MBEDTLS_ERR_NET_CONN_RESET)
     {
-        if (ret == MBEDTLS_ERR_NET_CONN_RESET)
-        {
-            DEBUG_PRINT("TLS", "peer closed the connection\n");
-            return -1;
-        }
+        DEBUG_PRINT("TLS", "peer closed the connection\n");
+        return -1;
+    }
 
-        if ((ret != MBEDTLS_ERR_SSL_WANT_READ) && (ret != MBEDTLS_ERR_SSL_WANT_WRITE))
-        {
-            DEBUG_PRINT("TLS", "mbedtls_ssl_write returned %d\n", ret);
-            return -1;
-        }
+    if (ret < 0)
+    {
+        DEBUG_PRINT("TLS", "mbedtls_ssl_write returned %d\n", ret);
+        return -1;
     }
 
     len = ret;
@@ -479,12 +619,19 @@ TLSSocket_close(TLSSocket self)
 {
     int ret;
 
-    while ((ret = mbedtls_ssl_close_notify(&(self->ssl))) < 0)
-    {
-        if ((ret != MBEDTLS_ERR_SSL_WANT_READ) && (ret != MBEDTLS_ERR_SSL_WANT_WRITE))
+    /* close notify alert cannot be sent by mbedtls when the kernel owns the transmit keys */
+    if (self->kernelTlsTx == false) {
+        while ((ret = mbedtls_ssl_close_notify(&(self->ssl))) < 0)
         {
-            DEBUG_PRINT("TLS", "mbedtls_ssl_close_notify returned %d\n", ret);
-            break;
+            /* send buffer full -> don't wait for the peer (the alert is optional) */
+            if (ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+                break;
+
+            if (ret != MBEDTLS_ERR_SSL_WANT_READ)
+            {
+                DEBUG_PRINT("TLS", "mbedtls_ssl_close_notify returned %d\n", ret);
+                break;
+            }
         }
     }
 
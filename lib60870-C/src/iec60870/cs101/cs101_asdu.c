@@ -135,6 +135,7 @@ CS101_ASDU_initializeStatic(CS101_StaticASDU self, CS101_AppLayerParameters para
     self->payload = self->encodedData + asduHeaderLength;
     self->payloadSize = 0;
     self->parameters = parameters;
+    self->receiveTimestamp = 0;
 
     return (CS101_ASDU) self;
 }
@@ -169,6 +170,7 @@ CS101_ASDU_createFromBuffer(CS101_AppLayerParameters parameters, uint8_t* msg, i
 
         self->payload = msg + asduHeaderLength;
         self->payloadSize = msgLength - asduHeaderLength;
+        self->receiveTimestamp = 0;
     }
 
     return self;
@@ -186,6 +188,18 @@ CS101_ASDU_getPayloadSize(CS101_ASDU self)
     return self->payloadSize;
 }
 
+uint64_t
+CS101_ASDU_getReceiveTimestamp(CS101_ASDU self)
+{
+    return self->receiveTimestamp;
+}
+
+void
+CS101_ASDU_setReceiveTimestamp(CS101_ASDU self, uint64_t timestamp)
+{
+    self->receiveTimestamp = timestamp;
+}
+
 bool
 CS101_ASDU_addPayload(CS101_ASDU self, uint8_t* buffer, int size)
 {
@@ -0,0 +1,171 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include "cs101_asdu_dispatcher.h"
+#include "lib_memory.h"
+#include "lib60870_config.h"
+#include "lib60870_internal.h"
+
+typedef struct {
+    uint32_t key; /* 0 = empty slot */
+    CS101_ASDUReceivedHandler handler;
+    void* parameter;
+} DispatchEntry;
+
+struct sCS101_ASDUDispatcher {
+    DispatchEntry* entries;
+    int tableSize; /* power of two */
+    int maxNumberOfHandlers;
+    int numberOfHandlers;
+
+    /* skip lookups of wildcard entries when there are none */
+    bool hasAnyTypeHandlers;
+    bool hasAnyCAHandlers;
+
+    CS101_ASDUReceivedHandler defaultHandler;
+    void* defaultHandlerParameter;
+};
+
+CS101_ASDUDispatcher
+CS101_ASDUDispatcher_create(int maxNumberOfHandlers)
+{
+    CS101_ASDUDispatcher self = (CS101_ASDUDispatcher) GLOBAL_CALLOC(1, sizeof(struct sCS101_ASDUDispatcher));
+
+    if (self) {
+        int tableSize = 16;
+
+        if (maxNumberOfHandlers < 1)
+            maxNumberOfHandlers = 1;
+
+        /* keep the load factor below 0.5 to have short probe sequences */
+        while (tableSize < (maxNumberOfHandlers * 2))
+            tableSize = tableSize * 2;
+
+        self->entries = (DispatchEntry*) GLOBAL_CALLOC(tableSize, sizeof(DispatchEntry));
+
+        if (self->entries == NULL) {
+            GLOBAL_FREEMEM(self);
+            return NULL;
+        }
+
+        self->tableSize = tableSize;
+        self->maxNumberOfHandlers = maxNumberOfHandlers;
+    }
+
+    return self;
+}
+
+void
+CS101_ASDUDispatcher_destroy(CS101_ASDUDispatcher self)
+{
+    if (self) {
+        GLOBAL_FREEMEM(self->entries);
+        GLOBAL_FREEMEM(self);
+    }
+}
+
+static uint32_t
+getKey(int ca, int typeId)
+{
+    uint32_t caPart = (ca == CS101_ASDU_DISPATCHER_ANY) ? 0x10000 : (uint32_t) (ca & 0xffff);
+    uint32_t typePart = (typeId == CS101_ASDU_DISPATCHER_ANY) ? 0x100 : (uint32_t) (typeId & 0xff);
+
+    return ((caPart << 9) | typePart) + 1;
+}
+
+static DispatchEntry*
+lookupEntry(CS101_ASDUDispatcher self, uint32_t key)
+{
+    int mask = self->tableSize - 1;
+
+    /* Fibonacci hashing */
+    int index = (int) (((key * 0x9E3779B9U) >> 16) & (uint32_t) mask);
+
+    while (self->entries[index].key != 0) {
+        if (self->entries[index].key == key)
+            return &(self->entries[index]);
+
+        index = (index + 1) & mask;
+    }
+
+    /* empty slot where the key would be stored */
+    return &(self->entries[index]);
+}
+
+bool
+CS101_ASDUDispatcher_addHandler(CS101_ASDUDispatcher self, int ca, int typeId, CS101_ASDUReceivedHandler handler,
+        void* parameter)
+{
+    uint32_t key = getKey(ca, typeId);
+
+    DispatchEntry* entry = lookupEntry(self, key);
+
+    if (entry->key == 0) {
+        if (self->numberOfHandlers >= self->maxNumberOfHandlers)
+            return false;
+
+        entry->key = key;
+        self->numberOfHandlers++;
+    }
+
+    entry->handler = handler;
+    entry->parameter = parameter;
+
+    if (typeId == CS101_ASDU_DISPATCHER_ANY)
+        self->hasAnyTypeHandlers = true;
+
+    if (ca == CS101_ASDU_DISPATCHER_ANY)
+        self->hasAnyCAHandlers = true;
+
+    return true;
+}
+
+void
+CS101_ASDUDispatcher_setDefaultHandler(CS101_ASDUDispatcher self, CS101_ASDUReceivedHandler handler, void* parameter)
+{
+    self->defaultHandler = handler;
+    self->defaultHandlerParameter = parameter;
+}
+
+bool
+CS101_ASDUDispatcher_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    CS101_ASDUDispatcher self = (CS101_ASDUDispatcher) parameter;
+
+    int ca = CS101_ASDU_getCA(asdu);
+    int typeId = (int) CS101_ASDU_getTypeID(asdu);
+
+    DispatchEntry* entry = lookupEntry(self, getKey(ca, typeId));
+
+    if ((entry->key == 0) && self->hasAnyTypeHandlers)
+        entry = lookupEntry(self, getKey(ca, CS101_ASDU_DISPATCHER_ANY));
+
+    if ((entry->key == 0) && self->hasAnyCAHandlers)
+        entry = lookupEntry(self, getKey(CS101_ASDU_DISPATCHER_ANY, typeId));
+
+    if ((entry->key != 0) && (entry->handler != NULL))
+        return entry->handler(entry->parameter, address, asdu);
+
+    if (self->defaultHandler)
+        return self->defaultHandler(self->defaultHandlerParameter, address, asdu);
+
+    return false;
+}
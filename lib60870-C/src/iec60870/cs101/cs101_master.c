@@ -61,6 +61,10 @@ struct sCS101_Master
 #if (CONFIG_USE_THREADS == 1)
     bool isRunning;
     Thread workerThread;
+
+    bool useThreadAttributes;
+    struct sThreadAttributes threadAttributes;
+    char threadName[16];
 #endif
 };
 
@@ -103,6 +107,9 @@ IBalancedApplicationLayer_HandleReceivedData (void* parameter, uint8_t* msg, boo
 
     CS101_ASDU asdu = CS101_ASDU_createFromBuffer(&(self->alParameters), msg + userDataStart, userDataLength);
 
+    if (asdu)
+        CS101_ASDU_setReceiveTimestamp(asdu, SerialTransceiverFT12_getLastFrameTimestamp(self->transceiver));
+
     if (self->asduReceivedHandler)
         self->asduReceivedHandler(self->asduReceivedHandlerParameter, 0, asdu);
 
@@ -141,6 +148,9 @@ IPrimaryApplicationLayer_UserData(void* parameter, int slaveAddress, uint8_t* ms
 
     CS101_ASDU asdu = CS101_ASDU_createFromBuffer(&(self->alParameters), msg + start, length);
 
+    if (asdu)
+        CS101_ASDU_setReceiveTimestamp(asdu, SerialTransceiverFT12_getLastFrameTimestamp(self->transceiver));
+
     if (self->asduReceivedHandler)
         self->asduReceivedHandler(self->asduReceivedHandlerParameter, slaveAddress, asdu);
 
@@ -215,6 +225,7 @@ CS101_Master_createEx(SerialPort serialPort, LinkLayerParameters llParameters, C
 #if (CONFIG_USE_THREADS == 1)
         self->isRunning = false;
         self->workerThread = NULL;
+        self->useThreadAttributes = false;
 #endif
 
     }
@@ -260,7 +271,8 @@ CS101_Master_start(CS101_Master self)
 {
 #if (CONFIG_USE_THREADS == 1)
     if (self->workerThread == NULL) {
-        self->workerThread = Thread_create(masterMainThread, self, false);
+        self->workerThread = Thread_createEx(masterMainThread, self, false,
+                self->useThreadAttributes ? &(self->threadAttributes) : NULL);
         Thread_start(self->workerThread);
     }
 #endif /* (CONFIG_USE_THREADS == 1) */
@@ -519,6 +531,25 @@ CS101_Master_setRawMessageHandler(CS101_Master self, IEC60870_RawMessageHandler
     SerialTransceiverFT12_setRawMessageHandler(self->transceiver, handler, parameter);
 }
 
+#if (CONFIG_USE_THREADS == 1)
+void
+CS101_Master_setThreadAttributes(CS101_Master self, ThreadAttributes attributes)
+{
+    if (attributes) {
+        self->threadAttributes = *attributes;
+        self->useThreadAttributes = true;
+
+        if (attributes->name) {
+            strncpy(self->threadName, attributes->name, sizeof(self->threadName) - 1);
+            self->threadName[sizeof(self->threadName) - 1] = 0;
+            self->threadAttributes.name = self->threadName;
+        }
+    }
+    else
+        self->useThreadAttributes = false;
+}
+#endif /* (CONFIG_USE_THREADS == 1) */
+
 void
 CS101_Master_setIdleTimeout(CS101_Master self, int timeoutInMs)
 {
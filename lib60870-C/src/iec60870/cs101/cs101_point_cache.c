@@ -0,0 +1,659 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <string.h>
+
+#include "cs101_point_cache.h"
+#include "cs101_asdu_internal.h"
+#include "hal_thread.h"
+#include "hal_time.h"
+#include "lib_memory.h"
+#include "lib60870_config.h"
+#include "lib60870_internal.h"
+#include "platform_endian.h"
+
+/* full memory barrier for the sequence counters of the lock-free readers */
+#if defined(__GNUC__)
+#define MEMORY_BARRIER() __sync_synchronize()
+#elif defined(_MSC_VER)
+#include <windows.h>
+
+#define MEMORY_BARRIER() MemoryBarrier()
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+
+#define MEMORY_BARRIER() atomic_thread_fence(memory_order_seq_cst)
+#else
+#error "The point cache requires a memory barrier (GCC, MSVC, or C11 atomics)"
+#endif
+
+#ifndef CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS
+#define CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS 32
+#endif
+
+/* value encoding of the supported monitoring direction types */
+typedef enum {
+    VALUE_SIQ,        /* single point with quality */
+    VALUE_DIQ,        /* double point with quality */
+    VALUE_VTI,        /* step position + QDS */
+    VALUE_BSI,        /* bitstring of 32 bit + QDS */
+    VALUE_NVA,        /* normalized value + QDS */
+    VALUE_NVA_NO_QDS, /* normalized value without quality */
+    VALUE_SVA,        /* scaled value + QDS */
+    VALUE_FLOAT,      /* short floating point value + QDS */
+    VALUE_BCR         /* binary counter reading */
+} ValueEncoding;
+
+typedef struct {
+    IEC60870_5_TypeID typeId;
+    ValueEncoding encoding;
+    int valueSize; /* size of the value including the quality descriptor */
+    int timeSize;  /* 0, 3 (CP24Time2a) or 7 (CP56Time2a) */
+} PointTypeInfo;
+
+static const PointTypeInfo pointTypes[] = {
+    { M_SP_NA_1, VALUE_SIQ, 1, 0 },
+    { M_SP_TA_1, VALUE_SIQ, 1, 3 },
+    { M_DP_NA_1, VALUE_DIQ, 1, 0 },
+    { M_DP_TA_1, VALUE_DIQ, 1, 3 },
+    { M_ST_NA_1, VALUE_VTI, 2, 0 },
+    { M_ST_TA_1, VALUE_VTI, 2, 3 },
+    { M_BO_NA_1, VALUE_BSI, 5, 0 },
+    { M_BO_TA_1, VALUE_BSI, 5, 3 },
+    { M_ME_NA_1, VALUE_NVA, 3, 0 },
+    { M_ME_TA_1, VALUE_NVA, 3, 3 },
+    { M_ME_NB_1, VALUE_SVA, 3, 0 },
+    { M_ME_TB_1, VALUE_SVA, 3, 3 },
+    { M_ME_NC_1, VALUE_FLOAT, 5, 0 },
+    { M_ME_TC_1, VALUE_FLOAT, 5, 3 },
+    { M_IT_NA_1, VALUE_BCR, 5, 0 },
+    { M_IT_TA_1, VALUE_BCR, 5, 3 },
+    { M_ME_ND_1, VALUE_NVA_NO_QDS, 2, 0 },
+    { M_SP_TB_1, VALUE_SIQ, 1, 7 },
+    { M_DP_TB_1, VALUE_DIQ, 1, 7 },
+    { M_ST_TB_1, VALUE_VTI, 2, 7 },
+    { M_BO_TB_1, VALUE_BSI, 5, 7 },
+    { M_ME_TD_1, VALUE_NVA, 3, 7 },
+    { M_ME_TE_1, VALUE_SVA, 3, 7 },
+    { M_ME_TF_1, VALUE_FLOAT, 5, 7 },
+    { M_IT_TB_1, VALUE_BCR, 5, 7 }
+};
+
+typedef struct {
+    volatile uint64_t key;      /* 0 = unused, otherwise ((ca << 24) | ioa) + 1 */
+    volatile uint32_t sequence; /* odd while the writer updates the entry */
+    CS101_PointValue value;
+} PointCacheEntry;
+
+typedef struct {
+    int ca;
+    volatile CS101_GIState state;
+    volatile int pointsReceived;
+} GIStationState;
+
+struct sCS101_PointCache {
+    PointCacheEntry* entries;
+    int tableSize; /* power of two */
+    int maxNumberOfPoints;
+    volatile int numberOfPoints;
+
+    GIStationState giStates[CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS];
+    int numberOfGIStations;
+    volatile int numberOfIgnoredGIStations; /* GI events of stations that didn't fit into giStates */
+
+    CS101_PointCacheChangeHandler changeHandler;
+    void* changeHandlerParameter;
+    bool reportOnlyChanges;
+    CS101_PointValue* changes; /* buffer for one ASDU (max. 127 elements) */
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore updateLock;
+#endif
+};
+
+CS101_PointCache
+CS101_PointCache_create(int maxNumberOfPoints)
+{
+    CS101_PointCache self = (CS101_PointCache) GLOBAL_CALLOC(1, sizeof(struct sCS101_PointCache));
+
+    if (self) {
+        int tableSize = 16;
+
+        if (maxNumberOfPoints < 1)
+            maxNumberOfPoints = 1;
+
+        /* keep the load factor below 0.5 to have short probe sequences */
+        while (tableSize < (maxNumberOfPoints * 2))
+            tableSize = tableSize * 2;
+
+        self->entries = (PointCacheEntry*) GLOBAL_CALLOC(tableSize, sizeof(PointCacheEntry));
+
+        if (self->entries == NULL) {
+            GLOBAL_FREEMEM(self);
+            return NULL;
+        }
+
+        self->tableSize = tableSize;
+        self->maxNumberOfPoints = maxNumberOfPoints;
+        self->numberOfPoints = 0;
+        self->numberOfGIStations = 0;
+        self->numberOfIgnoredGIStations = 0;
+
+        self->changeHandler = NULL;
+        self->changes = NULL;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->updateLock = Semaphore_create(1);
+#endif
+    }
+
+    return self;
+}
+
+void
+CS101_PointCache_destroy(CS101_PointCache self)
+{
+    if (self) {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_destroy(self->updateLock);
+#endif
+
+        if (self->changes)
+            GLOBAL_FREEMEM(self->changes);
+
+        GLOBAL_FREEMEM(self->entries);
+        GLOBAL_FREEMEM(self);
+    }
+}
+
+bool
+CS101_PointCache_setChangeHandler(CS101_PointCache self, CS101_PointCacheChangeHandler handler, void* parameter,
+        bool reportOnlyChanges)
+{
+    bool success = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->updateLock);
+#endif
+
+    if ((handler != NULL) && (self->changes == NULL)) {
+        self->changes = (CS101_PointValue*) GLOBAL_CALLOC(127, sizeof(CS101_PointValue));
+
+        if (self->changes == NULL) {
+            DEBUG_PRINT("POINT CACHE: failed to allocate change buffer\n");
+
+            handler = NULL;
+            success = false;
+        }
+    }
+
+    self->changeHandler = handler;
+    self->changeHandlerParameter = parameter;
+    self->reportOnlyChanges = reportOnlyChanges;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->updateLock);
+#endif
+
+    return success;
+}
+
+static uint64_t
+getKey(int ca, int ioa)
+{
+    return ((((uint64_t) ca) << 24) | (uint64_t) (ioa & 0xffffff)) + 1;
+}
+
+static int
+getHashIndex(CS101_PointCache self, uint64_t key)
+{
+    /* Fibonacci hashing */
+    uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+
+    return (int) ((hash >> 32) & (uint64_t) (self->tableSize - 1));
+}
+
+static PointCacheEntry*
+lookupEntry(CS101_PointCache self, uint64_t key)
+{
+    int index = getHashIndex(self, key);
+    int i;
+
+    for (i = 0; i < self->tableSize; i++) {
+        PointCacheEntry* entry = &(self->entries[index]);
+
+        uint64_t entryKey = entry->key;
+
+        if (entryKey == key)
+            return entry;
+
+        if (entryKey == 0)
+            return NULL;
+
+        index = (index + 1) & (self->tableSize - 1);
+    }
+
+    return NULL;
+}
+
+/* called by the writer only */
+static PointCacheEntry*
+getOrAddEntry(CS101_PointCache self, uint64_t key, int ca, int ioa)
+{
+    int index = getHashIndex(self, key);
+    int i;
+
+    for (i = 0; i < self->tableSize; i++) {
+        PointCacheEntry* entry = &(self->entries[index]);
+
+        if (entry->key == key)
+            return entry;
+
+        if (entry->key == 0) {
+
+            if (self->numberOfPoints >= self->maxNumberOfPoints)
+                return NULL;
+
+            memset(&(entry->value), 0, sizeof(CS101_PointValue));
+            entry->value.ca = ca;
+            entry->value.ioa = ioa;
+            entry->sequence = 0;
+
+            /* make the entry visible to readers after it is initialized */
+            MEMORY_BARRIER();
+
+            entry->key = key;
+
+            self->numberOfPoints++;
+
+            return entry;
+        }
+
+        index = (index + 1) & (self->tableSize - 1);
+    }
+
+    return NULL;
+}
+
+static GIStationState*
+getGIStation(CS101_PointCache self, int ca, bool create)
+{
+    int i;
+
+    for (i = 0; i < self->numberOfGIStations; i++) {
+        if (self->giStates[i].ca == ca)
+            return &(self->giStates[i]);
+    }
+
+    if (create == false)
+        return NULL;
+
+    if (self->numberOfGIStations < CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS) {
+        GIStationState* station = &(self->giStates[self->numberOfGIStations]);
+
+        station->ca = ca;
+        station->state = CS101_GI_STATE_NONE;
+        station->pointsReceived = 0;
+
+        MEMORY_BARRIER();
+
+        self->numberOfGIStations++;
+
+        return station;
+    }
+
+    self->numberOfIgnoredGIStations++;
+
+    DEBUG_PRINT("POINT CACHE: too many stations - ignore GI of CA %i\n", ca);
+
+    return NULL;
+}
+
+static void
+handleInterrogationCommand(CS101_PointCache self, CS101_ASDU asdu)
+{
+    CS101_CauseOfTransmission cot = CS101_ASDU_getCOT(asdu);
+    int sizeOfIOA = asdu->parameters->sizeOfIOA;
+
+    /* only the station interrogation covers all points of the station */
+    if ((asdu->payloadSize <= sizeOfIOA) || (asdu->payload[sizeOfIOA] != IEC60870_QOI_STATION))
+        return;
+
+    if ((cot != CS101_COT_ACTIVATION_CON) && (cot != CS101_COT_ACTIVATION_TERMINATION))
+        return;
+
+    GIStationState* station = getGIStation(self, CS101_ASDU_getCA(asdu), true);
+
+    if (station) {
+        if (cot == CS101_COT_ACTIVATION_CON) {
+            if (CS101_ASDU_isNegative(asdu))
+                station->state = CS101_GI_STATE_FAILED;
+            else {
+                station->pointsReceived = 0;
+                station->state = CS101_GI_STATE_IN_PROGRESS;
+            }
+        }
+        else if (cot == CS101_COT_ACTIVATION_TERMINATION) {
+            station->state = CS101_GI_STATE_COMPLETE;
+        }
+    }
+}
+
+static const PointTypeInfo*
+getPointTypeInfo(IEC60870_5_TypeID typeId)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(pointTypes) / sizeof(PointTypeInfo); i++) {
+        if (pointTypes[i].typeId == typeId)
+            return &(pointTypes[i]);
+    }
+
+    return NULL;
+}
+
+static int
+getInt16(uint8_t* buffer)
+{
+    int value = buffer[0] + (buffer[1] * 0x100);
+
+    if (value > 32767)
+        value = value - 65536;
+
+    return value;
+}
+
+static void
+decodeValue(const PointTypeInfo* typeInfo, uint8_t* buffer, double* value, uint8_t* quality)
+{
+    switch (typeInfo->encoding) {
+
+    case VALUE_SIQ:
+        *value = (double) (buffer[0] & 0x01);
+        *quality = buffer[0] & 0xf0;
+        break;
+
+    case VALUE_DIQ:
+        *value = (double) (buffer[0] & 0x03);
+        *quality = buffer[0] & 0xf0;
+        break;
+
+    case VALUE_VTI:
+        {
+            int vti = buffer[0] & 0x7f;
+
+            if (vti > 63)
+                vti = vti - 128;
+
+            *value = (double) vti;
+            *quality = buffer[1];
+        }
+        break;
+
+    case VALUE_BSI:
+        *value = (double) ((uint32_t) buffer[0] + ((uint32_t) buffer[1] << 8) +
+                ((uint32_t) buffer[2] << 16) + ((uint32_t) buffer[3] << 24));
+        *quality = buffer[4];
+        break;
+
+    case VALUE_NVA:
+        *value = (double) getInt16(buffer) / 32767.0;
+        *quality = buffer[2];
+        break;
+
+    case VALUE_NVA_NO_QDS:
+        *value = ((double) getInt16(buffer) + 0.5) / 32767.5;
+        *quality = 0;
+        break;
+
+    case VALUE_SVA:
+        *value = (double) getInt16(buffer);
+        *quality = buffer[2];
+        break;
+
+    case VALUE_FLOAT:
+        {
+            float floatValue;
+            uint8_t* valueBytes = (uint8_t*) &floatValue;
+
+#if (ORDER_LITTLE_ENDIAN == 1)
+            valueBytes[0] = buffer[0];
+            valueBytes[1] = buffer[1];
+            valueBytes[2] = buffer[2];
+            valueBytes[3] = buffer[3];
+#else
+            valueBytes[3] = buffer[0];
+            valueBytes[2] = buffer[1];
+            valueBytes[1] = buffer[2];
+            valueBytes[0] = buffer[3];
+#endif
+
+            *value = (double) floatValue;
+            *quality = buffer[4];
+        }
+        break;
+
+    case VALUE_BCR:
+        *value = (double) (int32_t) ((uint32_t) buffer[0] + ((uint32_t) buffer[1] << 8) +
+                ((uint32_t) buffer[2] << 16) + ((uint32_t) buffer[3] << 24));
+        *quality = buffer[4];
+        break;
+    }
+}
+
+static uint64_t
+decodeTimestamp(uint8_t* buffer, int timeSize)
+{
+    if (timeSize == 7)
+        return CP56Time2a_toMsTimestamp((CP56Time2a) buffer);
+
+    /* CP24Time2a: only milliseconds and minutes are available */
+    return (uint64_t) (buffer[0] + (buffer[1] * 0x100)) + ((uint64_t) (buffer[2] & 0x3f) * 60000);
+}
+
+void
+CS101_PointCache_handleASDU(CS101_PointCache self, CS101_ASDU asdu)
+{
+    IEC60870_5_TypeID typeId = CS101_ASDU_getTypeID(asdu);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->updateLock);
+#endif
+
+    if (typeId == C_IC_NA_1) {
+        handleInterrogationCommand(self, asdu);
+        goto exit_function;
+    }
+
+    const PointTypeInfo* typeInfo = getPointTypeInfo(typeId);
+
+    if (typeInfo == NULL)
+        goto exit_function;
+
+    int ca = CS101_ASDU_getCA(asdu);
+    CS101_CauseOfTransmission cot = CS101_ASDU_getCOT(asdu);
+    bool isSequence = CS101_ASDU_isSequence(asdu);
+    int numberOfElements = CS101_ASDU_getNumberOfElements(asdu);
+    int sizeOfIOA = asdu->parameters->sizeOfIOA;
+
+    uint8_t* payload = asdu->payload;
+    int payloadSize = asdu->payloadSize;
+
+    int elementSize = typeInfo->valueSize + typeInfo->timeSize;
+
+    GIStationState* giStation = NULL;
+
+    if (cot == CS101_COT_INTERROGATED_BY_STATION) {
+        giStation = getGIStation(self, ca, false);
+
+        if (giStation && (giStation->state != CS101_GI_STATE_IN_PROGRESS))
+            giStation = NULL;
+    }
+
+    uint64_t updateTime = Hal_getTimeInMs();
+
+    int numberOfChanges = 0;
+
+    int pos = 0;
+    int ioa = 0;
+    int i;
+
+    for (i = 0; i < numberOfElements; i++) {
+
+        if ((isSequence == false) || (i == 0)) {
+
+            if (pos + sizeOfIOA > payloadSize)
+                break;
+
+            ioa = payload[pos];
+
+            if (sizeOfIOA > 1)
+                ioa += (payload[pos + 1] * 0x100);
+
+            if (sizeOfIOA > 2)
+                ioa += (payload[pos + 2] * 0x10000);
+
+            pos += sizeOfIOA;
+        }
+        else
+            ioa++;
+
+        if (pos + elementSize > payloadSize)
+            break;
+
+        double value;
+        uint8_t quality;
+
+        decodeValue(typeInfo, payload + pos, &value, &quality);
+
+        uint64_t key = getKey(ca, ioa);
+
+        PointCacheEntry* entry = getOrAddEntry(self, key, ca, ioa);
+
+        if (entry) {
+            bool changed = (entry->value.updateCount == 0) || (entry->value.value != value) ||
+                    (entry->value.quality != quality);
+
+            entry->sequence++; /* odd -> readers retry */
+            MEMORY_BARRIER();
+
+            entry->value.typeId = typeId;
+            entry->value.cot = cot;
+            entry->value.value = value;
+            entry->value.quality = quality;
+            entry->value.hasTimestamp = (typeInfo->timeSize > 0);
+
+            if (typeInfo->timeSize > 0)
+                entry->value.timestamp = decodeTimestamp(payload + pos + typeInfo->valueSize, typeInfo->timeSize);
+
+            entry->value.updateTime = updateTime;
+            entry->value.updateCount++;
+
+            MEMORY_BARRIER();
+            entry->sequence++; /* even -> entry is consistent */
+
+            if (self->changeHandler && (changed || (self->reportOnlyChanges == false)))
+                self->changes[numberOfChanges++] = entry->value;
+        }
+        else
+            DEBUG_PRINT("POINT CACHE: cache full - ignore CA %i IOA %i\n", ca, ioa);
+
+        if (giStation)
+            giStation->pointsReceived++;
+
+        pos += elementSize;
+    }
+
+    if (numberOfChanges > 0)
+        self->changeHandler(self->changeHandlerParameter, self->changes, numberOfChanges);
+
+exit_function:
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->updateLock);
+#endif
+
+    return;
+}
+
+bool
+CS101_PointCache_getValue(CS101_PointCache self, int ca, int ioa, CS101_PointValue* value)
+{
+    PointCacheEntry* entry = lookupEntry(self, getKey(ca, ioa));
+
+    if (entry == NULL)
+        return false;
+
+    while (true) {
+        uint32_t sequence = entry->sequence;
+
+        MEMORY_BARRIER();
+
+        if ((sequence & 1) == 0) {
+            *value = entry->value;
+
+            MEMORY_BARRIER();
+
+            if (entry->sequence == sequence)
+                break;
+        }
+
+        Thread_sleep(0);
+    }
+
+    return true;
+}
+
+int
+CS101_PointCache_getNumberOfPoints(CS101_PointCache self)
+{
+    return self->numberOfPoints;
+}
+
+CS101_GIState
+CS101_PointCache_getGIState(CS101_PointCache self, int ca, int* pointsReceived)
+{
+    int numberOfStations = self->numberOfGIStations;
+    int i;
+
+    MEMORY_BARRIER();
+
+    for (i = 0; i < numberOfStations; i++) {
+        if (self->giStates[i].ca == ca) {
+
+            if (pointsReceived)
+                *pointsReceived = self->giStates[i].pointsReceived;
+
+            return self->giStates[i].state;
+        }
+    }
+
+    if (pointsReceived)
+        *pointsReceived = 0;
+
+    return CS101_GI_STATE_NONE;
+}
+
+int
+CS101_PointCache_getNumberOfIgnoredGIStations(CS101_PointCache self)
+{
+    return self->numberOfIgnoredGIStations;
+}
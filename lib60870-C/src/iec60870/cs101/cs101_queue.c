@@ -93,11 +93,12 @@ CS101_Queue_unlock(CS101_Queue self)
 #endif
 }
 
-void
-CS101_Queue_enqueue(CS101_Queue self, CS101_ASDU asdu)
+/*
+ * NOTE: Locking has to be done by caller!
+ */
+static void
+enqueueInternal(CS101_Queue self, CS101_ASDU asdu)
 {
-    CS101_Queue_lock(self);
-
     int nextIndex;
     bool removeEntry = false;
 
@@ -144,6 +145,27 @@ CS101_Queue_enqueue(CS101_Queue self, CS101_ASDU asdu)
 
     DEBUG_PRINT("Events in FIFO: %i (first: %i, last: %i)\n", self->entryCounter,
             self->firstMsgIndex, self->lastMsgIndex);
+}
+
+void
+CS101_Queue_enqueue(CS101_Queue self, CS101_ASDU asdu)
+{
+    CS101_Queue_lock(self);
+
+    enqueueInternal(self, asdu);
+
+    CS101_Queue_unlock(self);
+}
+
+void
+CS101_Queue_enqueueMultiple(CS101_Queue self, CS101_ASDU* asdus, int count)
+{
+    int i;
+
+    CS101_Queue_lock(self);
+
+    for (i = 0; i < count; i++)
+        enqueueInternal(self, asdus[i]);
 
     CS101_Queue_unlock(self);
 }
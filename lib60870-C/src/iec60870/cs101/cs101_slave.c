@@ -68,6 +68,9 @@ struct sCS101_Slave
     CS101_ResetCUHandler resetCUHandler;
     void* resetCUHandlerParameter;
 
+    CS101_Class2DataProvider class2DataProvider;
+    void* class2DataProviderParameter;
+
     SerialTransceiverFT12 transceiver;
 
     LinkLayerSecondaryUnbalanced unbalancedLinkLayer;
@@ -88,9 +91,15 @@ struct sCS101_Slave
 #if (CONFIG_USE_THREADS == 1)
     bool isRunning;
     Thread workerThread;
+
+    bool useThreadAttributes;
+    struct sThreadAttributes threadAttributes;
+    char threadName[16];
 #endif
 
-    LinkedList plugins;
+    LinkedList plugins;         /* all plugins (for the plugin tasks) */
+    LinkedList allTypesPlugins; /* plugins that are called for all received ASDUs */
+    LinkedList* pluginsByTypeId; /* 256 lists of plugins indexed by type ID (NULL when not used) */
 };
 
 static void
@@ -135,6 +144,20 @@ GetClass2Data (void* parameter, Frame frame)
 
     CS101_Queue_unlock(&(self->userDataClass2Queue));
 
+    if ((userData == NULL) && (self->class2DataProvider != NULL)) {
+        sCS101_StaticASDU _asdu;
+
+        CS101_ASDU asdu = CS101_ASDU_initializeStatic(&_asdu, &(self->alParameters), false, CS101_COT_PERIODIC,
+                self->alParameters.originatorAddress, 0, false, false);
+
+        if (self->class2DataProvider(self->class2DataProviderParameter, asdu)) {
+            if (CS101_ASDU_getNumberOfElements(asdu) > 0) {
+                CS101_ASDU_encode(asdu, frame);
+                userData = frame;
+            }
+        }
+    }
+
     return userData;
 }
 
@@ -147,6 +170,9 @@ HandleReceivedData (void* parameter, uint8_t* msg, bool isBroadcast, int userDat
 
     CS101_ASDU asdu = CS101_ASDU_createFromBuffer(&(self->alParameters), msg + userDataStart, userDataLength);
 
+    if (asdu)
+        CS101_ASDU_setReceiveTimestamp(asdu, SerialTransceiverFT12_getLastFrameTimestamp(self->transceiver));
+
     handleASDU(self, asdu);
 
     CS101_ASDU_destroy(asdu);
@@ -303,9 +329,12 @@ CS101_Slave_createEx(SerialPort serialPort, LinkLayerParameters llParameters, CS
         self->delayAcquisitionHandler = NULL;
         self->resetCUHandler = NULL;
 
+        self->class2DataProvider = NULL;
+
 #if (CONFIG_USE_THREADS == 1)
         self->isRunning = false;
         self->workerThread = NULL;
+        self->useThreadAttributes = false;
 #endif
 
         if (llParameters)
@@ -359,6 +388,8 @@ CS101_Slave_createEx(SerialPort serialPort, LinkLayerParameters llParameters, CS
         CS101_Queue_initialize(&(self->userDataClass2Queue), class2QueueSize);
 
         self->plugins = NULL;
+        self->allTypesPlugins = NULL;
+        self->pluginsByTypeId = NULL;
     }
 
     return self;
@@ -370,6 +401,27 @@ CS101_Slave_create(SerialPort serialPort, LinkLayerParameters llParameters, CS10
     return CS101_Slave_createEx(serialPort, llParameters, alParameters, linkLayerMode, CS101_MAX_QUEUE_SIZE, CS101_MAX_QUEUE_SIZE);
 }
 
+static void
+destroyPlugins(CS101_Slave self)
+{
+    if (self->plugins)
+        LinkedList_destroyStatic(self->plugins);
+
+    if (self->allTypesPlugins)
+        LinkedList_destroyStatic(self->allTypesPlugins);
+
+    if (self->pluginsByTypeId) {
+        int i;
+
+        for (i = 0; i < 256; i++) {
+            if (self->pluginsByTypeId[i])
+                LinkedList_destroyStatic(self->pluginsByTypeId[i]);
+        }
+
+        GLOBAL_FREEMEM(self->pluginsByTypeId);
+    }
+}
+
 void
 CS101_Slave_destroy(CS101_Slave self)
 {
@@ -386,11 +438,9 @@ CS101_Slave_destroy(CS101_Slave self)
         CS101_Queue_dispose(&(self->userDataClass1Queue));
         CS101_Queue_dispose(&(self->userDataClass2Queue));
 
-        GLOBAL_FREEMEM(self);
+        destroyPlugins(self);
 
-        if (self->plugins) {
-            LinkedList_destroyStatic(self->plugins);
-        }
+        GLOBAL_FREEMEM(self);
     }
 }
 
@@ -400,8 +450,55 @@ CS101_Slave_addPlugin(CS101_Slave self, CS101_SlavePlugin plugin)
     if (self->plugins == NULL)
         self->plugins = LinkedList_create();
 
-    if (self->plugins)
+    if (self->allTypesPlugins == NULL)
+        self->allTypesPlugins = LinkedList_create();
+
+    if (self->plugins && self->allTypesPlugins) {
         LinkedList_add(self->plugins, plugin);
+        LinkedList_add(self->allTypesPlugins, plugin);
+    }
+}
+
+static bool
+containsPlugin(LinkedList plugins, CS101_SlavePlugin plugin)
+{
+    LinkedList pluginElem = LinkedList_getNext(plugins);
+
+    while (pluginElem) {
+        if (LinkedList_getData(pluginElem) == plugin)
+            return true;
+
+        pluginElem = LinkedList_getNext(pluginElem);
+    }
+
+    return false;
+}
+
+void
+CS101_Slave_addPluginForTypeID(CS101_Slave self, CS101_SlavePlugin plugin, IEC60870_5_TypeID typeId)
+{
+    if (((int) typeId < 1) || ((int) typeId > 255))
+        return;
+
+    if (self->plugins == NULL)
+        self->plugins = LinkedList_create();
+
+    if (self->pluginsByTypeId == NULL)
+        self->pluginsByTypeId = (LinkedList*) GLOBAL_CALLOC(256, sizeof(LinkedList));
+
+    if ((self->plugins == NULL) || (self->pluginsByTypeId == NULL))
+        return;
+
+    if (self->pluginsByTypeId[typeId] == NULL)
+        self->pluginsByTypeId[typeId] = LinkedList_create();
+
+    if (self->pluginsByTypeId[typeId]) {
+        LinkedList_add(self->pluginsByTypeId[typeId], plugin);
+
+        /* the task of the plugin is called once, regardless of the number of type IDs */
+        if (containsPlugin(self->plugins, plugin) == false)
+            LinkedList_add(self->plugins, plugin);
+    }
 }
 
 void
@@ -412,6 +509,25 @@ CS101_Slave_setDIR(CS101_Slave self, bool dir)
     }
 }
 
+#if (CONFIG_USE_THREADS == 1)
+void
+CS101_Slave_setThreadAttributes(CS101_Slave self, ThreadAttributes attributes)
+{
+    if (attributes) {
+        self->threadAttributes = *attributes;
+        self->useThreadAttributes = true;
+
+        if (attributes->name) {
+            strncpy(self->threadName, attributes->name, sizeof(self->threadName) - 1);
+            self->threadName[sizeof(self->threadName) - 1] = 0;
+            self->threadAttributes.name = self->threadName;
+        }
+    }
+    else
+        self->useThreadAttributes = false;
+}
+#endif /* (CONFIG_USE_THREADS == 1) */
+
 void
 CS101_Slave_setIdleTimeout(CS101_Slave self, int timeoutInMs)
 {
@@ -460,6 +576,12 @@ CS101_Slave_enqueueUserDataClass1(CS101_Slave self, CS101_ASDU asdu)
     CS101_Queue_enqueue(&(self->userDataClass1Queue), asdu);
 }
 
+void
+CS101_Slave_enqueueUserDataClass1ASDUs(CS101_Slave self, CS101_ASDU* asdus, int count)
+{
+    CS101_Queue_enqueueMultiple(&(self->userDataClass1Queue), asdus, count);
+}
+
 
 bool
 CS101_Slave_isClass2QueueFull(CS101_Slave self)
@@ -473,6 +595,12 @@ CS101_Slave_enqueueUserDataClass2(CS101_Slave self, CS101_ASDU asdu)
     CS101_Queue_enqueue(&(self->userDataClass2Queue), asdu);
 }
 
+void
+CS101_Slave_enqueueUserDataClass2ASDUs(CS101_Slave self, CS101_ASDU* asdus, int count)
+{
+    CS101_Queue_enqueueMultiple(&(self->userDataClass2Queue), asdus, count);
+}
+
 void
 CS101_Slave_flushQueues(CS101_Slave self)
 {
@@ -526,7 +654,8 @@ CS101_Slave_start(CS101_Slave self)
 {
 #if (CONFIG_USE_THREADS == 1)
     if (self->workerThread == NULL) {
-        self->workerThread = Thread_create(slaveMainThread, self, false);
+        self->workerThread = Thread_createEx(slaveMainThread, self, false,
+                self->useThreadAttributes ? &(self->threadAttributes) : NULL);
         Thread_start(self->workerThread);
     }
 #endif /* (CONFIG_USE_THREADS == 1) */
@@ -565,6 +694,13 @@ CS101_Slave_setResetCUHandler(CS101_Slave self, CS101_ResetCUHandler handler, vo
     self->resetCUHandlerParameter = parameter;
 }
 
+void
+CS101_Slave_setClass2DataProvider(CS101_Slave self, CS101_Class2DataProvider provider, void* parameter)
+{
+    self->class2DataProvider = provider;
+    self->class2DataProviderParameter = parameter;
+}
+
 void
 CS101_Slave_setInterrogationHandler(CS101_Slave self, CS101_InterrogationHandler handler, void*  parameter)
 {
@@ -624,6 +760,33 @@ responseCOTUnknown(CS101_ASDU asdu, IMasterConnection self)
 }
 
 
+/*
+ * Call the plugins of the list until one of them handles the ASDU
+ *
+ * \return true when the ASDU was handled by a plugin
+ */
+static bool
+callPlugins(LinkedList plugins, IMasterConnection connection, CS101_ASDU asdu)
+{
+    LinkedList pluginElem = LinkedList_getNext(plugins);
+
+    while (pluginElem) {
+
+        CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
+
+        CS101_SlavePlugin_Result result = plugin->handleAsdu(plugin->parameter, connection, asdu);
+
+        if (result == CS101_PLUGIN_RESULT_HANDLED)
+            return true;
+        else if (result == CS101_PLUGIN_RESULT_INVALID_ASDU)
+            DEBUG_PRINT("Invalid message");
+
+        pluginElem = LinkedList_getNext(pluginElem);
+    }
+
+    return false;
+}
+
 /*
  * Handle received ASDUs
  *
@@ -634,25 +797,17 @@ handleASDU(CS101_Slave self, CS101_ASDU asdu)
 {
     bool messageHandled = false;
 
-    /* call plugins */
-    if (self->plugins) {
-        LinkedList pluginElem = LinkedList_getNext(self->plugins);
-
-        while (pluginElem) {
-
-            CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
-
-            CS101_SlavePlugin_Result result = plugin->handleAsdu(plugin->parameter, &(self->iMasterConnection), asdu);
+    /* call the plugins registered for the type ID first, then the plugins for all type IDs */
+    if (self->pluginsByTypeId) {
+        LinkedList plugins = self->pluginsByTypeId[CS101_ASDU_getTypeID(asdu)];
 
-            if (result == CS101_PLUGIN_RESULT_HANDLED) {
-                return;
-            }
-            else if (result == CS101_PLUGIN_RESULT_INVALID_ASDU) {
-                DEBUG_PRINT("Invalid message");
-            }
+        if (plugins && callPlugins(plugins, &(self->iMasterConnection), asdu))
+            return;
+    }
 
-            pluginElem = LinkedList_getNext(pluginElem);
-        }
+    if (self->allTypesPlugins) {
+        if (callPlugins(self->allTypesPlugins, &(self->iMasterConnection), asdu))
+            return;
     }
 
     uint8_t cot = CS101_ASDU_getCOT(asdu);
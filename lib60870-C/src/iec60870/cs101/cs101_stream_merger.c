@@ -0,0 +1,403 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <string.h>
+
+#include "cs101_stream_merger.h"
+#include "cs101_asdu_internal.h"
+#include "hal_thread.h"
+#include "hal_time.h"
+#include "lib_memory.h"
+#include "lib60870_config.h"
+#include "lib60870_internal.h"
+
+/*
+ * The window is a set of 64 bit fingerprints of the received information objects. It consists of two
+ * generations (open addressing hash tables without delete). New fingerprints are added to the current
+ * generation. When the current generation is full or older than the window time, the old generation is
+ * dropped and the current generation becomes the old one.
+ */
+typedef struct {
+    uint64_t* entries; /* 0 = empty slot */
+    int numberOfEntries;
+    uint64_t startTime;
+    uint64_t lastAddTime;
+} Generation;
+
+struct sCS101_StreamMerger {
+    Generation generations[2];
+    int current;
+
+    int tableSize; /* power of two */
+    int maxEntries;
+    uint64_t windowTimeInMs;
+
+    CS101_ASDUReceivedHandler handler;
+    void* handlerParameter;
+
+    CS101_StreamMergerStatistics statistics;
+
+    uint64_t fingerprints[127];
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore lock;
+#endif
+};
+
+CS101_StreamMerger
+CS101_StreamMerger_create(int maxWindowSize, int windowTimeInMs)
+{
+    CS101_StreamMerger self = (CS101_StreamMerger) GLOBAL_CALLOC(1, sizeof(struct sCS101_StreamMerger));
+
+    if (self) {
+        int tableSize = 16;
+
+        if (maxWindowSize < 1)
+            maxWindowSize = 1;
+
+        /* keep the load factor below 0.5 to have short probe sequences */
+        while (tableSize < (maxWindowSize * 2))
+            tableSize = tableSize * 2;
+
+        self->generations[0].entries = (uint64_t*) GLOBAL_CALLOC(tableSize, sizeof(uint64_t));
+        self->generations[1].entries = (uint64_t*) GLOBAL_CALLOC(tableSize, sizeof(uint64_t));
+
+        if ((self->generations[0].entries == NULL) || (self->generations[1].entries == NULL)) {
+            CS101_StreamMerger_destroy(self);
+            return NULL;
+        }
+
+        self->tableSize = tableSize;
+        self->maxEntries = maxWindowSize;
+        self->windowTimeInMs = (windowTimeInMs > 0) ? (uint64_t) windowTimeInMs : 0;
+        self->current = 0;
+        self->generations[0].startTime = Hal_getTimeInMs();
+        self->generations[0].lastAddTime = self->generations[0].startTime;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->lock = Semaphore_create(1);
+#endif
+    }
+
+    return self;
+}
+
+void
+CS101_StreamMerger_destroy(CS101_StreamMerger self)
+{
+    if (self) {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        if (self->lock)
+            Semaphore_destroy(self->lock);
+#endif
+
+        if (self->generations[0].entries)
+            GLOBAL_FREEMEM(self->generations[0].entries);
+
+        if (self->generations[1].entries)
+            GLOBAL_FREEMEM(self->generations[1].entries);
+
+        GLOBAL_FREEMEM(self);
+    }
+}
+
+void
+CS101_StreamMerger_setASDUReceivedHandler(CS101_StreamMerger self, CS101_ASDUReceivedHandler handler, void* parameter)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    self->handler = handler;
+    self->handlerParameter = parameter;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+}
+
+void
+CS101_StreamMerger_getStatistics(CS101_StreamMerger self, CS101_StreamMergerStatistics* statistics)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    *statistics = self->statistics;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+}
+
+/* FNV-1a */
+static uint64_t
+hashBytes(uint64_t hash, const uint8_t* buffer, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= (uint64_t) buffer[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static uint64_t
+getFingerprint(int ca, int typeId, int ioa, const uint8_t* element, int elementSize)
+{
+    uint8_t key[7];
+
+    key[0] = (uint8_t) (ca & 0xff);
+    key[1] = (uint8_t) ((ca >> 8) & 0xff);
+    key[2] = (uint8_t) typeId;
+    key[3] = (uint8_t) (ioa & 0xff);
+    key[4] = (uint8_t) ((ioa >> 8) & 0xff);
+    key[5] = (uint8_t) ((ioa >> 16) & 0xff);
+    key[6] = (uint8_t) elementSize;
+
+    uint64_t hash = hashBytes(0xCBF29CE484222325ULL, key, sizeof(key));
+
+    hash = hashBytes(hash, element, elementSize);
+
+    /* 0 marks an empty slot */
+    if (hash == 0)
+        hash = 1;
+
+    return hash;
+}
+
+static int
+getHashIndex(CS101_StreamMerger self, uint64_t fingerprint)
+{
+    /* Fibonacci hashing */
+    uint64_t hash = fingerprint * 0x9E3779B97F4A7C15ULL;
+
+    return (int) ((hash >> 32) & (uint64_t) (self->tableSize - 1));
+}
+
+static bool
+Generation_contains(CS101_StreamMerger self, Generation* generation, uint64_t fingerprint)
+{
+    int mask = self->tableSize - 1;
+    int index = getHashIndex(self, fingerprint);
+
+    while (generation->entries[index] != 0) {
+        if (generation->entries[index] == fingerprint)
+            return true;
+
+        index = (index + 1) & mask;
+    }
+
+    return false;
+}
+
+static void
+Generation_add(CS101_StreamMerger self, Generation* generation, uint64_t fingerprint)
+{
+    int mask = self->tableSize - 1;
+    int index = getHashIndex(self, fingerprint);
+
+    while (generation->entries[index] != 0) {
+        if (generation->entries[index] == fingerprint)
+            return;
+
+        index = (index + 1) & mask;
+    }
+
+    generation->entries[index] = fingerprint;
+    generation->numberOfEntries++;
+}
+
+static void
+Generation_clear(CS101_StreamMerger self, Generation* generation, uint64_t currentTime)
+{
+    if (generation->numberOfEntries > 0) {
+        memset(generation->entries, 0, self->tableSize * sizeof(uint64_t));
+        generation->numberOfEntries = 0;
+    }
+
+    generation->startTime = currentTime;
+    generation->lastAddTime = currentTime;
+}
+
+static void
+rotateGenerations(CS101_StreamMerger self, uint64_t currentTime)
+{
+    self->current = 1 - self->current;
+
+    Generation_clear(self, &(self->generations[self->current]), currentTime);
+}
+
+/* drop the generations that only contain information objects older than the window time */
+static void
+expireGenerations(CS101_StreamMerger self, uint64_t currentTime)
+{
+    Generation* current = &(self->generations[self->current]);
+    Generation* old = &(self->generations[1 - self->current]);
+
+    if ((old->numberOfEntries > 0) && ((currentTime - old->lastAddTime) >= self->windowTimeInMs))
+        Generation_clear(self, old, currentTime);
+
+    if ((currentTime - current->startTime) >= self->windowTimeInMs) {
+        rotateGenerations(self, currentTime);
+
+        if ((currentTime - current->lastAddTime) >= self->windowTimeInMs)
+            Generation_clear(self, current, currentTime);
+    }
+}
+
+static bool
+isDuplicate(CS101_StreamMerger self, uint64_t fingerprint)
+{
+    if (Generation_contains(self, &(self->generations[0]), fingerprint))
+        return true;
+
+    return Generation_contains(self, &(self->generations[1]), fingerprint);
+}
+
+/* returns true when the ASDU contains at least one information object that is not in the window */
+static bool
+checkAndAddASDU(CS101_StreamMerger self, CS101_ASDU asdu)
+{
+    int typeId = (int) CS101_ASDU_getTypeID(asdu);
+    int numberOfElements = CS101_ASDU_getNumberOfElements(asdu);
+    int sizeOfIOA = asdu->parameters->sizeOfIOA;
+
+    if ((numberOfElements < 1) || (numberOfElements > 127))
+        return true;
+
+    int ca = CS101_ASDU_getCA(asdu);
+    uint8_t* payload = asdu->payload;
+    int payloadSize = asdu->payloadSize;
+
+    int i;
+    int elementSize;
+    int baseIOA = 0;
+
+    if (CS101_ASDU_isSequence(asdu)) {
+        elementSize = (payloadSize - sizeOfIOA) / numberOfElements;
+
+        if ((elementSize < 1) || (payloadSize < sizeOfIOA))
+            return true;
+
+        baseIOA = payload[0];
+
+        if (sizeOfIOA > 1)
+            baseIOA += (payload[1] * 0x100);
+
+        if (sizeOfIOA > 2)
+            baseIOA += (payload[2] * 0x10000);
+
+        for (i = 0; i < numberOfElements; i++)
+            self->fingerprints[i] = getFingerprint(ca, typeId, baseIOA + i,
+                    payload + sizeOfIOA + (i * elementSize), elementSize);
+    }
+    else {
+        elementSize = payloadSize / numberOfElements;
+
+        if (elementSize <= sizeOfIOA)
+            return true;
+
+        for (i = 0; i < numberOfElements; i++) {
+            uint8_t* element = payload + (i * elementSize);
+
+            int ioa = element[0];
+
+            if (sizeOfIOA > 1)
+                ioa += (element[1] * 0x100);
+
+            if (sizeOfIOA > 2)
+                ioa += (element[2] * 0x10000);
+
+            self->fingerprints[i] = getFingerprint(ca, typeId, ioa, element + sizeOfIOA, elementSize - sizeOfIOA);
+        }
+    }
+
+    uint64_t currentTime = Hal_getTimeInMs();
+
+    expireGenerations(self, currentTime);
+
+    bool containsNewElement = false;
+
+    for (i = 0; i < numberOfElements; i++) {
+        if (isDuplicate(self, self->fingerprints[i]) == false) {
+            containsNewElement = true;
+            break;
+        }
+    }
+
+    if (containsNewElement) {
+        for (i = 0; i < numberOfElements; i++) {
+            Generation* current = &(self->generations[self->current]);
+
+            if (current->numberOfEntries >= self->maxEntries) {
+                rotateGenerations(self, currentTime);
+                current = &(self->generations[self->current]);
+            }
+
+            Generation_add(self, current, self->fingerprints[i]);
+            current->lastAddTime = currentTime;
+        }
+    }
+
+    return containsNewElement;
+}
+
+bool
+CS101_StreamMerger_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    CS101_StreamMerger self = (CS101_StreamMerger) parameter;
+
+    bool retVal = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    self->statistics.receivedASDUs++;
+
+    bool forward = true;
+
+    /* only monitoring direction information objects are checked for duplicates */
+    if ((CS101_ASDU_getTypeID(asdu) < C_SC_NA_1) && (CS101_ASDU_getTypeID(asdu) > 0))
+        forward = checkAndAddASDU(self, asdu);
+
+    if (forward) {
+        self->statistics.forwardedASDUs++;
+
+        if (self->handler)
+            retVal = self->handler(self->handlerParameter, address, asdu);
+    }
+    else {
+        self->statistics.suppressedASDUs++;
+
+        DEBUG_PRINT("StreamMerger: suppressed duplicate ASDU (type: %i CA: %i)\n", CS101_ASDU_getTypeID(asdu),
+                CS101_ASDU_getCA(asdu));
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+
+    return retVal;
+}
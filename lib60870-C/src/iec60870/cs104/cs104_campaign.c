@@ -0,0 +1,737 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cs104_campaign.h"
+#include "cs104_connection_internal.h"
+#include "hal_thread.h"
+#include "hal_time.h"
+#include "lib_memory.h"
+#include "lib60870_config.h"
+#include "lib60870_internal.h"
+
+#if (CONFIG_USE_THREADS == 1)
+
+typedef enum {
+    PROCEDURE_INTERROGATION,
+    PROCEDURE_COUNTER_INTERROGATION,
+    PROCEDURE_CLOCK_SYNC
+} CampaignProcedure;
+
+typedef enum {
+    PHASE_WAITING,
+    PHASE_SEND_TEST,
+    PHASE_WAIT_TEST_CON,
+    PHASE_SEND_COMMAND,
+    PHASE_WAIT_ACT_CON,
+    PHASE_WAIT_ACT_TERM,
+    PHASE_DONE
+} StationPhase;
+
+typedef struct {
+    CS104_Connection connection;
+    int ca;
+
+    StationPhase phase;
+    CS104_CampaignStationResult result;
+
+    uint64_t startTime;    /* monotonic time in ns */
+    uint64_t testSentTime; /* monotonic time in ns */
+    uint64_t deadline;     /* monotonic time in ns */
+
+    int delayInUs;
+    int completionTimeInUs;
+} CampaignStation;
+
+struct sCS104_Campaign {
+    CampaignStation* stations;
+    int maxNumberOfStations;
+    int numberOfStations;
+
+    /* open addressing table (connection, CA) -> station index + 1 */
+    int* stationTable;
+    int stationTableMask;
+
+    int* inflight; /* indices of the stations with a running procedure */
+    int numberOfInflight;
+    int nextStation;
+
+    int maxConcurrency;
+    int actConTimeoutInMs;
+    int actTermTimeoutInMs;
+    bool delayCompensation;
+
+    CampaignProcedure procedure;
+    IEC60870_5_TypeID commandTypeId;
+    QualifierOfInterrogation qoi;
+    uint8_t qcc;
+
+    uint64_t campaignStartTime;
+    int durationInMs;
+
+    CS104_CampaignCompletedHandler completedHandler;
+    void* completedHandlerParameter;
+
+    Thread thread;
+    volatile bool running;
+    volatile bool stopRequested;
+
+    bool useThreadAttributes;
+    struct sThreadAttributes threadAttributes;
+    char threadName[16];
+
+    Semaphore lock;
+    Semaphore wakeUp; /* posted when a station changed the phase or a stop is requested */
+};
+
+static uint32_t
+stationHash(CS104_Connection connection, int ca)
+{
+    uint64_t key = ((uint64_t) (uintptr_t) connection) ^ ((uint64_t) ca << 48);
+
+    return (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+static void
+insertStation(CS104_Campaign self, int index)
+{
+    uint32_t pos = stationHash(self->stations[index].connection, self->stations[index].ca) & self->stationTableMask;
+
+    while (self->stationTable[pos] != 0)
+        pos = (pos + 1) & self->stationTableMask;
+
+    self->stationTable[pos] = index + 1;
+}
+
+static CampaignStation*
+lookupStation(CS104_Campaign self, CS104_Connection connection, int ca)
+{
+    uint32_t pos = stationHash(connection, ca) & self->stationTableMask;
+
+    while (self->stationTable[pos] != 0) {
+        CampaignStation* station = &(self->stations[self->stationTable[pos] - 1]);
+
+        if ((station->connection == connection) && (station->ca == ca))
+            return station;
+
+        pos = (pos + 1) & self->stationTableMask;
+    }
+
+    return NULL;
+}
+
+CS104_Campaign
+CS104_Campaign_create(int maxNumberOfStations)
+{
+    CS104_Campaign self = (CS104_Campaign) GLOBAL_CALLOC(1, sizeof(struct sCS104_Campaign));
+
+    if (self) {
+        int tableSize = 2;
+
+        if (maxNumberOfStations < 1)
+            maxNumberOfStations = 1;
+
+        while (tableSize < (2 * maxNumberOfStations))
+            tableSize = tableSize * 2;
+
+        self->stations = (CampaignStation*) GLOBAL_CALLOC(maxNumberOfStations, sizeof(CampaignStation));
+        self->inflight = (int*) GLOBAL_CALLOC(maxNumberOfStations, sizeof(int));
+        self->stationTable = (int*) GLOBAL_CALLOC(tableSize, sizeof(int));
+
+        if ((self->stations == NULL) || (self->inflight == NULL) || (self->stationTable == NULL)) {
+            GLOBAL_FREEMEM(self->stations);
+            GLOBAL_FREEMEM(self->inflight);
+            GLOBAL_FREEMEM(self->stationTable);
+            GLOBAL_FREEMEM(self);
+            return NULL;
+        }
+
+        self->maxNumberOfStations = maxNumberOfStations;
+        self->stationTableMask = tableSize - 1;
+
+        self->maxConcurrency = 100;
+        self->actConTimeoutInMs = 15000;
+        self->actTermTimeoutInMs = 60000;
+        self->delayCompensation = true;
+
+        self->lock = Semaphore_create(1);
+        self->wakeUp = Semaphore_create(0);
+    }
+
+    return self;
+}
+
+void
+CS104_Campaign_destroy(CS104_Campaign self)
+{
+    if (self) {
+        CS104_Campaign_stop(self);
+
+        Semaphore_destroy(self->lock);
+        Semaphore_destroy(self->wakeUp);
+
+        GLOBAL_FREEMEM(self->stations);
+        GLOBAL_FREEMEM(self->inflight);
+        GLOBAL_FREEMEM(self->stationTable);
+        GLOBAL_FREEMEM(self);
+    }
+}
+
+int
+CS104_Campaign_addStation(CS104_Campaign self, CS104_Connection connection, int ca)
+{
+    int index = -1;
+
+    Semaphore_wait(self->lock);
+
+    if ((self->running == false) && (self->numberOfStations < self->maxNumberOfStations)) {
+        index = self->numberOfStations;
+
+        self->stations[index].connection = connection;
+        self->stations[index].ca = ca;
+        self->stations[index].delayInUs = -1;
+
+        insertStation(self, index);
+
+        self->numberOfStations++;
+    }
+
+    Semaphore_post(self->lock);
+
+    return index;
+}
+
+void
+CS104_Campaign_setMaxConcurrency(CS104_Campaign self, int maxConcurrency)
+{
+    if (maxConcurrency < 1)
+        maxConcurrency = 1;
+
+    self->maxConcurrency = maxConcurrency;
+}
+
+void
+CS104_Campaign_setTimeouts(CS104_Campaign self, int actConTimeoutInMs, int actTermTimeoutInMs)
+{
+    self->actConTimeoutInMs = actConTimeoutInMs;
+    self->actTermTimeoutInMs = actTermTimeoutInMs;
+}
+
+void
+CS104_Campaign_setDelayCompensation(CS104_Campaign self, bool enable)
+{
+    self->delayCompensation = enable;
+}
+
+void
+CS104_Campaign_setCompletedHandler(CS104_Campaign self, CS104_CampaignCompletedHandler handler, void* parameter)
+{
+    self->completedHandler = handler;
+    self->completedHandlerParameter = parameter;
+}
+
+void
+CS104_Campaign_setThreadAttributes(CS104_Campaign self, ThreadAttributes attributes)
+{
+    if (attributes) {
+        self->threadAttributes = *attributes;
+        self->useThreadAttributes = true;
+
+        if (attributes->name) {
+            strncpy(self->threadName, attributes->name, sizeof(self->threadName) - 1);
+            self->threadName[sizeof(self->threadName) - 1] = 0;
+            self->threadAttributes.name = self->threadName;
+        }
+    }
+    else
+        self->useThreadAttributes = false;
+}
+
+/* called with campaign lock */
+static void
+finishStation(CampaignStation* station, CS104_CampaignStationResult result, uint64_t currentTime)
+{
+    station->phase = PHASE_DONE;
+    station->result = result;
+
+    if (result == CS104_CAMPAIGN_STATION_SUCCESS)
+        station->completionTimeInUs = (int) ((currentTime - station->startTime) / 1000);
+}
+
+/* called by the connection threads */
+static void
+asduObserver(void* parameter, CS104_Connection connection, CS101_ASDU asdu)
+{
+    CS104_Campaign self = (CS104_Campaign) parameter;
+
+    IEC60870_5_TypeID typeId = CS101_ASDU_getTypeID(asdu);
+    CS101_CauseOfTransmission cot = CS101_ASDU_getCOT(asdu);
+
+    /* unknown type ID, COT, CA or IOA -> the station rejected the command */
+    bool rejected = (cot >= CS101_COT_UNKNOWN_TYPE_ID);
+
+    if ((cot != CS101_COT_ACTIVATION_CON) && (cot != CS101_COT_ACTIVATION_TERMINATION) && (rejected == false))
+        return;
+
+    if ((typeId != self->commandTypeId) && (typeId != C_TS_TA_1))
+        return;
+
+    uint64_t currentTime = Hal_getMonotonicTimeInNs();
+
+    Semaphore_wait(self->lock);
+
+    CampaignStation* station = lookupStation(self, connection, CS101_ASDU_getCA(asdu));
+
+    if (station) {
+        StationPhase oldPhase = station->phase;
+
+        if (typeId == C_TS_TA_1) {
+            if ((station->phase == PHASE_WAIT_TEST_CON) && ((cot == CS101_COT_ACTIVATION_CON) || rejected)) {
+
+                /* station doesn't support the test command -> no compensation */
+                if (rejected || CS101_ASDU_isNegative(asdu))
+                    station->delayInUs = 0;
+                else
+                    station->delayInUs = (int) ((currentTime - station->testSentTime) / 2000);
+
+                station->phase = PHASE_SEND_COMMAND;
+            }
+        }
+        else if (rejected) {
+            if ((station->phase == PHASE_WAIT_ACT_CON) || (station->phase == PHASE_WAIT_ACT_TERM))
+                finishStation(station, CS104_CAMPAIGN_STATION_NEGATIVE, currentTime);
+        }
+        else if (cot == CS101_COT_ACTIVATION_CON) {
+            if (station->phase == PHASE_WAIT_ACT_CON) {
+                if (CS101_ASDU_isNegative(asdu))
+                    finishStation(station, CS104_CAMPAIGN_STATION_NEGATIVE, currentTime);
+                else if (self->procedure == PROCEDURE_CLOCK_SYNC)
+                    finishStation(station, CS104_CAMPAIGN_STATION_SUCCESS, currentTime);
+                else {
+                    station->phase = PHASE_WAIT_ACT_TERM;
+                    station->deadline = currentTime + (uint64_t) self->actTermTimeoutInMs * 1000000;
+                }
+            }
+        }
+        else {
+            /* ACT_TERM */
+            if ((station->phase == PHASE_WAIT_ACT_CON) || (station->phase == PHASE_WAIT_ACT_TERM))
+                finishStation(station, CS104_CAMPAIGN_STATION_SUCCESS, currentTime);
+        }
+
+        if (station->phase != oldPhase)
+            Semaphore_post(self->wakeUp);
+    }
+
+    Semaphore_post(self->lock);
+}
+
+static bool
+sendCommand(CS104_Campaign self, CampaignStation* station)
+{
+    switch (self->procedure) {
+
+    case PROCEDURE_INTERROGATION:
+        return CS104_Connection_sendInterrogationCommand(station->connection, CS101_COT_ACTIVATION, station->ca, self->qoi);
+
+    case PROCEDURE_COUNTER_INTERROGATION:
+        return CS104_Connection_sendCounterInterrogationCommand(station->connection, CS101_COT_ACTIVATION, station->ca, self->qcc);
+
+    case PROCEDURE_CLOCK_SYNC:
+        {
+            struct sCP56Time2a time;
+            uint64_t timestamp = Hal_getTimeInMs();
+
+            if (station->delayInUs > 0)
+                timestamp += (uint64_t) ((station->delayInUs + 500) / 1000);
+
+            CP56Time2a_createFromMsTimestamp(&time, timestamp);
+
+            return CS104_Connection_sendClockSyncCommand(station->connection, station->ca, &time);
+        }
+    }
+
+    return false;
+}
+
+static bool
+sendTestCommand(CampaignStation* station, uint16_t tsc)
+{
+    struct sCP56Time2a time;
+
+    CP56Time2a_createFromMsTimestamp(&time, Hal_getTimeInMs());
+
+    return CS104_Connection_sendTestCommandWithTimestamp(station->connection, station->ca, tsc, &time);
+}
+
+/* Sends the test command or the command (when required). Called with campaign lock; the lock
+ * is released while sending because the confirmation can be received before the send function returns. */
+static void
+sendPendingMessage(CS104_Campaign self, CampaignStation* station, uint16_t tsc)
+{
+    StationPhase sendPhase = station->phase;
+    bool sent;
+
+    if (sendPhase == PHASE_SEND_TEST) {
+        station->phase = PHASE_WAIT_TEST_CON;
+        station->testSentTime = Hal_getMonotonicTimeInNs();
+    }
+    else if (sendPhase == PHASE_SEND_COMMAND)
+        station->phase = PHASE_WAIT_ACT_CON;
+    else
+        return;
+
+    Semaphore_post(self->lock);
+
+    if (sendPhase == PHASE_SEND_TEST)
+        sent = sendTestCommand(station, tsc);
+    else
+        sent = sendCommand(self, station);
+
+    bool bufferFull = (sent == false) && CS104_Connection_isTransmitBufferFull(station->connection);
+
+    Semaphore_wait(self->lock);
+
+    if (sent == false) {
+        if (bufferFull)
+            station->phase = sendPhase; /* retry later */
+        else
+            finishStation(station, CS104_CAMPAIGN_STATION_NOT_CONNECTED, 0);
+    }
+}
+
+static void
+setObservers(CS104_Campaign self, bool set)
+{
+    int i;
+
+    for (i = 0; i < self->numberOfStations; i++) {
+        if (set)
+            CS104_Connection_setASDUObserver(self->stations[i].connection, asduObserver, self);
+        else
+            CS104_Connection_setASDUObserver(self->stations[i].connection, NULL, NULL);
+    }
+}
+
+static void*
+campaignThread(void* parameter)
+{
+    CS104_Campaign self = (CS104_Campaign) parameter;
+
+    setObservers(self, true);
+
+    Semaphore_wait(self->lock);
+
+    while ((self->stopRequested == false) && ((self->nextStation < self->numberOfStations) || (self->numberOfInflight > 0))) {
+
+        uint64_t currentTime = Hal_getMonotonicTimeInNs();
+
+        /* start the procedure at the next stations */
+        while ((self->numberOfInflight < self->maxConcurrency) && (self->nextStation < self->numberOfStations)) {
+            int index = self->nextStation++;
+            CampaignStation* station = &(self->stations[index]);
+
+            station->startTime = currentTime;
+            station->deadline = currentTime + (uint64_t) self->actConTimeoutInMs * 1000000;
+
+            if ((self->procedure == PROCEDURE_CLOCK_SYNC) && self->delayCompensation)
+                station->phase = PHASE_SEND_TEST;
+            else
+                station->phase = PHASE_SEND_COMMAND;
+
+            self->inflight[self->numberOfInflight++] = index;
+        }
+
+        int i = 0;
+        uint64_t nextDeadline = UINT64_MAX;
+        bool retry = false;
+
+        while (i < self->numberOfInflight) {
+            int index = self->inflight[i];
+            CampaignStation* station = &(self->stations[index]);
+
+            sendPendingMessage(self, station, (uint16_t) index);
+
+            if ((station->phase != PHASE_DONE) && (Hal_getMonotonicTimeInNs() > station->deadline))
+                finishStation(station, CS104_CAMPAIGN_STATION_TIMEOUT, 0);
+
+            if (station->phase == PHASE_DONE)
+                self->inflight[i] = self->inflight[--self->numberOfInflight];
+            else {
+                if ((station->phase == PHASE_SEND_TEST) || (station->phase == PHASE_SEND_COMMAND))
+                    retry = true; /* transmit buffer full */
+
+                if (station->deadline < nextDeadline)
+                    nextDeadline = station->deadline;
+
+                i++;
+            }
+        }
+
+        /* stations finished -> start the procedure at the next stations without waiting */
+        if ((self->numberOfInflight < self->maxConcurrency) && (self->nextStation < self->numberOfStations))
+            continue;
+
+        int waitTimeInMs = 1;
+
+        if ((retry == false) && (self->numberOfInflight > 0)) {
+            currentTime = Hal_getMonotonicTimeInNs();
+
+            if (nextDeadline > currentTime)
+                waitTimeInMs = (int) ((nextDeadline - currentTime) / 1000000) + 1;
+        }
+
+        Semaphore_post(self->lock);
+
+        Semaphore_waitTimeout(self->wakeUp, waitTimeInMs);
+
+        Semaphore_wait(self->lock);
+    }
+
+    /* stopped -> cancel the remaining stations */
+    while (self->nextStation < self->numberOfStations)
+        self->inflight[self->numberOfInflight++] = self->nextStation++;
+
+    while (self->numberOfInflight > 0) {
+        CampaignStation* station = &(self->stations[self->inflight[--self->numberOfInflight]]);
+
+        if (station->phase != PHASE_DONE)
+            finishStation(station, CS104_CAMPAIGN_STATION_CANCELED, 0);
+    }
+
+    self->durationInMs = (int) ((Hal_getMonotonicTimeInNs() - self->campaignStartTime) / 1000000);
+
+    Semaphore_post(self->lock);
+
+    setObservers(self, false);
+
+    if (self->completedHandler)
+        self->completedHandler(self->completedHandlerParameter, self);
+
+    self->running = false;
+
+    return NULL;
+}
+
+static bool
+startCampaign(CS104_Campaign self, CampaignProcedure procedure, IEC60870_5_TypeID commandTypeId)
+{
+    if (self->running)
+        return false;
+
+    /* release the thread of the previous campaign */
+    if (self->thread) {
+        Thread_destroy(self->thread);
+        self->thread = NULL;
+    }
+
+    Semaphore_wait(self->lock);
+
+    int i;
+
+    for (i = 0; i < self->numberOfStations; i++) {
+        CampaignStation* station = &(self->stations[i]);
+
+        station->phase = PHASE_WAITING;
+        station->result = CS104_CAMPAIGN_STATION_PENDING;
+        station->delayInUs = -1;
+        station->completionTimeInUs = 0;
+    }
+
+    self->procedure = procedure;
+    self->commandTypeId = commandTypeId;
+    self->nextStation = 0;
+    self->numberOfInflight = 0;
+    self->durationInMs = 0;
+    self->campaignStartTime = Hal_getMonotonicTimeInNs();
+
+    self->stopRequested = false;
+    self->running = true;
+
+    Semaphore_post(self->lock);
+
+    self->thread = Thread_createEx(campaignThread, self, false,
+            self->useThreadAttributes ? &(self->threadAttributes) : NULL);
+
+    if (self->thread == NULL) {
+        self->running = false;
+        return false;
+    }
+
+    Thread_start(self->thread);
+
+    return true;
+}
+
+bool
+CS104_Campaign_startInterrogation(CS104_Campaign self, QualifierOfInterrogation qoi)
+{
+    if (self->running)
+        return false;
+
+    self->qoi = qoi;
+
+    return startCampaign(self, PROCEDURE_INTERROGATION, C_IC_NA_1);
+}
+
+bool
+CS104_Campaign_startCounterInterrogation(CS104_Campaign self, uint8_t qcc)
+{
+    if (self->running)
+        return false;
+
+    self->qcc = qcc;
+
+    return startCampaign(self, PROCEDURE_COUNTER_INTERROGATION, C_CI_NA_1);
+}
+
+bool
+CS104_Campaign_startClockSync(CS104_Campaign self)
+{
+    return startCampaign(self, PROCEDURE_CLOCK_SYNC, C_CS_NA_1);
+}
+
+void
+CS104_Campaign_stop(CS104_Campaign self)
+{
+    self->stopRequested = true;
+
+    if (self->thread) {
+        Semaphore_post(self->wakeUp);
+
+        Thread_destroy(self->thread);
+        self->thread = NULL;
+    }
+}
+
+bool
+CS104_Campaign_isRunning(CS104_Campaign self)
+{
+    return self->running;
+}
+
+CS104_CampaignStationResult
+CS104_Campaign_getStationResult(CS104_Campaign self, int stationIndex)
+{
+    CS104_CampaignStationResult result = CS104_CAMPAIGN_STATION_PENDING;
+
+    if ((stationIndex >= 0) && (stationIndex < self->numberOfStations)) {
+        Semaphore_wait(self->lock);
+        result = self->stations[stationIndex].result;
+        Semaphore_post(self->lock);
+    }
+
+    return result;
+}
+
+int
+CS104_Campaign_getStationDelay(CS104_Campaign self, int stationIndex)
+{
+    int delay = -1;
+
+    if ((stationIndex >= 0) && (stationIndex < self->numberOfStations)) {
+        Semaphore_wait(self->lock);
+        delay = self->stations[stationIndex].delayInUs;
+        Semaphore_post(self->lock);
+    }
+
+    return delay;
+}
+
+static int
+compareInt(const void* a, const void* b)
+{
+    int valA = *((const int*) a);
+    int valB = *((const int*) b);
+
+    return (valA > valB) - (valA < valB);
+}
+
+void
+CS104_Campaign_getStatistics(CS104_Campaign self, CS104_CampaignStatistics* statistics)
+{
+    memset(statistics, 0, sizeof(CS104_CampaignStatistics));
+
+    int* completionTimes = (int*) GLOBAL_MALLOC(self->maxNumberOfStations * sizeof(int));
+
+    if (completionTimes == NULL)
+        return;
+
+    int numberOfTimes = 0;
+    int64_t sum = 0;
+    int i;
+
+    Semaphore_wait(self->lock);
+
+    statistics->numberOfStations = self->numberOfStations;
+    statistics->durationInMs = self->durationInMs;
+
+    for (i = 0; i < self->numberOfStations; i++) {
+        CampaignStation* station = &(self->stations[i]);
+
+        switch (station->result) {
+
+        case CS104_CAMPAIGN_STATION_SUCCESS:
+            statistics->succeeded++;
+            completionTimes[numberOfTimes++] = station->completionTimeInUs;
+            sum += station->completionTimeInUs;
+            break;
+
+        case CS104_CAMPAIGN_STATION_NEGATIVE:
+            statistics->negative++;
+            break;
+
+        case CS104_CAMPAIGN_STATION_TIMEOUT:
+            statistics->timeouts++;
+            break;
+
+        case CS104_CAMPAIGN_STATION_NOT_CONNECTED:
+            statistics->notConnected++;
+            break;
+
+        case CS104_CAMPAIGN_STATION_CANCELED:
+            statistics->canceled++;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    Semaphore_post(self->lock);
+
+    if (numberOfTimes > 0) {
+        qsort(completionTimes, numberOfTimes, sizeof(int), compareInt);
+
+        statistics->minCompletionTimeInUs = completionTimes[0];
+        statistics->maxCompletionTimeInUs = completionTimes[numberOfTimes - 1];
+        statistics->avgCompletionTimeInUs = (int) (sum / numberOfTimes);
+        statistics->p50CompletionTimeInUs = completionTimes[((numberOfTimes - 1) * 50) / 100];
+        statistics->p90CompletionTimeInUs = completionTimes[((numberOfTimes - 1) * 90) / 100];
+        statistics->p99CompletionTimeInUs = completionTimes[((numberOfTimes - 1) * 99) / 100];
+    }
+
+    GLOBAL_FREEMEM(completionTimes);
+}
+
+#endif /* (CONFIG_USE_THREADS == 1) */
@@ -20,6 +20,7 @@
  */
 
 #include "cs104_connection.h"
+#include "cs104_connection_internal.h"
 
 #include <limits.h>
 #include <stdlib.h>
@@ -37,6 +38,7 @@
 #include "information_objects_internal.h"
 #include "lib60870_internal.h"
 #include "cs101_asdu_internal.h"
+#include "cs104_decode_pipeline_internal.h"
 
 struct sCS104_APCIParameters defaultAPCIParameters = {
 		/* .k = */ 12,
@@ -83,6 +85,9 @@ struct sCS104_Connection {
 
     uint8_t recvBuffer[260];
     int recvBufPos;
+    uint64_t recvTimestamp; /* receive time of the first byte of the message in recvBuffer (ns since epoch) */
+
+    bool receiveTimestamps; /* use receive time stamps of the operating system */
 
     int connectTimeoutInMs;
     uint8_t sMessage[6];
@@ -95,15 +100,31 @@ struct sCS104_Connection {
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore sentASDUsLock;
     Semaphore socketWriteLock;
+    Semaphore pendingDecodesLock;
+    Semaphore observerLock;
 #endif
 
 #if (CONFIG_USE_THREADS == 1)
     Thread connectionHandlingThread;
+
+    bool useThreadAttributes;
+    struct sThreadAttributes threadAttributes;
+    char threadName[16];
+
+    CS104_DecodePipeline decodePipeline;
+    int pendingDecodes;       /* received I messages that cannot be confirmed yet (not handled or older message not handled) */
+    int oldestPendingDecode;  /* receive sequence number of the oldest I message that cannot be confirmed yet */
+    uint8_t* handledDecodes;  /* one bit per receive sequence number - I messages handled out of order */
+    int decodeWaiters;        /* number of threads waiting for decodeProgress */
+    Semaphore decodeProgress; /* posted by the workers when an ASDU is handled and a thread is waiting */
+    volatile bool decodeFailure; /* decode pipeline failed to parse a received ASDU */
 #endif
 
     int receiveCount;
     int sendCount;
 
+    uint32_t traceId; /* connection ID used in trace events */
+
     int unconfirmedReceivedIMessages;
 
     /* timeout T2 handling */
@@ -135,6 +156,11 @@ struct sCS104_Connection {
 
     IEC60870_RawMessageHandler rawMessageHandler;
     void* rawMessageHandlerParameter;
+
+    CS101_PointCache pointCache;
+
+    CS104_ASDUObserver asduObserver;
+    void* asduObserverParameter;
 };
 
 
@@ -153,6 +179,116 @@ static uint8_t STOPDT_ACT_MSG[] = { 0x68, 0x04, 0x13, 0x00, 0x00, 0x00 };
 static uint8_t STARTDT_CON_MSG[] = { 0x68, 0x04, 0x0b, 0x00, 0x00, 0x00 };
 #define STARTDT_CON_MSG_SIZE 6
 
+static int
+getPendingDecodes(CS104_Connection self)
+{
+#if (CONFIG_USE_THREADS == 1)
+    int pendingDecodes;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->pendingDecodesLock);
+#endif
+
+    pendingDecodes = self->pendingDecodes;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->pendingDecodesLock);
+#endif
+
+    return pendingDecodes;
+#else
+    (void) self;
+
+    return 0;
+#endif
+}
+
+#if (CONFIG_USE_THREADS == 1)
+/* called by the connection handling thread before the I message is passed to the decode pipeline */
+static void
+addPendingDecode(CS104_Connection self, int sequenceNumber)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->pendingDecodesLock);
+#endif
+
+    if (self->pendingDecodes == 0)
+        self->oldestPendingDecode = sequenceNumber;
+
+    self->pendingDecodes++;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->pendingDecodesLock);
+#endif
+}
+
+/* called by a worker thread when the I message has been handled */
+static void
+removePendingDecode(CS104_Connection self, int sequenceNumber)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->pendingDecodesLock);
+#endif
+
+    self->handledDecodes[sequenceNumber / 8] |= (uint8_t) (1 << (sequenceNumber % 8));
+
+    /* the workers finish out of order - only confirm up to the first I message that is not handled yet */
+    while ((self->pendingDecodes > 0) &&
+            (self->handledDecodes[self->oldestPendingDecode / 8] & (1 << (self->oldestPendingDecode % 8))))
+    {
+        self->handledDecodes[self->oldestPendingDecode / 8] &= (uint8_t) ~(1 << (self->oldestPendingDecode % 8));
+
+        self->oldestPendingDecode = (self->oldestPendingDecode + 1) % 32768;
+        self->pendingDecodes--;
+    }
+
+    bool wakeUp = (self->decodeWaiters > 0);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->pendingDecodesLock);
+#endif
+
+    if (wakeUp)
+        Semaphore_post(self->decodeProgress);
+}
+
+static void
+changeDecodeWaiters(CS104_Connection self, int change)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->pendingDecodesLock);
+#endif
+
+    self->decodeWaiters += change;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->pendingDecodesLock);
+#endif
+}
+
+/* wait until all received I messages are handled by the decode pipeline */
+static void
+waitForPendingDecodes(CS104_Connection self)
+{
+    while (getPendingDecodes(self) > 0) {
+        /* register before checking again so that the post of the worker cannot be missed */
+        changeDecodeWaiters(self, 1);
+
+        if (getPendingDecodes(self) > 0)
+            Semaphore_waitTimeout(self->decodeProgress, 100);
+
+        changeDecodeWaiters(self, -1);
+    }
+}
+#endif /* (CONFIG_USE_THREADS == 1) */
+
+/* receive sequence number to be confirmed - I messages still in the decode pipeline are not confirmed */
+static int
+getConfirmedReceiveCount(CS104_Connection self)
+{
+    return (self->receiveCount - getPendingDecodes(self) + 32768) % 32768;
+}
+
 static int
 writeToSocket(CS104_Connection self, uint8_t* buf, int size)
 {
@@ -160,8 +296,14 @@ writeToSocket(CS104_Connection self, uint8_t* buf, int size)
         self->rawMessageHandler(self->rawMessageHandlerParameter, buf, size, true);
 
 #if (CONFIG_CS104_SUPPORT_TLS == 1)
-    if (self->tlsSocket)
-        return TLSSocket_write(self->tlsSocket, buf, size);
+    if (self->tlsSocket) {
+        int ret;
+
+        /* no output buffer -> the record has to be sent before the next message is written */
+        while ((ret = TLSSocket_write(self->tlsSocket, buf, size)) == 0);
+
+        return ret;
+    }
     else
         return Socket_write(self->socket, buf, size);
 #else
@@ -186,8 +328,12 @@ sendSMessage(CS104_Connection self)
 #endif
     uint8_t* msg = self->sMessage;
 
-    msg [4] = (uint8_t) ((self->receiveCount % 128) * 2);
-    msg [5] = (uint8_t) (self->receiveCount / 128);
+    int receiveCount = getConfirmedReceiveCount(self);
+
+    msg [4] = (uint8_t) ((receiveCount % 128) * 2);
+    msg [5] = (uint8_t) (receiveCount / 128);
+
+    TRACE_POINT(LIB60870_TRACE_SEND_S, self->traceId, receiveCount, 0);
 
     writeToSocket(self, msg, 6);
 #if (CONFIG_USE_SEMAPHORES == 1)
@@ -198,7 +344,9 @@ sendSMessage(CS104_Connection self)
 static int
 sendIMessage(CS104_Connection self, Frame frame)
 {
-    T104Frame_prepareToSend((T104Frame) frame, self->sendCount, self->receiveCount);
+    int receiveCount = getConfirmedReceiveCount(self);
+
+    T104Frame_prepareToSend((T104Frame) frame, self->sendCount, receiveCount);
 
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_wait(self->socketWriteLock);
@@ -208,9 +356,11 @@ sendIMessage(CS104_Connection self, Frame frame)
     Semaphore_post(self->socketWriteLock);
 #endif
 
+    TRACE_POINT(LIB60870_TRACE_SEND_I, self->traceId, self->sendCount, receiveCount);
+
     self->sendCount = (self->sendCount + 1) % 32768;
 
-    self->unconfirmedReceivedIMessages = false;
+    self->unconfirmedReceivedIMessages = (self->receiveCount - receiveCount + 32768) % 32768;
     self->timeoutT2Trigger = false;
 
     return self->sendCount;
@@ -236,13 +386,32 @@ createConnection(const char* hostname, int tcpPort)
         self->rawMessageHandler = NULL;
         self->rawMessageHandlerParameter = NULL;
 
+        self->pointCache = NULL;
+
+        self->asduObserver = NULL;
+        self->asduObserverParameter = NULL;
+
+        self->receiveTimestamps = false;
+
+        /* not connected -> send functions fail until connect is called */
+        self->running = false;
+
 #if (CONFIG_USE_SEMAPHORES == 1)
         self->sentASDUsLock = Semaphore_create(1);
         self->socketWriteLock = Semaphore_create(1);
+        self->pendingDecodesLock = Semaphore_create(1);
+        self->observerLock = Semaphore_create(1);
 #endif
 
 #if (CONFIG_USE_THREADS == 1)
         self->connectionHandlingThread = NULL;
+        self->useThreadAttributes = false;
+        self->decodePipeline = NULL;
+        self->pendingDecodes = 0;
+        self->oldestPendingDecode = 0;
+        self->handledDecodes = NULL;
+        self->decodeWaiters = 0;
+        self->decodeProgress = Semaphore_create(0);
 #endif
 
 #if (CONFIG_CS104_SUPPORT_TLS == 1)
@@ -306,8 +475,19 @@ resetConnection(CS104_Connection self)
     self->receiveCount = 0;
     self->sendCount = 0;
 
+    self->traceId = lib60870_trace_newConnectionId();
+
     self->unconfirmedReceivedIMessages = 0;
     self->lastConfirmationTime = 0xffffffffffffffff;
+
+#if (CONFIG_USE_THREADS == 1)
+    self->pendingDecodes = 0;
+    self->oldestPendingDecode = 0;
+    self->decodeFailure = false;
+
+    if (self->handledDecodes)
+        memset(self->handledDecodes, 0, 32768 / 8);
+#endif
     self->timeoutT2Trigger = false;
 
     self->oldestSentASDU = -1;
@@ -339,6 +519,7 @@ checkSequenceNumber(CS104_Connection self, int seqNo)
     bool seqNoIsValid = false;
     bool counterOverflowDetected = false;
     int oldestValidSeqNo = -1;
+    int confirmedMessages = 0;
 
     if (self->oldestSentASDU == -1) { /* if k-Buffer is empty */
         if (seqNo == self->sendCount)
@@ -382,7 +563,7 @@ checkSequenceNumber(CS104_Connection self, int seqNo)
                 if (seqNo == oldestValidSeqNo)
                     break;
 
-
+                confirmedMessages++;
 
                 if (self->sentASDUs [self->oldestSentASDU].seqNo == seqNo) {
                     /* we arrived at the seq# that has been confirmed */
@@ -409,6 +590,9 @@ checkSequenceNumber(CS104_Connection self, int seqNo)
         }
     }
 
+    if (confirmedMessages > 0)
+        TRACE_POINT(LIB60870_TRACE_ACK, self->traceId, seqNo, confirmedMessages);
+
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_post(self->sentASDUsLock);
 #endif
@@ -431,6 +615,27 @@ isSentBufferFull(CS104_Connection self)
         return false;
 }
 
+void
+CS104_Connection_setPointCache(CS104_Connection self, CS101_PointCache cache)
+{
+    self->pointCache = cache;
+}
+
+void
+CS104_Connection_setASDUObserver(CS104_Connection self, CS104_ASDUObserver observer, void* parameter)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->observerLock);
+#endif
+
+    self->asduObserver = observer;
+    self->asduObserverParameter = parameter;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->observerLock);
+#endif
+}
+
 void
 CS104_Connection_close(CS104_Connection self)
 {
@@ -455,6 +660,15 @@ CS104_Connection_destroy(CS104_Connection self)
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_destroy(self->sentASDUsLock);
     Semaphore_destroy(self->socketWriteLock);
+    Semaphore_destroy(self->pendingDecodesLock);
+    Semaphore_destroy(self->observerLock);
+#endif
+
+#if (CONFIG_USE_THREADS == 1)
+    Semaphore_destroy(self->decodeProgress);
+
+    if (self->handledDecodes)
+        GLOBAL_FREEMEM(self->handledDecodes);
 #endif
 
     GLOBAL_FREEMEM(self);
@@ -486,6 +700,47 @@ CS104_Connection_setConnectTimeout(CS104_Connection self, int millies)
     self->connectTimeoutInMs = millies;
 }
 
+void
+CS104_Connection_setReceiveTimestamps(CS104_Connection self, bool enable)
+{
+    self->receiveTimestamps = enable;
+}
+
+#if (CONFIG_USE_THREADS == 1)
+void
+CS104_Connection_setThreadAttributes(CS104_Connection self, ThreadAttributes attributes)
+{
+    if (attributes) {
+        self->threadAttributes = *attributes;
+        self->useThreadAttributes = true;
+
+        if (attributes->name) {
+            strncpy(self->threadName, attributes->name, sizeof(self->threadName) - 1);
+            self->threadName[sizeof(self->threadName) - 1] = 0;
+            self->threadAttributes.name = self->threadName;
+        }
+    }
+    else
+        self->useThreadAttributes = false;
+}
+
+void
+CS104_Connection_setDecodePipeline(CS104_Connection self, CS104_DecodePipeline pipeline)
+{
+    /* one bit for each possible receive sequence number */
+    if ((pipeline != NULL) && (self->handledDecodes == NULL)) {
+        self->handledDecodes = (uint8_t*) GLOBAL_CALLOC(1, 32768 / 8);
+
+        if (self->handledDecodes == NULL) {
+            DEBUG_PRINT("Failed to allocate memory for the decode pipeline -> handle ASDUs in connection thread\n");
+            pipeline = NULL;
+        }
+    }
+
+    self->decodePipeline = pipeline;
+}
+#endif /* (CONFIG_USE_THREADS == 1) */
+
 CS104_APCIParameters
 CS104_Connection_getAPCIParameters(CS104_Connection self)
 {
@@ -508,6 +763,29 @@ readFromSocket(CS104_Connection self, uint8_t* buffer, int size)
 #endif
 }
 
+/**
+ * \brief Read from socket and get the receive time of the data
+ *
+ * \return number of bytes read, or -1 in case of an error
+ */
+static int
+readFromSocketWithTimestamp(CS104_Connection self, uint8_t* buffer, int size, uint64_t* timestamp)
+{
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsSocket != NULL) {
+        /* time stamps of the TCP segments are not available for the decrypted data */
+        int readBytes = TLSSocket_read(self->tlsSocket, buffer, size);
+
+        if (readBytes > 0)
+            *timestamp = Hal_getTimeInNs();
+
+        return readBytes;
+    }
+#endif
+
+    return Socket_readWithTimestamp(self->socket, buffer, size, timestamp);
+}
+
 /**
  * \brief Read message part into receive buffer
  *
@@ -521,7 +799,12 @@ receiveMessage(CS104_Connection self)
 
     /* read start byte */
     if (bufPos == 0) {
-        int readFirst = readFromSocket(self, buffer, 1);
+        int readFirst;
+
+        if (self->receiveTimestamps)
+            readFirst = readFromSocketWithTimestamp(self, buffer, 1, &(self->recvTimestamp));
+        else
+            readFirst = readFromSocket(self, buffer, 1);
 
         if (readFirst < 1)
             return readFirst;
@@ -587,15 +870,144 @@ checkConfirmTimeout(CS104_Connection self, uint64_t currentTime)
     return false;
 }
 
+/* received I messages that can be confirmed (i.e. are not waiting in the decode pipeline) */
+static int
+getConfirmableMessages(CS104_Connection self)
+{
+    return self->unconfirmedReceivedIMessages - getPendingDecodes(self);
+}
+
 static void
 confirmOutstandingMessages(CS104_Connection self)
 {
     self->lastConfirmationTime = Hal_getTimeInMs();
-    self->unconfirmedReceivedIMessages = 0;
+    self->unconfirmedReceivedIMessages = getPendingDecodes(self);
     self->timeoutT2Trigger = false;
     sendSMessage(self);
 }
 
+/**
+ * \brief Decode the ASDU and pass it to the point cache and the ASDU received handler
+ *
+ * \return false when the ASDU cannot be parsed
+ */
+static bool
+handleASDU(CS104_Connection self, uint8_t* buffer, int asduSize, uint64_t receiveTimestamp)
+{
+    CS101_ASDU asdu = CS101_ASDU_createFromBuffer((CS101_AppLayerParameters)&(self->alParameters), buffer, asduSize);
+
+    if (asdu == NULL)
+        return false;
+
+    if (self->receiveTimestamps) {
+        CS101_ASDU_setReceiveTimestamp(asdu, receiveTimestamp);
+
+        TRACE_POINT(LIB60870_TRACE_RECV_DELAY, self->traceId, (Hal_getTimeInNs() - receiveTimestamp) / 1000,
+                CS101_ASDU_getTypeID(asdu));
+    }
+
+    if (self->asduObserver != NULL) {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->observerLock);
+#endif
+
+        if (self->asduObserver != NULL)
+            self->asduObserver(self->asduObserverParameter, self, asdu);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->observerLock);
+#endif
+    }
+
+    if (self->pointCache != NULL)
+        CS101_PointCache_handleASDU(self->pointCache, asdu);
+
+    if (self->receivedHandler != NULL) {
+        TRACE_POINT(LIB60870_TRACE_HANDLER_ENTER, self->traceId, CS101_ASDU_getTypeID(asdu), CS101_ASDU_getCOT(asdu));
+
+        bool handled = self->receivedHandler(self->receivedHandlerParameter, -1, asdu);
+
+        TRACE_POINT(LIB60870_TRACE_HANDLER_EXIT, self->traceId, CS101_ASDU_getTypeID(asdu), handled);
+
+        (void) handled;
+    }
+
+    CS101_ASDU_destroy(asdu);
+
+    return true;
+}
+
+#if (CONFIG_USE_THREADS == 1)
+/* called by a worker thread of the decode pipeline */
+static void
+decodeJobHandler(void* parameter, int sequenceNumber, uint8_t* asdu, int asduSize, uint64_t receiveTimestamp)
+{
+    CS104_Connection self = (CS104_Connection) parameter;
+
+    if (handleASDU(self, asdu, asduSize, receiveTimestamp) == false)
+        self->decodeFailure = true;
+
+    removePendingDecode(self, sequenceNumber);
+}
+
+/**
+ * \brief Pass the ASDU to the decode pipeline
+ *
+ * Waits while the queue of the responsible worker is full.
+ *
+ * \param sequenceNumber the send sequence number N(S) of the received I message
+ *
+ * \return false when the connection was closed while waiting
+ */
+static bool
+enqueueASDU(CS104_Connection self, int sequenceNumber, uint8_t* asdu, int asduSize)
+{
+    uint32_t ca = 0;
+
+    int caIndex = 2 + self->alParameters.sizeOfCOT;
+
+    if (asduSize > caIndex) {
+        ca = asdu[caIndex];
+
+        if ((self->alParameters.sizeOfCA > 1) && (asduSize > (caIndex + 1)))
+            ca += (asdu[caIndex + 1] * 0x100);
+    }
+
+    /* keep the order of the ASDUs of each station */
+    uint32_t partitionKey = ((uint32_t) (((uintptr_t) self) >> 4) * 31) + ca;
+
+    addPendingDecode(self, sequenceNumber);
+
+    if (CS104_DecodePipeline_enqueue(self->decodePipeline, partitionKey, decodeJobHandler, self, sequenceNumber,
+            asdu, asduSize, self->recvTimestamp))
+        return true;
+
+    CS104_DecodePipeline_countQueueFull(self->decodePipeline);
+
+    while (true) {
+        /* register before the next attempt so that the post of the worker cannot be missed */
+        changeDecodeWaiters(self, 1);
+
+        bool queued = CS104_DecodePipeline_enqueue(self->decodePipeline, partitionKey, decodeJobHandler, self,
+                sequenceNumber, asdu, asduSize, self->recvTimestamp);
+
+        if ((queued == false) && (self->close == false))
+            Semaphore_waitTimeout(self->decodeProgress, 100);
+
+        changeDecodeWaiters(self, -1);
+
+        if (queued)
+            return true;
+
+        if (self->close) {
+            /* the connection is closed - no more confirmations are sent */
+            removePendingDecode(self, sequenceNumber);
+            return false;
+        }
+    }
+}
+#endif /* (CONFIG_USE_THREADS == 1) */
+
 static bool
 checkMessage(CS104_Connection self, uint8_t* buffer, int msgSize)
 {
@@ -615,6 +1027,7 @@ checkMessage(CS104_Connection self, uint8_t* buffer, int msgSize)
         int frameRecvSequenceNumber = ((buffer [5] * 0x100) + (buffer [4] & 0xfe)) / 2;
 
         DEBUG_PRINT("Received I frame: N(S) = %i N(R) = %i\n", frameSendSequenceNumber, frameRecvSequenceNumber);
+        TRACE_POINT(LIB60870_TRACE_RECV_I, self->traceId, frameSendSequenceNumber, frameRecvSequenceNumber);
 
         /* check the receive sequence number N(R) - connection will be closed on an unexpected value */
         if (frameSendSequenceNumber != self->receiveCount) {
@@ -628,15 +1041,14 @@ checkMessage(CS104_Connection self, uint8_t* buffer, int msgSize)
         self->receiveCount = (self->receiveCount + 1) % 32768;
         self->unconfirmedReceivedIMessages++;
 
-        CS101_ASDU asdu = CS101_ASDU_createFromBuffer((CS101_AppLayerParameters)&(self->alParameters), buffer + 6, msgSize - 6);
-
-        if (asdu != NULL) {
-            if (self->receivedHandler != NULL)
-                self->receivedHandler(self->receivedHandlerParameter, -1, asdu);
-
-            CS101_ASDU_destroy(asdu);
+#if (CONFIG_USE_THREADS == 1)
+        if (self->decodePipeline != NULL) {
+            if (enqueueASDU(self, frameSendSequenceNumber, buffer + 6, msgSize - 6) == false)
+                return false;
         }
         else
+#endif
+        if (handleASDU(self, buffer + 6, msgSize - 6, self->recvTimestamp) == false)
             return false;
 
     }
@@ -714,6 +1126,7 @@ handleTimeouts(CS104_Connection self)
 
         if (self->outstandingTestFCConMessages > 2) {
             DEBUG_PRINT("Timeout for TESTFR_CON message\n");
+            TRACE_POINT(LIB60870_TRACE_TIMEOUT, self->traceId, 3, self->sendCount);
 
             /* close connection */
             retVal = false;
@@ -735,9 +1148,10 @@ handleTimeouts(CS104_Connection self)
         }
     }
 
-    if (self->unconfirmedReceivedIMessages > 0) {
+    if (getConfirmableMessages(self) > 0) {
 
         if (checkConfirmTimeout(self, currentTime)) {
+            TRACE_POINT(LIB60870_TRACE_TIMEOUT, self->traceId, 2, self->receiveCount);
             confirmOutstandingMessages(self);
         }
     }
@@ -745,6 +1159,7 @@ handleTimeouts(CS104_Connection self)
     if (self->uMessageTimeout != 0) {
         if (currentTime > self->uMessageTimeout) {
             DEBUG_PRINT("U message T1 timeout\n");
+            TRACE_POINT(LIB60870_TRACE_TIMEOUT, self->traceId, 1, self->sendCount);
             retVal = false;
             goto exit_function;
         }
@@ -758,6 +1173,7 @@ handleTimeouts(CS104_Connection self)
         if (currentTime > self->sentASDUs[self->oldestSentASDU].sentTime) {
             if ((currentTime - self->sentASDUs[self->oldestSentASDU].sentTime) >= (uint64_t) (self->parameters.t1 * 1000)) {
                 DEBUG_PRINT("I message timeout\n");
+                TRACE_POINT(LIB60870_TRACE_TIMEOUT, self->traceId, 1, self->sentASDUs[self->oldestSentASDU].seqNo);
                 retVal = false;
             }
         }
@@ -787,6 +1203,9 @@ handleConnection(void* parameter)
 
         if (Socket_connect(self->socket, self->hostname, self->tcpPort)) {
 
+            if (self->receiveTimestamps)
+                Socket_setReceiveTimestamps(self->socket, true);
+
 #if (CONFIG_CS104_SUPPORT_TLS == 1)
             if (self->tlsConfig != NULL) {
                 self->tlsSocket = TLSSocket_create(self->socket, self->tlsConfig, false);
@@ -806,6 +1225,8 @@ handleConnection(void* parameter)
 
                 self->conState = STATE_INACTIVE;
 
+                TRACE_POINT(LIB60870_TRACE_CONNECT, self->traceId, 1, 0);
+
                 /* Call connection handler */
                 if (self->connectionHandler != NULL)
                     self->connectionHandler(self->connectionHandlerParameter, self, CS104_CONNECTION_OPENED);
@@ -814,12 +1235,20 @@ handleConnection(void* parameter)
 
                 bool loopRunning = true;
 
+                if (handleSet == NULL) {
+                    DEBUG_PRINT("Cannot create handle set (out of memory) -> close connection\n");
+                    loopRunning = false;
+                }
+
                 while (loopRunning) {
 
                     Handleset_reset(handleSet);
                     Handleset_addSocket(handleSet, self->socket);
 
-                    if (Handleset_waitReady(handleSet, 100)) {
+                    /* shorter wait while the decode pipeline has messages to be confirmed */
+                    int waitTime = (getPendingDecodes(self) > 0) ? 10 : 100;
+
+                    if (Handleset_waitReady(handleSet, waitTime)) {
                         int bytesRec = receiveMessage(self);
 
                         if (bytesRec == -1) {
@@ -839,8 +1268,20 @@ handleConnection(void* parameter)
                             }
                         }
 
-                        if ((self->unconfirmedReceivedIMessages >= self->parameters.w) || (self->conState == STATE_WAITING_FOR_STOPDT_CON)) {
+                        if ((getConfirmableMessages(self) >= self->parameters.w) || (self->conState == STATE_WAITING_FOR_STOPDT_CON)) {
+                            confirmOutstandingMessages(self);
+                        }
+                    }
+
+                    if (self->decodePipeline != NULL) {
+                        /* confirm the I messages that have been handled by the decode pipeline in the meantime */
+                        if (getConfirmableMessages(self) >= self->parameters.w)
                             confirmOutstandingMessages(self);
+
+                        if (self->decodeFailure) {
+                            /* close connection on error */
+                            loopRunning = false;
+                            self->failure = true;
                         }
                     }
 
@@ -851,7 +1292,13 @@ handleConnection(void* parameter)
                         loopRunning = false;
                 }
 
-                Handleset_destroy(handleSet);
+                if (handleSet)
+                    Handleset_destroy(handleSet);
+
+                /* the workers of the decode pipeline must not use the connection after the CLOSED event */
+                waitForPendingDecodes(self);
+
+                TRACE_POINT(LIB60870_TRACE_DISCONNECT, self->traceId, 1, 0);
 
                 /* Call connection handler */
                 if (self->connectionHandler != NULL)
@@ -902,7 +1349,8 @@ CS104_Connection_connectAsync(CS104_Connection self)
         self->connectionHandlingThread = NULL;
     }
 
-    self->connectionHandlingThread = Thread_create(handleConnection, (void*) self, false);
+    self->connectionHandlingThread = Thread_createEx(handleConnection, (void*) self, false,
+            self->useThreadAttributes ? &(self->threadAttributes) : NULL);
 
     if (self->connectionHandlingThread)
         Thread_start(self->connectionHandlingThread);
@@ -0,0 +1,269 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <string.h>
+
+#include "cs104_decode_pipeline_internal.h"
+#include "hal_thread.h"
+#include "lib_memory.h"
+#include "lib60870_config.h"
+#include "lib60870_internal.h"
+
+#if (CONFIG_USE_THREADS == 1)
+
+typedef struct {
+    CS104_DecodeJobHandler handler;
+    void* parameter;
+    int sequenceNumber;
+    uint64_t receiveTimestamp;
+    int asduSize;
+    uint8_t asdu[CS104_DECODE_PIPELINE_MAX_ASDU_SIZE];
+} DecodeJob;
+
+typedef struct sDecodeWorker* DecodeWorker;
+
+struct sDecodeWorker {
+    CS104_DecodePipeline pipeline;
+    Thread thread;
+
+    DecodeJob* jobs; /* ring buffer */
+    int oldestJob;
+    int numberOfJobs;
+
+    uint64_t handledASDUs;
+
+    Semaphore jobsLock;
+    Semaphore jobsAvailable; /* counts the queued jobs */
+};
+
+struct sCS104_DecodePipeline {
+    struct sDecodeWorker* workers;
+    int numberOfWorkers;
+    int queueSize;
+
+    uint64_t queueFull;
+    Semaphore statisticsLock;
+
+    volatile bool running;
+};
+
+static void*
+workerThread(void* parameter)
+{
+    DecodeWorker self = (DecodeWorker) parameter;
+
+    while (true) {
+        Semaphore_wait(self->jobsAvailable);
+
+        Semaphore_wait(self->jobsLock);
+
+        if (self->numberOfJobs == 0) {
+            Semaphore_post(self->jobsLock);
+
+            if (self->pipeline->running == false)
+                break;
+
+            continue;
+        }
+
+        /* the entry is not reused before it is released below */
+        DecodeJob* job = &(self->jobs[self->oldestJob]);
+
+        Semaphore_post(self->jobsLock);
+
+        job->handler(job->parameter, job->sequenceNumber, job->asdu, job->asduSize, job->receiveTimestamp);
+
+        Semaphore_wait(self->jobsLock);
+
+        self->oldestJob = (self->oldestJob + 1) % self->pipeline->queueSize;
+        self->numberOfJobs--;
+        self->handledASDUs++;
+
+        Semaphore_post(self->jobsLock);
+    }
+
+    return NULL;
+}
+
+CS104_DecodePipeline
+CS104_DecodePipeline_create(int numberOfWorkers, int queueSize)
+{
+    return CS104_DecodePipeline_createEx(numberOfWorkers, queueSize, NULL);
+}
+
+CS104_DecodePipeline
+CS104_DecodePipeline_createEx(int numberOfWorkers, int queueSize, ThreadAttributes attributes)
+{
+    if (numberOfWorkers < 1)
+        numberOfWorkers = 1;
+
+    if (queueSize < 1)
+        queueSize = 1;
+
+    CS104_DecodePipeline self = (CS104_DecodePipeline) GLOBAL_CALLOC(1, sizeof(struct sCS104_DecodePipeline));
+
+    if (self == NULL)
+        return NULL;
+
+    self->workers = (DecodeWorker) GLOBAL_CALLOC(numberOfWorkers, sizeof(struct sDecodeWorker));
+
+    if (self->workers == NULL) {
+        GLOBAL_FREEMEM(self);
+        return NULL;
+    }
+
+    self->queueSize = queueSize;
+    self->statisticsLock = Semaphore_create(1);
+    self->running = true;
+
+    int i;
+
+    for (i = 0; i < numberOfWorkers; i++) {
+        DecodeWorker worker = &(self->workers[i]);
+
+        worker->pipeline = self;
+        worker->jobs = (DecodeJob*) GLOBAL_CALLOC(queueSize, sizeof(DecodeJob));
+
+        if (worker->jobs == NULL)
+            break;
+
+        worker->jobsLock = Semaphore_create(1);
+        worker->jobsAvailable = Semaphore_create(0);
+
+        worker->thread = Thread_createEx(workerThread, (void*) worker, false, attributes);
+
+        if (worker->thread == NULL) {
+            Semaphore_destroy(worker->jobsLock);
+            Semaphore_destroy(worker->jobsAvailable);
+            GLOBAL_FREEMEM(worker->jobs);
+            break;
+        }
+
+        self->numberOfWorkers++;
+
+        Thread_start(worker->thread);
+    }
+
+    if (self->numberOfWorkers < numberOfWorkers) {
+        DEBUG_PRINT("Failed to start decode pipeline workers\n");
+        CS104_DecodePipeline_destroy(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void
+CS104_DecodePipeline_destroy(CS104_DecodePipeline self)
+{
+    if (self) {
+        int i;
+
+        self->running = false;
+
+        for (i = 0; i < self->numberOfWorkers; i++)
+            Semaphore_post(self->workers[i].jobsAvailable);
+
+        for (i = 0; i < self->numberOfWorkers; i++) {
+            DecodeWorker worker = &(self->workers[i]);
+
+            Thread_destroy(worker->thread);
+
+            Semaphore_destroy(worker->jobsLock);
+            Semaphore_destroy(worker->jobsAvailable);
+            GLOBAL_FREEMEM(worker->jobs);
+        }
+
+        Semaphore_destroy(self->statisticsLock);
+
+        GLOBAL_FREEMEM(self->workers);
+        GLOBAL_FREEMEM(self);
+    }
+}
+
+void
+CS104_DecodePipeline_getStatistics(CS104_DecodePipeline self, CS104_DecodePipelineStatistics* statistics)
+{
+    int i;
+
+    Semaphore_wait(self->statisticsLock);
+    statistics->queueFull = self->queueFull;
+    Semaphore_post(self->statisticsLock);
+
+    statistics->handledASDUs = 0;
+
+    for (i = 0; i < self->numberOfWorkers; i++) {
+        DecodeWorker worker = &(self->workers[i]);
+
+        Semaphore_wait(worker->jobsLock);
+        statistics->handledASDUs += worker->handledASDUs;
+        Semaphore_post(worker->jobsLock);
+    }
+}
+
+bool
+CS104_DecodePipeline_enqueue(CS104_DecodePipeline self, uint32_t partitionKey, CS104_DecodeJobHandler handler,
+        void* parameter, int sequenceNumber, uint8_t* asdu, int asduSize, uint64_t receiveTimestamp)
+{
+    if ((asduSize < 1) || (asduSize > CS104_DECODE_PIPELINE_MAX_ASDU_SIZE))
+        return false;
+
+    /* Fibonacci hashing to spread similar keys (e.g. consecutive CAs) over the workers */
+    uint32_t hash = partitionKey * 0x9E3779B9U;
+
+    DecodeWorker worker = &(self->workers[(hash >> 16) % (uint32_t) self->numberOfWorkers]);
+
+    bool queued = false;
+
+    Semaphore_wait(worker->jobsLock);
+
+    if (worker->numberOfJobs < self->queueSize) {
+        DecodeJob* job = &(worker->jobs[(worker->oldestJob + worker->numberOfJobs) % self->queueSize]);
+
+        job->handler = handler;
+        job->parameter = parameter;
+        job->sequenceNumber = sequenceNumber;
+        job->receiveTimestamp = receiveTimestamp;
+        job->asduSize = asduSize;
+        memcpy(job->asdu, asdu, asduSize);
+
+        worker->numberOfJobs++;
+
+        queued = true;
+    }
+
+    Semaphore_post(worker->jobsLock);
+
+    if (queued)
+        Semaphore_post(worker->jobsAvailable);
+
+    return queued;
+}
+
+void
+CS104_DecodePipeline_countQueueFull(CS104_DecodePipeline self)
+{
+    Semaphore_wait(self->statisticsLock);
+    self->queueFull++;
+    Semaphore_post(self->statisticsLock);
+}
+
+#endif /* (CONFIG_USE_THREADS == 1) */
@@ -0,0 +1,532 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <stdlib.h>
+
+#include "cs104_redundant_connection.h"
+#include "hal_thread.h"
+#include "hal_time.h"
+#include "lib_memory.h"
+#include "lib60870_config.h"
+#include "lib60870_internal.h"
+
+#if (CONFIG_USE_THREADS == 1)
+
+#define CS104_REDUNDANT_CONNECTION_MAX_SERVERS 8
+
+typedef enum {
+    SERVER_STATE_DISCONNECTED,
+    SERVER_STATE_CONNECTING,
+    SERVER_STATE_STANDBY,  /* connected, STOPDT */
+    SERVER_STATE_STARTING, /* STARTDT_ACT sent */
+    SERVER_STATE_ACTIVE    /* STARTDT_CON received */
+} ServerState;
+
+typedef struct sRedundantServer* RedundantServer;
+
+struct sRedundantServer {
+    CS104_RedundantConnection parent;
+    int index;
+    CS104_Connection connection;
+    ServerState state;
+    uint64_t nextReconnectTime;
+    uint64_t connectTimeout; /* a failed connect attempt does not cause a CLOSED event */
+};
+
+struct sCS104_RedundantConnection {
+    struct sRedundantServer servers[CS104_REDUNDANT_CONNECTION_MAX_SERVERS];
+    int numberOfServers;
+
+    int activeServer;   /* -1 = none */
+    int startingServer; /* -1 = none */
+    int previousServer; /* active server before the running switchover */
+    uint64_t switchoverStartTime;
+
+    /* after start: wait until this time for the connections of preferred servers */
+    uint64_t preferredServerDeadline;
+
+    int reconnectInterval;
+
+    bool running;
+    Thread supervisionThread;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore stateLock;
+    Semaphore wakeUpSupervision; /* posted when the supervision thread has to re-evaluate the server states */
+#endif
+
+    CS101_ASDUReceivedHandler asduReceivedHandler;
+    void* asduReceivedHandlerParameter;
+
+    CS104_SwitchoverHandler switchoverHandler;
+    void* switchoverHandlerParameter;
+};
+
+static void
+lockState(CS104_RedundantConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->stateLock);
+#endif
+}
+
+static void
+unlockState(CS104_RedundantConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->stateLock);
+#endif
+}
+
+static void
+wakeUpSupervision(CS104_RedundantConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->wakeUpSupervision);
+#endif
+}
+
+CS104_RedundantConnection
+CS104_RedundantConnection_create()
+{
+    CS104_RedundantConnection self = (CS104_RedundantConnection) GLOBAL_CALLOC(1, sizeof(struct sCS104_RedundantConnection));
+
+    if (self) {
+        self->numberOfServers = 0;
+        self->activeServer = -1;
+        self->startingServer = -1;
+        self->previousServer = -1;
+        self->reconnectInterval = 1000;
+        self->running = false;
+        self->supervisionThread = NULL;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->stateLock = Semaphore_create(1);
+        self->wakeUpSupervision = Semaphore_create(0);
+#endif
+    }
+
+    return self;
+}
+
+/*
+ * select the most preferred connected standby server - has to be called with state lock
+ *
+ * After start the connection attempts of preferred servers are awaited for one reconnect interval.
+ */
+static RedundantServer
+getStandbyServer(CS104_RedundantConnection self, uint64_t currentTime)
+{
+    int i;
+
+    for (i = 0; i < self->numberOfServers; i++) {
+        if (self->servers[i].state == SERVER_STATE_STANDBY)
+            return &(self->servers[i]);
+
+        if ((self->servers[i].state == SERVER_STATE_CONNECTING) && (currentTime < self->preferredServerDeadline))
+            return NULL;
+    }
+
+    return NULL;
+}
+
+/* has to be called with state lock */
+static void
+startServer(CS104_RedundantConnection self, RedundantServer server, uint64_t switchoverStartTime)
+{
+    server->state = SERVER_STATE_STARTING;
+
+    self->startingServer = server->index;
+    self->switchoverStartTime = switchoverStartTime;
+
+    DEBUG_PRINT("REDUNDANT CONNECTION: activate server %i\n", server->index);
+
+    CS104_Connection_sendStartDT(server->connection);
+}
+
+static bool
+asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    RedundantServer server = (RedundantServer) parameter;
+    CS104_RedundantConnection self = server->parent;
+
+    lockState(self);
+
+    bool isActive = ((server->index == self->activeServer) || (server->index == self->startingServer));
+
+    unlockState(self);
+
+    if (isActive) {
+        if (self->asduReceivedHandler)
+            return self->asduReceivedHandler(self->asduReceivedHandlerParameter, address, asdu);
+    }
+
+    return true;
+}
+
+static void
+connectionHandler(void* parameter, CS104_Connection connection, CS104_ConnectionEvent event)
+{
+    RedundantServer server = (RedundantServer) parameter;
+    CS104_RedundantConnection self = server->parent;
+
+    bool callSwitchoverHandler = false;
+    int oldServer = -1;
+    int switchoverTime = 0;
+
+    UNUSED_PARAMETER(connection);
+
+    lockState(self);
+
+    uint64_t currentTime = Hal_getTimeInMs();
+
+    switch (event) {
+
+    case CS104_CONNECTION_OPENED:
+
+        server->state = SERVER_STATE_STANDBY;
+
+        if (self->running && (self->activeServer == -1) && (self->startingServer == -1)) {
+            RedundantServer standby = getStandbyServer(self, currentTime);
+
+            if (standby)
+                startServer(self, standby, currentTime);
+        }
+
+        break;
+
+    case CS104_CONNECTION_STARTDT_CON_RECEIVED:
+
+        if (server->state == SERVER_STATE_STARTING) {
+            server->state = SERVER_STATE_ACTIVE;
+
+            oldServer = self->previousServer;
+
+            self->activeServer = server->index;
+            self->startingServer = -1;
+            self->previousServer = -1;
+
+            switchoverTime = (int) (currentTime - self->switchoverStartTime);
+            callSwitchoverHandler = true;
+
+            DEBUG_PRINT("REDUNDANT CONNECTION: server %i active (switchover time: %i ms)\n", server->index, switchoverTime);
+        }
+
+        break;
+
+    case CS104_CONNECTION_STOPDT_CON_RECEIVED:
+
+        if (server->state != SERVER_STATE_STARTING)
+            server->state = SERVER_STATE_STANDBY;
+
+        break;
+
+    case CS104_CONNECTION_CLOSED:
+
+        server->state = SERVER_STATE_DISCONNECTED;
+        server->nextReconnectTime = currentTime + self->reconnectInterval;
+
+        if ((self->activeServer == server->index) || (self->startingServer == server->index)) {
+
+            if (self->activeServer == server->index) {
+                self->previousServer = server->index;
+                self->activeServer = -1;
+            }
+
+            self->startingServer = -1;
+
+            if (self->running) {
+                RedundantServer standby = getStandbyServer(self, currentTime);
+
+                if (standby)
+                    startServer(self, standby, currentTime);
+            }
+        }
+
+        /* schedule the reconnect */
+        wakeUpSupervision(self);
+
+        break;
+    }
+
+    unlockState(self);
+
+    if (callSwitchoverHandler && self->switchoverHandler)
+        self->switchoverHandler(self->switchoverHandlerParameter, oldServer, server->index, switchoverTime);
+}
+
+static void*
+supervisionThread(void* parameter)
+{
+    CS104_RedundantConnection self = (CS104_RedundantConnection) parameter;
+
+    while (self->running) {
+
+        CS104_Connection reconnect[CS104_REDUNDANT_CONNECTION_MAX_SERVERS];
+        int numberOfReconnects = 0;
+        int i;
+
+        lockState(self);
+
+        uint64_t currentTime = Hal_getTimeInMs();
+
+        /* time of the next reconnect, connect timeout or preferred server deadline */
+        uint64_t nextEventTime = currentTime + self->reconnectInterval;
+
+        for (i = 0; i < self->numberOfServers; i++) {
+            RedundantServer server = &(self->servers[i]);
+
+            if ((server->state == SERVER_STATE_CONNECTING) && (currentTime >= server->connectTimeout)) {
+                server->state = SERVER_STATE_DISCONNECTED;
+                server->nextReconnectTime = currentTime;
+            }
+
+            if ((server->state == SERVER_STATE_DISCONNECTED) && (currentTime >= server->nextReconnectTime)) {
+                CS104_APCIParameters apciParameters = CS104_Connection_getAPCIParameters(server->connection);
+
+                server->state = SERVER_STATE_CONNECTING;
+                server->connectTimeout = currentTime + (apciParameters->t0 * 1000) + self->reconnectInterval;
+
+                reconnect[numberOfReconnects++] = server->connection;
+            }
+
+            if ((server->state == SERVER_STATE_DISCONNECTED) && (server->nextReconnectTime < nextEventTime))
+                nextEventTime = server->nextReconnectTime;
+
+            if ((server->state == SERVER_STATE_CONNECTING) && (server->connectTimeout < nextEventTime))
+                nextEventTime = server->connectTimeout;
+        }
+
+        if ((self->activeServer == -1) && (self->startingServer == -1)) {
+            RedundantServer standby = getStandbyServer(self, currentTime);
+
+            if (standby)
+                startServer(self, standby, currentTime);
+            else if ((currentTime < self->preferredServerDeadline) && (self->preferredServerDeadline < nextEventTime))
+                nextEventTime = self->preferredServerDeadline;
+        }
+
+        unlockState(self);
+
+        /* has to be called without state lock because the old connection thread is joined */
+        for (i = 0; i < numberOfReconnects; i++)
+            CS104_Connection_connectAsync(reconnect[i]);
+
+        int waitTime = 0;
+
+        if (nextEventTime > currentTime)
+            waitTime = (int) (nextEventTime - currentTime);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_waitTimeout(self->wakeUpSupervision, waitTime);
+#else
+        Thread_sleep(waitTime < 10 ? waitTime : 10);
+#endif
+    }
+
+    return NULL;
+}
+
+int
+CS104_RedundantConnection_addServer(CS104_RedundantConnection self, const char* hostname, int tcpPort)
+{
+    if (self->numberOfServers >= CS104_REDUNDANT_CONNECTION_MAX_SERVERS)
+        return -1;
+
+    CS104_Connection connection = CS104_Connection_create(hostname, tcpPort);
+
+    if (connection == NULL)
+        return -1;
+
+    RedundantServer server = &(self->servers[self->numberOfServers]);
+
+    server->parent = self;
+    server->index = self->numberOfServers;
+    server->connection = connection;
+    server->state = SERVER_STATE_DISCONNECTED;
+    server->nextReconnectTime = 0;
+
+    CS104_Connection_setASDUReceivedHandler(connection, asduReceivedHandler, server);
+    CS104_Connection_setConnectionHandler(connection, connectionHandler, server);
+
+    self->numberOfServers++;
+
+    return server->index;
+}
+
+CS104_Connection
+CS104_RedundantConnection_getConnection(CS104_RedundantConnection self, int serverIndex)
+{
+    if ((serverIndex < 0) || (serverIndex >= self->numberOfServers))
+        return NULL;
+
+    return self->servers[serverIndex].connection;
+}
+
+void
+CS104_RedundantConnection_setASDUReceivedHandler(CS104_RedundantConnection self, CS101_ASDUReceivedHandler handler, void* parameter)
+{
+    self->asduReceivedHandler = handler;
+    self->asduReceivedHandlerParameter = parameter;
+}
+
+void
+CS104_RedundantConnection_setSwitchoverHandler(CS104_RedundantConnection self, CS104_SwitchoverHandler handler, void* parameter)
+{
+    self->switchoverHandler = handler;
+    self->switchoverHandlerParameter = parameter;
+}
+
+void
+CS104_RedundantConnection_setReconnectInterval(CS104_RedundantConnection self, int intervalInMs)
+{
+    self->reconnectInterval = intervalInMs;
+}
+
+void
+CS104_RedundantConnection_start(CS104_RedundantConnection self)
+{
+    if (self->running)
+        return;
+
+    self->preferredServerDeadline = Hal_getTimeInMs() + self->reconnectInterval;
+
+    self->running = true;
+
+    self->supervisionThread = Thread_create(supervisionThread, (void*) self, false);
+
+    if (self->supervisionThread)
+        Thread_start(self->supervisionThread);
+}
+
+void
+CS104_RedundantConnection_stop(CS104_RedundantConnection self)
+{
+    int i;
+
+    if (self->running == false)
+        return;
+
+    self->running = false;
+
+    wakeUpSupervision(self);
+
+    if (self->supervisionThread) {
+        Thread_destroy(self->supervisionThread);
+        self->supervisionThread = NULL;
+    }
+
+    for (i = 0; i < self->numberOfServers; i++)
+        CS104_Connection_close(self->servers[i].connection);
+
+    lockState(self);
+
+    for (i = 0; i < self->numberOfServers; i++)
+        self->servers[i].state = SERVER_STATE_DISCONNECTED;
+
+    self->activeServer = -1;
+    self->startingServer = -1;
+    self->previousServer = -1;
+
+    unlockState(self);
+}
+
+int
+CS104_RedundantConnection_getActiveServer(CS104_RedundantConnection self)
+{
+    lockState(self);
+
+    int activeServer = self->activeServer;
+
+    unlockState(self);
+
+    return activeServer;
+}
+
+CS104_Connection
+CS104_RedundantConnection_getActiveConnection(CS104_RedundantConnection self)
+{
+    CS104_Connection connection = NULL;
+
+    lockState(self);
+
+    if (self->activeServer != -1)
+        connection = self->servers[self->activeServer].connection;
+
+    unlockState(self);
+
+    return connection;
+}
+
+bool
+CS104_RedundantConnection_switchover(CS104_RedundantConnection self, int serverIndex)
+{
+    bool retVal = false;
+
+    if ((serverIndex < 0) || (serverIndex >= self->numberOfServers))
+        return false;
+
+    lockState(self);
+
+    RedundantServer server = &(self->servers[serverIndex]);
+
+    if (self->running && (server->state == SERVER_STATE_STANDBY) && (self->startingServer == -1)) {
+
+        if (self->activeServer != -1) {
+            RedundantServer oldServer = &(self->servers[self->activeServer]);
+
+            oldServer->state = SERVER_STATE_STANDBY;
+
+            self->previousServer = self->activeServer;
+            self->activeServer = -1;
+
+            CS104_Connection_sendStopDT(oldServer->connection);
+        }
+
+        startServer(self, server, Hal_getTimeInMs());
+
+        retVal = true;
+    }
+
+    unlockState(self);
+
+    return retVal;
+}
+
+void
+CS104_RedundantConnection_destroy(CS104_RedundantConnection self)
+{
+    int i;
+
+    CS104_RedundantConnection_stop(self);
+
+    for (i = 0; i < self->numberOfServers; i++)
+        CS104_Connection_destroy(self->servers[i].connection);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_destroy(self->stateLock);
+    Semaphore_destroy(self->wakeUpSupervision);
+#endif
+
+    GLOBAL_FREEMEM(self);
+}
+
+#endif /* (CONFIG_USE_THREADS == 1) */
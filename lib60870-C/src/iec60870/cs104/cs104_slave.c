@@ -48,6 +48,10 @@
 #error Illegal configuration: Define either CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP or CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP or CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS
 #endif
 
+#ifndef CONFIG_CS104_SLAVE_LISTEN_BACKLOG
+#define CONFIG_CS104_SLAVE_LISTEN_BACKLOG 1024
+#endif
+
 typedef struct sMasterConnection* MasterConnection;
 
 void
@@ -62,6 +66,15 @@ MasterConnection_activate(MasterConnection self);
 
 #define CS104_DEFAULT_PORT 2404
 
+/* maximum time between two calls of the plugin tasks in non-threaded mode with external event loop */
+#define CS104_SLAVE_PLUGIN_TASK_INTERVAL 100
+
+/* maximum number of periodic ASDUs that are put into the event queue(s) at once */
+#define CS104_SLAVE_CYCLIC_BATCH_SIZE 16
+
+/* number of ASDUs of a batch (CS104_Slave_enqueueASDUs) that are encoded on the stack and enqueued together */
+#define CS104_SLAVE_ENQUEUE_CHUNK_SIZE 16
+
 static struct sCS104_APCIParameters defaultConnectionParameters = {
 	/* .k = */ 12,
 	/* .w = */ 8,
@@ -86,22 +99,229 @@ typedef struct {
     int msgSize;
 } FrameBuffer;
 
+/* maximum number of slots checked when searching the latest value of a point */
+#define LATEST_VALUE_MAX_PROBES 8
+
+struct sLatestValueSlot {
+    uint64_t key; /* type ID, VSQ, CA, and IOA of the first information object */
+    uint64_t entryId;
+    uint8_t* queueEntry;
+};
+
 typedef enum  {
     QUEUE_ENTRY_STATE_NOT_USED_OR_CONFIRMED,
     QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION,
     QUEUE_ENTRY_STATE_SENT_BUT_NOT_CONFIRMED
 } QueueEntryState;
 
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+
+/***************************************************
+ * QueueReplicator (primary side of the event queue replication)
+ ***************************************************/
+
+#ifndef CONFIG_CS104_SLAVE_QUEUE_REPLICATION_BUFFER_SIZE
+#define CONFIG_CS104_SLAVE_QUEUE_REPLICATION_BUFFER_SIZE 16384
+#endif
+
+/*
+ * replication record: operation (1 byte), queue index (1 byte), entry ID (8 bytes), expiration time (8 bytes),
+ * size (1 byte), ASDU (size bytes)
+ *
+ * The expiration time is the absolute ms timestamp of the primary (0 = no expiration) so that the remaining
+ * time to live is not restarted at the standby.
+ */
+#define QUEUE_REPLICATION_HEADER_SIZE 19
+
+#define QUEUE_REPLICATION_OP_ENQUEUE 1
+#define QUEUE_REPLICATION_OP_CONFIRM 2
+#define QUEUE_REPLICATION_OP_CLEAR 3
+#define QUEUE_REPLICATION_OP_REPLACE 4
+
+typedef struct sQueueReplicator* QueueReplicator;
+
+struct sQueueReplicator {
+    uint8_t* pendingBuffer; /* records not yet sent to the standby */
+    int pendingSize;
+
+    uint8_t* sendBuffer; /* records currently sent by the replication thread (swapped with pending buffer) */
+
+    bool resyncRequired; /* pending records have been dropped -> transfer the complete queue(s) */
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore lock;
+    Semaphore dataAvailable; /* posted when the first record is added to the empty pending buffer */
+#endif
+};
+
+static QueueReplicator
+QueueReplicator_create(void)
+{
+    QueueReplicator self = (QueueReplicator) GLOBAL_CALLOC(1, sizeof(struct sQueueReplicator));
+
+    if (self) {
+        self->pendingBuffer = (uint8_t*) GLOBAL_MALLOC(CONFIG_CS104_SLAVE_QUEUE_REPLICATION_BUFFER_SIZE);
+        self->sendBuffer = (uint8_t*) GLOBAL_MALLOC(CONFIG_CS104_SLAVE_QUEUE_REPLICATION_BUFFER_SIZE);
+
+        if ((self->pendingBuffer == NULL) || (self->sendBuffer == NULL)) {
+            GLOBAL_FREEMEM(self->pendingBuffer);
+            GLOBAL_FREEMEM(self->sendBuffer);
+            GLOBAL_FREEMEM(self);
+            return NULL;
+        }
+
+        self->pendingSize = 0;
+        self->resyncRequired = true;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->lock = Semaphore_create(1);
+        self->dataAvailable = Semaphore_create(0);
+#endif
+    }
+
+    return self;
+}
+
+static void
+QueueReplicator_destroy(QueueReplicator self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_destroy(self->lock);
+    Semaphore_destroy(self->dataAvailable);
+#endif
+
+    GLOBAL_FREEMEM(self->pendingBuffer);
+    GLOBAL_FREEMEM(self->sendBuffer);
+    GLOBAL_FREEMEM(self);
+}
+
+static int
+QueueReplicator_encodeRecord(uint8_t* buffer, int op, int queueIndex, uint64_t entryId, uint64_t expirationTime,
+        uint8_t* asdu, int asduSize)
+{
+    int i;
+
+    buffer[0] = (uint8_t) op;
+    buffer[1] = (uint8_t) queueIndex;
+
+    for (i = 0; i < 8; i++) {
+        buffer[2 + i] = (uint8_t) (entryId >> (56 - (i * 8)));
+        buffer[10 + i] = (uint8_t) (expirationTime >> (56 - (i * 8)));
+    }
+
+    buffer[18] = (uint8_t) asduSize;
+
+    if (asduSize > 0)
+        memcpy(buffer + QUEUE_REPLICATION_HEADER_SIZE, asdu, asduSize);
+
+    return QUEUE_REPLICATION_HEADER_SIZE + asduSize;
+}
+
+/**
+ * Record a queue operation - called with the queue lock held to keep the order of the operations.
+ */
+static void
+QueueReplicator_addOperation(QueueReplicator self, int op, int queueIndex, uint64_t entryId, uint64_t expirationTime,
+        uint8_t* asdu, int asduSize)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    bool wakeUpSender = false;
+
+    if (self->resyncRequired == false) {
+
+        if (self->pendingSize + QUEUE_REPLICATION_HEADER_SIZE + asduSize <= CONFIG_CS104_SLAVE_QUEUE_REPLICATION_BUFFER_SIZE) {
+            wakeUpSender = (self->pendingSize == 0);
+
+            self->pendingSize += QueueReplicator_encodeRecord(self->pendingBuffer + self->pendingSize, op, queueIndex,
+                    entryId, expirationTime, asdu, asduSize);
+        }
+        else {
+            DEBUG_PRINT("CS104 SLAVE: replication buffer overflow -> resync required\n");
+
+            /* the complete queue content will be transferred instead */
+            self->pendingSize = 0;
+            self->resyncRequired = true;
+
+            wakeUpSender = true;
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+
+    if (wakeUpSender)
+        Semaphore_post(self->dataAvailable);
+#else
+    UNUSED_PARAMETER(wakeUpSender);
+#endif
+}
+
+/**
+ * Check if the complete queue content has to be transferred (called by the replication thread)
+ */
+static bool
+QueueReplicator_isResyncRequired(QueueReplicator self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->lock);
+#endif
+
+    bool resyncRequired = self->resyncRequired;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->lock);
+#endif
+
+    return resyncRequired;
+}
+
+/**
+ * Wait until records are available or the timeout expires (called by the replication thread)
+ */
+static void
+QueueReplicator_waitForData(QueueReplicator self, int timeoutInMs)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_waitTimeout(self->dataAvailable, timeoutInMs);
+#else
+    UNUSED_PARAMETER(self);
+    Thread_sleep(timeoutInMs < 10 ? timeoutInMs : 10);
+#endif
+}
+
+/**
+ * Wake up the replication thread (e.g. to stop it)
+ */
+static void
+QueueReplicator_wakeUp(QueueReplicator self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->dataAvailable);
+#else
+    UNUSED_PARAMETER(self);
+#endif
+}
+
+#endif /* (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1) */
+
 /***************************************************
  * MessageQueue
  ***************************************************/
 
 struct sMessageQueueEntryInfo {
     uint64_t entryId;
+    uint32_t expirationTime; /* entry is not sent after this time (lower 32 bit of ms timestamp) */
     unsigned int entryState:2;
     unsigned int size:8;
+    unsigned int hasExpirationTime:1;
 };
 
+/* expiration check with 32 bit timestamps (supports time to live values up to 24 days) */
+#define ENTRY_IS_EXPIRED(entryInfo, currentTime) ((int32_t) ((uint32_t) (currentTime) - (entryInfo).expirationTime) >= 0)
+
 struct sMessageQueue {
     int size; /* size of buffer in bytes */
     int entryCounter; /* number of messages (ASDU) in the queue */
@@ -116,6 +336,26 @@ struct sMessageQueue {
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore queueLock;
 #endif
+
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    QueueReplicator replicator; /* NULL when queue is not replicated */
+    int replicationIndex; /* index of the queue at primary and standby */
+#endif
+
+    /* incremented when the complete content is replaced (standby side) - invalidates the queue entry
+     * pointers of the sent but unconfirmed ASDUs of the connections */
+    uint32_t generation;
+
+    /* index of the waiting cyclic values (NULL = keep all values) */
+    struct sLatestValueSlot* latestValueSlots;
+    int latestValueSlotMask;
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    int weight; /* scheduling weight of the event class */
+
+    /* queues of the event classes - only used in the queue of event class 0 ([0] = queue itself) */
+    struct sMessageQueue* eventClassQueues[CONFIG_CS104_SLAVE_EVENT_CLASSES];
+#endif
 };
 
 typedef struct sMessageQueue* MessageQueue;
@@ -136,9 +376,31 @@ MessageQueue_initialize(MessageQueue self, int maxQueueSize)
     self->lastInBufferEntry = NULL;
     self->entryId = 1;
 
+    self->latestValueSlots = NULL;
+    self->latestValueSlotMask = 0;
+
 #if (CONFIG_USE_SEMAPHORES == 1)
     self->queueLock = Semaphore_create(1);
 #endif
+
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    self->replicator = NULL;
+    self->replicationIndex = 0;
+#endif
+
+    self->generation = 0;
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    {
+        int i;
+
+        self->weight = 1;
+        self->eventClassQueues[0] = self;
+
+        for (i = 1; i < CONFIG_CS104_SLAVE_EVENT_CLASSES; i++)
+            self->eventClassQueues[i] = NULL;
+    }
+#endif
 }
 
 static MessageQueue
@@ -157,15 +419,56 @@ MessageQueue_destroy(MessageQueue self)
 {
     if (self != NULL) {
 
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+        int i;
+
+        for (i = 1; i < CONFIG_CS104_SLAVE_EVENT_CLASSES; i++)
+            MessageQueue_destroy(self->eventClassQueues[i]);
+#endif
+
 #if (CONFIG_USE_SEMAPHORES == 1)
         Semaphore_destroy(self->queueLock);
 #endif
 
+        if (self->latestValueSlots)
+            GLOBAL_FREEMEM(self->latestValueSlots);
+
         GLOBAL_FREEMEM(self->buffer);
         GLOBAL_FREEMEM(self);
     }
 }
 
+/**
+ * Get the queue of an event class. Events of classes without own queue are stored in the queue of class 0.
+ */
+static MessageQueue
+MessageQueue_getEventClassQueue(MessageQueue self, int eventClass)
+{
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    if ((eventClass > 0) && (eventClass < CONFIG_CS104_SLAVE_EVENT_CLASSES) && self->eventClassQueues[eventClass])
+        return self->eventClassQueues[eventClass];
+#else
+    (void) eventClass;
+#endif
+
+    return self;
+}
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+static void
+MessageQueue_addEventClass(MessageQueue self, int eventClass, int maxQueueSize, int weight)
+{
+    if (self->eventClassQueues[eventClass] == NULL) {
+        MessageQueue eventClassQueue = MessageQueue_create(maxQueueSize);
+
+        if (eventClassQueue) {
+            eventClassQueue->weight = weight;
+            self->eventClassQueues[eventClass] = eventClassQueue;
+        }
+    }
+}
+#endif /* (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1) */
+
 static void
 MessageQueue_lock(MessageQueue self)
 {
@@ -197,6 +500,17 @@ MessageQueue_getEntryCount(MessageQueue self)
     Semaphore_post(self->queueLock);
 #endif
 
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    {
+        int i;
+
+        for (i = 1; i < CONFIG_CS104_SLAVE_EVENT_CLASSES; i++) {
+            if (self->eventClassQueues[i])
+                count += MessageQueue_getEntryCount(self->eventClassQueues[i]);
+        }
+    }
+#endif
+
     return count;
 }
 
@@ -228,24 +542,13 @@ MessageQueue_countEntriesUntilEndOfBuffer(MessageQueue self, uint8_t* firstEntry
 }
 
 /**
- * Add an ASDU to the queue. When queue is full, override oldest entry.
+ * Allocate space for a new entry at the end of the queue. When queue is full, override oldest entry.
+ *
+ * Has to be called with the queue lock held.
  */
-static void
-MessageQueue_enqueueASDU(MessageQueue self, CS101_ASDU asdu)
+static uint8_t*
+MessageQueue_allocateEntry(MessageQueue self, int entrySize)
 {
-    int asduSize = asdu->asduHeaderLength + asdu->payloadSize;
-
-    if (asduSize > 256 - IEC60870_5_104_APCI_LENGTH) {
-        DEBUG_PRINT("CS104 SLAVE: ASDU too large!\n");
-        return;
-    }
-
-    int entrySize = sizeof(struct sMessageQueueEntryInfo) + asduSize;
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
-
     struct sMessageQueueEntryInfo entryInfo;
 
     uint8_t* nextMsgPtr;
@@ -302,85 +605,380 @@ MessageQueue_enqueueASDU(MessageQueue self, CS101_ASDU asdu)
 
     self->entryCounter++;
 
-    struct sBufferFrame bufferFrame;
+    return nextMsgPtr;
+}
 
-    Frame frame = BufferFrame_initialize(&bufferFrame, nextMsgPtr + sizeof(struct sMessageQueueEntryInfo), 0);
-    CS101_ASDU_encode(asdu, frame);
+/**
+ * Check if the entry with the given ID is still in the queue (entry IDs in the queue are consecutive)
+ */
+static bool
+MessageQueue_containsEntry(MessageQueue self, uint64_t entryId)
+{
+    if (self->entryCounter == 0)
+        return false;
 
-    entryInfo.size = asduSize;
-    entryInfo.entryId = self->entryId++;
-    entryInfo.entryState = QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION;
+    struct sMessageQueueEntryInfo entryInfo;
+    memcpy(&entryInfo, self->firstEntry, sizeof(struct sMessageQueueEntryInfo));
 
-    memcpy(nextMsgPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+    return ((entryId >= entryInfo.entryId) && (entryId < self->entryId));
+}
 
-    DEBUG_PRINT("CS104 SLAVE: ASDUs in FIFO: %i (new(size=%i/%i): %p, first: %p, last: %p lastInBuf: %p)\n", self->entryCounter, entrySize, asduSize, nextMsgPtr,
-            self->firstEntry, self->lastEntry, self->lastInBufferEntry);
+/**
+ * Keep only the latest waiting value of cyclic data in the queue
+ */
+static void
+MessageQueue_setKeepOnlyLatestValues(MessageQueue self, int maxQueueSize)
+{
+    int numberOfSlots = 16;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+    while (numberOfSlots < (maxQueueSize * 2))
+        numberOfSlots *= 2;
+
+    self->latestValueSlots = (struct sLatestValueSlot*) GLOBAL_CALLOC(numberOfSlots, sizeof(struct sLatestValueSlot));
+
+    if (self->latestValueSlots)
+        self->latestValueSlotMask = numberOfSlots - 1;
 }
 
-static bool
-MessageQueue_isAsduAvailable(MessageQueue self)
+/**
+ * Find the slot for a cyclic value. Returns the slot with the same key or a free/stale slot (NULL if all
+ * probed slots are in use).
+ */
+static struct sLatestValueSlot*
+MessageQueue_getLatestValueSlot(MessageQueue self, uint64_t key)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->queueLock);
-#endif
+    struct sLatestValueSlot* freeSlot = NULL;
 
-    bool retVal;
+    uint32_t hash = (uint32_t) ((key ^ (key >> 29)) * 2654435761u);
+    int i;
 
-    if (self->entryCounter > 0)
-        retVal = true;
-    else
-        retVal = false;
+    for (i = 0; i < LATEST_VALUE_MAX_PROBES; i++) {
+        struct sLatestValueSlot* slot = &(self->latestValueSlots[(hash + i) & self->latestValueSlotMask]);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->queueLock);
-#endif
+        if (slot->key == key)
+            return slot;
 
-    return retVal;
+        if ((freeSlot == NULL) && ((slot->entryId == 0) || (MessageQueue_containsEntry(self, slot->entryId) == false)))
+            freeSlot = slot;
+    }
+
+    return freeSlot;
 }
 
-static uint8_t*
-MessageQueue_getNextWaitingASDU(MessageQueue self, uint64_t* entryId, uint8_t** queueEntry, int* size)
+/**
+ * Add an encoded ASDU to the queue. When queue is full, override oldest entry.
+ *
+ * \param expirationTime the entry is not sent after this time (0 = no expiration)
+ * \param latestValueKey when not 0 a waiting entry with the same key is replaced by the new ASDU
+ */
+static void
+MessageQueue_enqueueEncodedASDU(MessageQueue self, uint8_t* encodedAsdu, int asduSize, uint64_t expirationTime, uint64_t latestValueKey)
 {
-    uint8_t* buffer = NULL;
+    /* locking has to be done by caller! */
 
-    if (self->entryCounter != 0) {
+    int entrySize = sizeof(struct sMessageQueueEntryInfo) + asduSize;
 
-        uint8_t* entryPtr = self->firstEntry;
+    struct sMessageQueueEntryInfo entryInfo;
 
-        struct sMessageQueueEntryInfo entryInfo;
+    struct sLatestValueSlot* latestValueSlot = NULL;
 
-        memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+    if (latestValueKey && self->latestValueSlots) {
 
-        while (entryInfo.entryState != QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION) {
-            if (entryPtr == self->lastEntry)
-                break;
+        latestValueSlot = MessageQueue_getLatestValueSlot(self, latestValueKey);
 
-            /* move to next entry */
-            if (entryPtr == self->lastInBufferEntry)
-                entryPtr = self->buffer;
-            else
-                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+        if (latestValueSlot && (latestValueSlot->key == latestValueKey) && MessageQueue_containsEntry(self, latestValueSlot->entryId)) {
 
-            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
-        }
+            uint8_t* queueEntry = latestValueSlot->queueEntry;
 
-        if (entryInfo.entryState == QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION) {
+            memcpy(&entryInfo, queueEntry, sizeof(struct sMessageQueueEntryInfo));
 
-            *entryId = entryInfo.entryId;
-            *queueEntry = entryPtr;
-            entryInfo.entryState = QUEUE_ENTRY_STATE_SENT_BUT_NOT_CONFIRMED;
+            if ((entryInfo.entryId == latestValueSlot->entryId) &&
+                    (entryInfo.entryState == QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION) && (entryInfo.size == asduSize)) {
 
-            memcpy(entryPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+                /* replace the value that is still waiting for transmission */
+                memcpy(queueEntry + sizeof(struct sMessageQueueEntryInfo), encodedAsdu, asduSize);
 
-            buffer = entryPtr + sizeof(struct sMessageQueueEntryInfo);
-            *size = entryInfo.size;
+                entryInfo.expirationTime = (uint32_t) expirationTime;
+                entryInfo.hasExpirationTime = (expirationTime != 0);
+                memcpy(queueEntry, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+                if (self->replicator)
+                    QueueReplicator_addOperation(self->replicator, QUEUE_REPLICATION_OP_REPLACE, self->replicationIndex,
+                            entryInfo.entryId, expirationTime, queueEntry + sizeof(struct sMessageQueueEntryInfo), asduSize);
+#endif
+
+                return;
+            }
         }
     }
 
+    uint8_t* nextMsgPtr = MessageQueue_allocateEntry(self, entrySize);
+
+    memcpy(nextMsgPtr + sizeof(struct sMessageQueueEntryInfo), encodedAsdu, asduSize);
+
+    entryInfo.size = asduSize;
+    entryInfo.entryId = self->entryId++;
+    entryInfo.expirationTime = (uint32_t) expirationTime;
+    entryInfo.hasExpirationTime = (expirationTime != 0);
+    entryInfo.entryState = QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION;
+
+    memcpy(nextMsgPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+
+    if (latestValueSlot) {
+        latestValueSlot->key = latestValueKey;
+        latestValueSlot->entryId = entryInfo.entryId;
+        latestValueSlot->queueEntry = nextMsgPtr;
+    }
+
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    if (self->replicator)
+        QueueReplicator_addOperation(self->replicator, QUEUE_REPLICATION_OP_ENQUEUE, self->replicationIndex,
+                entryInfo.entryId, expirationTime, nextMsgPtr + sizeof(struct sMessageQueueEntryInfo), asduSize);
+#endif
+
+    DEBUG_PRINT("CS104 SLAVE: ASDUs in FIFO: %i (new(size=%i/%i): %p, first: %p, last: %p lastInBuf: %p)\n", self->entryCounter, entrySize, asduSize, nextMsgPtr,
+            self->firstEntry, self->lastEntry, self->lastInBufferEntry);
+
+    TRACE_POINT(LIB60870_TRACE_ENQUEUE, 0, entryInfo.entryId, encodedAsdu[0]);
+}
+
+static void
+MessageQueue_enqueueASDU(MessageQueue self, CS101_ASDU asdu, uint64_t expirationTime, uint64_t latestValueKey)
+{
+    int asduSize = asdu->asduHeaderLength + asdu->payloadSize;
+
+    if (asduSize > 256 - IEC60870_5_104_APCI_LENGTH) {
+        DEBUG_PRINT("CS104 SLAVE: ASDU too large!\n");
+        return;
+    }
+
+    uint8_t encodedAsdu[256];
+
+    struct sBufferFrame bufferFrame;
+
+    Frame frame = BufferFrame_initialize(&bufferFrame, encodedAsdu, 0);
+    CS101_ASDU_encode(asdu, frame);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->queueLock);
+#endif
+
+    MessageQueue_enqueueEncodedASDU(self, encodedAsdu, asduSize, expirationTime, latestValueKey);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->queueLock);
+#endif
+}
+
+static void
+MessageQueue_resetLatestValueSlots(MessageQueue self)
+{
+    if (self->latestValueSlots)
+        memset(self->latestValueSlots, 0, (self->latestValueSlotMask + 1) * sizeof(struct sLatestValueSlot));
+}
+
+static bool
+MessageQueue_isAsduAvailable(MessageQueue self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->queueLock);
+#endif
+
+    bool retVal;
+
+    if (self->entryCounter > 0)
+        retVal = true;
+    else
+        retVal = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->queueLock);
+#endif
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    {
+        int i;
+
+        for (i = 1; (retVal == false) && (i < CONFIG_CS104_SLAVE_EVENT_CLASSES); i++) {
+            if (self->eventClassQueues[i])
+                retVal = MessageQueue_isAsduAvailable(self->eventClassQueues[i]);
+        }
+    }
+#endif
+
+    return retVal;
+}
+
+/**
+ * Check if the queue contains ASDUs that are waiting for transmission (not yet sent)
+ */
+static bool
+MessageQueue_hasWaitingASDU(MessageQueue self)
+{
+    bool retVal = false;
+
+    MessageQueue_lock(self);
+
+    if (self->entryCounter != 0) {
+
+        uint8_t* entryPtr = self->firstEntry;
+
+        struct sMessageQueueEntryInfo entryInfo;
+
+        while (true) {
+            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+            if (entryInfo.entryState == QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION) {
+                retVal = true;
+                break;
+            }
+
+            if (entryPtr == self->lastEntry)
+                break;
+
+            if (entryPtr == self->lastInBufferEntry)
+                entryPtr = self->buffer;
+            else
+                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+        }
+    }
+
+    MessageQueue_unlock(self);
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    {
+        int i;
+
+        for (i = 1; (retVal == false) && (i < CONFIG_CS104_SLAVE_EVENT_CLASSES); i++) {
+            if (self->eventClassQueues[i])
+                retVal = MessageQueue_hasWaitingASDU(self->eventClassQueues[i]);
+        }
+    }
+#endif
+
+    return retVal;
+}
+
+static void
+removeFirstEntry(MessageQueue self)
+{
+    if (self->firstEntry == self->lastInBufferEntry) {
+
+        if (self->firstEntry == self->lastEntry) {
+            self->firstEntry = NULL;
+            self->lastEntry = NULL;
+            self->lastInBufferEntry = NULL;
+        }
+        else {
+            self->firstEntry = self->buffer;
+            self->lastInBufferEntry = self->lastEntry;
+        }
+    }
+    else {
+        struct sMessageQueueEntryInfo entryInfo;
+
+        memcpy(&entryInfo, self->firstEntry, sizeof(struct sMessageQueueEntryInfo));
+        self->firstEntry = self->firstEntry + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+    }
+
+    self->entryCounter--;
+}
+
+/**
+ * Remove confirmed and expired entries from the beginning of the queue
+ */
+static void
+removeUnusedEntries(MessageQueue self)
+{
+    uint64_t lastRemovedEntryId = 0;
+
+    while (self->entryCounter > 0) {
+
+        struct sMessageQueueEntryInfo entryInfo;
+        memcpy(&entryInfo, self->firstEntry, sizeof(struct sMessageQueueEntryInfo));
+
+        if (entryInfo.entryState != QUEUE_ENTRY_STATE_NOT_USED_OR_CONFIRMED)
+            break;
+
+        lastRemovedEntryId = entryInfo.entryId;
+
+        removeFirstEntry(self);
+    }
+
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    if (self->replicator && (lastRemovedEntryId != 0))
+        QueueReplicator_addOperation(self->replicator, QUEUE_REPLICATION_OP_CONFIRM, self->replicationIndex,
+                lastRemovedEntryId, 0, NULL, 0);
+#else
+    (void) lastRemovedEntryId;
+#endif
+}
+
+static uint8_t*
+MessageQueue_getNextWaitingASDU(MessageQueue self, uint64_t* entryId, uint8_t** queueEntry, int* size)
+{
+    uint8_t* buffer = NULL;
+
+    if (self->entryCounter != 0) {
+
+        uint8_t* entryPtr = self->firstEntry;
+
+        struct sMessageQueueEntryInfo entryInfo;
+
+        uint64_t currentTime = 0;
+        bool entriesExpired = false;
+
+        memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+        while (true) {
+
+            if (entryInfo.entryState == QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION) {
+
+                if (entryInfo.hasExpirationTime == 0)
+                    break;
+
+                if (currentTime == 0)
+                    currentTime = Hal_getTimeInMs();
+
+                if (ENTRY_IS_EXPIRED(entryInfo, currentTime) == false)
+                    break;
+
+                /* skip expired entry */
+                entryInfo.entryState = QUEUE_ENTRY_STATE_NOT_USED_OR_CONFIRMED;
+                memcpy(entryPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+
+                entriesExpired = true;
+            }
+
+            if (entryPtr == self->lastEntry)
+                break;
+
+            /* move to next entry */
+            if (entryPtr == self->lastInBufferEntry)
+                entryPtr = self->buffer;
+            else
+                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+
+            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+        }
+
+        if (entryInfo.entryState == QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION) {
+
+            *entryId = entryInfo.entryId;
+            *queueEntry = entryPtr;
+            entryInfo.entryState = QUEUE_ENTRY_STATE_SENT_BUT_NOT_CONFIRMED;
+
+            memcpy(entryPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+
+            buffer = entryPtr + sizeof(struct sMessageQueueEntryInfo);
+            *size = entryInfo.size;
+        }
+
+        if (entriesExpired)
+            removeUnusedEntries(self);
+    }
+
     return buffer;
 }
 
@@ -421,6 +1019,17 @@ MessageQueue_setWaitingForTransmissionWhenNotConfirmed(MessageQueue self)
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_post(self->queueLock);
 #endif
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    {
+        int i;
+
+        for (i = 1; i < CONFIG_CS104_SLAVE_EVENT_CLASSES; i++) {
+            if (self->eventClassQueues[i])
+                MessageQueue_setWaitingForTransmissionWhenNotConfirmed(self->eventClassQueues[i]);
+        }
+    }
+#endif
 }
 
 static void
@@ -435,43 +1044,35 @@ MessageQueue_releaseAllQueuedASDUs(MessageQueue self)
     self->lastInBufferEntry = NULL;
     self->entryCounter = 0;
 
+    MessageQueue_resetLatestValueSlots(self);
+
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_post(self->queueLock);
 #endif
-}
 
-static void
-removeFirstEntry(MessageQueue self)
-{
-    if (self->firstEntry == self->lastInBufferEntry) {
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    {
+        int i;
 
-        if (self->firstEntry == self->lastEntry) {
-            self->firstEntry = NULL;
-            self->lastEntry = NULL;
-            self->lastInBufferEntry = NULL;
-        }
-        else {
-            self->firstEntry = self->buffer;
-            self->lastInBufferEntry = self->lastEntry;
+        for (i = 1; i < CONFIG_CS104_SLAVE_EVENT_CLASSES; i++) {
+            if (self->eventClassQueues[i])
+                MessageQueue_releaseAllQueuedASDUs(self->eventClassQueues[i]);
         }
     }
-    else {
-        struct sMessageQueueEntryInfo entryInfo;
-
-        memcpy(&entryInfo, self->firstEntry, sizeof(struct sMessageQueueEntryInfo));
-        self->firstEntry = self->firstEntry + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
-    }
-
-    self->entryCounter--;
+#endif
 }
 
 static void
-MessageQueue_markAsduAsConfirmed(MessageQueue self, uint8_t* queueEntry, uint64_t entryId)
+MessageQueue_markAsduAsConfirmed(MessageQueue self, uint8_t* queueEntry, uint64_t entryId, uint32_t generation)
 {
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_wait(self->queueLock);
 #endif
 
+    /* the entry has been removed by a reset of the queue after the ASDU was sent */
+    if (generation != self->generation)
+        goto exit_function;
+
     if (self->entryCounter > 0) {
 
         /* entryId plausibility check */
@@ -488,7 +1089,7 @@ MessageQueue_markAsduAsConfirmed(MessageQueue self, uint8_t* queueEntry, uint64_
                 memcpy(queueEntry, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
 
                 if (queueEntry == self->firstEntry) {
-                    removeFirstEntry(self);
+                    removeUnusedEntries(self);
                 }
                 else {
                     DEBUG_PRINT("CS104 SLAVE: message queue corrupted (not first in buffer)\n");
@@ -501,27 +1102,202 @@ MessageQueue_markAsduAsConfirmed(MessageQueue self, uint8_t* queueEntry, uint64_
         }
     }
 
+exit_function:
+
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore_post(self->queueLock);
 #endif
+
+    return;
 }
 
-/***************************************************
- * HighPriorityASDUQueue
- ***************************************************/
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
 
-struct sHighPriorityASDUQueue {
-    int size; /* size of buffer in bytes */
-    int entryCounter; /* number of messages (ASDU) in the queue */
+/**
+ * Add an entry received from the primary server (standby side). The entry keeps the ID of the primary.
+ */
+static void
+MessageQueue_addReplicatedEntry(MessageQueue self, uint64_t entryId, uint8_t* asdu, int asduSize, uint64_t expirationTime)
+{
+    MessageQueue_lock(self);
 
-    uint8_t* firstEntry;
-    uint8_t* lastEntry;
-    uint8_t* lastInBufferEntry;
+    uint8_t* nextMsgPtr = MessageQueue_allocateEntry(self, sizeof(struct sMessageQueueEntryInfo) + asduSize);
 
-    uint8_t* buffer;
+    memcpy(nextMsgPtr + sizeof(struct sMessageQueueEntryInfo), asdu, asduSize);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore queueLock;
+    struct sMessageQueueEntryInfo entryInfo;
+
+    entryInfo.size = asduSize;
+    entryInfo.entryId = entryId;
+    entryInfo.expirationTime = (uint32_t) expirationTime;
+    entryInfo.hasExpirationTime = (expirationTime != 0);
+    entryInfo.entryState = QUEUE_ENTRY_STATE_WAITING_FOR_TRANSMISSION;
+
+    memcpy(nextMsgPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+
+    self->entryId = entryId + 1;
+
+    MessageQueue_unlock(self);
+}
+
+/**
+ * Replace the ASDU of an entry with a newer value received from the primary server (standby side)
+ */
+static void
+MessageQueue_replaceReplicatedEntry(MessageQueue self, uint64_t entryId, uint8_t* asdu, int asduSize, uint64_t expirationTime)
+{
+    MessageQueue_lock(self);
+
+    if (MessageQueue_containsEntry(self, entryId)) {
+
+        uint8_t* entryPtr = self->firstEntry;
+
+        struct sMessageQueueEntryInfo entryInfo;
+
+        while (entryPtr) {
+
+            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+            if (entryInfo.entryId == entryId) {
+
+                if (entryInfo.size == asduSize) {
+                    memcpy(entryPtr + sizeof(struct sMessageQueueEntryInfo), asdu, asduSize);
+
+                    entryInfo.expirationTime = (uint32_t) expirationTime;
+                    entryInfo.hasExpirationTime = (expirationTime != 0);
+                    memcpy(entryPtr, &entryInfo, sizeof(struct sMessageQueueEntryInfo));
+                }
+
+                break;
+            }
+
+            if (entryPtr == self->lastEntry)
+                break;
+
+            /* move to next entry */
+            if (entryPtr == self->lastInBufferEntry)
+                entryPtr = self->buffer;
+            else
+                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+        }
+    }
+
+    MessageQueue_unlock(self);
+}
+
+/**
+ * Remove all entries up to the entry confirmed at the primary server (standby side)
+ */
+static void
+MessageQueue_removeConfirmedEntries(MessageQueue self, uint64_t entryId)
+{
+    MessageQueue_lock(self);
+
+    while (self->entryCounter > 0) {
+
+        struct sMessageQueueEntryInfo entryInfo;
+        memcpy(&entryInfo, self->firstEntry, sizeof(struct sMessageQueueEntryInfo));
+
+        if (entryInfo.entryId > entryId)
+            break;
+
+        removeFirstEntry(self);
+    }
+
+    MessageQueue_unlock(self);
+}
+
+/**
+ * Remove all entries and continue with the entry ID of the primary server (standby side)
+ */
+static void
+MessageQueue_resetReplicatedQueue(MessageQueue self, uint64_t nextEntryId)
+{
+    MessageQueue_lock(self);
+
+    self->firstEntry = NULL;
+    self->lastEntry = NULL;
+    self->lastInBufferEntry = NULL;
+    self->entryCounter = 0;
+    self->entryId = nextEntryId;
+
+    /* connections may still reference the removed entries */
+    self->generation++;
+
+    MessageQueue_resetLatestValueSlots(self);
+
+    MessageQueue_unlock(self);
+}
+
+/**
+ * Encode the complete queue content as replication records (primary side).
+ *
+ * Has to be called with the queue lock held. The buffer requires space for self->size + QUEUE_REPLICATION_HEADER_SIZE bytes.
+ *
+ * \return number of bytes written to the buffer
+ */
+static int
+MessageQueue_encodeReplicationSnapshot(MessageQueue self, uint8_t* buffer)
+{
+    int bufPos = QueueReplicator_encodeRecord(buffer, QUEUE_REPLICATION_OP_CLEAR, self->replicationIndex, self->entryId, 0,
+            NULL, 0);
+
+    if (self->entryCounter != 0) {
+
+        uint8_t* entryPtr = self->firstEntry;
+
+        struct sMessageQueueEntryInfo entryInfo;
+
+        uint64_t currentTime = Hal_getTimeInMs();
+
+        while (entryPtr) {
+
+            memcpy(&entryInfo, entryPtr, sizeof(struct sMessageQueueEntryInfo));
+
+            /* confirmed entries in front of the first entry are already removed */
+            if (entryInfo.entryState != QUEUE_ENTRY_STATE_NOT_USED_OR_CONFIRMED) {
+                uint64_t expirationTime = 0;
+
+                /* restore the absolute time from the lower 32 bit stored in the entry */
+                if (entryInfo.hasExpirationTime)
+                    expirationTime = currentTime + (int32_t) (entryInfo.expirationTime - (uint32_t) currentTime);
+
+                bufPos += QueueReplicator_encodeRecord(buffer + bufPos, QUEUE_REPLICATION_OP_ENQUEUE, self->replicationIndex,
+                        entryInfo.entryId, expirationTime, entryPtr + sizeof(struct sMessageQueueEntryInfo), entryInfo.size);
+            }
+
+            if (entryPtr == self->lastEntry)
+                break;
+
+            /* move to next entry */
+            if (entryPtr == self->lastInBufferEntry)
+                entryPtr = self->buffer;
+            else
+                entryPtr = entryPtr + sizeof(struct sMessageQueueEntryInfo) + entryInfo.size;
+        }
+    }
+
+    return bufPos;
+}
+
+#endif /* (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1) */
+
+/***************************************************
+ * HighPriorityASDUQueue
+ ***************************************************/
+
+struct sHighPriorityASDUQueue {
+    int size; /* size of buffer in bytes */
+    int entryCounter; /* number of messages (ASDU) in the queue */
+
+    uint8_t* firstEntry;
+    uint8_t* lastEntry;
+    uint8_t* lastInBufferEntry;
+
+    uint8_t* buffer;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore queueLock;
 #endif
 };
 
@@ -885,8 +1661,12 @@ CS104_RedundancyGroup_create(const char* name)
     CS104_RedundancyGroup self = (CS104_RedundancyGroup) GLOBAL_MALLOC(sizeof(struct sCS104_RedundancyGroup));
 
     if (self) {
-        if (name)
-            self->name = strdup(name);
+        if (name) {
+            self->name = (char*) GLOBAL_MALLOC(strlen(name) + 1);
+
+            if (self->name)
+                strcpy(self->name, name);
+        }
         else
             self->name = NULL;
 
@@ -1032,6 +1812,9 @@ struct sCS104_Slave {
     int openConnections; /**< number of connected clients */
     MasterConnection masterConnections[CONFIG_CS104_MAX_CLIENT_CONNECTIONS]; /**< references to all MasterConnection objects */
 
+    MasterConnection freeConnections[CONFIG_CS104_MAX_CLIENT_CONNECTIONS]; /**< stack of unused MasterConnection objects (protected by openConnectionsLock) */
+    int numberOfFreeConnections;
+
 #if (CONFIG_USE_SEMAPHORES == 1)
     Semaphore openConnectionsLock;
 #endif
@@ -1063,17 +1846,117 @@ struct sCS104_Slave {
 
     ServerSocket serverSocket;
 
-    LinkedList plugins;
+    LinkedList plugins;         /* all plugins (for the plugin tasks) */
+    LinkedList allTypesPlugins; /* plugins that are called for all received ASDUs */
+    LinkedList* pluginsByTypeId; /* 256 lists of plugins indexed by type ID (NULL when not used) */
+
+    bool useThreadAttributes;
+    struct sThreadAttributes threadAttributes; /**< attributes of the server and connection threads */
+    char threadName[16]; /**< copy of the thread name of the attributes */
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    struct {
+        int maxQueueSize; /**< 0 = event class not used (except class 0) */
+        int weight;
+    } eventClasses[CONFIG_CS104_SLAVE_EVENT_CLASSES];
+
+    LinkedList eventClassMappings; /**< type ID/COT to event class mapping (struct sEventMapping) */
+#endif
+
+    LinkedList timeToLiveMappings; /**< type ID/COT to time to live (ms) mapping (struct sEventMapping) */
+    bool keepOnlyLatestCyclicValues; /**< replace waiting periodic/background values of the same information object */
+
+    int commandResponseReserve; /**< part of the send window (k) that cannot be used by events */
+
+    int outputMaxBytesPerSecond; /**< default output rate limit of new connections (0 = unlimited) */
+    int outputMaxFramesPerSecond;
+    int outputBurstSize;
+
+    int adaptiveMaxK; /**< maximum k of the adaptive send window (0 = fixed k) */
+    int adaptiveMaxW; /**< maximum w of the adaptive receive window (0 = fixed w) */
+    bool adaptiveT1; /**< extend t1 when the measured round trip time requires it */
+
+    bool receiveTimestamps; /**< use receive time stamps of the operating system for received messages */
+
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    struct {
+        CS101_CauseOfTransmission cot; /**< CS101_COT_PERIODIC or CS101_COT_BACKGROUND_SCAN */
+        int cycleTimeInMs;
+        CS104_CyclicGroupHandler handler;
+        void* parameter;
+        uint64_t nextCycleTime; /**< start of the next periodic cycle (0 = not scheduled) */
+    } cyclicGroups[CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS];
+
+    int numberOfCyclicGroups;
+#endif
+
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    char* replicationTargetAddress; /**< address of the standby (primary side) */
+    int replicationTargetPort;
+    bool replicationListenerEnabled; /**< receive replicated queue(s) (standby side) */
+    char* replicationLocalAddress;
+    int replicationLocalPort;
+    QueueReplicator replicator;
+    Thread replicationThread;
+    bool replicationRunning;
+    bool replicationConnected;
+#endif
+};
+
+/* assignment of a value (event class, time to live) to events by type ID and COT */
+struct sEventMapping {
+    IEC60870_5_TypeID typeId; /* 0 = any type ID */
+    CS101_CauseOfTransmission cot; /* 0 = any COT */
+    int value;
 };
 
 typedef struct {
     uint64_t entryId; /* required to identify message in server (low-priority) queue */
     uint8_t* queueEntry; /* NULL if ASDU is not from low-priority queue */
+    MessageQueue queue; /* low-priority queue (of the event class) containing the entry */
+    uint32_t queueGeneration; /* generation of the queue when the ASDU was sent */
 
     uint64_t sentTime; /* required for T1 timeout */
     int seqNo;
 } SentASDUSlave;
 
+/* token bucket to limit the output rate of I messages (tokens are stored in 1/1000 byte/frame) */
+typedef struct {
+    int maxBytesPerSecond; /* 0 = unlimited */
+    int maxFramesPerSecond; /* 0 = unlimited */
+    int64_t byteCapacity;
+    int64_t frameCapacity;
+    int64_t byteTokens;
+    int64_t frameTokens;
+    uint64_t lastRefillTime;
+    uint64_t blockedSince; /* time of the first send attempt that was blocked (0 = not blocked) */
+
+    CS104_OutputShapingStatistics statistics;
+} OutputShaper;
+
+/* round trip time estimation and adaptive k/w window of a connection */
+typedef struct {
+    int k; /* current send window (number of unconfirmed I messages) */
+    int minK; /* configured k */
+    int maxK;
+
+    int w; /* current receive window (received I messages before sending an acknowledgement) */
+    int minW; /* configured w */
+    int maxW;
+    int peerWindowLimit; /* observed window of the peer (0 = unknown) */
+
+    bool adaptiveT1;
+
+    int srtt; /* smoothed round trip time in ms (-1 = no sample yet) */
+    int rttVar; /* round trip time variation in ms */
+    int minRtt;
+
+    uint64_t confirmedFrames;
+    uint64_t ratePeriodStart;
+    uint64_t ratePeriodFrames;
+    int framesPerSecond;
+} LinkControl;
+
 struct sMasterConnection {
 
     Socket socket;
@@ -1087,6 +1970,8 @@ struct sMasterConnection {
 
     CS104_Slave slave;
 
+    uint32_t traceId; /* connection ID used in trace events */
+
     unsigned int isUsed:1;
     unsigned int isActive:1;
     unsigned int isRunning:1;
@@ -1115,12 +2000,53 @@ struct sMasterConnection {
 
     uint8_t recvBuffer[260];
     int recvBufPos;
+    uint64_t recvTimestamp; /* receive time of the first byte of the message in recvBuffer (ns since epoch, 0 = not available) */
+
+    int lastReceiveDelay; /* time between reception and the ASDU handler call of the last received I message (us) */
+    int maxReceiveDelay;
+
+    /* command response time measurement (protected by sentASDUsLock) */
+    uint64_t commandReceiveTime; /* reception of the control command waiting for a response (ns since epoch, 0 = none) */
+    uint8_t commandTypeId;
+    uint64_t commandResponses;
+    int lastCommandResponseTime; /* time between reception of a control command and sending the response (us) */
+    int maxCommandResponseTime;
 
     uint8_t sendBuffer[260];
 
+    /*
+     * data that could not be written to the socket yet (TCP send buffer full) or frames of the current batch.
+     * Only used by the I/O thread of the connection.
+     */
+    uint8_t outputBuffer[CONFIG_CS104_SLAVE_OUTPUT_BUFFER_SIZE];
+    int outputBufferStart;
+    int outputBufferLength;
+    bool isBatchingOutput; /* collect frames in the output buffer and write them at the end of the batch */
+
+#if (CONFIG_USE_THREADS == 1)
+    uint64_t ioThreadId; /* thread that handles the connection (only this thread writes to the socket) */
+#endif
+
     MessageQueue lowPrioQueue;
     HighPriorityASDUQueue highPrioQueue;
 
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    int eventClassCredits[CONFIG_CS104_SLAVE_EVENT_CLASSES]; /* remaining ASDUs per event class in the current scheduling round */
+#endif
+
+    OutputShaper outputShaper; /* protected by sentASDUsLock */
+
+    LinkControl linkControl; /* protected by sentASDUsLock */
+
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    struct {
+        uint64_t nextCycleTime; /* start of the next background scan cycle */
+        int nextAsduIndex; /* -1 = no cycle running */
+    } backgroundScans[CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS];
+
+    int nextBackgroundScanGroup; /* round robin between the background scan groups */
+#endif
+
 #if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
     CS104_RedundancyGroup redundancyGroup;
 #endif
@@ -1142,2358 +2068,4728 @@ static uint8_t TESTFR_ACT_MSG[] = { 0x68, 0x04, 0x43, 0x00, 0x00, 0x00 };
 
 #define TESTFR_ACT_MSG_SIZE 6
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
 static void
-initializeMessageQueues(CS104_Slave self, int lowPrioMaxQueueSize, int highPrioMaxQueueSize)
+OutputShaper_configure(OutputShaper* self, int maxBytesPerSecond, int maxFramesPerSecond, int burstSize)
 {
-    /* initialized low priority queue */
-    if (lowPrioMaxQueueSize < 1)
-        lowPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_SIZE;
+    if (maxBytesPerSecond < 0)
+        maxBytesPerSecond = 0;
 
-    self->asduQueue = MessageQueue_create(lowPrioMaxQueueSize);
+    if (maxFramesPerSecond < 0)
+        maxFramesPerSecond = 0;
 
-    /* initialize high priority queue */
-    if (highPrioMaxQueueSize < 1)
-        highPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE;
+    if (burstSize < 1)
+        burstSize = 1;
 
-    self->connectionAsduQueue = HighPriorityASDUQueue_create(highPrioMaxQueueSize);
+    self->maxBytesPerSecond = maxBytesPerSecond;
+    self->maxFramesPerSecond = maxFramesPerSecond;
+
+    /* a message can be sent when the bucket is not negative -> the capacity is one message less than the burst size */
+    self->byteCapacity = (int64_t) (burstSize - 1) * (IEC60870_5_104_MAX_ASDU_LENGTH + IEC60870_5_104_APCI_LENGTH) * 1000;
+    self->frameCapacity = (int64_t) (burstSize - 1) * 1000;
+    self->byteTokens = self->byteCapacity;
+    self->frameTokens = self->frameCapacity;
+    self->lastRefillTime = Hal_getTimeInMs();
+    self->blockedSince = 0;
 }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
 static void
-initializeConnectionSpecificQueues(CS104_Slave self)
+OutputShaper_refill(OutputShaper* self, uint64_t currentTime)
 {
-    int i;
-
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-        self->masterConnections[i]->lowPrioQueue = MessageQueue_create(self->maxLowPrioQueueSize);
-        self->masterConnections[i]->highPrioQueue = HighPriorityASDUQueue_create(self->maxHighPrioQueueSize);
+    if (currentTime <= self->lastRefillTime) {
+        /* clock jumped back */
+        self->lastRefillTime = currentTime;
+        return;
     }
-}
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1) */
 
-static MasterConnection
-MasterConnection_create(CS104_Slave slave);
-
-static CS104_Slave
-createSlave(int maxLowPrioQueueSize, int maxHighPrioQueueSize)
-{
-    CS104_Slave self = (CS104_Slave) GLOBAL_CALLOC(1, sizeof(struct sCS104_Slave));
+    int64_t elapsed = (int64_t) (currentTime - self->lastRefillTime);
 
-    if (self != NULL) {
+    self->lastRefillTime = currentTime;
 
-        self->conParameters = defaultConnectionParameters;
-        self->alParameters = defaultAppLayerParameters;
+    if (self->maxBytesPerSecond > 0) {
+        self->byteTokens += elapsed * self->maxBytesPerSecond;
 
-        self->asduHandler = NULL;
-        self->interrogationHandler = NULL;
-        self->counterInterrogationHandler = NULL;
-        self->readHandler = NULL;
-        self->clockSyncHandler = NULL;
-        self->resetProcessHandler = NULL;
-        self->delayAcquisitionHandler = NULL;
-        self->connectionRequestHandler = NULL;
-        self->connectionEventHandler = NULL;
-        self->rawMessageHandler = NULL;
-        self->maxLowPrioQueueSize = maxLowPrioQueueSize;
-        self->maxHighPrioQueueSize = maxHighPrioQueueSize;
+        if (self->byteTokens > self->byteCapacity)
+            self->byteTokens = self->byteCapacity;
+    }
 
-        {
-            int i;
+    if (self->maxFramesPerSecond > 0) {
+        self->frameTokens += elapsed * self->maxFramesPerSecond;
 
-            for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-                self->masterConnections[i] = MasterConnection_create(self);
-            }
-        }
+        if (self->frameTokens > self->frameCapacity)
+            self->frameTokens = self->frameCapacity;
+    }
+}
 
-        self->maxOpenConnections = CONFIG_CS104_MAX_CLIENT_CONNECTIONS;
-#if (CONFIG_USE_SEMAPHORES == 1)
-        self->openConnectionsLock = Semaphore_create(1);
-#endif
+static bool
+OutputShaper_isLimited(OutputShaper* self)
+{
+    return ((self->maxBytesPerSecond > 0) || (self->maxFramesPerSecond > 0));
+}
 
-#if (CONFIG_USE_THREADS == 1)
-        self->isThreadlessMode = false;
-#endif
+static bool
+OutputShaper_hasTokens(OutputShaper* self)
+{
+    return ((self->byteTokens >= 0) && (self->frameTokens >= 0));
+}
 
-        self->isRunning = false;
-        self->stopRunning = false;
+/**
+ * Check if the rate limit allows to send the next I message. The size of the message is not required
+ * because the tokens of a message are taken after sending (the bucket can become negative).
+ */
+static bool
+OutputShaper_isSendAllowed(OutputShaper* self)
+{
+    if (OutputShaper_isLimited(self) == false)
+        return true;
 
-        self->localAddress = NULL;
-        self->tcpPort = CS104_DEFAULT_PORT;
-        self->openConnections = 0;
-        self->listeningThread = NULL;
+    uint64_t currentTime = Hal_getTimeInMs();
 
-        self->serverSocket = NULL;
+    OutputShaper_refill(self, currentTime);
 
-        self->plugins = NULL;
+    if (OutputShaper_hasTokens(self))
+        return true;
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        self->tlsConfig = NULL;
-#endif
+    if (self->blockedSince == 0)
+        self->blockedSince = currentTime;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-        self->redundancyGroups = NULL;
-#endif
+    return false;
+}
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-        self->serverMode = CS104_MODE_SINGLE_REDUNDANCY_GROUP;
-#else
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-        self->serverMode = CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP;
-#endif
-#endif
-    }
+/**
+ * Called when messages are waiting for transmission (start measurement of the shaping delay when
+ * the bucket is empty)
+ */
+static void
+OutputShaper_messagesWaiting(OutputShaper* self)
+{
+    if (OutputShaper_isLimited(self) && (self->blockedSince == 0)) {
+        uint64_t currentTime = Hal_getTimeInMs();
 
-    return self;
+        OutputShaper_refill(self, currentTime);
+
+        if (OutputShaper_hasTokens(self) == false)
+            self->blockedSince = currentTime;
+    }
 }
 
-CS104_Slave
-CS104_Slave_create(int maxLowPrioQueueSize, int maxHighPrioQueueSize)
+/**
+ * Called when sending was allowed but no message was waiting
+ */
+static void
+OutputShaper_noMessageWaiting(OutputShaper* self)
 {
-    return createSlave(maxLowPrioQueueSize, maxHighPrioQueueSize);
+    self->blockedSince = 0;
 }
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-CS104_Slave
-CS104_Slave_createSecure(int maxLowPrioQueueSize, int maxHighPrioQueueSize, TLSConfiguration tlsConfig)
+static void
+OutputShaper_messageSent(OutputShaper* self, int msgSize)
 {
-    CS104_Slave self = createSlave(maxLowPrioQueueSize, maxHighPrioQueueSize);
+    self->statistics.sentFrames++;
+    self->statistics.sentBytes += msgSize;
 
-    if (self != NULL) {
-        self->tcpPort = 19998;
-        self->tlsConfig = tlsConfig;
-    }
+    if (self->blockedSince != 0) {
+        uint32_t delay = (uint32_t) (Hal_getTimeInMs() - self->blockedSince);
 
-    return self;
-}
-#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
+        self->statistics.delayedFrames++;
+        self->statistics.totalDelayInMs += delay;
 
-void
-CS104_Slave_addPlugin(CS104_Slave self, CS101_SlavePlugin plugin)
-{
-    if (self->plugins == NULL)
-        self->plugins = LinkedList_create();
+        if (delay > self->statistics.maxDelayInMs)
+            self->statistics.maxDelayInMs = delay;
 
-    if (self->plugins)
-        LinkedList_add(self->plugins, plugin);
-}
+        self->blockedSince = 0;
+    }
 
-void
-CS104_Slave_setServerMode(CS104_Slave self, CS104_ServerMode serverMode)
-{
-    self->serverMode = serverMode;
+    if (self->maxBytesPerSecond > 0)
+        self->byteTokens -= (int64_t) msgSize * 1000;
+
+    if (self->maxFramesPerSecond > 0)
+        self->frameTokens -= 1000;
 }
 
-void
-CS104_Slave_setLocalAddress(CS104_Slave self, const char* ipAddress)
+/**
+ * Get the time (in ms) until the next I message can be sent
+ */
+static int
+OutputShaper_getWaitTime(OutputShaper* self)
 {
-    if (self->localAddress)
-        GLOBAL_FREEMEM(self->localAddress);
+    int64_t waitTime = 0;
 
-    self->localAddress = (char*) GLOBAL_MALLOC(strlen(ipAddress) + 1);
+    if ((self->maxBytesPerSecond > 0) && (self->byteTokens < 0))
+        waitTime = (-self->byteTokens + self->maxBytesPerSecond - 1) / self->maxBytesPerSecond;
 
-    if (self->localAddress)
-        strcpy(self->localAddress, ipAddress);
-}
+    if ((self->maxFramesPerSecond > 0) && (self->frameTokens < 0)) {
+        int64_t frameWaitTime = (-self->frameTokens + self->maxFramesPerSecond - 1) / self->maxFramesPerSecond;
 
-void
-CS104_Slave_setLocalPort(CS104_Slave self, int tcpPort)
-{
-    self->tcpPort = tcpPort;
+        if (frameWaitTime > waitTime)
+            waitTime = frameWaitTime;
+    }
+
+    if (waitTime > INT32_MAX)
+        waitTime = INT32_MAX;
+
+    return (int) waitTime;
 }
 
-int
-CS104_Slave_getOpenConnections(CS104_Slave self)
+static void
+LinkControl_initialize(LinkControl* self, CS104_APCIParameters conParameters, int maxK, int maxW, bool adaptiveT1)
 {
-    int openConnections;
+    self->minK = conParameters->k;
+    self->k = self->minK;
+    self->maxK = (maxK > self->minK) ? maxK : self->minK;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->openConnectionsLock);
-#endif
+    self->minW = conParameters->w;
+    self->w = self->minW;
+    self->maxW = (maxW > self->minW) ? maxW : self->minW;
+    self->peerWindowLimit = 0;
 
-    openConnections = self->openConnections;
+    self->adaptiveT1 = adaptiveT1;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->openConnectionsLock);
-#endif
+    self->srtt = -1;
+    self->rttVar = 0;
+    self->minRtt = -1;
 
-    return openConnections;
+    self->confirmedFrames = 0;
+    self->ratePeriodStart = 0;
+    self->ratePeriodFrames = 0;
+    self->framesPerSecond = 0;
 }
 
+/**
+ * Called when the peer acknowledged I messages
+ *
+ * \param rtt time between sending the newest confirmed message and receiving the acknowledgement
+ * \param confirmedMessages number of confirmed messages
+ * \param windowWasFull the sender was limited by the window when the acknowledgement was received
+ */
 static void
-decreaseConnectionCounter(CS104_Slave self)
+LinkControl_acknowledged(LinkControl* self, uint64_t currentTime, int rtt, int confirmedMessages, bool windowWasFull)
 {
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_wait(self->openConnectionsLock);
-#endif
+    /* RTT estimation (RFC 6298) */
+    if (self->srtt == -1) {
+        self->srtt = rtt;
+        self->rttVar = rtt / 2;
+    }
+    else {
+        int delta = (self->srtt > rtt) ? (self->srtt - rtt) : (rtt - self->srtt);
 
-    self->openConnections--;
+        self->rttVar = (3 * self->rttVar + delta) / 4;
+        self->srtt = (7 * self->srtt + rtt) / 8;
+    }
 
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_post(self->openConnectionsLock);
-#endif
-}
+    if ((self->minRtt == -1) || (rtt < self->minRtt))
+        self->minRtt = rtt;
 
-static MasterConnection
-getFreeConnection(CS104_Slave self)
-{
-    MasterConnection connection = NULL;
+    /* throughput measurement */
+    self->confirmedFrames += confirmedMessages;
+    self->ratePeriodFrames += confirmedMessages;
 
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_wait(self->openConnectionsLock);
-#endif
+    if (self->ratePeriodStart == 0)
+        self->ratePeriodStart = currentTime;
+    else if (currentTime >= self->ratePeriodStart + 1000) {
+        self->framesPerSecond = (int) ((self->ratePeriodFrames * 1000) / (currentTime - self->ratePeriodStart));
+        self->ratePeriodStart = currentTime;
+        self->ratePeriodFrames = 0;
+    }
 
-    int i;
+    /* adaptive send window */
+    if (self->maxK > self->minK) {
 
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-        if ((self->masterConnections[i]) && (self->masterConnections[i]->isUsed == false)) {
-            connection = self->masterConnections[i];
-            connection->isUsed = true;
-            self->openConnections++;
-            break;
-        }
-    }
+        if (rtt > (2 * self->minRtt + 4 * self->rttVar + 10)) {
+            /* acknowledgements are delayed -> peer or link cannot keep up with the current window */
+            self->k = self->k / 2;
 
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_post(self->openConnectionsLock);
-#endif
+            if (self->k < self->minK)
+                self->k = self->minK;
+        }
+        else if (windowWasFull) {
+            /* window limited the throughput -> open the window (doubles per round trip) */
+            self->k += confirmedMessages;
 
-    return connection;
+            if (self->k > self->maxK)
+                self->k = self->maxK;
+        }
+    }
 }
 
-#if 0
+/**
+ * Called when an acknowledgement is sent because w I messages have been received
+ */
 static void
-addOpenConnection(CS104_Slave self, MasterConnection connection)
+LinkControl_receiveWindowReached(LinkControl* self)
 {
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_wait(self->openConnectionsLock);
-#endif
+    if (self->w < self->maxW) {
+        int limit = self->maxW;
 
-    int i;
+        /* acknowledge before the peer runs out of its send window */
+        if ((self->peerWindowLimit > 0) && (limit > (self->peerWindowLimit * 2) / 3))
+            limit = (self->peerWindowLimit * 2) / 3;
 
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-        if (self->masterConnections[i] == NULL) {
-            self->masterConnections[i] = connection;
-            self->openConnections++;
-            break;
-        }
+        if (self->w < limit)
+            self->w++;
     }
-
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_post(self->openConnectionsLock);
-#endif
 }
-#endif
 
-void
-CS104_Slave_setMaxOpenConnections(CS104_Slave self, int maxOpenConnections)
+/**
+ * Called when an acknowledgement is sent because of the t2 timeout
+ *
+ * \param unconfirmedMessages number of received I messages that are acknowledged
+ */
+static void
+LinkControl_receiveTimeout(LinkControl* self, int unconfirmedMessages)
 {
-    if (CONFIG_CS104_MAX_CLIENT_CONNECTIONS > 0) {
-        if (maxOpenConnections > CONFIG_CS104_MAX_CLIENT_CONNECTIONS)
-            maxOpenConnections = CONFIG_CS104_MAX_CLIENT_CONNECTIONS;
-    }
+    /*
+     * The peer stopped sending with more than the configured w but less than the current w
+     * unconfirmed messages -> its send window (k) is smaller than the current w
+     */
+    if ((unconfirmedMessages > self->minW) && (unconfirmedMessages < self->w)) {
+        self->peerWindowLimit = unconfirmedMessages;
 
-    self->maxOpenConnections = maxOpenConnections;
-}
+        self->w = (unconfirmedMessages * 2) / 3;
 
-void
-CS104_Slave_setConnectionRequestHandler(CS104_Slave self, CS104_ConnectionRequestHandler handler, void* parameter)
-{
-    self->connectionRequestHandler = handler;
-    self->connectionRequestHandlerParameter = parameter;
+        if (self->w < self->minW)
+            self->w = self->minW;
+    }
 }
 
-void
-CS104_Slave_setConnectionEventHandler(CS104_Slave self, CS104_ConnectionEventHandler handler, void* parameter)
+/**
+ * Get the t1 timeout (in ms) to wait for the acknowledgement of sent I messages
+ */
+static int
+LinkControl_getT1Timeout(LinkControl* self, int configuredT1)
 {
-    self->connectionEventHandler = handler;
-    self->connectionEventHandlerParameter = parameter;
+    int t1 = configuredT1 * 1000;
+
+    if (self->adaptiveT1 && (self->srtt != -1)) {
+        int rto = self->srtt + 4 * self->rttVar;
+
+        if (rto > t1)
+            t1 = rto;
+    }
+
+    return t1;
 }
 
 /**
- * Activate connection and deactivate existing active connections if required
+ * Create the queues of the configured event classes and apply the queue options
  */
 static void
-CS104_Slave_activate(CS104_Slave self, MasterConnection connectionToActivate)
+initializeEventQueue(CS104_Slave self, MessageQueue lowPrioQueue, int maxQueueSize)
 {
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP) {
+    if (lowPrioQueue == NULL)
+        return;
 
-        /* Deactivate all other connections */
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->openConnectionsLock);
-#endif
+    if (self->keepOnlyLatestCyclicValues)
+        MessageQueue_setKeepOnlyLatestValues(lowPrioQueue, maxQueueSize);
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    {
         int i;
 
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-            MasterConnection con = self->masterConnections[i];
+        lowPrioQueue->weight = self->eventClasses[0].weight;
 
-            if (con) {
-                if (con != connectionToActivate)
-                    MasterConnection_deactivate(con);
-            }
+        for (i = 1; i < CONFIG_CS104_SLAVE_EVENT_CLASSES; i++) {
+            if (self->eventClasses[i].maxQueueSize > 0) {
+                MessageQueue_addEventClass(lowPrioQueue, i, self->eventClasses[i].maxQueueSize, self->eventClasses[i].weight);
 
+                if (self->keepOnlyLatestCyclicValues && lowPrioQueue->eventClassQueues[i])
+                    MessageQueue_setKeepOnlyLatestValues(lowPrioQueue->eventClassQueues[i], self->eventClasses[i].maxQueueSize);
+            }
         }
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_post(self->openConnectionsLock);
-#endif
-
     }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
-
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-
-    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
-
-        /* Deactivate all other connections of the same redundancy group */
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->openConnectionsLock);
 #endif
+}
 
-        int i;
-
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-            MasterConnection con = self->masterConnections[i];
-
-            if (con) {
-                if (con->redundancyGroup == connectionToActivate->redundancyGroup) {
-                    if (con != connectionToActivate)
-                        MasterConnection_deactivate(con);
-                }
-            }
-
-        }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+static void
+initializeMessageQueues(CS104_Slave self, int lowPrioMaxQueueSize, int highPrioMaxQueueSize)
+{
+    /* initialized low priority queue */
+    if (lowPrioMaxQueueSize < 1)
+        lowPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_SIZE;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_post(self->openConnectionsLock);
-#endif
+    self->asduQueue = MessageQueue_create(lowPrioMaxQueueSize);
 
-    }
+    initializeEventQueue(self, self->asduQueue, lowPrioMaxQueueSize);
 
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+    /* initialize high priority queue */
+    if (highPrioMaxQueueSize < 1)
+        highPrioMaxQueueSize = CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE;
 
-    MasterConnection_activate(connectionToActivate);
+    self->connectionAsduQueue = HighPriorityASDUQueue_create(highPrioMaxQueueSize);
 }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-void
-CS104_Slave_setInterrogationHandler(CS104_Slave self, CS101_InterrogationHandler handler, void*  parameter)
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+static void
+initializeConnectionSpecificQueues(CS104_Slave self)
 {
-    self->interrogationHandler = handler;
-    self->interrogationHandlerParameter = parameter;
-}
+    int i;
 
-void
-CS104_Slave_setCounterInterrogationHandler(CS104_Slave self, CS101_CounterInterrogationHandler handler, void*  parameter)
-{
-    self->counterInterrogationHandler = handler;
-    self->counterInterrogationHandlerParameter = parameter;
+    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+        self->masterConnections[i]->lowPrioQueue = MessageQueue_create(self->maxLowPrioQueueSize);
+        initializeEventQueue(self, self->masterConnections[i]->lowPrioQueue, self->maxLowPrioQueueSize);
+        self->masterConnections[i]->highPrioQueue = HighPriorityASDUQueue_create(self->maxHighPrioQueueSize);
+    }
 }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1) */
 
-void
-CS104_Slave_setReadHandler(CS104_Slave self, CS101_ReadHandler handler, void* parameter)
-{
-    self->readHandler = handler;
-    self->readHandlerParameter = parameter;
-}
+static MasterConnection
+MasterConnection_create(CS104_Slave slave);
 
-void
-CS104_Slave_setASDUHandler(CS104_Slave self, CS101_ASDUHandler handler, void* parameter)
+static CS104_Slave
+createSlave(int maxLowPrioQueueSize, int maxHighPrioQueueSize)
 {
-    self->asduHandler = handler;
-    self->asduHandlerParameter = parameter;
-}
+    CS104_Slave self = (CS104_Slave) GLOBAL_CALLOC(1, sizeof(struct sCS104_Slave));
 
-void
-CS104_Slave_setClockSyncHandler(CS104_Slave self, CS101_ClockSynchronizationHandler handler, void* parameter)
-{
-    self->clockSyncHandler = handler;
-    self->clockSyncHandlerParameter = parameter;
-}
+    if (self != NULL) {
 
-void
-CS104_Slave_setRawMessageHandler(CS104_Slave self, CS104_SlaveRawMessageHandler handler, void* parameter)
-{
-    self->rawMessageHandler = handler;
-    self->rawMessageHandlerParameter = parameter;
-}
+        self->conParameters = defaultConnectionParameters;
+        self->alParameters = defaultAppLayerParameters;
 
-CS104_APCIParameters
-CS104_Slave_getConnectionParameters(CS104_Slave self)
-{
-    return &(self->conParameters);
-}
+        self->asduHandler = NULL;
+        self->interrogationHandler = NULL;
+        self->counterInterrogationHandler = NULL;
+        self->readHandler = NULL;
+        self->clockSyncHandler = NULL;
+        self->resetProcessHandler = NULL;
+        self->delayAcquisitionHandler = NULL;
+        self->connectionRequestHandler = NULL;
+        self->connectionEventHandler = NULL;
+        self->rawMessageHandler = NULL;
+        self->maxLowPrioQueueSize = maxLowPrioQueueSize;
+        self->maxHighPrioQueueSize = maxHighPrioQueueSize;
 
-CS101_AppLayerParameters
-CS104_Slave_getAppLayerParameters(CS104_Slave self)
-{
-    return &(self->alParameters);
-}
+        {
+            int i;
 
-/********************************************************
- * MasterConnection
- *********************************************************/
+            /* all connection objects are allocated in advance and reused for new client connections */
+            for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+                self->masterConnections[i] = MasterConnection_create(self);
 
-static void
-printSendBuffer(MasterConnection self)
-{
-    if (self->oldestSentASDU != -1) {
-        int currentIndex = self->oldestSentASDU;
+                if (self->masterConnections[i])
+                    self->freeConnections[self->numberOfFreeConnections++] = self->masterConnections[i];
+            }
+        }
 
-        int nextIndex = 0;
+        self->maxOpenConnections = CONFIG_CS104_MAX_CLIENT_CONNECTIONS;
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->openConnectionsLock = Semaphore_create(1);
+#endif
 
-        DEBUG_PRINT ("CS104 SLAVE: ------k-buffer------\n");
+#if (CONFIG_USE_THREADS == 1)
+        self->isThreadlessMode = false;
+#endif
 
-        do {
-            DEBUG_PRINT("CS104 SLAVE: %02i : SeqNo=%i time=%llu : queueEntry=%p\n", currentIndex,
-                    self->sentASDUs[currentIndex].seqNo,
-                    self->sentASDUs[currentIndex].sentTime,
-                    self->sentASDUs[currentIndex].queueEntry);
+        self->isRunning = false;
+        self->stopRunning = false;
 
-            if (currentIndex == self->newestSentASDU)
-                nextIndex = -1;
-            else
-                currentIndex = (currentIndex + 1) % self->maxSentASDUs;
+        self->localAddress = NULL;
+        self->tcpPort = CS104_DEFAULT_PORT;
+        self->openConnections = 0;
+        self->listeningThread = NULL;
 
-        } while (nextIndex != -1);
+        self->serverSocket = NULL;
 
-        DEBUG_PRINT ("CS104 SLAVE: --------------------\n");
-    }
-    else
-        DEBUG_PRINT("CS104 SLAVE: k-buffer is empty\n");
-}
+        self->plugins = NULL;
+        self->allTypesPlugins = NULL;
+        self->pluginsByTypeId = NULL;
 
-/**
- * \return number of bytes read, or -1 in case of an error
- */
-static int
-readFromSocket(MasterConnection self, uint8_t* buffer, int size)
-{
 #if (CONFIG_CS104_SUPPORT_TLS == 1)
-    if (self->tlsSocket != NULL)
-        return TLSSocket_read(self->tlsSocket, buffer, size);
-    else
-        return Socket_read(self->socket, buffer, size);
-#else
-    return Socket_read(self->socket, buffer, size);
+        self->tlsConfig = NULL;
 #endif
-}
-
-/**
- * \brief Read message part into receive buffer
- *
- * \return -1 in case of an error, 0 when no complete message can be read, > 0 when a complete message is in buffer
- */
-static int
-receiveMessage(MasterConnection self)
-{
-    uint8_t* buffer = self->recvBuffer;
-    int bufPos = self->recvBufPos;
-
-    /* read start byte */
-    if (bufPos == 0) {
-        int readFirst = readFromSocket(self, buffer, 1);
 
-        if (readFirst < 1)
-            return readFirst;
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+        self->redundancyGroups = NULL;
+#endif
 
-        if (buffer[0] != 0x68)
-            return -1; /* message error */
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+        self->eventClasses[0].weight = 1;
+        self->eventClassMappings = NULL;
+#endif
 
-        bufPos++;
-    }
+        self->timeToLiveMappings = NULL;
+        self->keepOnlyLatestCyclicValues = false;
+        self->commandResponseReserve = 0;
 
-    /* read length byte */
-    if (bufPos == 1)  {
-        if (readFromSocket(self, buffer + 1, 1) != 1) {
-            self->recvBufPos = 0;
-            return -1;
-        }
+        self->outputMaxBytesPerSecond = 0;
+        self->outputMaxFramesPerSecond = 0;
+        self->outputBurstSize = 1;
 
-        bufPos++;
-    }
+        self->adaptiveMaxK = 0;
+        self->adaptiveMaxW = 0;
+        self->adaptiveT1 = false;
 
-    /* read remaining frame */
-    if (bufPos > 1) {
-        int length = buffer[1];
+        self->receiveTimestamps = false;
 
-        int remainingLength = length - bufPos + 2;
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+        self->numberOfCyclicGroups = 0;
+#endif
 
-        int readCnt = readFromSocket(self, buffer + bufPos, remainingLength);
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+        self->replicationTargetAddress = NULL;
+        self->replicationListenerEnabled = false;
+        self->replicationLocalAddress = NULL;
+        self->replicator = NULL;
+        self->replicationThread = NULL;
+        self->replicationRunning = false;
+        self->replicationConnected = false;
+#endif
 
-        if (readCnt == remainingLength) {
-            self->recvBufPos = 0;
-            return length + 2;
-        }
-        else if (readCnt == -1) {
-            self->recvBufPos = 0;
-            return -1;
-        }
-        else {
-            self->recvBufPos = bufPos + readCnt;
-            return 0;
-        }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+        self->serverMode = CS104_MODE_SINGLE_REDUNDANCY_GROUP;
+#else
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+        self->serverMode = CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP;
+#endif
+#endif
     }
 
-    self->recvBufPos = bufPos;
-    return 0;
+    return self;
 }
 
-static int
-writeToSocket(MasterConnection self, uint8_t* buf, int size)
+CS104_Slave
+CS104_Slave_create(int maxLowPrioQueueSize, int maxHighPrioQueueSize)
 {
-    if (self->slave->rawMessageHandler)
-        self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter,
-                &(self->iMasterConnection), buf, size, true);
-
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-    if (self->tlsSocket)
-        return TLSSocket_write(self->tlsSocket, buf, size);
-    else
-        return Socket_write(self->socket, buf, size);
-#else
-    return Socket_write(self->socket, buf, size);
-#endif
+    return createSlave(maxLowPrioQueueSize, maxHighPrioQueueSize);
 }
 
-static int
-sendIMessage(MasterConnection self, uint8_t* buffer, int msgSize)
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+CS104_Slave
+CS104_Slave_createSecure(int maxLowPrioQueueSize, int maxHighPrioQueueSize, TLSConfiguration tlsConfig)
 {
-    buffer[0] = (uint8_t) 0x68;
-    buffer[1] = (uint8_t) (msgSize - 2);
+    CS104_Slave self = createSlave(maxLowPrioQueueSize, maxHighPrioQueueSize);
 
-    buffer[2] = (uint8_t) ((self->sendCount % 128) * 2);
-    buffer[3] = (uint8_t) (self->sendCount / 128);
+    if (self != NULL) {
+        self->tcpPort = 19998;
+        self->tlsConfig = tlsConfig;
+    }
 
-    buffer[4] = (uint8_t) ((self->receiveCount % 128) * 2);
-    buffer[5] = (uint8_t) (self->receiveCount / 128);
+    return self;
+}
+#endif /* (CONFIG_CS104_SUPPORT_TLS == 1) */
 
-    if (writeToSocket(self, buffer, msgSize) > 0) {
-        DEBUG_PRINT("CS104 SLAVE: SEND I (size = %i) N(S) = %i N(R) = %i\n", msgSize, self->sendCount, self->receiveCount);
-        self->sendCount = (self->sendCount + 1) % 32768;
-        self->unconfirmedReceivedIMessages = 0;
-        self->timeoutT2Triggered = false;
-    }
-    else
-        self->isRunning = false;
+void
+CS104_Slave_addPlugin(CS104_Slave self, CS101_SlavePlugin plugin)
+{
+    if (self->plugins == NULL)
+        self->plugins = LinkedList_create();
 
-    self->unconfirmedReceivedIMessages = 0;
+    if (self->allTypesPlugins == NULL)
+        self->allTypesPlugins = LinkedList_create();
 
-    return self->sendCount;
+    if (self->plugins && self->allTypesPlugins) {
+        LinkedList_add(self->plugins, plugin);
+        LinkedList_add(self->allTypesPlugins, plugin);
+    }
 }
 
 static bool
-isSentBufferFull(MasterConnection self)
+containsPlugin(LinkedList plugins, CS101_SlavePlugin plugin)
 {
-    /* locking of k-buffer has to be done by caller! */
-    if (self->oldestSentASDU == -1)
-        return false;
+    LinkedList pluginElem = LinkedList_getNext(plugins);
 
-    int newIndex = (self->newestSentASDU + 1) % (self->maxSentASDUs);
+    while (pluginElem) {
+        if (LinkedList_getData(pluginElem) == plugin)
+            return true;
 
-    if (newIndex == self->oldestSentASDU)
-        return true;
-    else
-        return false;
-}
+        pluginElem = LinkedList_getNext(pluginElem);
+    }
 
+    return false;
+}
 
-static void
-sendASDU(MasterConnection self, uint8_t* buffer, int msgSize, uint64_t entryId, uint8_t* queueEntry)
+void
+CS104_Slave_addPluginForTypeID(CS104_Slave self, CS101_SlavePlugin plugin, IEC60870_5_TypeID typeId)
 {
-    int currentIndex = 0;
+    if (((int) typeId < 1) || ((int) typeId > 255))
+        return;
 
-    if (self->oldestSentASDU == -1) {
-        self->oldestSentASDU = 0;
-        self->newestSentASDU = 0;
-    }
-    else {
-        currentIndex = (self->newestSentASDU + 1) % self->maxSentASDUs;
-    }
+    if (self->plugins == NULL)
+        self->plugins = LinkedList_create();
 
-    self->sentASDUs[currentIndex].entryId = entryId;
-    self->sentASDUs[currentIndex].queueEntry = queueEntry;
-    self->sentASDUs[currentIndex].seqNo = sendIMessage(self, buffer, msgSize);
-    self->sentASDUs[currentIndex].sentTime = Hal_getTimeInMs();
+    if (self->pluginsByTypeId == NULL)
+        self->pluginsByTypeId = (LinkedList*) GLOBAL_CALLOC(256, sizeof(LinkedList));
 
-    self->newestSentASDU = currentIndex;
+    if ((self->plugins == NULL) || (self->pluginsByTypeId == NULL))
+        return;
 
-    printSendBuffer(self);
-}
+    if (self->pluginsByTypeId[typeId] == NULL)
+        self->pluginsByTypeId[typeId] = LinkedList_create();
 
+    if (self->pluginsByTypeId[typeId]) {
+        LinkedList_add(self->pluginsByTypeId[typeId], plugin);
 
-static bool
-sendASDUInternal(MasterConnection self, CS101_ASDU asdu)
+        /* the task of the plugin is called once, regardless of the number of type IDs */
+        if (containsPlugin(self->plugins, plugin) == false)
+            LinkedList_add(self->plugins, plugin);
+    }
+}
+
+static void
+destroyPlugins(CS104_Slave self)
 {
-    bool asduSent;
+    if (self->plugins)
+        LinkedList_destroyStatic(self->plugins);
 
-    if (self->isActive) {
+    if (self->allTypesPlugins)
+        LinkedList_destroyStatic(self->allTypesPlugins);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->sentASDUsLock);
-#endif
+    if (self->pluginsByTypeId) {
+        int i;
 
-        if (isSentBufferFull(self) == false) {
+        for (i = 0; i < 256; i++) {
+            if (self->pluginsByTypeId[i])
+                LinkedList_destroyStatic(self->pluginsByTypeId[i]);
+        }
 
-            FrameBuffer frameBuffer;
+        GLOBAL_FREEMEM(self->pluginsByTypeId);
+    }
+}
 
-            struct sBufferFrame bufferFrame;
-
-            Frame frame = BufferFrame_initialize(&bufferFrame, frameBuffer.msg, IEC60870_5_104_APCI_LENGTH);
-            CS101_ASDU_encode(asdu, frame);
-
-            frameBuffer.msgSize = Frame_getMsgSize(frame);
-
-            sendASDU(self, frameBuffer.msg, frameBuffer.msgSize, 0, NULL);
-
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->sentASDUsLock);
-#endif
+void
+CS104_Slave_setServerMode(CS104_Slave self, CS104_ServerMode serverMode)
+{
+    self->serverMode = serverMode;
+}
 
-            asduSent = true;
-        }
-        else {
-#if (CONFIG_USE_SEMAPHORES == 1)
-            Semaphore_post(self->sentASDUsLock);
-#endif
-            asduSent = HighPriorityASDUQueue_enqueue(self->highPrioQueue, asdu);
+void
+CS104_Slave_setThreadAttributes(CS104_Slave self, ThreadAttributes attributes)
+{
+    if (attributes) {
+        self->threadAttributes = *attributes;
+        self->useThreadAttributes = true;
+
+        if (attributes->name) {
+            strncpy(self->threadName, attributes->name, sizeof(self->threadName) - 1);
+            self->threadName[sizeof(self->threadName) - 1] = 0;
+            self->threadAttributes.name = self->threadName;
         }
-
     }
     else
-        asduSent = false;
+        self->useThreadAttributes = false;
+}
 
-    if (asduSent == false)
-        DEBUG_PRINT("CS104 SLAVE: unable to send response (isActive=%i)\n", self->isActive);
+void
+CS104_Slave_setLocalAddress(CS104_Slave self, const char* ipAddress)
+{
+    if (self->localAddress)
+        GLOBAL_FREEMEM(self->localAddress);
 
-    return asduSent;
-}
+    self->localAddress = (char*) GLOBAL_MALLOC(strlen(ipAddress) + 1);
 
+    if (self->localAddress)
+        strcpy(self->localAddress, ipAddress);
+}
 
-static void
-responseCOTUnknown(CS101_ASDU asdu, MasterConnection self)
+void
+CS104_Slave_setLocalPort(CS104_Slave self, int tcpPort)
 {
-    DEBUG_PRINT("CS104 SLAVE:   with unknown COT\n");
-    CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_COT);
-    CS101_ASDU_setNegative(asdu, true);
-    sendASDUInternal(self, asdu);
+    self->tcpPort = tcpPort;
 }
 
-/*
- * Handle received ASDUs
- *
- * Call the appropriate callbacks according to ASDU type and CoT
- *
- * \return true when ASDU is valid, false otherwise (e.g. corrupted message data)
- */
-static bool
-handleASDU(MasterConnection self, CS101_ASDU asdu)
+int
+CS104_Slave_getOpenConnections(CS104_Slave self)
 {
-    bool messageHandled = false;
-
-    CS104_Slave slave = self->slave;
+    int openConnections;
 
-    /* call plugins */
-    if (slave->plugins) {
-        LinkedList pluginElem = LinkedList_getNext(slave->plugins);
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->openConnectionsLock);
+#endif
 
-        while (pluginElem) {
+    openConnections = self->openConnections;
 
-            CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->openConnectionsLock);
+#endif
 
-            CS101_SlavePlugin_Result result = plugin->handleAsdu(plugin->parameter, &(self->iMasterConnection), asdu);
+    return openConnections;
+}
 
-            if (result == CS101_PLUGIN_RESULT_HANDLED)
-                return true;
+/* return connection object to the pool of free connections - openConnectionsLock has to be held by caller! */
+static void
+putFreeConnection(CS104_Slave self, MasterConnection connection)
+{
+    if (connection->isUsed) {
+        connection->isUsed = false;
 
-            pluginElem = LinkedList_getNext(pluginElem);
-        }
+        self->freeConnections[self->numberOfFreeConnections++] = connection;
+        self->openConnections--;
     }
+}
 
-    uint8_t cot = CS101_ASDU_getCOT(asdu);
-
-    switch (CS101_ASDU_getTypeID(asdu)) {
+/* release a connection that failed to initialize */
+static void
+releaseConnection(CS104_Slave self, MasterConnection connection)
+{
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_wait(self->openConnectionsLock);
+#endif
 
-    case C_IC_NA_1: /* 100 - interrogation command */
+    putFreeConnection(self, connection);
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd interrogation command C_IC_NA_1\n");
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_post(self->openConnectionsLock);
+#endif
+}
 
-        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_DEACTIVATION)) {
-            if (slave->interrogationHandler != NULL) {
+static MasterConnection
+getFreeConnection(CS104_Slave self)
+{
+    MasterConnection connection = NULL;
 
-                union uInformationObject _io;
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_wait(self->openConnectionsLock);
+#endif
 
-                InterrogationCommand irc = (InterrogationCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+    if (self->numberOfFreeConnections > 0) {
+        connection = self->freeConnections[--(self->numberOfFreeConnections)];
+        connection->isUsed = true;
+        self->openConnections++;
+    }
 
-                if (irc) {
-                    if (slave->interrogationHandler(slave->interrogationHandlerParameter,
-                            &(self->iMasterConnection), asdu, InterrogationCommand_getQOI(irc)))
-                        messageHandled = true;
-                }
-                else
-                    return false;
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_post(self->openConnectionsLock);
+#endif
 
-            }
-        }
-        else
-            responseCOTUnknown(asdu, self);
+    return connection;
+}
 
-        break;
+void
+CS104_Slave_setMaxOpenConnections(CS104_Slave self, int maxOpenConnections)
+{
+    if (CONFIG_CS104_MAX_CLIENT_CONNECTIONS > 0) {
+        if (maxOpenConnections > CONFIG_CS104_MAX_CLIENT_CONNECTIONS)
+            maxOpenConnections = CONFIG_CS104_MAX_CLIENT_CONNECTIONS;
+    }
 
-    case C_CI_NA_1: /* 101 - counter interrogation command */
+    self->maxOpenConnections = maxOpenConnections;
+}
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd counter interrogation command C_CI_NA_1\n");
+void
+CS104_Slave_setConnectionRequestHandler(CS104_Slave self, CS104_ConnectionRequestHandler handler, void* parameter)
+{
+    self->connectionRequestHandler = handler;
+    self->connectionRequestHandlerParameter = parameter;
+}
 
-        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_DEACTIVATION)) {
+void
+CS104_Slave_setConnectionEventHandler(CS104_Slave self, CS104_ConnectionEventHandler handler, void* parameter)
+{
+    self->connectionEventHandler = handler;
+    self->connectionEventHandlerParameter = parameter;
+}
 
-            if (slave->counterInterrogationHandler != NULL) {
+/**
+ * Activate connection and deactivate existing active connections if required
+ */
+static void
+CS104_Slave_activate(CS104_Slave self, MasterConnection connectionToActivate)
+{
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP) {
 
-                union uInformationObject _io;
+        /* Deactivate all other connections */
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->openConnectionsLock);
+#endif
+        int i;
 
-                CounterInterrogationCommand cic = (CounterInterrogationCommand)  CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+            MasterConnection con = self->masterConnections[i];
 
-                if (cic) {
-                    if (slave->counterInterrogationHandler(slave->counterInterrogationHandlerParameter,
-                            &(self->iMasterConnection), asdu, CounterInterrogationCommand_getQCC(cic)))
-                        messageHandled = true;
-                }
-                else
-                    return false;
+            if (con) {
+                if (con != connectionToActivate)
+                    MasterConnection_deactivate(con);
             }
+
         }
-        else
-            responseCOTUnknown(asdu, self);
 
-        break;
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
+#endif
 
-    case C_RD_NA_1: /* 102 - read command */
+    }
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd read command C_RD_NA_1\n");
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
 
-        if (cot == CS101_COT_REQUEST) {
-            if (slave->readHandler != NULL) {
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
 
-                union uInformationObject _io;
+        /* Deactivate all other connections of the same redundancy group */
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->openConnectionsLock);
+#endif
 
-                ReadCommand rc = (ReadCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+        int i;
 
-                if (rc) {
-                    if (slave->readHandler(slave->readHandlerParameter,
-                            &(self->iMasterConnection), asdu, InformationObject_getObjectAddress((InformationObject) rc)))
-                        messageHandled = true;
+        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+            MasterConnection con = self->masterConnections[i];
+
+            if (con) {
+                if (con->redundancyGroup == connectionToActivate->redundancyGroup) {
+                    if (con != connectionToActivate)
+                        MasterConnection_deactivate(con);
                 }
-                else
-                    return false;
             }
-        }
-        else
-            responseCOTUnknown(asdu, self);
-
-        break;
 
-    case C_CS_NA_1: /* 103 - Clock synchronization command */
+        }
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd clock sync command C_CS_NA_1\n");
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
+#endif
 
-        if (cot == CS101_COT_ACTIVATION) {
+    }
 
-            if (slave->clockSyncHandler != NULL) {
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
-                union uInformationObject _io;
+    MasterConnection_activate(connectionToActivate);
+}
 
-                ClockSynchronizationCommand csc = (ClockSynchronizationCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+void
+CS104_Slave_setInterrogationHandler(CS104_Slave self, CS101_InterrogationHandler handler, void*  parameter)
+{
+    self->interrogationHandler = handler;
+    self->interrogationHandlerParameter = parameter;
+}
 
-                if (csc) {
-                    CP56Time2a newTime = ClockSynchronizationCommand_getTime(csc);
+void
+CS104_Slave_setCounterInterrogationHandler(CS104_Slave self, CS101_CounterInterrogationHandler handler, void*  parameter)
+{
+    self->counterInterrogationHandler = handler;
+    self->counterInterrogationHandlerParameter = parameter;
+}
 
-                    if (slave->clockSyncHandler(slave->clockSyncHandlerParameter,
-                            &(self->iMasterConnection), asdu, newTime)) {
+void
+CS104_Slave_setReadHandler(CS104_Slave self, CS101_ReadHandler handler, void* parameter)
+{
+    self->readHandler = handler;
+    self->readHandlerParameter = parameter;
+}
 
-                        CS101_ASDU_removeAllElements(asdu);
+void
+CS104_Slave_setASDUHandler(CS104_Slave self, CS101_ASDUHandler handler, void* parameter)
+{
+    self->asduHandler = handler;
+    self->asduHandlerParameter = parameter;
+}
+
+void
+CS104_Slave_setClockSyncHandler(CS104_Slave self, CS101_ClockSynchronizationHandler handler, void* parameter)
+{
+    self->clockSyncHandler = handler;
+    self->clockSyncHandlerParameter = parameter;
+}
+
+void
+CS104_Slave_setRawMessageHandler(CS104_Slave self, CS104_SlaveRawMessageHandler handler, void* parameter)
+{
+    self->rawMessageHandler = handler;
+    self->rawMessageHandlerParameter = parameter;
+}
+
+CS104_APCIParameters
+CS104_Slave_getConnectionParameters(CS104_Slave self)
+{
+    return &(self->conParameters);
+}
+
+CS101_AppLayerParameters
+CS104_Slave_getAppLayerParameters(CS104_Slave self)
+{
+    return &(self->alParameters);
+}
+
+/********************************************************
+ * MasterConnection
+ *********************************************************/
+
+static void
+printSendBuffer(MasterConnection self)
+{
+    if (self->oldestSentASDU != -1) {
+        int currentIndex = self->oldestSentASDU;
+
+        int nextIndex = 0;
+
+        DEBUG_PRINT ("CS104 SLAVE: ------k-buffer------\n");
+
+        do {
+            DEBUG_PRINT("CS104 SLAVE: %02i : SeqNo=%i time=%llu : queueEntry=%p\n", currentIndex,
+                    self->sentASDUs[currentIndex].seqNo,
+                    self->sentASDUs[currentIndex].sentTime,
+                    self->sentASDUs[currentIndex].queueEntry);
+
+            if (currentIndex == self->newestSentASDU)
+                nextIndex = -1;
+            else
+                currentIndex = (currentIndex + 1) % self->maxSentASDUs;
+
+        } while (nextIndex != -1);
+
+        DEBUG_PRINT ("CS104 SLAVE: --------------------\n");
+    }
+    else
+        DEBUG_PRINT("CS104 SLAVE: k-buffer is empty\n");
+}
+
+/**
+ * \return number of bytes read, or -1 in case of an error
+ */
+static int
+readFromSocket(MasterConnection self, uint8_t* buffer, int size)
+{
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsSocket != NULL)
+        return TLSSocket_read(self->tlsSocket, buffer, size);
+    else
+        return Socket_read(self->socket, buffer, size);
+#else
+    return Socket_read(self->socket, buffer, size);
+#endif
+}
+
+/**
+ * \brief Read from socket and get the receive time of the data
+ *
+ * \return number of bytes read, or -1 in case of an error
+ */
+static int
+readFromSocketWithTimestamp(MasterConnection self, uint8_t* buffer, int size, uint64_t* timestamp)
+{
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsSocket != NULL) {
+        /* time stamps of the TCP segments are not available for the decrypted data */
+        int readBytes = TLSSocket_read(self->tlsSocket, buffer, size);
+
+        if (readBytes > 0)
+            *timestamp = Hal_getTimeInNs();
+
+        return readBytes;
+    }
+#endif
+
+    return Socket_readWithTimestamp(self->socket, buffer, size, timestamp);
+}
+
+/**
+ * \brief Read message part into receive buffer
+ *
+ * \return -1 in case of an error, 0 when no complete message can be read, > 0 when a complete message is in buffer
+ */
+static int
+receiveMessage(MasterConnection self)
+{
+    uint8_t* buffer = self->recvBuffer;
+    int bufPos = self->recvBufPos;
+
+    /* read start byte */
+    if (bufPos == 0) {
+        int readFirst;
+
+        if (self->slave->receiveTimestamps)
+            readFirst = readFromSocketWithTimestamp(self, buffer, 1, &(self->recvTimestamp));
+        else
+            readFirst = readFromSocket(self, buffer, 1);
+
+        if (readFirst < 1)
+            return readFirst;
+
+        if (buffer[0] != 0x68)
+            return -1; /* message error */
+
+        bufPos++;
+    }
+
+    /* read length byte */
+    if (bufPos == 1)  {
+        if (readFromSocket(self, buffer + 1, 1) != 1) {
+            self->recvBufPos = 0;
+            return -1;
+        }
+
+        bufPos++;
+    }
+
+    /* read remaining frame */
+    if (bufPos > 1) {
+        int length = buffer[1];
+
+        int remainingLength = length - bufPos + 2;
+
+        int readCnt = readFromSocket(self, buffer + bufPos, remainingLength);
+
+        if (readCnt == remainingLength) {
+            self->recvBufPos = 0;
+            return length + 2;
+        }
+        else if (readCnt == -1) {
+            self->recvBufPos = 0;
+            return -1;
+        }
+        else {
+            self->recvBufPos = bufPos + readCnt;
+            return 0;
+        }
+    }
+
+    self->recvBufPos = bufPos;
+    return 0;
+}
+
+static int
+writeToSocketInternal(MasterConnection self, uint8_t* buf, int size)
+{
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+    if (self->tlsSocket)
+        return TLSSocket_write(self->tlsSocket, buf, size);
+    else
+        return Socket_write(self->socket, buf, size);
+#else
+    return Socket_write(self->socket, buf, size);
+#endif
+}
+
+/**
+ * Write the buffered output data to the socket (locking has to be done by caller).
+ *
+ * \return false in case of a socket error, true otherwise
+ */
+static bool
+flushOutputBufferInternal(MasterConnection self)
+{
+    while (self->outputBufferLength > 0) {
+        int sentBytes = writeToSocketInternal(self, self->outputBuffer + self->outputBufferStart, self->outputBufferLength);
+
+        if (sentBytes < 0)
+            return false;
+
+        if (sentBytes == 0)
+            break;
+
+        self->outputBufferStart += sentBytes;
+        self->outputBufferLength -= sentBytes;
+    }
+
+    if (self->outputBufferLength == 0)
+        self->outputBufferStart = 0;
+
+    return true;
+}
+
+/**
+ * Try to write the buffered output data to the socket
+ *
+ * \return false in case of a socket error, true otherwise
+ */
+static bool
+MasterConnection_flushOutputBuffer(MasterConnection self)
+{
+    return flushOutputBufferInternal(self);
+}
+
+/**
+ * Check if output data is waiting until the socket becomes writable (frames of the current batch are not counted)
+ */
+static bool
+MasterConnection_isOutputPending(MasterConnection self)
+{
+    return (self->isBatchingOutput == false) && (self->outputBufferLength > 0);
+}
+
+/**
+ * Write a complete message. The part of the message that cannot be written immediately
+ * is stored in the output buffer.
+ *
+ * \return the message size, or -1 in case of a socket error or output buffer overflow
+ */
+static int
+writeToSocket(MasterConnection self, uint8_t* buf, int size)
+{
+    int retVal = size;
+
+    if (self->slave->rawMessageHandler)
+        self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter,
+                &(self->iMasterConnection), buf, size, true);
+
+    if (self->isBatchingOutput) {
+        if (self->outputBufferStart + self->outputBufferLength + size <= CONFIG_CS104_SLAVE_OUTPUT_BUFFER_SIZE) {
+            memcpy(self->outputBuffer + self->outputBufferStart + self->outputBufferLength, buf, size);
+            self->outputBufferLength += size;
+
+            return retVal;
+        }
+
+        /* no more space for the batch -> write the collected frames and continue without batching */
+        self->isBatchingOutput = false;
+    }
+
+    int sentBytes = 0;
+
+    /* keep message order - only write directly when no older data is waiting */
+    if (flushOutputBufferInternal(self) == false) {
+        retVal = -1;
+        goto exit_function;
+    }
+
+    if (self->outputBufferLength == 0) {
+        sentBytes = writeToSocketInternal(self, buf, size);
+
+        if (sentBytes < 0) {
+            retVal = -1;
+            goto exit_function;
+        }
+    }
+
+    if (sentBytes < size) {
+        int remaining = size - sentBytes;
+
+        if (self->outputBufferStart + self->outputBufferLength + remaining > CONFIG_CS104_SLAVE_OUTPUT_BUFFER_SIZE) {
+            memmove(self->outputBuffer, self->outputBuffer + self->outputBufferStart, self->outputBufferLength);
+            self->outputBufferStart = 0;
+        }
+
+        if (self->outputBufferLength + remaining > CONFIG_CS104_SLAVE_OUTPUT_BUFFER_SIZE) {
+            DEBUG_PRINT("CS104 SLAVE: output buffer overflow\n");
+            retVal = -1;
+            goto exit_function;
+        }
+
+        memcpy(self->outputBuffer + self->outputBufferStart + self->outputBufferLength, buf + sentBytes, remaining);
+        self->outputBufferLength += remaining;
+    }
+
+exit_function:
+
+    return retVal;
+}
+
+static int
+sendIMessage(MasterConnection self, uint8_t* buffer, int msgSize)
+{
+    buffer[0] = (uint8_t) 0x68;
+    buffer[1] = (uint8_t) (msgSize - 2);
+
+    buffer[2] = (uint8_t) ((self->sendCount % 128) * 2);
+    buffer[3] = (uint8_t) (self->sendCount / 128);
+
+    buffer[4] = (uint8_t) ((self->receiveCount % 128) * 2);
+    buffer[5] = (uint8_t) (self->receiveCount / 128);
+
+    if (writeToSocket(self, buffer, msgSize) > 0) {
+        DEBUG_PRINT("CS104 SLAVE: SEND I (size = %i) N(S) = %i N(R) = %i\n", msgSize, self->sendCount, self->receiveCount);
+        TRACE_POINT(LIB60870_TRACE_SEND_I, self->traceId, self->sendCount, self->receiveCount);
+        self->sendCount = (self->sendCount + 1) % 32768;
+        self->unconfirmedReceivedIMessages = 0;
+        self->timeoutT2Triggered = false;
+    }
+    else
+        self->isRunning = false;
+
+    self->unconfirmedReceivedIMessages = 0;
+
+    return self->sendCount;
+}
+
+static int
+getNumberOfUnconfirmedASDUs(MasterConnection self)
+{
+    /* locking of k-buffer has to be done by caller! */
+    if (self->oldestSentASDU == -1)
+        return 0;
+
+    return ((self->newestSentASDU - self->oldestSentASDU + self->maxSentASDUs) % self->maxSentASDUs) + 1;
+}
+
+static bool
+isSentBufferFull(MasterConnection self)
+{
+    /* locking of k-buffer has to be done by caller! */
+    if (self->oldestSentASDU == -1)
+        return false;
+
+    return (getNumberOfUnconfirmedASDUs(self) >= self->linkControl.k);
+}
+
+/* events cannot use the part of the send window that is reserved for command responses (locking of k-buffer by caller) */
+static bool
+isSentBufferFullForEvents(MasterConnection self)
+{
+    if (self->oldestSentASDU == -1)
+        return false;
+
+    int maxEventFrames = self->linkControl.k - self->slave->commandResponseReserve;
+
+    if (maxEventFrames < 1)
+        maxEventFrames = 1;
+
+    return (getNumberOfUnconfirmedASDUs(self) >= maxEventFrames);
+}
+
+static bool
+isControlCommand(uint8_t typeId)
+{
+    return ((typeId >= C_SC_NA_1) && (typeId <= C_BO_TA_1));
+}
+
+/* measure the time between reception of a control command and its confirmation (locking of k-buffer by caller) */
+static void
+checkCommandResponse(MasterConnection self, uint8_t* buffer)
+{
+    if (self->commandReceiveTime == 0)
+        return;
+
+    uint8_t typeId = buffer[IEC60870_5_104_APCI_LENGTH];
+    uint8_t cot = buffer[IEC60870_5_104_APCI_LENGTH + 2] & 0x3f;
+
+    if (typeId != self->commandTypeId)
+        return;
+
+    if ((cot == CS101_COT_ACTIVATION_CON) || (cot == CS101_COT_DEACTIVATION_CON) || (cot >= CS101_COT_UNKNOWN_TYPE_ID)) {
+        uint64_t currentTime = Hal_getTimeInNs();
+
+        int responseTime = (currentTime > self->commandReceiveTime) ? (int) ((currentTime - self->commandReceiveTime) / 1000) : 0;
+
+        self->commandReceiveTime = 0;
+        self->commandResponses++;
+        self->lastCommandResponseTime = responseTime;
+
+        if (responseTime > self->maxCommandResponseTime)
+            self->maxCommandResponseTime = responseTime;
+    }
+}
+
+
+static void
+sendASDU(MasterConnection self, uint8_t* buffer, int msgSize, uint64_t entryId, uint8_t* queueEntry, MessageQueue queue)
+{
+    int currentIndex = 0;
+
+    if (self->oldestSentASDU == -1) {
+        self->oldestSentASDU = 0;
+        self->newestSentASDU = 0;
+    }
+    else {
+        currentIndex = (self->newestSentASDU + 1) % self->maxSentASDUs;
+    }
+
+    self->sentASDUs[currentIndex].entryId = entryId;
+    self->sentASDUs[currentIndex].queueEntry = queueEntry;
+    self->sentASDUs[currentIndex].queue = queue;
+
+    /* called with the queue lock held */
+    if (queue)
+        self->sentASDUs[currentIndex].queueGeneration = queue->generation;
+
+    checkCommandResponse(self, buffer);
+
+    self->sentASDUs[currentIndex].seqNo = sendIMessage(self, buffer, msgSize);
+    self->sentASDUs[currentIndex].sentTime = Hal_getTimeInMs();
+
+    OutputShaper_messageSent(&(self->outputShaper), msgSize);
+
+    self->newestSentASDU = currentIndex;
+
+    printSendBuffer(self);
+}
+
+
+static bool
+sendASDUInternal(MasterConnection self, CS101_ASDU asdu)
+{
+    bool asduSent;
+
+    if (self->isActive) {
+
+#if (CONFIG_USE_THREADS == 1)
+        /* other threads don't write to the socket - the I/O thread sends the ASDU from the high priority queue */
+        if (self->ioThreadId != Thread_getCurrentThreadId()) {
+            asduSent = HighPriorityASDUQueue_enqueue(self->highPrioQueue, asdu);
+
+            if (asduSent)
+                Handleset_wakeUp(self->handleSet);
+
+            return asduSent;
+        }
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->sentASDUsLock);
+#endif
+
+        /* send directly when no older response is waiting in the queue */
+        if ((isSentBufferFull(self) == false) && (MasterConnection_isOutputPending(self) == false) &&
+                (HighPriorityASDUQueue_isAsduAvailable(self->highPrioQueue) == false) &&
+                OutputShaper_isSendAllowed(&(self->outputShaper))) {
+
+            FrameBuffer frameBuffer;
+
+            struct sBufferFrame bufferFrame;
+
+            Frame frame = BufferFrame_initialize(&bufferFrame, frameBuffer.msg, IEC60870_5_104_APCI_LENGTH);
+            CS101_ASDU_encode(asdu, frame);
+
+            frameBuffer.msgSize = Frame_getMsgSize(frame);
+
+            sendASDU(self, frameBuffer.msg, frameBuffer.msgSize, 0, NULL, NULL);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->sentASDUsLock);
+#endif
+
+            asduSent = true;
+        }
+        else {
+#if (CONFIG_USE_SEMAPHORES == 1)
+            Semaphore_post(self->sentASDUsLock);
+#endif
+            asduSent = HighPriorityASDUQueue_enqueue(self->highPrioQueue, asdu);
+        }
+
+    }
+    else
+        asduSent = false;
+
+    if (asduSent == false)
+        DEBUG_PRINT("CS104 SLAVE: unable to send response (isActive=%i)\n", self->isActive);
+
+    return asduSent;
+}
+
+
+static void
+responseCOTUnknown(CS101_ASDU asdu, MasterConnection self)
+{
+    DEBUG_PRINT("CS104 SLAVE:   with unknown COT\n");
+    CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_COT);
+    CS101_ASDU_setNegative(asdu, true);
+    sendASDUInternal(self, asdu);
+}
+
+/*
+ * Call the plugins of the list until one of them handles the ASDU
+ *
+ * \return true when the ASDU was handled by a plugin
+ */
+static bool
+callPlugins(LinkedList plugins, IMasterConnection connection, CS101_ASDU asdu)
+{
+    LinkedList pluginElem = LinkedList_getNext(plugins);
+
+    while (pluginElem) {
+
+        CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
+
+        CS101_SlavePlugin_Result result = plugin->handleAsdu(plugin->parameter, connection, asdu);
+
+        if (result == CS101_PLUGIN_RESULT_HANDLED)
+            return true;
+
+        pluginElem = LinkedList_getNext(pluginElem);
+    }
+
+    return false;
+}
+
+/*
+ * Handle received ASDUs
+ *
+ * Call the appropriate callbacks according to ASDU type and CoT
+ *
+ * \return true when ASDU is valid, false otherwise (e.g. corrupted message data)
+ */
+static bool
+handleASDU(MasterConnection self, CS101_ASDU asdu)
+{
+    bool messageHandled = false;
+
+    CS104_Slave slave = self->slave;
+
+    /* call the plugins registered for the type ID first, then the plugins for all type IDs */
+    if (slave->pluginsByTypeId) {
+        LinkedList plugins = slave->pluginsByTypeId[CS101_ASDU_getTypeID(asdu)];
+
+        if (plugins && callPlugins(plugins, &(self->iMasterConnection), asdu))
+            return true;
+    }
+
+    if (slave->allTypesPlugins) {
+        if (callPlugins(slave->allTypesPlugins, &(self->iMasterConnection), asdu))
+            return true;
+    }
+
+    uint8_t cot = CS101_ASDU_getCOT(asdu);
+
+    switch (CS101_ASDU_getTypeID(asdu)) {
+
+    case C_IC_NA_1: /* 100 - interrogation command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd interrogation command C_IC_NA_1\n");
+
+        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_DEACTIVATION)) {
+            if (slave->interrogationHandler != NULL) {
+
+                union uInformationObject _io;
+
+                InterrogationCommand irc = (InterrogationCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+
+                if (irc) {
+                    if (slave->interrogationHandler(slave->interrogationHandlerParameter,
+                            &(self->iMasterConnection), asdu, InterrogationCommand_getQOI(irc)))
+                        messageHandled = true;
+                }
+                else
+                    return false;
+
+            }
+        }
+        else
+            responseCOTUnknown(asdu, self);
+
+        break;
+
+    case C_CI_NA_1: /* 101 - counter interrogation command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd counter interrogation command C_CI_NA_1\n");
+
+        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_DEACTIVATION)) {
+
+            if (slave->counterInterrogationHandler != NULL) {
+
+                union uInformationObject _io;
+
+                CounterInterrogationCommand cic = (CounterInterrogationCommand)  CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+
+                if (cic) {
+                    if (slave->counterInterrogationHandler(slave->counterInterrogationHandlerParameter,
+                            &(self->iMasterConnection), asdu, CounterInterrogationCommand_getQCC(cic)))
+                        messageHandled = true;
+                }
+                else
+                    return false;
+            }
+        }
+        else
+            responseCOTUnknown(asdu, self);
+
+        break;
+
+    case C_RD_NA_1: /* 102 - read command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd read command C_RD_NA_1\n");
+
+        if (cot == CS101_COT_REQUEST) {
+            if (slave->readHandler != NULL) {
+
+                union uInformationObject _io;
+
+                ReadCommand rc = (ReadCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+
+                if (rc) {
+                    if (slave->readHandler(slave->readHandlerParameter,
+                            &(self->iMasterConnection), asdu, InformationObject_getObjectAddress((InformationObject) rc)))
+                        messageHandled = true;
+                }
+                else
+                    return false;
+            }
+        }
+        else
+            responseCOTUnknown(asdu, self);
+
+        break;
+
+    case C_CS_NA_1: /* 103 - Clock synchronization command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd clock sync command C_CS_NA_1\n");
+
+        if (cot == CS101_COT_ACTIVATION) {
+
+            if (slave->clockSyncHandler != NULL) {
+
+                union uInformationObject _io;
+
+                ClockSynchronizationCommand csc = (ClockSynchronizationCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+
+                if (csc) {
+                    CP56Time2a newTime = ClockSynchronizationCommand_getTime(csc);
+
+                    if (slave->clockSyncHandler(slave->clockSyncHandlerParameter,
+                            &(self->iMasterConnection), asdu, newTime)) {
+
+                        CS101_ASDU_removeAllElements(asdu);
 
                         ClockSynchronizationCommand_create(csc, 0, newTime);
 
-                        CS101_ASDU_addInformationObject(asdu, (InformationObject) csc);
+                        CS101_ASDU_addInformationObject(asdu, (InformationObject) csc);
+
+                        CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+
+                        CS104_Slave_enqueueASDU(slave, asdu);
+                    }
+                    else {
+                        CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+                        CS101_ASDU_setNegative(asdu, true);
+
+                        sendASDUInternal(self, asdu);
+                    }
+
+                    messageHandled = true;
+                }
+                else
+                    return false;
+            }
+        }
+        else
+            responseCOTUnknown(asdu, self);
+
+        break;
+
+    case C_TS_NA_1: /* 104 - test command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd test command C_TS_NA_1\n");
+
+        if (cot != CS101_COT_ACTIVATION) {
+            CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_COT);
+            CS101_ASDU_setNegative(asdu, true);
+        }
+        else
+            CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+
+        sendASDUInternal(self, asdu);
+
+        messageHandled = true;
+
+        break;
+
+    case C_RP_NA_1: /* 105 - Reset process command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd reset process command C_RP_NA_1\n");
+
+        if (cot == CS101_COT_ACTIVATION) {
+
+            if (slave->resetProcessHandler != NULL) {
+
+                union uInformationObject _io;
+
+                ResetProcessCommand rpc = (ResetProcessCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+
+                if (rpc) {
+                    if (slave->resetProcessHandler(slave->resetProcessHandlerParameter,
+                            &(self->iMasterConnection), asdu, ResetProcessCommand_getQRP(rpc)))
+                        messageHandled = true;
+                }
+                else
+                    return false;
+            }
+
+        }
+        else
+            responseCOTUnknown(asdu, self);
+
+        break;
+
+    case C_CD_NA_1: /* 106 - Delay acquisition command */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd delay acquisition command C_CD_NA_1\n");
+
+        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_SPONTANEOUS)) {
+
+            if (slave->delayAcquisitionHandler != NULL) {
+
+                union uInformationObject _io;
+
+                DelayAcquisitionCommand dac = (DelayAcquisitionCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+
+                if (dac) {
+                    if (slave->delayAcquisitionHandler(slave->delayAcquisitionHandlerParameter,
+                            &(self->iMasterConnection), asdu, DelayAcquisitionCommand_getDelay(dac)))
+                        messageHandled = true;
+                }
+                else
+                    return false;
+
+            }
+        }
+        else
+            responseCOTUnknown(asdu, self);
+
+        break;
+
+    case C_TS_TA_1: /* 107 - test command with timestamp */
+
+        DEBUG_PRINT("CS104 SLAVE: Rcvd test command with CP56Time2a C_TS_TA_1\n");
+
+        if (cot != CS101_COT_ACTIVATION) {
+            CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_COT);
+            CS101_ASDU_setNegative(asdu, true);
+        }
+        else
+            CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+
+        sendASDUInternal(self, asdu);
+
+        messageHandled = true;
+
+        break;
+
+
+    default: /* no special handler available -> use default handler */
+        break;
+    }
+
+    if ((messageHandled == false) && (slave->asduHandler != NULL))
+        if (slave->asduHandler(slave->asduHandlerParameter, &(self->iMasterConnection), asdu))
+            messageHandled = true;
+
+    if (messageHandled == false) {
+        /* send error response */
+        CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_TYPE_ID);
+        CS101_ASDU_setNegative(asdu, true);
+        sendASDUInternal(self, asdu);
+    }
+
+    return true;
+}
+
+static bool
+checkSequenceNumber(MasterConnection self, int seqNo)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    /* check if received sequence number is valid */
+
+    bool seqNoIsValid = false;
+    bool counterOverflowDetected = false;
+    int oldestValidSeqNo = -1;
+    int confirmedMessages = 0;
+    uint64_t newestConfirmedSentTime = 0;
+    bool windowWasFull = isSentBufferFull(self);
+
+    if (self->oldestSentASDU == -1) { /* if k-Buffer is empty */
+        if (seqNo == self->sendCount)
+            seqNoIsValid = true;
+    }
+    else {
+        /* two cases are required to reflect sequence number overflow */
+        int oldestAsduSeqNo = self->sentASDUs[self->oldestSentASDU].seqNo;
+        int newestAsduSeqNo = self->sentASDUs[self->newestSentASDU].seqNo;
+
+        if (oldestAsduSeqNo <= newestAsduSeqNo) {
+            if ((seqNo >= oldestAsduSeqNo) && (seqNo <= newestAsduSeqNo))
+                seqNoIsValid = true;
+        }
+        else {
+            if ((seqNo >= oldestAsduSeqNo) || (seqNo <= newestAsduSeqNo))
+                seqNoIsValid = true;
+
+            counterOverflowDetected = true;
+        }
+
+        /* check if confirmed message was already removed from list */
+        if (oldestAsduSeqNo == 0)
+            oldestValidSeqNo = 32767;
+        else
+            oldestValidSeqNo = (oldestAsduSeqNo - 1) % 32768;
+
+        if (oldestValidSeqNo == seqNo)
+            seqNoIsValid = true;
+    }
+
+    if (seqNoIsValid) {
+        if (self->oldestSentASDU != -1) {
+
+            do {
+                int oldestAsduSeqNo = self->sentASDUs[self->oldestSentASDU].seqNo;
+
+                if (counterOverflowDetected == false) {
+                    if (seqNo < oldestAsduSeqNo)
+                        break;
+                }
+
+                if (seqNo == oldestValidSeqNo)
+                    break;
+
+                confirmedMessages++;
+
+                newestConfirmedSentTime = self->sentASDUs[self->oldestSentASDU].sentTime;
+
+                /* remove from server (low-priority) queue if required */
+                if (self->sentASDUs[self->oldestSentASDU].queueEntry != NULL) {
+
+                    MessageQueue_markAsduAsConfirmed(self->sentASDUs[self->oldestSentASDU].queue,
+                            self->sentASDUs[self->oldestSentASDU].queueEntry,
+                            self->sentASDUs[self->oldestSentASDU].entryId,
+                            self->sentASDUs[self->oldestSentASDU].queueGeneration);
+
+                    self->sentASDUs[self->oldestSentASDU].queueEntry = NULL;
+
+                    self->sentASDUs[self->oldestSentASDU].seqNo = -1;
+                }
+
+                if (oldestAsduSeqNo == seqNo) {
+                    /* we arrived at the seq# that has been confirmed */
+
+                    if (self->oldestSentASDU == self->newestSentASDU)
+                        self->oldestSentASDU = -1;
+                    else
+                        self->oldestSentASDU = (self->oldestSentASDU + 1) % self->maxSentASDUs;
+
+                    break;
+                }
+
+                self->oldestSentASDU = (self->oldestSentASDU + 1) % self->maxSentASDUs;
+
+                int checkIndex = (self->newestSentASDU + 1) % self->maxSentASDUs;
+
+                if (self->oldestSentASDU == checkIndex) {
+                    self->oldestSentASDU = -1;
+                    break;
+                }
+
+            } while (true);
+        }
+    }
+    else
+        DEBUG_PRINT("CS104 SLAVE: Received sequence number out of range");
+
+    if (confirmedMessages > 0) {
+        TRACE_POINT(LIB60870_TRACE_ACK, self->traceId, seqNo, confirmedMessages);
+
+        uint64_t currentTime = Hal_getTimeInMs();
+
+        int rtt = (currentTime > newestConfirmedSentTime) ? (int) (currentTime - newestConfirmedSentTime) : 0;
+
+        LinkControl_acknowledged(&(self->linkControl), currentTime, rtt, confirmedMessages, windowWasFull);
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    return seqNoIsValid;
+}
+
+static void
+resetT3Timeout(MasterConnection self, uint64_t currentTime)
+{
+    self->nextT3Timeout = currentTime + (uint64_t) (self->slave->conParameters.t3 * 1000);
+}
+
+static bool
+checkT3Timeout(MasterConnection self, uint64_t currentTime)
+{
+    if (self->nextT3Timeout > (currentTime + (uint64_t) (self->slave->conParameters.t3 * 1000))) {
+        /* timeout value not plausible (maybe system time changed) */
+        resetT3Timeout(self, currentTime);
+    }
+
+    if (currentTime > self->nextT3Timeout)
+        return true;
+    else
+        return false;
+}
+
+static void
+sendSMessage(MasterConnection self)
+{
+    uint8_t msg[6];
+
+    msg[0] = 0x68;
+    msg[1] = 0x04;
+    msg[2] = 0x01;
+    msg[3] = 0;
+    msg[4] = (uint8_t) ((self->receiveCount % 128) * 2);
+    msg[5] = (uint8_t) (self->receiveCount / 128);
+
+    TRACE_POINT(LIB60870_TRACE_SEND_S, self->traceId, self->receiveCount, 0);
+
+    if (writeToSocket(self, msg, 6) < 0)
+        self->isRunning = false;
+}
+
+/* pass the receive time to the ASDU and measure the delay until the ASDU handlers are called */
+static void
+MasterConnection_setReceiveTimestamp(MasterConnection self, CS101_ASDU asdu)
+{
+    uint64_t receiveTime = self->recvTimestamp;
+
+    CS101_ASDU_setReceiveTimestamp(asdu, receiveTime);
+
+    uint64_t currentTime = Hal_getTimeInNs();
+
+    int delay = (currentTime > receiveTime) ? (int) ((currentTime - receiveTime) / 1000) : 0;
+
+    self->lastReceiveDelay = delay;
+
+    if (delay > self->maxReceiveDelay)
+        self->maxReceiveDelay = delay;
+
+    TRACE_POINT(LIB60870_TRACE_RECV_DELAY, self->traceId, delay, CS101_ASDU_getTypeID(asdu));
+}
+
+static bool
+handleMessage(MasterConnection self, uint8_t* buffer, int msgSize)
+{
+    uint64_t currentTime = Hal_getTimeInMs();
+
+    if (msgSize >= 3) {
+
+        if (buffer[0] != 0x68) {
+            DEBUG_PRINT("CS104 SLAVE: Invalid START character!");
+            return false;
+        }
+
+        uint8_t lengthOfApdu = buffer[1];
+
+        if (lengthOfApdu != msgSize - 2) {
+            DEBUG_PRINT("CS104 SLAVE: Invalid length of APDU");
+            return false;
+        }
+
+        if ((buffer[2] & 1) == 0) {
+
+            if (msgSize < 7) {
+                DEBUG_PRINT("CS104 SLAVE: Received I msg too small!");
+                return false;
+            }
+
+            if (self->timeoutT2Triggered == false) {
+                self->timeoutT2Triggered = true;
+                self->lastConfirmationTime = currentTime; /* start timeout T2 */
+            }
+
+            int frameSendSequenceNumber = ((buffer [3] * 0x100) + (buffer [2] & 0xfe)) / 2;
+            int frameRecvSequenceNumber = ((buffer [5] * 0x100) + (buffer [4] & 0xfe)) / 2;
+
+            DEBUG_PRINT("CS104 SLAVE: Received I frame: N(S) = %i N(R) = %i\n", frameSendSequenceNumber, frameRecvSequenceNumber);
+            TRACE_POINT(LIB60870_TRACE_RECV_I, self->traceId, frameSendSequenceNumber, frameRecvSequenceNumber);
+
+            if (frameSendSequenceNumber != self->receiveCount) {
+                DEBUG_PRINT("CS104 SLAVE: Sequence error - close connection");
+                return false;
+            }
+
+            if (checkSequenceNumber (self, frameRecvSequenceNumber) == false) {
+                DEBUG_PRINT("CS104 SLAVE: Sequence number check failed - close connection");
+                return false;
+            }
+
+            self->receiveCount = (self->receiveCount + 1) % 32768;
+            self->unconfirmedReceivedIMessages++;
+
+            if (self->isActive) {
+
+                CS101_ASDU asdu = CS101_ASDU_createFromBuffer(&(self->slave->alParameters), buffer + 6, msgSize - 6);
+
+                if (asdu) {
+                    if (self->slave->receiveTimestamps)
+                        MasterConnection_setReceiveTimestamp(self, asdu);
+
+                    uint8_t typeId = (uint8_t) CS101_ASDU_getTypeID(asdu);
+
+                    if (isControlCommand(typeId)) {
+#if (CONFIG_USE_SEMAPHORES == 1)
+                        Semaphore_wait(self->sentASDUsLock);
+#endif
+
+                        self->commandReceiveTime = (self->recvTimestamp != 0) ? self->recvTimestamp : Hal_getTimeInNs();
+                        self->commandTypeId = typeId;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+                        Semaphore_post(self->sentASDUsLock);
+#endif
+                    }
+
+                    TRACE_POINT(LIB60870_TRACE_HANDLER_ENTER, self->traceId, CS101_ASDU_getTypeID(asdu), CS101_ASDU_getCOT(asdu));
+
+                    bool validAsdu = handleASDU(self, asdu);
+
+                    TRACE_POINT(LIB60870_TRACE_HANDLER_EXIT, self->traceId, CS101_ASDU_getTypeID(asdu), validAsdu);
+
+                    CS101_ASDU_destroy(asdu);
+
+                    if (validAsdu == false) {
+                        DEBUG_PRINT("CS104 SLAVE: ASDU corrupted");
+                        return false;
+                    }
+                }
+                else {
+                    DEBUG_PRINT("CS104 SLAVE: Invalid ASDU");
+                    return false;
+                }
+            }
+            else
+                DEBUG_PRINT("CS104 SLAVE: Connection not activated. Skip I message");
+
+        }
+
+        /* Check for TESTFR_ACT message */
+        else if ((buffer[2] & 0x43) == 0x43) {
+            DEBUG_PRINT("CS104 SLAVE: Send TESTFR_CON\n");
+
+            if (writeToSocket(self, TESTFR_CON_MSG, TESTFR_CON_MSG_SIZE) < 0)
+                return false;
+        }
+
+        /* Check for STARTDT_ACT message */
+        else if ((buffer [2] & 0x07) == 0x07) {
+            CS104_Slave_activate(self->slave, self);
+
+            HighPriorityASDUQueue_resetConnectionQueue(self->highPrioQueue);
+
+            DEBUG_PRINT("CS104 SLAVE: Send STARTDT_CON\n");
+
+            if (writeToSocket(self, STARTDT_CON_MSG, STARTDT_CON_MSG_SIZE) < 0)
+                return false;
+        }
+
+        /* Check for STOPDT_ACT message */
+        else if ((buffer [2] & 0x13) == 0x13) {
+            MasterConnection_deactivate(self);
+
+            /* Send S-Message to confirm all outstanding messages */
+            self->lastConfirmationTime = Hal_getTimeInMs();
+
+            self->unconfirmedReceivedIMessages = 0;
+
+            self->timeoutT2Triggered = false;
+
+            sendSMessage(self);
+
+            DEBUG_PRINT("CS104 SLAVE: Send STOPDT_CON\n");
+
+            if (writeToSocket(self, STOPDT_CON_MSG, STOPDT_CON_MSG_SIZE) < 0)
+                return false;
+        }
+
+        /* Check for TESTFR_CON message */
+        else if ((buffer[2] & 0x83) == 0x83) {
+            DEBUG_PRINT("CS104 SLAVE: Recv TESTFR_CON\n");
+
+            self->outstandingTestFRConMessages = 0;
+        }
+
+        else if (buffer [2] == 0x01) { /* S-message */
+            int seqNo = (buffer[4] + buffer[5] * 0x100) / 2;
+
+            DEBUG_PRINT("CS104 SLAVE: Rcvd S(%i) (own sendcounter = %i)\n", seqNo, self->sendCount);
+
+            if (checkSequenceNumber(self, seqNo) == false)
+                return false;
+        }
+
+        else {
+            DEBUG_PRINT("CS104 SLAVE: unknown message - IGNORE\n");
+            return true;
+        }
+
+        resetT3Timeout(self, currentTime);
+
+        return true;
+    }
+    else {
+        DEBUG_PRINT("CS104 SLAVE: Invalid message (too small)");
+        return false;
+    }
+}
+
+static void
+MasterConnection_deinit(MasterConnection self)
+{
+    if (self) {
+        TRACE_POINT(LIB60870_TRACE_DISCONNECT, self->traceId, 0, 0);
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+        if (self->tlsSocket != NULL)
+            TLSSocket_close(self->tlsSocket);
+#endif
+
+        Socket_destroy(self->socket);
+    }
+}
+
+static void
+MasterConnection_destroy(MasterConnection self)
+{
+    if (self) {
+
+        GLOBAL_FREEMEM(self->sentASDUs);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_destroy(self->sentASDUsLock);
+#endif
+
+        if (self->handleSet)
+            Handleset_destroy(self->handleSet);
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+        if (self->slave->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
+            MessageQueue_destroy(self->lowPrioQueue);
+            HighPriorityASDUQueue_destroy(self->highPrioQueue);
+        }
+#endif
+
+        GLOBAL_FREEMEM(self);
+    }
+}
+
+/**
+ * Send the next waiting ASDU of the given low-priority queue.
+ *
+ * \return true when an ASDU has been sent, false when no ASDU is waiting for transmission
+ */
+static bool
+sendNextASDUFromQueue(MasterConnection self, MessageQueue queue)
+{
+    uint64_t entryId;
+    uint8_t* queueEntry;
+    int msgSize;
+
+    MessageQueue_lock(queue);
+
+    uint8_t* asduBuffer = MessageQueue_getNextWaitingASDU(queue, &entryId, &queueEntry, &msgSize);
+
+    if (asduBuffer) {
+        TRACE_POINT(LIB60870_TRACE_DEQUEUE, self->traceId, entryId, asduBuffer[0]);
+
+        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, asduBuffer, msgSize);
+
+        msgSize += IEC60870_5_104_APCI_LENGTH;
+
+        sendASDU(self, self->sendBuffer, msgSize, entryId, queueEntry, queue);
+    }
+
+    MessageQueue_unlock(queue);
+
+    return (asduBuffer != NULL);
+}
+
+static void
+sendNextLowPriorityASDU(MasterConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    if (isSentBufferFullForEvents(self))
+        goto exit_function;
+
+    if (OutputShaper_isSendAllowed(&(self->outputShaper)) == false)
+        goto exit_function;
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    {
+        /*
+         * Weighted round robin: in each round an event class can send up to "weight" ASDUs. Higher
+         * event classes are served first. A new round starts when no class with remaining credit has
+         * waiting ASDUs.
+         */
+        int round;
+
+        for (round = 0; round < 2; round++) {
+            int eventClass;
+
+            for (eventClass = CONFIG_CS104_SLAVE_EVENT_CLASSES - 1; eventClass >= 0; eventClass--) {
+
+                MessageQueue queue = self->lowPrioQueue->eventClassQueues[eventClass];
+
+                if ((queue == NULL) || (self->eventClassCredits[eventClass] < 1))
+                    continue;
+
+                if (sendNextASDUFromQueue(self, queue)) {
+                    self->eventClassCredits[eventClass]--;
+                    goto exit_function;
+                }
+            }
+
+            for (eventClass = 0; eventClass < CONFIG_CS104_SLAVE_EVENT_CLASSES; eventClass++) {
+                MessageQueue queue = self->lowPrioQueue->eventClassQueues[eventClass];
+
+                if (queue)
+                    self->eventClassCredits[eventClass] = queue->weight;
+            }
+        }
+
+        OutputShaper_noMessageWaiting(&(self->outputShaper));
+    }
+#else
+    if (sendNextASDUFromQueue(self, self->lowPrioQueue) == false)
+        OutputShaper_noMessageWaiting(&(self->outputShaper));
+#endif
+
+exit_function:
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    return;
+}
+
+static bool
+sendNextHighPriorityASDU(MasterConnection self)
+{
+    bool retVal = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    if (isSentBufferFull(self))
+        goto exit_function;
+
+    if (OutputShaper_isSendAllowed(&(self->outputShaper)) == false)
+        goto exit_function;
+
+    HighPriorityASDUQueue_lock(self->highPrioQueue);
+
+    int msgSize;
+    uint8_t* buffer = HighPriorityASDUQueue_getNextASDU(self->highPrioQueue, &msgSize);
+
+    if (buffer) {
+        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, buffer, msgSize);
+
+        msgSize += IEC60870_5_104_APCI_LENGTH;
+
+        sendASDU(self, self->sendBuffer, msgSize, 0, NULL, NULL);
+
+        retVal = true;
+    }
+    else
+        OutputShaper_noMessageWaiting(&(self->outputShaper));
+
+    HighPriorityASDUQueue_unlock(self->highPrioQueue);
+
+exit_function:
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    return retVal;
+}
+
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+
+/* first multiple of the cycle time after the given time (ms) */
+static uint64_t
+getNextCycleTime(uint64_t time, int cycleTimeInMs)
+{
+    uint64_t cycleTime = (uint64_t) cycleTimeInMs;
+
+    return ((time / cycleTime) + 1) * cycleTime;
+}
+
+/*
+ * background scan data leaves a quarter of the send window free for other ASDUs. More than half of the window
+ * can be used so that the client acknowledges (w) before t2 expires (locking of k-buffer by caller)
+ */
+static bool
+isBackgroundScanWindowAvailable(MasterConnection self)
+{
+    return (getNumberOfUnconfirmedASDUs(self) < (self->linkControl.k - (self->linkControl.k / 4))) &&
+            (isSentBufferFullForEvents(self) == false);
+}
+
+/**
+ * Create and send the next ASDU of the running background scan cycles (round robin between the groups).
+ *
+ * \return true when an ASDU has been sent, false when no background scan data is waiting or sending is not allowed
+ */
+static bool
+sendNextBackgroundScanASDU(MasterConnection self)
+{
+    CS104_Slave slave = self->slave;
+
+    if (slave->numberOfCyclicGroups == 0)
+        return false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    bool sendAllowed = isBackgroundScanWindowAvailable(self) && (MasterConnection_isOutputPending(self) == false) &&
+            OutputShaper_isSendAllowed(&(self->outputShaper));
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    if (sendAllowed == false)
+        return false;
+
+    uint64_t currentTime = Hal_getTimeInMs();
+
+    int i;
+
+    for (i = 0; i < slave->numberOfCyclicGroups; i++) {
+
+        int groupId = (self->nextBackgroundScanGroup + i) % slave->numberOfCyclicGroups;
+
+        if (slave->cyclicGroups[groupId].cot != CS101_COT_BACKGROUND_SCAN)
+            continue;
+
+        if (self->backgroundScans[groupId].nextAsduIndex == -1) {
+
+            if (currentTime < self->backgroundScans[groupId].nextCycleTime)
+                continue;
+
+            /* start a new cycle */
+            self->backgroundScans[groupId].nextAsduIndex = 0;
+            self->backgroundScans[groupId].nextCycleTime = getNextCycleTime(currentTime, slave->cyclicGroups[groupId].cycleTimeInMs);
+        }
+
+        sCS101_StaticASDU _asdu;
+
+        while (self->backgroundScans[groupId].nextAsduIndex != -1) {
+
+            CS101_ASDU asdu = CS101_ASDU_initializeStatic(&_asdu, &(slave->alParameters), false, CS101_COT_BACKGROUND_SCAN,
+                    slave->alParameters.originatorAddress, 0, false, false);
+
+            if (slave->cyclicGroups[groupId].handler(slave->cyclicGroups[groupId].parameter, groupId,
+                    self->backgroundScans[groupId].nextAsduIndex, asdu) == false)
+            {
+                /* cycle complete */
+                self->backgroundScans[groupId].nextAsduIndex = -1;
+            }
+            else {
+                self->backgroundScans[groupId].nextAsduIndex++;
+
+                if (CS101_ASDU_getNumberOfElements(asdu) > 0) {
+                    sendASDUInternal(self, asdu);
+
+                    self->nextBackgroundScanGroup = (groupId + 1) % slave->numberOfCyclicGroups;
+
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+#endif /* (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0) */
+
+/**
+ * Send all high-priority ASDUs and the last waiting ASDU from the low-priority queue.
+ * Returns true if ASDUs are still waiting. This can happen when there are more ASDUs
+ * in the event (low-priority) buffer, or the connection is unavailable to send the high-priority
+ * ASDUs (congestion or connection lost).
+ */
+static bool
+sendQueuedASDUs(MasterConnection self)
+{
+    bool isAsduWaiting;
+
+    /* send all available high priority ASDUs first */
+    while (HighPriorityASDUQueue_isAsduAvailable(self->highPrioQueue)) {
+
+        if (sendNextHighPriorityASDU(self) == false) {
+            isAsduWaiting = true;
+            goto exit_function;
+        }
+
+        if (self->isRunning == false)
+            return true;
+
+        if (MasterConnection_isOutputPending(self))
+            return true;
+    }
+
+    /* send messages from low-priority queue */
+    sendNextLowPriorityASDU(self);
+
+    isAsduWaiting = MessageQueue_isAsduAvailable(self->lowPrioQueue);
+
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    /* background scan data is only sent when no other ASDUs are waiting */
+    if ((isAsduWaiting == false) && (HighPriorityASDUQueue_isAsduAvailable(self->highPrioQueue) == false))
+        isAsduWaiting = sendNextBackgroundScanASDU(self);
+#endif
+
+exit_function:
+
+    if (isAsduWaiting) {
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->sentASDUsLock);
+#endif
+
+        OutputShaper_messagesWaiting(&(self->outputShaper));
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->sentASDUsLock);
+#endif
+    }
+
+    return isAsduWaiting;
+}
+
+/**
+ * Send the waiting ASDUs. The frames are collected and written to the socket together.
+ *
+ * \return true when ASDUs are still waiting for transmission
+ */
+static bool
+sendWaitingASDUs(MasterConnection self)
+{
+    /* don't take new ASDUs from the queues until the output buffer is drained */
+    if (MasterConnection_flushOutputBuffer(self) == false) {
+        self->isRunning = false;
+        return true;
+    }
+
+    if (MasterConnection_isOutputPending(self))
+        return true;
+
+    self->isBatchingOutput = true;
+
+    bool isAsduWaiting = sendQueuedASDUs(self);
+
+    self->isBatchingOutput = false;
+
+    if (MasterConnection_flushOutputBuffer(self) == false) {
+        self->isRunning = false;
+        return true;
+    }
+
+    return isAsduWaiting || MasterConnection_isOutputPending(self);
+}
+
+static bool
+handleTimeouts(MasterConnection self)
+{
+    uint64_t currentTime = Hal_getTimeInMs();
+
+    bool timeoutsOk = true;
+
+    /* check T3 timeout */
+    if (checkT3Timeout(self, currentTime)) {
+
+        if (self->outstandingTestFRConMessages > 2) {
+            DEBUG_PRINT("CS104 SLAVE: Timeout for TESTFR CON message\n");
+            TRACE_POINT(LIB60870_TRACE_TIMEOUT, self->traceId, 3, self->sendCount);
+
+            /* close connection */
+            timeoutsOk = false;
+        }
+        else {
+            if (writeToSocket(self, TESTFR_ACT_MSG, TESTFR_ACT_MSG_SIZE) < 0) {
+
+                DEBUG_PRINT("CS104 SLAVE: Failed to write TESTFR ACT message\n");
+
+                self->isRunning = false;
+            }
+
+            self->outstandingTestFRConMessages++;
+            resetT3Timeout(self, currentTime);
+        }
+    }
+
+    /* check timeout for others station I messages */
+    if (self->unconfirmedReceivedIMessages > 0) {
+
+        /* Check validity of last confirmation time */
+        if (self->lastConfirmationTime != UINT64_MAX && self->lastConfirmationTime > currentTime) {
+            /* last confirmation time is in the future (maybe caused by system time change) */
+            self->lastConfirmationTime = currentTime;
+        }
+
+        if (currentTime > self->lastConfirmationTime) {
+            if ((currentTime - self->lastConfirmationTime) >= (uint64_t) (self->slave->conParameters.t2 * 1000)) {
+                TRACE_POINT(LIB60870_TRACE_TIMEOUT, self->traceId, 2, self->receiveCount);
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+                Semaphore_wait(self->sentASDUsLock);
+#endif
+                LinkControl_receiveTimeout(&(self->linkControl), self->unconfirmedReceivedIMessages);
+#if (CONFIG_USE_SEMAPHORES == 1)
+                Semaphore_post(self->sentASDUsLock);
+#endif
+
+                self->lastConfirmationTime = currentTime;
+                self->unconfirmedReceivedIMessages = 0;
+                self->timeoutT2Triggered = false;
+                sendSMessage(self);
+            }
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    /* check if counterpart confirmed I message */
+    if (self->oldestSentASDU != -1) {
+
+        if (currentTime > self->sentASDUs[self->oldestSentASDU].sentTime) {
+
+            /* check validity of sent time */
+
+            if (self->sentASDUs[self->oldestSentASDU].sentTime > currentTime) {
+                /* sent time is in the future (maybe caused by system time change) */
+                self->sentASDUs[self->oldestSentASDU].sentTime = currentTime;
+            }
+
+            if ((currentTime - self->sentASDUs[self->oldestSentASDU].sentTime) >=
+                    (uint64_t) LinkControl_getT1Timeout(&(self->linkControl), self->slave->conParameters.t1)) {
+                timeoutsOk = false;
+
+                printSendBuffer(self);
+
+                DEBUG_PRINT("CS104 SLAVE: I message timeout for %i seqNo: %i\n", self->oldestSentASDU,
+                        self->sentASDUs[self->oldestSentASDU].seqNo);
+                TRACE_POINT(LIB60870_TRACE_TIMEOUT, self->traceId, 1, self->sentASDUs[self->oldestSentASDU].seqNo);
+            }
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    return timeoutsOk;
+}
+
+static void
+CS104_Slave_removeConnection(CS104_Slave self, MasterConnection connection)
+{
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_wait(self->openConnectionsLock);
+#endif
+
+    putFreeConnection(self, connection);
+
+    MessageQueue_setWaitingForTransmissionWhenNotConfirmed(connection->lowPrioQueue);
+
+    MasterConnection_deinit(connection);
+
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_post(self->openConnectionsLock);
+#endif
+}
+
+static void
+CS104_Slave_closeAllConnections(CS104_Slave self) 
+{
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_wait(self->openConnectionsLock);
+#endif
+
+    int i;
+
+    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+        if (self->masterConnections[i]) {
+            if (self->masterConnections[i]->isUsed) {
+                putFreeConnection(self, self->masterConnections[i]);
+                MasterConnection_deinit(self->masterConnections[i]);
+            }
+        }
+    }
+
+#if (CONFIG_USE_SEMAPHORES)
+    Semaphore_post(self->openConnectionsLock);
+#endif
+}
+
+static void
+MasterConnection_receiveWindowReached(MasterConnection self)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
+
+    LinkControl_receiveWindowReached(&(self->linkControl));
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+}
+
+static void*
+connectionHandlingThread(void* parameter)
+{
+    MasterConnection self = (MasterConnection) parameter;
+
+    self->isRunning = true;
+
+    resetT3Timeout(self, Hal_getTimeInMs());
+
+#if (CONFIG_USE_THREADS == 1)
+    self->ioThreadId = Thread_getCurrentThreadId();
+#endif
+
+    /* responses sent by other threads wake up the connection thread */
+    Handleset_enableWakeUp(self->handleSet);
+
+    bool isAsduWaiting = false;
+
+    if (self->slave->connectionEventHandler) {
+        self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
+    }
+
+    while (self->isRunning) {
+
+        Handleset_reset(self->handleSet);
+        Handleset_addSocket(self->handleSet, self->socket);
+
+        /* wake up when the remaining output data can be written */
+        if (MasterConnection_isOutputPending(self))
+            Handleset_addSocketForWrite(self->handleSet, self->socket);
+
+        int socketTimeout;
+
+        /*
+         * When an ASDU is waiting only have a short look to see if a client request
+         * was received. Otherwise wait to save CPU time.
+         */
+        if (isAsduWaiting) {
+            /* when the output rate limit is reached wait until the next message can be sent */
+            socketTimeout = OutputShaper_getWaitTime(&(self->outputShaper));
+
+            if (socketTimeout < 1)
+                socketTimeout = 1;
+            else if (socketTimeout > 100)
+                socketTimeout = 100;
+        }
+        else
+            socketTimeout = 100;
+
+        if (Handleset_waitReady(self->handleSet, socketTimeout)) {
+
+            int bytesRec = receiveMessage(self);
+
+            if (bytesRec == -1) {
+                DEBUG_PRINT("CS104 SLAVE: Error reading from socket\n");
+                break;
+            }
+
+            if (bytesRec > 0) {
+                DEBUG_PRINT("CS104 SLAVE: Connection: rcvd msg(%i bytes)\n", bytesRec);
+
+                if (self->slave->rawMessageHandler)
+                    self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter,
+                            &(self->iMasterConnection), self->recvBuffer, bytesRec, false);
+
+                if (handleMessage(self, self->recvBuffer, bytesRec) == false)
+                    self->isRunning = false;
+
+                if (self->unconfirmedReceivedIMessages >= self->linkControl.w) {
+
+                    MasterConnection_receiveWindowReached(self);
+
+                    self->lastConfirmationTime = Hal_getTimeInMs();
+
+                    self->unconfirmedReceivedIMessages = 0;
+
+                    self->timeoutT2Triggered = false;
+
+                    sendSMessage(self);
+                }
+            }
+        }
+
+        if (MasterConnection_flushOutputBuffer(self) == false)
+            self->isRunning = false;
+
+        if (handleTimeouts(self) == false)
+            self->isRunning = false;
+
+        if (self->isRunning)
+            if (self->isActive)
+                isAsduWaiting = sendWaitingASDUs(self);
+    }
+
+    if (self->slave->connectionEventHandler) {
+       self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+    }
+
+    self->isRunning = false;
+
+    CS104_Slave_removeConnection(self->slave, self);
+
+    return NULL;
+}
+
+/********************************************
+ * IMasterConnection
+ *******************************************/
+
+static bool
+_IMasterConnection_isReady(IMasterConnection self)
+{
+    MasterConnection con = (MasterConnection) self->object;
+
+    if (con->isActive) {
+        if (isSentBufferFull(con) == false)
+            return true;
+
+        if (HighPriorityASDUQueue_isFull(con->highPrioQueue))
+            return false;
+
+        return true;
+    }
+    else
+        return false;
+}
+
+static bool
+_IMasterConnection_sendASDU(IMasterConnection self, CS101_ASDU asdu)
+{
+    MasterConnection con = (MasterConnection) self->object;
+
+    return sendASDUInternal(con, asdu);
+}
+
+static bool
+_IMasterConnection_sendACT_CON(IMasterConnection self, CS101_ASDU asdu, bool negative)
+{
+    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+    CS101_ASDU_setNegative(asdu, negative);
+
+    return _IMasterConnection_sendASDU(self, asdu);
+}
 
-                        CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+static bool
+_IMasterConnection_sendACT_TERM(IMasterConnection self, CS101_ASDU asdu)
+{
+    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_TERMINATION);
+    CS101_ASDU_setNegative(asdu, false);
 
-                        CS104_Slave_enqueueASDU(slave, asdu);
-                    }
-                    else {
-                        CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
-                        CS101_ASDU_setNegative(asdu, true);
+    return _IMasterConnection_sendASDU(self, asdu);
+}
 
-                        sendASDUInternal(self, asdu);
-                    }
+static void
+_IMasterConnection_close(IMasterConnection self)
+{
+    MasterConnection con = (MasterConnection) self->object;
 
-                    messageHandled = true;
+    MasterConnection_close(con);
+}
+
+static int
+_IMasterConnection_getPeerAddress(IMasterConnection self, char* addrBuf, int addrBufSize)
+{
+    MasterConnection con = (MasterConnection) self->object;
+
+    char buf[50];
+
+    char* addrStr = Socket_getPeerAddressStatic(con->socket, buf);
+
+    if (addrStr == NULL)
+        return 0;
+
+    int len = strlen(buf);
+
+    if (len < addrBufSize) {
+        strcpy(addrBuf, buf);
+        return len;
+    }
+    else
+        return 0;
+}
+
+static CS101_AppLayerParameters
+_IMasterConnection_getApplicationLayerParameters(IMasterConnection self)
+{
+    MasterConnection con = (MasterConnection) self->object;
+
+    return &(con->slave->alParameters);
+}
+
+/********************************************
+ * END IMasterConnection
+ *******************************************/
+
+static MasterConnection
+MasterConnection_create(CS104_Slave slave)
+{
+    MasterConnection self = (MasterConnection) GLOBAL_CALLOC(1, sizeof(struct sMasterConnection));
+
+    if (self != NULL) {
+        self->isUsed = false;
+        self->slave = slave;
+        self->maxSentASDUs = slave->conParameters.k;
+        self->sentASDUs = (SentASDUSlave*) GLOBAL_CALLOC(self->maxSentASDUs, sizeof(SentASDUSlave));
+
+        self->iMasterConnection.object = self;
+        self->iMasterConnection.getApplicationLayerParameters = _IMasterConnection_getApplicationLayerParameters;
+        self->iMasterConnection.isReady = _IMasterConnection_isReady;
+        self->iMasterConnection.sendASDU = _IMasterConnection_sendASDU;
+        self->iMasterConnection.sendACT_CON = _IMasterConnection_sendACT_CON;
+        self->iMasterConnection.sendACT_TERM = _IMasterConnection_sendACT_TERM;
+        self->iMasterConnection.close = _IMasterConnection_close;
+        self->iMasterConnection.getPeerAddress = _IMasterConnection_getPeerAddress;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        self->sentASDUsLock = Semaphore_create(1);
+#endif
+        self->handleSet = Handleset_new();
+
+        /* initialize pointers with NULL to avoid segmentation fault on destroy call */
+        self->socket = NULL;
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+        self->tlsSocket = NULL;
+#endif
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+        self->redundancyGroup = NULL;
+#endif
+        self->lowPrioQueue = NULL;
+        self->highPrioQueue = NULL;
+
+        if ((self->handleSet == NULL) || (self->sentASDUs == NULL)) {
+            DEBUG_PRINT("CS104 SLAVE: failed to create connection object (out of memory)\n");
+            MasterConnection_destroy(self);
+            self = NULL;
+        }
+    }
+
+    return self;
+}
+
+static bool
+MasterConnection_init(MasterConnection self, Socket skt, MessageQueue lowPrioQueue, HighPriorityASDUQueue highPrioQueue)
+{
+    if (self) {
+        self->traceId = lib60870_trace_newConnectionId();
+
+        TRACE_POINT(LIB60870_TRACE_CONNECT, self->traceId, 0, 0);
+
+        self->socket = skt;
+        self->isActive = false;
+        self->isRunning = false;
+        self->receiveCount = 0;
+        self->sendCount = 0;
+        self->recvBufPos = 0;
+        self->recvTimestamp = 0;
+
+        self->lastReceiveDelay = -1;
+        self->maxReceiveDelay = -1;
+
+        self->commandReceiveTime = 0;
+        self->commandTypeId = 0;
+        self->commandResponses = 0;
+        self->lastCommandResponseTime = -1;
+        self->maxCommandResponseTime = -1;
+
+        if (self->slave->receiveTimestamps) {
+            if (Socket_setReceiveTimestamps(skt, true) == false)
+                DEBUG_PRINT("CS104 SLAVE: Receive time stamps not supported -> use time of reception by the stack\n");
+        }
+
+        self->outputBufferStart = 0;
+        self->outputBufferLength = 0;
+        self->isBatchingOutput = false;
+
+#if (CONFIG_USE_THREADS == 1)
+        self->ioThreadId = 0;
+#endif
+
+        self->unconfirmedReceivedIMessages = 0;
+        self->lastConfirmationTime = UINT64_MAX;
+
+        self->timeoutT2Triggered = false;
+
+        self->oldestSentASDU = -1;
+        self->newestSentASDU = -1;
+
+        resetT3Timeout(self, Hal_getTimeInMs());
+
+        /* k-buffer has to be large enough for the maximum window */
+        int maxK = self->slave->adaptiveMaxK;
+
+        {
+            int requiredSize = self->slave->conParameters.k;
+
+            if (maxK > requiredSize)
+                requiredSize = maxK;
+
+            if ((requiredSize != self->maxSentASDUs) || (self->sentASDUs == NULL)) {
+                SentASDUSlave* sentASDUs = (SentASDUSlave*) GLOBAL_CALLOC(requiredSize, sizeof(SentASDUSlave));
+
+                if (sentASDUs) {
+                    GLOBAL_FREEMEM(self->sentASDUs);
+
+                    self->maxSentASDUs = requiredSize;
+                    self->sentASDUs = sentASDUs;
                 }
                 else
-                    return false;
+                    DEBUG_PRINT("CS104 SLAVE: Failed to allocate k-buffer of size %i -> keep old buffer\n", requiredSize);
+            }
+
+            if ((self->sentASDUs == NULL) || (self->maxSentASDUs < self->slave->conParameters.k)) {
+                DEBUG_PRINT("CS104 SLAVE: k-buffer too small. Close connection\n");
+
+                return false;
+            }
+
+            /* the adaptive send window cannot grow beyond the available k-buffer */
+            if (maxK > self->maxSentASDUs)
+                maxK = self->maxSentASDUs;
+        }
+
+#if (CONFIG_CS104_SUPPORT_TLS == 1)
+        if (self->slave->tlsConfig != NULL) {
+            self->tlsSocket = TLSSocket_create(skt, self->slave->tlsConfig, false);
+
+            if (self->tlsSocket == NULL) {
+                DEBUG_PRINT("CS104 SLAVE: Failed to create TLS context. Close connection\n");
+
+                return false;
             }
         }
         else
-            responseCOTUnknown(asdu, self);
+            self->tlsSocket = NULL;
+#endif
 
-        break;
+        /* for the mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP we use the connection specific queues */
+        if (lowPrioQueue)
+            self->lowPrioQueue = lowPrioQueue;
+        else {
+            MessageQueue_releaseAllQueuedASDUs(self->lowPrioQueue);
+        }
 
-    case C_TS_NA_1: /* 104 - test command */
+        if (highPrioQueue)
+            self->highPrioQueue = highPrioQueue;
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd test command C_TS_NA_1\n");
+        HighPriorityASDUQueue_resetConnectionQueue(self->highPrioQueue);
 
-        if (cot != CS101_COT_ACTIVATION) {
-            CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_COT);
-            CS101_ASDU_setNegative(asdu, true);
+        self->outstandingTestFRConMessages = 0;
+
+        LinkControl_initialize(&(self->linkControl), &(self->slave->conParameters), maxK,
+                self->slave->adaptiveMaxW, self->slave->adaptiveT1);
+
+        memset(&(self->outputShaper.statistics), 0, sizeof(CS104_OutputShapingStatistics));
+        OutputShaper_configure(&(self->outputShaper), self->slave->outputMaxBytesPerSecond,
+                self->slave->outputMaxFramesPerSecond, self->slave->outputBurstSize);
+
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+        {
+            int i;
+
+            /* the first background scan cycles start when the connection is idle */
+            for (i = 0; i < CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS; i++) {
+                self->backgroundScans[i].nextCycleTime = 0;
+                self->backgroundScans[i].nextAsduIndex = -1;
+            }
+
+            self->nextBackgroundScanGroup = 0;
         }
-        else
-            CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+#endif
+
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+static bool
+MasterConnection_initEx(MasterConnection self, Socket skt, CS104_RedundancyGroup redGroup)
+{
+    bool retVal = false;
+
+    if (self) {
+        retVal = MasterConnection_init(self, skt, redGroup->asduQueue, redGroup->connectionAsduQueue);
+
+        if (retVal)
+            self->redundancyGroup = redGroup;
+    }
+
+    return retVal;
+}
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+
+
+static void
+MasterConnection_start(MasterConnection self)
+{
+    CS104_Slave slave = self->slave;
+
+    Thread newThread =
+           Thread_createEx((ThreadExecutionFunction) connectionHandlingThread,
+                   (void*) self, true, slave->useThreadAttributes ? &(slave->threadAttributes) : NULL);
+
+    Thread_start(newThread);
+}
+
+void
+MasterConnection_close(MasterConnection self)
+{
+    self->isRunning = false;
+
+    /* don't wait for the timeout of the connection thread */
+    Handleset_wakeUp(self->handleSet);
+}
+
+void
+MasterConnection_deactivate(MasterConnection self)
+{
+    if (self->isActive == true) {
+        if (self->slave->connectionEventHandler) {
+             self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
+        }
+    }
+
+    self->isActive = false;
+}
+
+void
+MasterConnection_activate(MasterConnection self)
+{
+    if (self->isActive == false) {
+        if (self->slave->connectionEventHandler) {
+             self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection), CS104_CON_EVENT_ACTIVATED);
+        }
+    }
+
+    self->isActive = true;
+}
+
+static int
+MasterConnection_handleTcpConnection(MasterConnection self)
+{
+#if (CONFIG_USE_THREADS == 1)
+    self->ioThreadId = Thread_getCurrentThreadId();
+#endif
 
-        sendASDUInternal(self, asdu);
+    int bytesRec = receiveMessage(self);
 
-        messageHandled = true;
+    if (bytesRec < 0) {
+        DEBUG_PRINT("CS104 SLAVE: Error reading from socket\n");
+        self->isRunning = false;
+    }
 
-        break;
+    if ((bytesRec > 0) && (self->isRunning)) {
 
-    case C_RP_NA_1: /* 105 - Reset process command */
+        if (self->slave->rawMessageHandler)
+            self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter,
+                    &(self->iMasterConnection), self->recvBuffer, bytesRec, false);
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd reset process command C_RP_NA_1\n");
+        if (handleMessage(self, self->recvBuffer, bytesRec) == false)
+            self->isRunning = false;
 
-        if (cot == CS101_COT_ACTIVATION) {
+        if (self->unconfirmedReceivedIMessages >= self->linkControl.w) {
 
-            if (slave->resetProcessHandler != NULL) {
+            MasterConnection_receiveWindowReached(self);
 
-                union uInformationObject _io;
+            self->lastConfirmationTime = Hal_getTimeInMs();
 
-                ResetProcessCommand rpc = (ResetProcessCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+            self->unconfirmedReceivedIMessages = 0;
 
-                if (rpc) {
-                    if (slave->resetProcessHandler(slave->resetProcessHandlerParameter,
-                            &(self->iMasterConnection), asdu, ResetProcessCommand_getQRP(rpc)))
-                        messageHandled = true;
-                }
-                else
-                    return false;
-            }
+            self->timeoutT2Triggered = false;
 
+            sendSMessage(self);
         }
-        else
-            responseCOTUnknown(asdu, self);
+    }
 
-        break;
+    return bytesRec;
+}
 
-    case C_CD_NA_1: /* 106 - Delay acquisition command */
+static void
+MasterConnection_executePeriodicTasks(MasterConnection self)
+{
+#if (CONFIG_USE_THREADS == 1)
+    self->ioThreadId = Thread_getCurrentThreadId();
+#endif
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd delay acquisition command C_CD_NA_1\n");
+    if (MasterConnection_flushOutputBuffer(self) == false)
+        self->isRunning = false;
 
-        if ((cot == CS101_COT_ACTIVATION) || (cot == CS101_COT_SPONTANEOUS)) {
+    if (self->isActive)
+        sendWaitingASDUs(self);
 
-            if (slave->delayAcquisitionHandler != NULL) {
+    if (handleTimeouts(self) == false)
+        self->isRunning = false;
+}
 
-                union uInformationObject _io;
+static void
+updateNextDeadline(uint64_t* nextDeadline, uint64_t deadline)
+{
+    if (deadline < *nextDeadline)
+        *nextDeadline = deadline;
+}
 
-                DelayAcquisitionCommand dac = (DelayAcquisitionCommand) CS101_ASDU_getElementEx(asdu, (InformationObject) &_io, 0);
+/**
+ * Get the time (in ms) when the periodic tasks of the connection have to be executed next
+ */
+static uint64_t
+MasterConnection_getNextDeadline(MasterConnection self, uint64_t currentTime)
+{
+    uint64_t nextDeadline = UINT64_MAX;
 
-                if (dac) {
-                    if (slave->delayAcquisitionHandler(slave->delayAcquisitionHandlerParameter,
-                            &(self->iMasterConnection), asdu, DelayAcquisitionCommand_getDelay(dac)))
-                        messageHandled = true;
-                }
-                else
-                    return false;
+    if (self->isRunning == false)
+        return currentTime;
 
-            }
-        }
-        else
-            responseCOTUnknown(asdu, self);
+    /* T3 - send TESTFR ACT */
+    updateNextDeadline(&nextDeadline, self->nextT3Timeout + 1);
 
-        break;
+    /* T2 - confirm received I messages */
+    if ((self->unconfirmedReceivedIMessages > 0) && (self->lastConfirmationTime != UINT64_MAX))
+        updateNextDeadline(&nextDeadline, self->lastConfirmationTime + (uint64_t) (self->slave->conParameters.t2 * 1000));
 
-    case C_TS_TA_1: /* 107 - test command with timestamp */
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->sentASDUsLock);
+#endif
 
-        DEBUG_PRINT("CS104 SLAVE: Rcvd test command with CP56Time2a C_TS_TA_1\n");
+    /* T1 - confirmation of sent I messages */
+    if (self->oldestSentASDU != -1)
+        updateNextDeadline(&nextDeadline, self->sentASDUs[self->oldestSentASDU].sentTime +
+                (uint64_t) LinkControl_getT1Timeout(&(self->linkControl), self->slave->conParameters.t1));
 
-        if (cot != CS101_COT_ACTIVATION) {
-            CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_COT);
-            CS101_ASDU_setNegative(asdu, true);
-        }
-        else
-            CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+    /* when output data is pending the connection waits until the socket is writable */
+    bool canSend = self->isActive && (isSentBufferFull(self) == false) && (MasterConnection_isOutputPending(self) == false);
 
-        sendASDUInternal(self, asdu);
+    int shaperWaitTime = 0;
 
-        messageHandled = true;
+    if (canSend) {
+        OutputShaper_refill(&(self->outputShaper), currentTime);
 
-        break;
+        if (OutputShaper_hasTokens(&(self->outputShaper)) == false)
+            shaperWaitTime = OutputShaper_getWaitTime(&(self->outputShaper));
+    }
 
+    bool canSendEvents = canSend && (isSentBufferFullForEvents(self) == false);
 
-    default: /* no special handler available -> use default handler */
-        break;
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    bool canSendBackgroundScan = canSend && isBackgroundScanWindowAvailable(self);
+#endif
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->sentASDUsLock);
+#endif
+
+    /* ASDUs waiting for transmission */
+    if ((canSend && HighPriorityASDUQueue_isAsduAvailable(self->highPrioQueue)) ||
+            (canSendEvents && MessageQueue_hasWaitingASDU(self->lowPrioQueue)))
+    {
+        updateNextDeadline(&nextDeadline, currentTime + shaperWaitTime);
     }
 
-    if ((messageHandled == false) && (slave->asduHandler != NULL))
-        if (slave->asduHandler(slave->asduHandlerParameter, &(self->iMasterConnection), asdu))
-            messageHandled = true;
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    /* running or next background scan cycles */
+    if (canSendBackgroundScan) {
+        int i;
 
-    if (messageHandled == false) {
-        /* send error response */
-        CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_TYPE_ID);
-        CS101_ASDU_setNegative(asdu, true);
-        sendASDUInternal(self, asdu);
+        for (i = 0; i < self->slave->numberOfCyclicGroups; i++) {
+            if (self->slave->cyclicGroups[i].cot == CS101_COT_BACKGROUND_SCAN) {
+                if (self->backgroundScans[i].nextAsduIndex != -1)
+                    updateNextDeadline(&nextDeadline, currentTime + shaperWaitTime);
+                else
+                    updateNextDeadline(&nextDeadline, self->backgroundScans[i].nextCycleTime);
+            }
+        }
     }
+#endif
 
-    return true;
+    return nextDeadline;
 }
 
-static bool
-checkSequenceNumber(MasterConnection self, int seqNo)
+/* release connections that have been closed (non-threaded mode) */
+static void
+removeClosedConnections(CS104_Slave self)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->sentASDUsLock);
-#endif
+    int i;
 
-    /* check if received sequence number is valid */
+    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
 
-    bool seqNoIsValid = false;
-    bool counterOverflowDetected = false;
-    int oldestValidSeqNo = -1;
+        MasterConnection con = self->masterConnections[i];
 
-    if (self->oldestSentASDU == -1) { /* if k-Buffer is empty */
-        if (seqNo == self->sendCount)
-            seqNoIsValid = true;
-    }
-    else {
-        /* two cases are required to reflect sequence number overflow */
-        int oldestAsduSeqNo = self->sentASDUs[self->oldestSentASDU].seqNo;
-        int newestAsduSeqNo = self->sentASDUs[self->newestSentASDU].seqNo;
+        if (con && con->isUsed && (con->isRunning == false)) {
 
-        if (oldestAsduSeqNo <= newestAsduSeqNo) {
-            if ((seqNo >= oldestAsduSeqNo) && (seqNo <= newestAsduSeqNo))
-                seqNoIsValid = true;
-        }
-        else {
-            if ((seqNo >= oldestAsduSeqNo) || (seqNo <= newestAsduSeqNo))
-                seqNoIsValid = true;
+            if (self->connectionEventHandler) {
+               self->connectionEventHandler(self->connectionEventHandlerParameter, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
+            }
 
-            counterOverflowDetected = true;
-        }
+            DEBUG_PRINT("CS104 SLAVE: Connection closed\n");
 
-        /* check if confirmed message was already removed from list */
-        if (oldestAsduSeqNo == 0)
-            oldestValidSeqNo = 32767;
-        else
-            oldestValidSeqNo = (oldestAsduSeqNo - 1) % 32768;
+#if (CONFIG_USE_SEMAPHORES)
+            Semaphore_wait(self->openConnectionsLock);
+#endif
 
-        if (oldestValidSeqNo == seqNo)
-            seqNoIsValid = true;
+            putFreeConnection(self, con);
+
+#if (CONFIG_USE_SEMAPHORES)
+            Semaphore_post(self->openConnectionsLock);
+#endif
+
+            MessageQueue_setWaitingForTransmissionWhenNotConfirmed(con->lowPrioQueue);
+
+            MasterConnection_deinit(con);
+        }
     }
+}
 
-    if (seqNoIsValid) {
-        if (self->oldestSentASDU != -1) {
+/* handle periodic tasks for running connections (non-threaded mode) */
+static void
+executePeriodicTasks(CS104_Slave self)
+{
+    int i;
 
-            do {
-                int oldestAsduSeqNo = self->sentASDUs[self->oldestSentASDU].seqNo;
+    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+        MasterConnection con = self->masterConnections[i];
 
-                if (counterOverflowDetected == false) {
-                    if (seqNo < oldestAsduSeqNo)
-                        break;
-                }
+        if (con != NULL && con->isUsed) {
+            if (con->isRunning) {
+                MasterConnection_executePeriodicTasks(con);
 
-                if (seqNo == oldestValidSeqNo)
-                    break;
+                /* call plugins */
+                if (self->plugins) {
 
-                /* remove from server (low-priority) queue if required */
-                if (self->sentASDUs[self->oldestSentASDU].queueEntry != NULL) {
+                    LinkedList pluginElem = LinkedList_getNext(self->plugins);
 
-                    MessageQueue_markAsduAsConfirmed(self->lowPrioQueue,
-                            self->sentASDUs[self->oldestSentASDU].queueEntry,
-                            self->sentASDUs[self->oldestSentASDU].entryId);
+                    while (pluginElem) {
 
-                    self->sentASDUs[self->oldestSentASDU].queueEntry = NULL;
+                        CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
 
-                    self->sentASDUs[self->oldestSentASDU].seqNo = -1;
+                        plugin->runTask(plugin->parameter, &(con->iMasterConnection));
+
+                        pluginElem = LinkedList_getNext(pluginElem);
+                    }
                 }
 
-                if (oldestAsduSeqNo == seqNo) {
-                    /* we arrived at the seq# that has been confirmed */
+            }
+        }
+    }
+}
 
-                    if (self->oldestSentASDU == self->newestSentASDU)
-                        self->oldestSentASDU = -1;
-                    else
-                        self->oldestSentASDU = (self->oldestSentASDU + 1) % self->maxSentASDUs;
+static void
+handleClientConnections(CS104_Slave self)
+{
+    HandleSet handleset = NULL;
 
-                    break;
-                }
+    if (self->openConnections > 0) {
 
-                self->oldestSentASDU = (self->oldestSentASDU + 1) % self->maxSentASDUs;
+        int i;
 
-                int checkIndex = (self->newestSentASDU + 1) % self->maxSentASDUs;
+        removeClosedConnections(self);
 
-                if (self->oldestSentASDU == checkIndex) {
-                    self->oldestSentASDU = -1;
-                    break;
-                }
+        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
 
-            } while (true);
-        }
-    }
-    else
-        DEBUG_PRINT("CS104 SLAVE: Received sequence number out of range");
+            MasterConnection con = self->masterConnections[i];
 
+            if (con && con->isUsed) {
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->sentASDUsLock);
-#endif
+                if (handleset == NULL) {
+                    handleset = con->handleSet;
+                    Handleset_reset(handleset);
+                }
 
-    return seqNoIsValid;
-}
+                Handleset_addSocket(handleset, con->socket);
+            }
+        }
 
-static void
-resetT3Timeout(MasterConnection self, uint64_t currentTime)
-{
-    self->nextT3Timeout = currentTime + (uint64_t) (self->slave->conParameters.t3 * 1000);
-}
+        /* handle incoming messages when available */
+        if (handleset != NULL) {
 
-static bool
-checkT3Timeout(MasterConnection self, uint64_t currentTime)
-{
-    if (self->nextT3Timeout > (currentTime + (uint64_t) (self->slave->conParameters.t3 * 1000))) {
-        /* timeout value not plausible (maybe system time changed) */
-        resetT3Timeout(self, currentTime);
-    }
+            if (Handleset_waitReady(handleset, 1)) {
 
-    if (currentTime > self->nextT3Timeout)
-        return true;
-    else
-        return false;
-}
+                for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+                    MasterConnection con = self->masterConnections[i];
 
-static void
-sendSMessage(MasterConnection self)
-{
-    uint8_t msg[6];
+                    if (con != NULL && con->isUsed)
+                        MasterConnection_handleTcpConnection(con);
+                }
 
-    msg[0] = 0x68;
-    msg[1] = 0x04;
-    msg[2] = 0x01;
-    msg[3] = 0;
-    msg[4] = (uint8_t) ((self->receiveCount % 128) * 2);
-    msg[5] = (uint8_t) (self->receiveCount / 128);
+            }
+        }
+
+        executePeriodicTasks(self);
+    }
 
-    if (writeToSocket(self, msg, 6) < 0)
-        self->isRunning = false;
 }
 
-static bool
-handleMessage(MasterConnection self, uint8_t* buffer, int msgSize)
+static char*
+getPeerAddress(Socket socket, char* ipAddress)
 {
-    uint64_t currentTime = Hal_getTimeInMs();
-
-    if (msgSize >= 3) {
+    char* ipAddrStr;
 
-        if (buffer[0] != 0x68) {
-            DEBUG_PRINT("CS104 SLAVE: Invalid START character!");
-            return false;
-        }
+    Socket_getPeerAddressStatic(socket, ipAddress);
 
-        uint8_t lengthOfApdu = buffer[1];
+    /* remove TCP port part */
+    if (ipAddress[0] == '[') {
+        /* IPV6 address */
+        ipAddrStr = ipAddress + 1;
 
-        if (lengthOfApdu != msgSize - 2) {
-            DEBUG_PRINT("CS104 SLAVE: Invalid length of APDU");
-            return false;
-        }
+        char* separator = strchr(ipAddrStr, ']');
 
-        if ((buffer[2] & 1) == 0) {
+        if (separator != NULL)
+            *separator = 0;
 
-            if (msgSize < 7) {
-                DEBUG_PRINT("CS104 SLAVE: Received I msg too small!");
-                return false;
-            }
+    }
+    else {
+        /* IPV4 address */
+        ipAddrStr = ipAddress;
 
-            if (self->timeoutT2Triggered == false) {
-                self->timeoutT2Triggered = true;
-                self->lastConfirmationTime = currentTime; /* start timeout T2 */
-            }
+        char* separator = strchr(ipAddrStr, ':');
 
-            int frameSendSequenceNumber = ((buffer [3] * 0x100) + (buffer [2] & 0xfe)) / 2;
-            int frameRecvSequenceNumber = ((buffer [5] * 0x100) + (buffer [4] & 0xfe)) / 2;
+        if (separator != NULL)
+            *separator = 0;
+    }
 
-            DEBUG_PRINT("CS104 SLAVE: Received I frame: N(S) = %i N(R) = %i\n", frameSendSequenceNumber, frameRecvSequenceNumber);
+    return ipAddrStr;
+}
 
-            if (frameSendSequenceNumber != self->receiveCount) {
-                DEBUG_PRINT("CS104 SLAVE: Sequence error - close connection");
-                return false;
-            }
+static bool
+callConnectionRequestHandler(CS104_Slave self, Socket newSocket)
+{
+    if (self->connectionRequestHandler != NULL) {
+        char ipAddress[60];
 
-            if (checkSequenceNumber (self, frameRecvSequenceNumber) == false) {
-                DEBUG_PRINT("CS104 SLAVE: Sequence number check failed - close connection");
-                return false;
-            }
+        char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
 
-            self->receiveCount = (self->receiveCount + 1) % 32768;
-            self->unconfirmedReceivedIMessages++;
+        return self->connectionRequestHandler(self->connectionRequestHandlerParameter,
+                ipAddrStr);
+    }
+    else
+        return true;
+}
 
-            if (self->isActive) {
+static CS104_RedundancyGroup
+getMatchingRedundancyGroup(CS104_Slave self, char* ipAddrStr)
+{
+    struct sCS104_IPAddress ipAddress;
 
-                CS101_ASDU asdu = CS101_ASDU_createFromBuffer(&(self->slave->alParameters), buffer + 6, msgSize - 6);
+    CS104_IPAddress_setFromString(&ipAddress, ipAddrStr);
 
-                if (asdu) {
-                    bool validAsdu = handleASDU(self, asdu);
+    CS104_RedundancyGroup catchAllGroup = NULL;
+    CS104_RedundancyGroup matchingGroup = NULL;
 
-                    CS101_ASDU_destroy(asdu);
+    LinkedList element = LinkedList_getNext(self->redundancyGroups);
 
-                    if (validAsdu == false) {
-                        DEBUG_PRINT("CS104 SLAVE: ASDU corrupted");
-                        return false;
-                    }
-                }
-                else {
-                    DEBUG_PRINT("CS104 SLAVE: Invalid ASDU");
-                    return false;
-                }
-            }
-            else
-                DEBUG_PRINT("CS104 SLAVE: Connection not activated. Skip I message");
+    while (element) {
+        CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup) LinkedList_getData(element);
 
+        if (CS104_RedundancyGroup_matches(redGroup, &ipAddress)) {
+            matchingGroup = redGroup;
+            break;
         }
 
-        /* Check for TESTFR_ACT message */
-        else if ((buffer[2] & 0x43) == 0x43) {
-            DEBUG_PRINT("CS104 SLAVE: Send TESTFR_CON\n");
+        if (CS104_RedundancyGroup_isCatchAll(redGroup))
+            catchAllGroup = redGroup;
 
-            if (writeToSocket(self, TESTFR_CON_MSG, TESTFR_CON_MSG_SIZE) < 0)
-                return false;
-        }
+        element = LinkedList_getNext(element);
+    }
 
-        /* Check for STARTDT_ACT message */
-        else if ((buffer [2] & 0x07) == 0x07) {
-            CS104_Slave_activate(self->slave, self);
+    if (matchingGroup == NULL)
+        matchingGroup = catchAllGroup;
 
-            HighPriorityASDUQueue_resetConnectionQueue(self->highPrioQueue);
+    return matchingGroup;
+}
 
-            DEBUG_PRINT("CS104 SLAVE: Send STARTDT_CON\n");
+static bool
+isAcceptingConnections(CS104_Slave self)
+{
+    return ((self->maxOpenConnections < 1) || (self->openConnections < self->maxOpenConnections));
+}
 
-            if (writeToSocket(self, STARTDT_CON_MSG, STARTDT_CON_MSG_SIZE) < 0)
-                return false;
-        }
+/* accept a new TCP connection in non-threaded mode */
+static void
+acceptConnectionThreadless(CS104_Slave self)
+{
+    if (isAcceptingConnections(self)) {
 
-        /* Check for STOPDT_ACT message */
-        else if ((buffer [2] & 0x13) == 0x13) {
-            MasterConnection_deactivate(self);
+        Socket newSocket = ServerSocket_accept(self->serverSocket);
 
-            /* Send S-Message to confirm all outstanding messages */
-            self->lastConfirmationTime = Hal_getTimeInMs();
+        if (newSocket != NULL) {
 
-            self->unconfirmedReceivedIMessages = 0;
+            bool acceptConnection = true;
 
-            self->timeoutT2Triggered = false;
+            if (acceptConnection)
+                acceptConnection = callConnectionRequestHandler(self, newSocket);
 
-            sendSMessage(self);
+            if (acceptConnection) {
 
-            DEBUG_PRINT("CS104 SLAVE: Send STOPDT_CON\n");
+                MessageQueue lowPrioQueue = NULL;
+                HighPriorityASDUQueue highPrioQueue = NULL;
 
-            if (writeToSocket(self, STOPDT_CON_MSG, STOPDT_CON_MSG_SIZE) < 0)
-                return false;
-        }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+                if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP) {
+                    lowPrioQueue = self->asduQueue;
+                    highPrioQueue = self->connectionAsduQueue;
+                }
+#endif
 
-        /* Check for TESTFR_CON message */
-        else if ((buffer[2] & 0x83) == 0x83) {
-            DEBUG_PRINT("CS104 SLAVE: Recv TESTFR_CON\n");
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+                if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
+                    /* use the connection specific queues allocated by initializeConnectionSpecificQueues */
+                    lowPrioQueue = NULL;
+                    highPrioQueue = NULL;
+                }
+#endif
+                MasterConnection connection = NULL;
 
-            self->outstandingTestFRConMessages = 0;
-        }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+                if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
 
-        else if (buffer [2] == 0x01) { /* S-message */
-            int seqNo = (buffer[4] + buffer[5] * 0x100) / 2;
+                    char ipAddress[60];
 
-            DEBUG_PRINT("CS104 SLAVE: Rcvd S(%i) (own sendcounter = %i)\n", seqNo, self->sendCount);
+                    char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
 
-            if (checkSequenceNumber(self, seqNo) == false)
-                return false;
-        }
+                    CS104_RedundancyGroup matchingGroup = getMatchingRedundancyGroup(self, ipAddrStr);
 
-        else {
-            DEBUG_PRINT("CS104 SLAVE: unknown message - IGNORE\n");
-            return true;
-        }
+                    if (matchingGroup != NULL) {
+                        connection = getFreeConnection(self);
 
-        resetT3Timeout(self, currentTime);
+                        if (connection) {
+                            if (MasterConnection_initEx(connection, newSocket, matchingGroup)) {
+                                if (matchingGroup->name) {
+                                    DEBUG_PRINT("CS104 SLAVE: Add connection to group: %s\n", matchingGroup->name);
+                                }
+                            }
+                            else {
+                                releaseConnection(self, connection);
+                                connection = NULL;
+                            }
+                        }
 
-        return true;
-    }
-    else {
-        DEBUG_PRINT("CS104 SLAVE: Invalid message (too small)");
-        return false;
-    }
-}
+                    }
+                    else {
+                        DEBUG_PRINT("CS104 SLAVE: Found no matching redundancy group -> close connection\n");
+                    }
 
-static void
-MasterConnection_deinit(MasterConnection self)
-{
-    if (self) {
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        if (self->tlsSocket != NULL)
-            TLSSocket_close(self->tlsSocket);
-#endif
 
-        Socket_destroy(self->socket);
-    }
-}
+                }
+                else {
+                    connection = getFreeConnection(self);
 
-static void
-MasterConnection_destroy(MasterConnection self)
-{
-    if (self) {
+                    if (connection) {
+                        if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue) == false) {
+                            releaseConnection(self, connection);
+                            connection = NULL;
+                        }
+                    }
 
-        GLOBAL_FREEMEM(self->sentASDUs);
+                }
+#else
+                connection = getFreeConnection(self);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_destroy(self->sentASDUsLock);
+                if (connection) {
+                    if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue) == false) {
+                        releaseConnection(self, connection);
+                        connection = NULL;
+                    }
+                }
 #endif
 
-        Handleset_destroy(self->handleSet);
+                if (connection) {
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-        if (self->slave->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
-            MessageQueue_destroy(self->lowPrioQueue);
-            HighPriorityASDUQueue_destroy(self->highPrioQueue);
+                    connection->isRunning = true;
+
+                    /* responses of other threads wake up the external event loop (see CS104_Slave_getPollDescriptors) */
+                    Handleset_enableWakeUp(connection->handleSet);
+
+                    if (self->connectionEventHandler) {
+                        self->connectionEventHandler(self->connectionEventHandlerParameter, &(connection->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
+                    }
+                }
+                else {
+                    Socket_destroy(newSocket);
+                    DEBUG_PRINT("CS104 SLAVE: Connection attempt failed!\n");
+                }
+
+            }
+            else {
+                Socket_destroy(newSocket);
+            }
         }
-#endif
 
-        GLOBAL_FREEMEM(self);
     }
 }
 
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+
+/* create the ASDUs of the periodic groups that are due and put them into the event queue(s) */
 static void
-sendNextLowPriorityASDU(MasterConnection self)
+runPeriodicGroups(CS104_Slave self, uint64_t currentTime)
 {
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->sentASDUsLock);
-#endif
+    sCS101_StaticASDU asduBuffers[CS104_SLAVE_CYCLIC_BATCH_SIZE];
+    CS101_ASDU batch[CS104_SLAVE_CYCLIC_BATCH_SIZE];
+    int batchSize = 0;
 
-    uint8_t* asduBuffer;
+    int groupId;
 
-    if (isSentBufferFull(self))
-        goto exit_function;
+    for (groupId = 0; groupId < self->numberOfCyclicGroups; groupId++) {
 
-    MessageQueue_lock(self->lowPrioQueue);
+        if (self->cyclicGroups[groupId].cot != CS101_COT_PERIODIC)
+            continue;
 
-    uint64_t entryId;
-    uint8_t* queueEntry;
-    int msgSize;
+        if (currentTime < self->cyclicGroups[groupId].nextCycleTime)
+            continue;
 
-    asduBuffer = MessageQueue_getNextWaitingASDU(self->lowPrioQueue, &entryId, &queueEntry, &msgSize);
+        /* fixed schedule - cycles are skipped when the handler is called too late */
+        self->cyclicGroups[groupId].nextCycleTime = getNextCycleTime(currentTime, self->cyclicGroups[groupId].cycleTimeInMs);
 
-    if (asduBuffer) {
-        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, asduBuffer, msgSize);
+        if (self->openConnections < 1)
+            continue;
 
-        msgSize += IEC60870_5_104_APCI_LENGTH;
+        int asduIndex = 0;
+
+        while (true) {
+            CS101_ASDU asdu = CS101_ASDU_initializeStatic(&(asduBuffers[batchSize]), &(self->alParameters), false,
+                    CS101_COT_PERIODIC, self->alParameters.originatorAddress, 0, false, false);
+
+            if (self->cyclicGroups[groupId].handler(self->cyclicGroups[groupId].parameter, groupId, asduIndex++, asdu) == false)
+                break;
 
-        sendASDU(self, self->sendBuffer, msgSize, entryId, queueEntry);
+            if (CS101_ASDU_getNumberOfElements(asdu) > 0) {
+                batch[batchSize++] = asdu;
+
+                if (batchSize == CS104_SLAVE_CYCLIC_BATCH_SIZE) {
+                    CS104_Slave_enqueueASDUs(self, batch, batchSize);
+                    batchSize = 0;
+                }
+            }
+        }
     }
 
-    MessageQueue_unlock(self->lowPrioQueue);
+    if (batchSize > 0)
+        CS104_Slave_enqueueASDUs(self, batch, batchSize);
+}
 
-exit_function:
+/* time (ms) of the next periodic cycle or UINT64_MAX when there is no periodic group */
+static uint64_t
+getNextPeriodicCycleTime(CS104_Slave self)
+{
+    uint64_t nextCycleTime = UINT64_MAX;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->sentASDUsLock);
-#endif
+    int groupId;
 
-    return;
+    for (groupId = 0; groupId < self->numberOfCyclicGroups; groupId++) {
+        if (self->cyclicGroups[groupId].cot == CS101_COT_PERIODIC)
+            updateNextDeadline(&nextCycleTime, self->cyclicGroups[groupId].nextCycleTime);
+    }
+
+    return nextCycleTime;
 }
 
-static bool
-sendNextHighPriorityASDU(MasterConnection self)
+#endif /* (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0) */
+
+/* handle TCP connections in non-threaded mode */
+static void
+handleConnectionsThreadless(CS104_Slave self)
 {
-    bool retVal = false;
+    acceptConnectionThreadless(self);
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->sentASDUsLock);
+    handleClientConnections(self);
+
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    runPeriodicGroups(self, Hal_getTimeInMs());
 #endif
+}
 
-    if (isSentBufferFull(self))
+static void*
+serverThread (void* parameter)
+{
+    CS104_Slave self = (CS104_Slave) parameter;
+
+    if (self->localAddress)
+        self->serverSocket = TcpServerSocket_create(self->localAddress, self->tcpPort);
+    else
+        self->serverSocket = TcpServerSocket_create("0.0.0.0", self->tcpPort);
+
+    if (self->serverSocket == NULL) {
+        DEBUG_PRINT("CS104 SLAVE: Cannot create server socket\n");
+        self->isStarting = false;
+        goto exit_function;
+    }
+
+    ServerSocket_setBacklog(self->serverSocket, CONFIG_CS104_SLAVE_LISTEN_BACKLOG);
+    ServerSocket_listen(self->serverSocket);
+
+    /* used to wait for new connection requests */
+    HandleSet handleSet = Handleset_new();
+
+    if (handleSet == NULL) {
+        DEBUG_PRINT("CS104 SLAVE: Cannot create handle set (out of memory)\n");
+        Socket_destroy((Socket) self->serverSocket);
+        self->serverSocket = NULL;
+        self->isStarting = false;
         goto exit_function;
+    }
 
-    HighPriorityASDUQueue_lock(self->highPrioQueue);
+    self->isRunning = true;
+    self->isStarting = false;
 
-    int msgSize;
-    uint8_t* buffer = HighPriorityASDUQueue_getNextASDU(self->highPrioQueue, &msgSize);
+    while (self->stopRunning == false) {
 
-    if (buffer) {
-        memcpy(self->sendBuffer + IEC60870_5_104_APCI_LENGTH, buffer, msgSize);
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+        runPeriodicGroups(self, Hal_getTimeInMs());
+#endif
 
-        msgSize += IEC60870_5_104_APCI_LENGTH;
+        Socket newSocket = ServerSocket_accept(self->serverSocket);
 
-        sendASDU(self, self->sendBuffer, msgSize, 0, NULL);
+        if (newSocket != NULL) {
 
-        retVal = true;
-    }
+            bool acceptConnection = true;
 
-    HighPriorityASDUQueue_unlock(self->highPrioQueue);
+            /* check if maximum number of open connections is reached */
+            if (self->maxOpenConnections > 0) {
+                if (self->openConnections >= self->maxOpenConnections)
+                    acceptConnection = false;
+            }
 
-exit_function:
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->sentASDUsLock);
+            if (acceptConnection)
+                acceptConnection = callConnectionRequestHandler(self, newSocket);
+
+            if (acceptConnection) {
+
+                MessageQueue lowPrioQueue = NULL;
+                HighPriorityASDUQueue highPrioQueue = NULL;
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+                if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP) {
+                    lowPrioQueue = self->asduQueue;
+                    highPrioQueue = self->connectionAsduQueue;
+                }
 #endif
 
-    return retVal;
-}
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+                if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
+                    lowPrioQueue = NULL;
+                    highPrioQueue = NULL;
+                }
+#endif
 
-/**
- * Send all high-priority ASDUs and the last waiting ASDU from the low-priority queue.
- * Returns true if ASDUs are still waiting. This can happen when there are more ASDUs
- * in the event (low-priority) buffer, or the connection is unavailable to send the high-priority
- * ASDUs (congestion or connection lost).
- */
-static bool
-sendWaitingASDUs(MasterConnection self)
-{
-    /* send all available high priority ASDUs first */
-    while (HighPriorityASDUQueue_isAsduAvailable(self->highPrioQueue)) {
+                MasterConnection connection = NULL;
 
-        if (sendNextHighPriorityASDU(self) == false)
-            return true;
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+                if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
 
-        if (self->isRunning == false)
-            return true;
-    }
+                    char ipAddress[60];
 
-    /* send messages from low-priority queue */
-    sendNextLowPriorityASDU(self);
+                    char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
 
-    if (MessageQueue_isAsduAvailable(self->lowPrioQueue))
-        return true;
-    else
-        return false;
-}
+                    CS104_RedundancyGroup matchingGroup = getMatchingRedundancyGroup(self, ipAddrStr);
 
-static bool
-handleTimeouts(MasterConnection self)
-{
-    uint64_t currentTime = Hal_getTimeInMs();
+                    if (matchingGroup != NULL) {
+                        connection = getFreeConnection(self);
 
-    bool timeoutsOk = true;
+                        if (connection) {
+                            if (MasterConnection_initEx(connection, newSocket, matchingGroup)) {
+                                if (matchingGroup->name) {
+                                    DEBUG_PRINT("CS104 SLAVE: Add connection to group: %s\n", matchingGroup->name);
+                                }
+                            }
+                            else {
+                                releaseConnection(self, connection);
+                                connection = NULL;
+                            }
+                        }
 
-    /* check T3 timeout */
-    if (checkT3Timeout(self, currentTime)) {
+                    }
+                    else {
+                        DEBUG_PRINT("CS104 SLAVE: Found no matching redundancy group -> close connection\n");
+                    }
 
-        if (self->outstandingTestFRConMessages > 2) {
-            DEBUG_PRINT("CS104 SLAVE: Timeout for TESTFR CON message\n");
 
-            /* close connection */
-            timeoutsOk = false;
-        }
-        else {
-            if (writeToSocket(self, TESTFR_ACT_MSG, TESTFR_ACT_MSG_SIZE) < 0) {
+                }
+                else {
+                    connection = getFreeConnection(self);
 
-                DEBUG_PRINT("CS104 SLAVE: Failed to write TESTFR ACT message\n");
+                    if (connection) {
+                        if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue) == false) {
+                            releaseConnection(self, connection);
+                            connection = NULL;
+                        }
+                    }
 
-                self->isRunning = false;
-            }
+                }
+#else
+                connection = getFreeConnection(self);
 
-            self->outstandingTestFRConMessages++;
-            resetT3Timeout(self, currentTime);
-        }
-    }
+                if (connection) {
+                    if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue) == false) {
+                        releaseConnection(self, connection);
+                        connection = NULL;
+                    }
+                }
+#endif
 
-    /* check timeout for others station I messages */
-    if (self->unconfirmedReceivedIMessages > 0) {
+                if (connection) {
+                    /* now start the connection handling (thread) */
+                    MasterConnection_start(connection);
+                }
+                else{
+                    Socket_destroy(newSocket);
 
-        /* Check validity of last confirmation time */
-        if (self->lastConfirmationTime != UINT64_MAX && self->lastConfirmationTime > currentTime) {
-            /* last confirmation time is in the future (maybe caused by system time change) */
-            self->lastConfirmationTime = currentTime;
-        }
+                    DEBUG_PRINT("CS104 SLAVE: Connection attempt failed!");
+                }
 
-        if (currentTime > self->lastConfirmationTime) {
-            if ((currentTime - self->lastConfirmationTime) >= (uint64_t) (self->slave->conParameters.t2 * 1000)) {
-                self->lastConfirmationTime = currentTime;
-                self->unconfirmedReceivedIMessages = 0;
-                self->timeoutT2Triggered = false;
-                sendSMessage(self);
+            }
+            else {
+                Socket_destroy(newSocket);
             }
         }
-    }
+        else {
+            int waitTime = 10;
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_wait(self->sentASDUsLock);
-#endif
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+            /* wake up in time for the next periodic cycle */
+            uint64_t currentTime = Hal_getTimeInMs();
+            uint64_t nextCycleTime = getNextPeriodicCycleTime(self);
 
-    /* check if counterpart confirmed I message */
-    if (self->oldestSentASDU != -1) {
+            if (nextCycleTime <= currentTime)
+                waitTime = 0;
+            else if ((nextCycleTime - currentTime) < (uint64_t) waitTime)
+                waitTime = (int) (nextCycleTime - currentTime);
+#endif
 
-        if (currentTime > self->sentASDUs[self->oldestSentASDU].sentTime) {
+            /* wake up immediately when the next client connects */
+            Handleset_reset(handleSet);
+            Handleset_addSocket(handleSet, (Socket) self->serverSocket);
+            Handleset_waitReady(handleSet, waitTime);
+        }
+    }
 
-            /* check validity of sent time */
+    Handleset_destroy(handleSet);
 
-            if (self->sentASDUs[self->oldestSentASDU].sentTime > currentTime) {
-                /* sent time is in the future (maybe caused by system time change) */
-                self->sentASDUs[self->oldestSentASDU].sentTime = currentTime;
-            }
+    if (self->serverSocket)
+        Socket_destroy((Socket) self->serverSocket);
 
-            if ((currentTime - self->sentASDUs[self->oldestSentASDU].sentTime) >= (uint64_t) (self->slave->conParameters.t1 * 1000)) {
-                timeoutsOk = false;
+    self->isRunning = false;
+    self->stopRunning = false;
 
-                printSendBuffer(self);
+exit_function:
+    return NULL;
+}
 
-                DEBUG_PRINT("CS104 SLAVE: I message timeout for %i seqNo: %i\n", self->oldestSentASDU,
-                        self->sentASDUs[self->oldestSentASDU].seqNo);
-            }
-        }
+void
+CS104_Slave_setEventClass(CS104_Slave self, int eventClass, int maxQueueSize, int weight)
+{
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    if ((eventClass < 0) || (eventClass >= CONFIG_CS104_SLAVE_EVENT_CLASSES)) {
+        DEBUG_PRINT("CS104 SLAVE: invalid event class %i\n", eventClass);
+        return;
     }
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-    Semaphore_post(self->sentASDUsLock);
-#endif
+    if (maxQueueSize < 1)
+        maxQueueSize = (self->maxLowPrioQueueSize > 0) ? self->maxLowPrioQueueSize : CONFIG_CS104_MESSAGE_QUEUE_SIZE;
+
+    if (weight < 1)
+        weight = 1;
 
-    return timeoutsOk;
+    self->eventClasses[eventClass].maxQueueSize = maxQueueSize;
+    self->eventClasses[eventClass].weight = weight;
+#else
+    DEBUG_PRINT("CS104 SLAVE: event classes not supported (CONFIG_CS104_SLAVE_EVENT_CLASSES = 1)\n");
+#endif
 }
 
 static void
-CS104_Slave_removeConnection(CS104_Slave self, MasterConnection connection)
+addEventMapping(LinkedList* mappings, IEC60870_5_TypeID typeId, CS101_CauseOfTransmission cot, int value)
 {
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_wait(self->openConnectionsLock);
-#endif
+    struct sEventMapping* mapping = (struct sEventMapping*) GLOBAL_MALLOC(sizeof(struct sEventMapping));
 
-    self->openConnections--;
+    if (mapping) {
+        mapping->typeId = typeId;
+        mapping->cot = cot;
+        mapping->value = value;
 
-    int i;
+        if (*mappings == NULL)
+            *mappings = LinkedList_create();
 
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-        if (self->masterConnections[i] == connection) {
-            self->masterConnections[i]->isUsed = false;
-            break;
-        }
+        LinkedList_add(*mappings, mapping);
     }
+}
 
-    MessageQueue_setWaitingForTransmissionWhenNotConfirmed(connection->lowPrioQueue);
+/**
+ * Get the value of the most specific matching mapping (type ID and COT before type ID before COT)
+ */
+static int
+findEventMapping(LinkedList mappings, IEC60870_5_TypeID typeId, CS101_CauseOfTransmission cot, int defaultValue)
+{
+    int value = defaultValue;
 
-    MasterConnection_deinit(connection);
+    if (mappings) {
 
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_post(self->openConnectionsLock);
-#endif
-}
+        int bestMatch = 0;
 
-static void
-CS104_Slave_closeAllConnections(CS104_Slave self) 
-{
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_wait(self->openConnectionsLock);
-#endif
+        LinkedList element = LinkedList_getNext(mappings);
 
-    int i;
+        while (element) {
+            struct sEventMapping* mapping = (struct sEventMapping*) LinkedList_getData(element);
 
-    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-        if (self->masterConnections[i]) {
-            if (self->masterConnections[i]->isUsed) {
-                self->masterConnections[i]->isUsed = false;
-                MasterConnection_deinit(self->masterConnections[i]);
+            int match = 0;
+
+            if (((mapping->typeId == 0) || (mapping->typeId == typeId)) && ((mapping->cot == 0) || (mapping->cot == cot))) {
+
+                if (mapping->typeId != 0)
+                    match += 2;
+
+                if (mapping->cot != 0)
+                    match += 1;
+
+                if (match == 0)
+                    match = -1; /* wildcard for all ASDUs */
+            }
+
+            if ((match != 0) && ((bestMatch == 0) || (match > bestMatch))) {
+                bestMatch = match;
+                value = mapping->value;
             }
+
+            element = LinkedList_getNext(element);
         }
     }
 
-    self->openConnections = 0;
-
-#if (CONFIG_USE_SEMAPHORES)
-    Semaphore_post(self->openConnectionsLock);
-#endif
+    return value;
 }
 
-static void*
-connectionHandlingThread(void* parameter)
+void
+CS104_Slave_addEventClassMapping(CS104_Slave self, IEC60870_5_TypeID typeId, CS101_CauseOfTransmission cot, int eventClass)
 {
-    MasterConnection self = (MasterConnection) parameter;
-
-    self->isRunning = true;
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    if ((eventClass < 0) || (eventClass >= CONFIG_CS104_SLAVE_EVENT_CLASSES)) {
+        DEBUG_PRINT("CS104 SLAVE: invalid event class %i\n", eventClass);
+        return;
+    }
 
-    resetT3Timeout(self, Hal_getTimeInMs());
+    addEventMapping(&(self->eventClassMappings), typeId, cot, eventClass);
+#else
+    DEBUG_PRINT("CS104 SLAVE: event classes not supported (CONFIG_CS104_SLAVE_EVENT_CLASSES = 1)\n");
+#endif
+}
 
-    bool isAsduWaiting = false;
+void
+CS104_Slave_addEventTimeToLive(CS104_Slave self, IEC60870_5_TypeID typeId, CS101_CauseOfTransmission cot, int timeToLiveInMs)
+{
+    addEventMapping(&(self->timeToLiveMappings), typeId, cot, timeToLiveInMs);
+}
 
-    if (self->slave->connectionEventHandler) {
-        self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
-    }
+void
+CS104_Slave_setKeepOnlyLatestCyclicValues(CS104_Slave self, bool keepOnlyLatest)
+{
+    self->keepOnlyLatestCyclicValues = keepOnlyLatest;
+}
 
-    while (self->isRunning) {
+void
+CS104_Slave_setCommandResponseReserve(CS104_Slave self, int reservedFrames)
+{
+    if (reservedFrames < 0)
+        reservedFrames = 0;
 
-        Handleset_reset(self->handleSet);
-        Handleset_addSocket(self->handleSet, self->socket);
+    self->commandResponseReserve = reservedFrames;
+}
 
-        int socketTimeout;
+int
+CS104_Slave_addCyclicGroup(CS104_Slave self, CS101_CauseOfTransmission cot, int cycleTimeInMs, CS104_CyclicGroupHandler handler, void* parameter)
+{
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    if ((cot != CS101_COT_PERIODIC) && (cot != CS101_COT_BACKGROUND_SCAN))
+        return -1;
 
-        /*
-         * When an ASDU is waiting only have a short look to see if a client request
-         * was received. Otherwise wait to save CPU time.
-         */
-        if (isAsduWaiting)
-            socketTimeout = 1;
-        else
-            socketTimeout = 100;
+    if ((handler == NULL) || (cycleTimeInMs < 1))
+        return -1;
 
-        if (Handleset_waitReady(self->handleSet, socketTimeout)) {
+    if (self->numberOfCyclicGroups >= CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS)
+        return -1;
 
-            int bytesRec = receiveMessage(self);
+    int groupId = self->numberOfCyclicGroups;
 
-            if (bytesRec == -1) {
-                DEBUG_PRINT("CS104 SLAVE: Error reading from socket\n");
-                break;
-            }
+    self->cyclicGroups[groupId].cot = cot;
+    self->cyclicGroups[groupId].cycleTimeInMs = cycleTimeInMs;
+    self->cyclicGroups[groupId].handler = handler;
+    self->cyclicGroups[groupId].parameter = parameter;
+    self->cyclicGroups[groupId].nextCycleTime = 0; /* first cycle when the slave is running */
 
-            if (bytesRec > 0) {
-                DEBUG_PRINT("CS104 SLAVE: Connection: rcvd msg(%i bytes)\n", bytesRec);
+    self->numberOfCyclicGroups++;
 
-                if (self->slave->rawMessageHandler)
-                    self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter,
-                            &(self->iMasterConnection), self->recvBuffer, bytesRec, false);
+    return groupId;
+#else
+    UNUSED_PARAMETER(self);
+    UNUSED_PARAMETER(cot);
+    UNUSED_PARAMETER(cycleTimeInMs);
+    UNUSED_PARAMETER(handler);
+    UNUSED_PARAMETER(parameter);
 
-                if (handleMessage(self, self->recvBuffer, bytesRec) == false)
-                    self->isRunning = false;
+    return -1;
+#endif
+}
 
-                if (self->unconfirmedReceivedIMessages >= self->slave->conParameters.w) {
+void
+CS104_Slave_setOutputRateLimit(CS104_Slave self, int maxBytesPerSecond, int maxFramesPerSecond, int burstSize)
+{
+    self->outputMaxBytesPerSecond = maxBytesPerSecond;
+    self->outputMaxFramesPerSecond = maxFramesPerSecond;
+    self->outputBurstSize = burstSize;
+}
 
-                    self->lastConfirmationTime = Hal_getTimeInMs();
+void
+CS104_Slave_setConnectionOutputRateLimit(CS104_Slave self, IMasterConnection connection, int maxBytesPerSecond,
+        int maxFramesPerSecond, int burstSize)
+{
+    (void) self;
 
-                    self->unconfirmedReceivedIMessages = 0;
+    MasterConnection con = (MasterConnection) connection->object;
 
-                    self->timeoutT2Triggered = false;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(con->sentASDUsLock);
+#endif
 
-                    sendSMessage(self);
-                }
-            }
-        }
+    OutputShaper_configure(&(con->outputShaper), maxBytesPerSecond, maxFramesPerSecond, burstSize);
 
-        if (handleTimeouts(self) == false)
-            self->isRunning = false;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(con->sentASDUsLock);
+#endif
+}
 
-        if (self->isRunning)
-            if (self->isActive)
-                isAsduWaiting = sendWaitingASDUs(self);
-    }
+void
+CS104_Slave_getConnectionOutputStatistics(CS104_Slave self, IMasterConnection connection, CS104_OutputShapingStatistics* statistics)
+{
+    (void) self;
 
-    if (self->slave->connectionEventHandler) {
-       self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
-    }
+    MasterConnection con = (MasterConnection) connection->object;
 
-    self->isRunning = false;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(con->sentASDUsLock);
+#endif
 
-    CS104_Slave_removeConnection(self->slave, self);
+    *statistics = con->outputShaper.statistics;
 
-    return NULL;
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(con->sentASDUsLock);
+#endif
 }
 
-/********************************************
- * IMasterConnection
- *******************************************/
-
-static bool
-_IMasterConnection_isReady(IMasterConnection self)
+void
+CS104_Slave_setAdaptiveWindow(CS104_Slave self, int maxK, int maxW)
 {
-    MasterConnection con = (MasterConnection) self->object;
+    if ((maxK < 0) || (maxK > 32767))
+        maxK = 0;
 
-    if (con->isActive) {
-        if (isSentBufferFull(con) == false)
-            return true;
+    /* w should not exceed two-thirds of k */
+    int maxWLimit = (((maxK > self->conParameters.k) ? maxK : self->conParameters.k) * 2) / 3;
 
-        if (HighPriorityASDUQueue_isFull(con->highPrioQueue))
-            return false;
+    if (maxW < 0)
+        maxW = 0;
+    else if (maxW > maxWLimit)
+        maxW = maxWLimit;
 
-        return true;
-    }
-    else
-        return false;
+    self->adaptiveMaxK = maxK;
+    self->adaptiveMaxW = maxW;
 }
 
-static bool
-_IMasterConnection_sendASDU(IMasterConnection self, CS101_ASDU asdu)
+void
+CS104_Slave_setAdaptiveT1(CS104_Slave self, bool enable)
 {
-    MasterConnection con = (MasterConnection) self->object;
+    self->adaptiveT1 = enable;
+}
 
-    return sendASDUInternal(con, asdu);
+void
+CS104_Slave_setReceiveTimestamps(CS104_Slave self, bool enable)
+{
+    self->receiveTimestamps = enable;
 }
 
-static bool
-_IMasterConnection_sendACT_CON(IMasterConnection self, CS101_ASDU asdu, bool negative)
+void
+CS104_Slave_getConnectionLinkStatistics(CS104_Slave self, IMasterConnection connection, CS104_LinkStatistics* statistics)
 {
-    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
-    CS101_ASDU_setNegative(asdu, negative);
+    (void) self;
 
-    return _IMasterConnection_sendASDU(self, asdu);
+    MasterConnection con = (MasterConnection) connection->object;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(con->sentASDUsLock);
+#endif
+
+    LinkControl* linkControl = &(con->linkControl);
+
+    statistics->rttInMs = linkControl->srtt;
+    statistics->rttVariationInMs = linkControl->rttVar;
+    statistics->minRttInMs = linkControl->minRtt;
+    statistics->t1InMs = LinkControl_getT1Timeout(linkControl, con->slave->conParameters.t1);
+    statistics->k = linkControl->k;
+    statistics->w = linkControl->w;
+    statistics->confirmedFrames = linkControl->confirmedFrames;
+    statistics->confirmedFramesPerSecond = linkControl->framesPerSecond;
+    statistics->receiveDelayInUs = con->lastReceiveDelay;
+    statistics->maxReceiveDelayInUs = con->maxReceiveDelay;
+    statistics->commandResponses = con->commandResponses;
+    statistics->commandResponseTimeInUs = con->lastCommandResponseTime;
+    statistics->maxCommandResponseTimeInUs = con->maxCommandResponseTime;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(con->sentASDUsLock);
+#endif
 }
 
-static bool
-_IMasterConnection_sendACT_TERM(IMasterConnection self, CS101_ASDU asdu)
+static int
+getEventClass(CS104_Slave self, CS101_ASDU asdu)
 {
-    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_TERMINATION);
-    CS101_ASDU_setNegative(asdu, false);
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    return findEventMapping(self->eventClassMappings, CS101_ASDU_getTypeID(asdu), CS101_ASDU_getCOT(asdu), 0);
+#else
+    (void) self;
+    (void) asdu;
 
-    return _IMasterConnection_sendASDU(self, asdu);
+    return 0;
+#endif
 }
 
-static void
-_IMasterConnection_close(IMasterConnection self)
+/**
+ * Get the expiration time of an event (0 = no expiration)
+ */
+static uint64_t
+getEventExpirationTime(CS104_Slave self, IEC60870_5_TypeID typeId, CS101_CauseOfTransmission cot)
 {
-    MasterConnection con = (MasterConnection) self->object;
+    int timeToLive = findEventMapping(self->timeToLiveMappings, typeId, cot, 0);
 
-    MasterConnection_close(con);
+    if (timeToLive > 0)
+        return Hal_getTimeInMs() + timeToLive;
+    else
+        return 0;
 }
 
-static int
-_IMasterConnection_getPeerAddress(IMasterConnection self, char* addrBuf, int addrBufSize)
+/**
+ * Get the key to identify older values of periodic/background data (0 = keep all values)
+ */
+static uint64_t
+getLatestValueKey(CS104_Slave self, CS101_ASDU asdu)
 {
-    MasterConnection con = (MasterConnection) self->object;
+    if (self->keepOnlyLatestCyclicValues == false)
+        return 0;
 
-    char buf[50];
+    CS101_CauseOfTransmission cot = CS101_ASDU_getCOT(asdu);
 
-    char* addrStr = Socket_getPeerAddressStatic(con->socket, buf);
+    if ((cot != CS101_COT_PERIODIC) && (cot != CS101_COT_BACKGROUND_SCAN))
+        return 0;
 
-    if (addrStr == NULL)
+    /* the first IOA identifies all points only for a single object or a sequence of objects */
+    if ((CS101_ASDU_getNumberOfElements(asdu) != 1) && (CS101_ASDU_isSequence(asdu) == false))
         return 0;
 
-    int len = strlen(buf);
+    int sizeOfIOA = asdu->parameters->sizeOfIOA;
 
-    if (len < addrBufSize) {
-        strcpy(addrBuf, buf);
-        return len;
-    }
-    else
+    if (asdu->payloadSize < sizeOfIOA)
         return 0;
+
+    uint64_t ioa = 0;
+    int i;
+
+    for (i = sizeOfIOA - 1; i >= 0; i--)
+        ioa = (ioa << 8) + asdu->payload[i];
+
+    uint64_t vsq = (uint64_t) CS101_ASDU_getNumberOfElements(asdu) | (CS101_ASDU_isSequence(asdu) ? 0x80 : 0);
+
+    return ((uint64_t) CS101_ASDU_getTypeID(asdu) << 56) | (vsq << 48) | ((uint64_t) (CS101_ASDU_getCA(asdu) & 0xffff) << 32) | ioa;
 }
 
-static CS101_AppLayerParameters
-_IMasterConnection_getApplicationLayerParameters(IMasterConnection self)
+void
+CS104_Slave_enqueueASDU(CS104_Slave self, CS101_ASDU asdu)
 {
-    MasterConnection con = (MasterConnection) self->object;
+    int eventClass = getEventClass(self, asdu);
+    uint64_t expirationTime = getEventExpirationTime(self, CS101_ASDU_getTypeID(asdu), CS101_ASDU_getCOT(asdu));
+    uint64_t latestValueKey = getLatestValueKey(self, asdu);
 
-    return &(con->slave->alParameters);
-}
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+        MessageQueue_enqueueASDU(MessageQueue_getEventClassQueue(self->asduQueue, eventClass), asdu, expirationTime, latestValueKey);
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 
-/********************************************
- * END IMasterConnection
- *******************************************/
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
 
-static MasterConnection
-MasterConnection_create(CS104_Slave slave)
-{
-    MasterConnection self = (MasterConnection) GLOBAL_CALLOC(1, sizeof(struct sMasterConnection));
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
 
-    if (self != NULL) {
-        self->isUsed = false;
-        self->slave = slave;
-        self->maxSentASDUs = slave->conParameters.k;
-        self->sentASDUs = (SentASDUSlave*) GLOBAL_CALLOC(self->maxSentASDUs, sizeof(SentASDUSlave));
+        /************************************************
+         * Dispatch event to all redundancy groups
+         ************************************************/
 
-        self->iMasterConnection.object = self;
-        self->iMasterConnection.getApplicationLayerParameters = _IMasterConnection_getApplicationLayerParameters;
-        self->iMasterConnection.isReady = _IMasterConnection_isReady;
-        self->iMasterConnection.sendASDU = _IMasterConnection_sendASDU;
-        self->iMasterConnection.sendACT_CON = _IMasterConnection_sendACT_CON;
-        self->iMasterConnection.sendACT_TERM = _IMasterConnection_sendACT_TERM;
-        self->iMasterConnection.close = _IMasterConnection_close;
-        self->iMasterConnection.getPeerAddress = _IMasterConnection_getPeerAddress;
+        LinkedList element = LinkedList_getNext(self->redundancyGroups);
+
+        while (element) {
+
+            CS104_RedundancyGroup group = (CS104_RedundancyGroup) LinkedList_getData(element);
+
+            MessageQueue_enqueueASDU(MessageQueue_getEventClassQueue(group->asduQueue, eventClass), asdu, expirationTime, latestValueKey);
+
+            element = LinkedList_getNext(element);
+        }
+    }
+
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
 
 #if (CONFIG_USE_SEMAPHORES == 1)
-        self->sentASDUsLock = Semaphore_create(1);
+        Semaphore_wait(self->openConnectionsLock);
 #endif
-        self->handleSet = Handleset_new();
 
-        /* initialize pointers with NULL to avoid segmentation fault on destroy call */
-        self->socket = NULL;
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        self->tlsSocket = NULL;
-#endif
+        /************************************************
+         * Dispatch event to all open client connections
+         ************************************************/
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-        self->redundancyGroup = NULL;
+        int i;
+
+        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+
+            MasterConnection con = self->masterConnections[i];
+
+            if (con)
+                MessageQueue_enqueueASDU(MessageQueue_getEventClassQueue(con->lowPrioQueue, eventClass), asdu, expirationTime, latestValueKey);
+
+        }
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
 #endif
-        self->lowPrioQueue = NULL;
-        self->highPrioQueue = NULL;
     }
-
-    return self;
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 }
 
-static bool
-MasterConnection_init(MasterConnection self, Socket skt, MessageQueue lowPrioQueue, HighPriorityASDUQueue highPrioQueue)
+/* ASDU of a batch (CS104_Slave_enqueueASDUs) that is already encoded */
+typedef struct {
+    int offset; /* position in the encoding buffer */
+    int size;
+    int eventClass;
+    uint64_t expirationTime;
+    uint64_t latestValueKey;
+} EncodedASDU;
+
+/* enqueue the batch to the event class queue(s) of a redundancy group with a single lock per queue */
+static void
+enqueueEncodedASDUsToGroup(MessageQueue lowPrioQueue, EncodedASDU* encodedAsdus, int count, uint8_t* buffer, int usedEventClasses)
 {
-    if (self) {
-        self->socket = skt;
-        self->isActive = false;
-        self->isRunning = false;
-        self->receiveCount = 0;
-        self->sendCount = 0;
-        self->recvBufPos = 0;
+    MessageQueue queues[CONFIG_CS104_SLAVE_EVENT_CLASSES];
 
-        self->unconfirmedReceivedIMessages = 0;
-        self->lastConfirmationTime = UINT64_MAX;
+    int eventClass;
 
-        self->timeoutT2Triggered = false;
+    for (eventClass = 0; eventClass < CONFIG_CS104_SLAVE_EVENT_CLASSES; eventClass++)
+        queues[eventClass] = MessageQueue_getEventClassQueue(lowPrioQueue, eventClass);
 
-        self->oldestSentASDU = -1;
-        self->newestSentASDU = -1;
+    for (eventClass = 0; eventClass < CONFIG_CS104_SLAVE_EVENT_CLASSES; eventClass++) {
 
-        resetT3Timeout(self, Hal_getTimeInMs());
+        if ((usedEventClasses & (1 << eventClass)) == 0)
+            continue;
 
-#if (CONFIG_CS104_SUPPORT_TLS == 1)
-        if (self->slave->tlsConfig != NULL) {
-            self->tlsSocket = TLSSocket_create(skt, self->slave->tlsConfig, false);
+        MessageQueue queue = queues[eventClass];
 
-            if (self->tlsSocket == NULL) {
-                DEBUG_PRINT("CS104 SLAVE: Failed to create TLS context. Close connection\n");
+        /* event classes without own queue share the default queue */
+        int otherClass;
+        bool alreadyHandled = false;
 
-                self->isUsed = false;
-                return false;
-            }
+        for (otherClass = 0; otherClass < eventClass; otherClass++) {
+            if ((usedEventClasses & (1 << otherClass)) && (queues[otherClass] == queue))
+                alreadyHandled = true;
         }
-        else
-            self->tlsSocket = NULL;
-#endif
 
-        /* for the mode CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP we use the connection specific queues */
-        if (lowPrioQueue)
-            self->lowPrioQueue = lowPrioQueue;
-        else {
-            MessageQueue_releaseAllQueuedASDUs(self->lowPrioQueue);
-        }
+        if (alreadyHandled)
+            continue;
 
-        if (highPrioQueue)
-            self->highPrioQueue = highPrioQueue;
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(queue->queueLock);
+#endif
 
-        HighPriorityASDUQueue_resetConnectionQueue(self->highPrioQueue);
+        int i;
 
-        self->outstandingTestFRConMessages = 0;
+        for (i = 0; i < count; i++) {
+            if (queues[encodedAsdus[i].eventClass] == queue)
+                MessageQueue_enqueueEncodedASDU(queue, buffer + encodedAsdus[i].offset, encodedAsdus[i].size,
+                        encodedAsdus[i].expirationTime, encodedAsdus[i].latestValueKey);
+        }
 
-        return true;
-    }
-    else {
-        return false;
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(queue->queueLock);
+#endif
     }
 }
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-static bool
-MasterConnection_initEx(MasterConnection self, Socket skt, CS104_RedundancyGroup redGroup)
+/* enqueue the encoded ASDUs to all queues of the slave */
+static void
+enqueueEncodedASDUs(CS104_Slave self, EncodedASDU* encodedAsdus, int count, uint8_t* buffer, int usedEventClasses)
 {
-    bool retVal = false;
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
+        enqueueEncodedASDUsToGroup(self->asduQueue, encodedAsdus, count, buffer, usedEventClasses);
+#endif
 
-    if (self) {
-        retVal = MasterConnection_init(self, skt, redGroup->asduQueue, redGroup->connectionAsduQueue);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
 
-        if (retVal)
-            self->redundancyGroup = redGroup;
+        LinkedList element = LinkedList_getNext(self->redundancyGroups);
+
+        while (element) {
+
+            CS104_RedundancyGroup group = (CS104_RedundancyGroup) LinkedList_getData(element);
+
+            enqueueEncodedASDUsToGroup(group->asduQueue, encodedAsdus, count, buffer, usedEventClasses);
+
+            element = LinkedList_getNext(element);
+        }
     }
+#endif
 
-    return retVal;
-}
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
 
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(self->openConnectionsLock);
+#endif
 
-static void
-MasterConnection_start(MasterConnection self)
-{
-    Thread newThread =
-           Thread_create((ThreadExecutionFunction) connectionHandlingThread,
-                   (void*) self, true);
+        int i;
 
-    Thread_start(newThread);
-}
+        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
 
-void
-MasterConnection_close(MasterConnection self)
-{
-    self->isRunning = false;
-}
+            MasterConnection con = self->masterConnections[i];
 
-void
-MasterConnection_deactivate(MasterConnection self)
-{
-    if (self->isActive == true) {
-        if (self->slave->connectionEventHandler) {
-             self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection), CS104_CON_EVENT_DEACTIVATED);
+            if (con)
+                enqueueEncodedASDUsToGroup(con->lowPrioQueue, encodedAsdus, count, buffer, usedEventClasses);
         }
-    }
 
-    self->isActive = false;
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(self->openConnectionsLock);
+#endif
+    }
+#endif
 }
 
 void
-MasterConnection_activate(MasterConnection self)
+CS104_Slave_enqueueASDUs(CS104_Slave self, CS101_ASDU* asdus, int count)
 {
-    if (self->isActive == false) {
-        if (self->slave->connectionEventHandler) {
-             self->slave->connectionEventHandler(self->slave->connectionEventHandlerParameter, &(self->iMasterConnection), CS104_CON_EVENT_ACTIVATED);
-        }
-    }
+    /* the batch is handled in chunks so that no memory has to be allocated */
+    EncodedASDU encodedAsdus[CS104_SLAVE_ENQUEUE_CHUNK_SIZE];
+    uint8_t buffer[CS104_SLAVE_ENQUEUE_CHUNK_SIZE * (256 - IEC60870_5_104_APCI_LENGTH)];
 
-    self->isActive = true;
-}
+    int i = 0;
 
-static void
-MasterConnection_handleTcpConnection(MasterConnection self)
-{
-    int bytesRec = receiveMessage(self);
+    while (i < count) {
 
-    if (bytesRec < 0) {
-        DEBUG_PRINT("CS104 SLAVE: Error reading from socket\n");
-        self->isRunning = false;
-    }
+        /* encode each ASDU only once for all queues */
+        int encodedCount = 0;
+        int bufferPos = 0;
+        int usedEventClasses = 0;
 
-    if ((bytesRec > 0) && (self->isRunning)) {
+        while ((i < count) && (encodedCount < CS104_SLAVE_ENQUEUE_CHUNK_SIZE)) {
+            CS101_ASDU asdu = asdus[i++];
 
-        if (self->slave->rawMessageHandler)
-            self->slave->rawMessageHandler(self->slave->rawMessageHandlerParameter,
-                    &(self->iMasterConnection), self->recvBuffer, bytesRec, false);
+            int asduSize = asdu->asduHeaderLength + asdu->payloadSize;
 
-        if (handleMessage(self, self->recvBuffer, bytesRec) == false)
-            self->isRunning = false;
+            if (asduSize > 256 - IEC60870_5_104_APCI_LENGTH) {
+                DEBUG_PRINT("CS104 SLAVE: ASDU too large!\n");
+                continue;
+            }
 
-        if (self->unconfirmedReceivedIMessages >= self->slave->conParameters.w) {
+            struct sBufferFrame bufferFrame;
 
-            self->lastConfirmationTime = Hal_getTimeInMs();
+            Frame frame = BufferFrame_initialize(&bufferFrame, buffer + bufferPos, 0);
+            CS101_ASDU_encode(asdu, frame);
 
-            self->unconfirmedReceivedIMessages = 0;
+            EncodedASDU* encodedAsdu = &(encodedAsdus[encodedCount++]);
 
-            self->timeoutT2Triggered = false;
+            encodedAsdu->offset = bufferPos;
+            encodedAsdu->size = asduSize;
+            encodedAsdu->eventClass = getEventClass(self, asdu);
 
-            sendSMessage(self);
+            /* unknown event classes are handled by the default queue */
+            if ((encodedAsdu->eventClass < 0) || (encodedAsdu->eventClass >= CONFIG_CS104_SLAVE_EVENT_CLASSES))
+                encodedAsdu->eventClass = 0;
+            encodedAsdu->expirationTime = getEventExpirationTime(self, CS101_ASDU_getTypeID(asdu), CS101_ASDU_getCOT(asdu));
+            encodedAsdu->latestValueKey = getLatestValueKey(self, asdu);
+
+            usedEventClasses |= (1 << encodedAsdu->eventClass);
+
+            bufferPos += asduSize;
         }
+
+        if (encodedCount > 0)
+            enqueueEncodedASDUs(self, encodedAsdus, encodedCount, buffer, usedEventClasses);
     }
 }
 
-static void
-MasterConnection_executePeriodicTasks(MasterConnection self)
+void
+CS104_Slave_addRedundancyGroup(CS104_Slave self, CS104_RedundancyGroup redundancyGroup)
 {
-    if (self->isActive)
-        sendWaitingASDUs(self);
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
 
-    if (handleTimeouts(self) == false)
-        self->isRunning = false;
+        if (self->redundancyGroups == NULL)
+            self->redundancyGroups = LinkedList_create();
+
+        LinkedList_add(self->redundancyGroups, redundancyGroup);
+    }
+
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 }
 
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
 static void
-handleClientConnections(CS104_Slave self)
+initializeRedundancyGroups(CS104_Slave self, int lowPrioMaxQueueSize, int highPrioMaxQueueSize)
 {
-    HandleSet handleset = NULL;
-
-    if (self->openConnections > 0) {
-
-        int i;
-
-        bool first = true;
-
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-
-            MasterConnection con = self->masterConnections[i];
-
-            if (con && con->isUsed) {
-
-                if (con->isRunning) {
-
-                    if (first) {
-
-                        handleset = con->handleSet;
-                        Handleset_reset(handleset);
+    if (self->redundancyGroups == NULL) {
+        CS104_RedundancyGroup redGroup = CS104_RedundancyGroup_create(NULL);
+        CS104_Slave_addRedundancyGroup(self, redGroup);
+    }
 
-                        first = false;
-                    }
+    LinkedList element = LinkedList_getNext(self->redundancyGroups);
 
-                    Handleset_addSocket(handleset, con->socket);
-                }
-                else {
+    while (element) {
 
-                    if (self->connectionEventHandler) {
-                       self->connectionEventHandler(self->connectionEventHandlerParameter, &(con->iMasterConnection), CS104_CON_EVENT_CONNECTION_CLOSED);
-                    }
+        CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup) LinkedList_getData(element);
 
-                    DEBUG_PRINT("CS104 SLAVE: Connection closed\n");
+        if (redGroup->asduQueue == NULL) {
+            CS104_RedundancyGroup_initializeMessageQueues(redGroup, lowPrioMaxQueueSize, highPrioMaxQueueSize);
+            initializeEventQueue(self, redGroup->asduQueue, lowPrioMaxQueueSize);
+        }
 
-                    self->masterConnections[i]->isUsed = false;
+        element = LinkedList_getNext(element);
+    }
+}
+#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
-                    MessageQueue_setWaitingForTransmissionWhenNotConfirmed(self->masterConnections[i]->lowPrioQueue);
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
 
-                    self->openConnections--;
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+#define QUEUE_REPLICATION_QUEUES_PER_GROUP CONFIG_CS104_SLAVE_EVENT_CLASSES
+#else
+#define QUEUE_REPLICATION_QUEUES_PER_GROUP 1
+#endif
 
-                    MasterConnection_deinit(con);
-                }
+/**
+ * Get the low priority queue of a redundancy group (NULL if index is out of range)
+ */
+static MessageQueue
+getGroupQueue(CS104_Slave self, int groupIndex)
+{
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
+    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP) {
+        if (groupIndex == 0)
+            return self->asduQueue;
+    }
+#endif
 
-            }
+#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
+        if (self->redundancyGroups != NULL) {
+            LinkedList element = LinkedList_get(self->redundancyGroups, groupIndex);
 
+            if (element)
+                return ((CS104_RedundancyGroup) LinkedList_getData(element))->asduQueue;
         }
+    }
+#endif
 
-        /* handle incoming messages when available */
-        if (handleset != NULL) {
-
-            if (Handleset_waitReady(handleset, 1)) {
+    return NULL;
+}
 
-                for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-                    MasterConnection con = self->masterConnections[i];
+/**
+ * Get the number of replication indices (redundancy groups x event classes)
+ */
+static int
+getReplicationIndexRange(CS104_Slave self)
+{
+    int groupIndex = 0;
 
-                    if (con != NULL && con->isUsed)
-                        MasterConnection_handleTcpConnection(con);
-                }
+    while (getGroupQueue(self, groupIndex) != NULL)
+        groupIndex++;
 
-            }
-        }
+    groupIndex *= QUEUE_REPLICATION_QUEUES_PER_GROUP;
 
-        /* handle periodic tasks for running connections */
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
-            MasterConnection con = self->masterConnections[i];
+    return (groupIndex > 256) ? 256 : groupIndex;
+}
 
-            if (con != NULL && con->isUsed) {
-                if (con->isRunning) {
-                    MasterConnection_executePeriodicTasks(con);
+/**
+ * Get the (event class) queue with the given replication index (NULL if the queue doesn't exist)
+ */
+static MessageQueue
+getReplicatedQueue(CS104_Slave self, int index)
+{
+    MessageQueue queue = getGroupQueue(self, index / QUEUE_REPLICATION_QUEUES_PER_GROUP);
 
-                    /* call plugins */
-                    if (self->plugins) {
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+    if (queue)
+        queue = queue->eventClassQueues[index % QUEUE_REPLICATION_QUEUES_PER_GROUP];
+#endif
 
-                        LinkedList pluginElem = LinkedList_getNext(self->plugins);
+    return queue;
+}
 
-                        while (pluginElem) {
+static bool
+writeReplicationData(CS104_Slave self, Socket socket, HandleSet handleSet, uint8_t* buffer, int size)
+{
+    int sentBytes = 0;
 
-                            CS101_SlavePlugin plugin = (CS101_SlavePlugin) LinkedList_getData(pluginElem);
+    while (sentBytes < size) {
+        int result = Socket_write(socket, buffer + sentBytes, size - sentBytes);
 
-                            plugin->runTask(plugin->parameter, &(con->iMasterConnection));
+        if (result < 0)
+            return false;
 
-                            pluginElem = LinkedList_getNext(pluginElem);
-                        }
-                    }
+        if (result == 0) {
+            if (self->replicationRunning == false)
+                return false;
 
-                }
-            }
+            /* TCP send buffer is full -> wait until the socket is writable again */
+            Handleset_reset(handleSet);
+            Handleset_addSocketForWrite(handleSet, socket);
+            Handleset_waitReady(handleSet, 100);
         }
 
+        sentBytes += result;
     }
 
+    return true;
 }
 
-static char*
-getPeerAddress(Socket socket, char* ipAddress)
+/**
+ * Transfer the complete content of all replicated queues to the standby
+ */
+static bool
+sendReplicationSnapshot(CS104_Slave self, Socket socket, HandleSet handleSet)
 {
-    char* ipAddrStr;
+    bool retVal = true;
+    int bufferSize = 0;
+    int indexRange = getReplicationIndexRange(self);
+    int i;
+    MessageQueue queue;
 
-    Socket_getPeerAddressStatic(socket, ipAddress);
+    for (i = 0; i < indexRange; i++) {
+        if ((queue = getReplicatedQueue(self, i)) != NULL)
+            bufferSize += queue->size + QUEUE_REPLICATION_HEADER_SIZE;
+    }
 
-    /* remove TCP port part */
-    if (ipAddress[0] == '[') {
-        /* IPV6 address */
-        ipAddrStr = ipAddress + 1;
+    uint8_t* buffer = (uint8_t*) GLOBAL_MALLOC(bufferSize);
 
-        char* separator = strchr(ipAddrStr, ']');
+    if (buffer == NULL)
+        return false;
 
-        if (separator != NULL)
-            *separator = 0;
+    int bufPos = 0;
 
+    /* lock all queues to get a consistent state - new operations are recorded after the snapshot */
+    for (i = 0; i < indexRange; i++) {
+        if ((queue = getReplicatedQueue(self, i)) != NULL)
+            MessageQueue_lock(queue);
     }
-    else {
-        /* IPV4 address */
-        ipAddrStr = ipAddress;
 
-        char* separator = strchr(ipAddrStr, ':');
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_wait(self->replicator->lock);
+#endif
 
-        if (separator != NULL)
-            *separator = 0;
+    self->replicator->pendingSize = 0;
+    self->replicator->resyncRequired = false;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore_post(self->replicator->lock);
+#endif
+
+    for (i = 0; i < indexRange; i++) {
+        if ((queue = getReplicatedQueue(self, i)) != NULL) {
+            bufPos += MessageQueue_encodeReplicationSnapshot(queue, buffer + bufPos);
+            MessageQueue_unlock(queue);
+        }
     }
 
-    return ipAddrStr;
-}
+    DEBUG_PRINT("CS104 SLAVE: send replication snapshot (%i bytes)\n", bufPos);
 
-static bool
-callConnectionRequestHandler(CS104_Slave self, Socket newSocket)
-{
-    if (self->connectionRequestHandler != NULL) {
-        char ipAddress[60];
+    retVal = writeReplicationData(self, socket, handleSet, buffer, bufPos);
 
-        char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
+    GLOBAL_FREEMEM(buffer);
 
-        return self->connectionRequestHandler(self->connectionRequestHandlerParameter,
-                ipAddrStr);
-    }
-    else
-        return true;
+    return retVal;
 }
 
-static CS104_RedundancyGroup
-getMatchingRedundancyGroup(CS104_Slave self, char* ipAddrStr)
+/**
+ * Send the recorded queue operations to the standby (primary side)
+ */
+static void*
+replicationSenderThread(void* parameter)
 {
-    struct sCS104_IPAddress ipAddress;
+    CS104_Slave self = (CS104_Slave) parameter;
+    QueueReplicator replicator = self->replicator;
 
-    CS104_IPAddress_setFromString(&ipAddress, ipAddrStr);
+    Socket socket = NULL;
+    uint64_t nextConnectTime = 0;
 
-    CS104_RedundancyGroup catchAllGroup = NULL;
-    CS104_RedundancyGroup matchingGroup = NULL;
+    HandleSet handleSet = Handleset_new();
 
-    LinkedList element = LinkedList_getNext(self->redundancyGroups);
+    if (handleSet == NULL) {
+        DEBUG_PRINT("CS104 SLAVE: failed to start queue replication (out of memory)\n");
+        return NULL;
+    }
 
-    while (element) {
-        CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup) LinkedList_getData(element);
+    while (self->replicationRunning) {
 
-        if (CS104_RedundancyGroup_matches(redGroup, &ipAddress)) {
-            matchingGroup = redGroup;
-            break;
-        }
+        if (socket == NULL) {
 
-        if (CS104_RedundancyGroup_isCatchAll(redGroup))
-            catchAllGroup = redGroup;
+            uint64_t currentTime = Hal_getTimeInMs();
 
-        element = LinkedList_getNext(element);
-    }
+            if (currentTime < nextConnectTime) {
+                /* woken up early by stop */
+                QueueReplicator_waitForData(replicator, (int) (nextConnectTime - currentTime));
+                continue;
+            }
 
-    if (matchingGroup == NULL)
-        matchingGroup = catchAllGroup;
+            nextConnectTime = Hal_getTimeInMs() + 1000;
 
-    return matchingGroup;
-}
+            socket = TcpSocket_create();
 
-/* handle TCP connections in non-threaded mode */
-static void
-handleConnectionsThreadless(CS104_Slave self)
-{
-    if ((self->maxOpenConnections < 1) || (self->openConnections < self->maxOpenConnections)) {
+            if (socket == NULL)
+                continue;
 
-        Socket newSocket = ServerSocket_accept(self->serverSocket);
+            Socket_setConnectTimeout(socket, 1000);
 
-        if (newSocket != NULL) {
+            if (Socket_connect(socket, self->replicationTargetAddress, self->replicationTargetPort) == false) {
+                Socket_destroy(socket);
+                socket = NULL;
+                continue;
+            }
 
-            bool acceptConnection = true;
+            DEBUG_PRINT("CS104 SLAVE: connected to replication standby\n");
 
-            if (acceptConnection)
-                acceptConnection = callConnectionRequestHandler(self, newSocket);
+            /* the standby gets the complete queue content first */
+            if (sendReplicationSnapshot(self, socket, handleSet) == false)
+                goto connection_lost;
 
-            if (acceptConnection) {
+            self->replicationConnected = true;
+        }
 
-                MessageQueue lowPrioQueue = NULL;
-                HighPriorityASDUQueue highPrioQueue = NULL;
+        if (QueueReplicator_isResyncRequired(replicator)) {
+            if (sendReplicationSnapshot(self, socket, handleSet) == false)
+                goto connection_lost;
+        }
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-                if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP) {
-                    lowPrioQueue = self->asduQueue;
-                    highPrioQueue = self->connectionAsduQueue;
-                }
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(replicator->lock);
 #endif
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-                if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
-                    lowPrioQueue = MessageQueue_create(self->maxLowPrioQueueSize);
-                    highPrioQueue = HighPriorityASDUQueue_create(self->maxHighPrioQueueSize);
-                }
+        /* take all recorded operations as one batch */
+        uint8_t* batch = replicator->pendingBuffer;
+        int batchSize = replicator->pendingSize;
+
+        replicator->pendingBuffer = replicator->sendBuffer;
+        replicator->sendBuffer = batch;
+        replicator->pendingSize = 0;
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(replicator->lock);
 #endif
-                MasterConnection connection = NULL;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-                if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
+        if (batchSize > 0) {
+            if (writeReplicationData(self, socket, handleSet, batch, batchSize) == false) {
+                /* operations of the batch are lost -> resync after reconnect */
+                goto connection_lost;
+            }
+        }
+        else
+            QueueReplicator_waitForData(replicator, 100);
 
-                    char ipAddress[60];
+        continue;
 
-                    char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
+connection_lost:
+        DEBUG_PRINT("CS104 SLAVE: connection to replication standby lost\n");
 
-                    CS104_RedundancyGroup matchingGroup = getMatchingRedundancyGroup(self, ipAddrStr);
+        self->replicationConnected = false;
+        Socket_destroy(socket);
+        socket = NULL;
+    }
 
-                    if (matchingGroup != NULL) {
-                        connection = getFreeConnection(self);
+    if (socket) {
 
-                        if (connection) {
-                            if (MasterConnection_initEx(connection, newSocket, matchingGroup)) {
-                                if (matchingGroup->name) {
-                                    DEBUG_PRINT("CS104 SLAVE: Add connection to group: %s\n", matchingGroup->name);
-                                }
-                            }
-                            else {
-                                decreaseConnectionCounter(self);
-                                connection = NULL;
-                            }
-                        }
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_wait(replicator->lock);
+#endif
 
-                    }
-                    else {
-                        DEBUG_PRINT("CS104 SLAVE: Found no matching redundancy group -> close connection\n");
-                    }
+        /* send the remaining operations before closing the connection */
+        if (replicator->pendingSize > 0)
+            Socket_write(socket, replicator->pendingBuffer, replicator->pendingSize);
 
+#if (CONFIG_USE_SEMAPHORES == 1)
+        Semaphore_post(replicator->lock);
+#endif
 
-                }
-                else {
-                    connection = getFreeConnection(self);
+        Socket_destroy(socket);
+    }
 
-                    if (connection) {
-                        if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue) == false) {
-                            decreaseConnectionCounter(self);
-                            connection = NULL;
-                        }
-                    }
+    Handleset_destroy(handleSet);
 
-                }
-#else
-                connection = getFreeConnection(self);
+    self->replicationConnected = false;
 
-                if (connection) {
-                    if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue) == false) {
-                        decreaseConnectionCounter(self);
-                        connection = NULL;
-                    }
-                }
-#endif
+    return NULL;
+}
 
-                if (connection) {
+static void
+handleReplicationRecord(CS104_Slave self, int op, int queueIndex, uint64_t entryId, uint64_t expirationTime,
+        uint8_t* asdu, int asduSize)
+{
+    MessageQueue queue = getReplicatedQueue(self, queueIndex);
 
-                    connection->isRunning = true;
+    if (queue == NULL) {
+        DEBUG_PRINT("CS104 SLAVE: replication - unknown queue %i\n", queueIndex);
+        return;
+    }
 
-                    if (self->connectionEventHandler) {
-                        self->connectionEventHandler(self->connectionEventHandlerParameter, &(connection->iMasterConnection), CS104_CON_EVENT_CONNECTION_OPENED);
-                    }
-                }
-                else {
-                    Socket_destroy(newSocket);
-                    DEBUG_PRINT("CS104 SLAVE: Connection attempt failed!\n");
-                }
+    switch (op) {
 
-            }
-            else {
-                Socket_destroy(newSocket);
-            }
-        }
+    case QUEUE_REPLICATION_OP_ENQUEUE:
+        MessageQueue_addReplicatedEntry(queue, entryId, asdu, asduSize, expirationTime);
+        break;
 
-    }
+    case QUEUE_REPLICATION_OP_REPLACE:
+        MessageQueue_replaceReplicatedEntry(queue, entryId, asdu, asduSize, expirationTime);
+        break;
 
-    handleClientConnections(self);
+    case QUEUE_REPLICATION_OP_CONFIRM:
+        MessageQueue_removeConfirmedEntries(queue, entryId);
+        break;
+
+    case QUEUE_REPLICATION_OP_CLEAR:
+        MessageQueue_resetReplicatedQueue(queue, entryId);
+        break;
+
+    default:
+        DEBUG_PRINT("CS104 SLAVE: replication - unknown operation %i\n", op);
+        break;
+    }
 }
 
+/**
+ * Receive the queue operations of the primary server (standby side)
+ */
 static void*
-serverThread (void* parameter)
+replicationReceiverThread(void* parameter)
 {
     CS104_Slave self = (CS104_Slave) parameter;
 
-    if (self->localAddress)
-        self->serverSocket = TcpServerSocket_create(self->localAddress, self->tcpPort);
-    else
-        self->serverSocket = TcpServerSocket_create("0.0.0.0", self->tcpPort);
-
-    if (self->serverSocket == NULL) {
-        DEBUG_PRINT("CS104 SLAVE: Cannot create server socket\n");
-        self->isStarting = false;
-        goto exit_function;
-    }
-
-    ServerSocket_listen(self->serverSocket);
-
-    self->isRunning = true;
-    self->isStarting = false;
+    uint8_t recvBuffer[4096];
+    int recvBufPos = 0;
 
-    while (self->stopRunning == false) {
-        Socket newSocket = ServerSocket_accept(self->serverSocket);
+    Socket socket = NULL;
 
-        if (newSocket != NULL) {
+    /* the replication link is not authenticated -> only local connections unless an address is configured */
+    ServerSocket serverSocket = TcpServerSocket_create(self->replicationLocalAddress ? self->replicationLocalAddress : "127.0.0.1",
+            self->replicationLocalPort);
 
-            bool acceptConnection = true;
+    if (serverSocket == NULL) {
+        DEBUG_PRINT("CS104 SLAVE: Cannot create replication server socket\n");
+        return NULL;
+    }
 
-            /* check if maximum number of open connections is reached */
-            if (self->maxOpenConnections > 0) {
-                if (self->openConnections >= self->maxOpenConnections)
-                    acceptConnection = false;
-            }
+    ServerSocket_listen(serverSocket);
 
-            if (acceptConnection)
-                acceptConnection = callConnectionRequestHandler(self, newSocket);
+    HandleSet handleSet = Handleset_new();
 
-            if (acceptConnection) {
+    if (handleSet == NULL) {
+        DEBUG_PRINT("CS104 SLAVE: failed to start queue replication (out of memory)\n");
+        ServerSocket_destroy(serverSocket);
+        return NULL;
+    }
 
-                MessageQueue lowPrioQueue = NULL;
-                HighPriorityASDUQueue highPrioQueue = NULL;
+    while (self->replicationRunning) {
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-                if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP) {
-                    lowPrioQueue = self->asduQueue;
-                    highPrioQueue = self->connectionAsduQueue;
-                }
-#endif
+        if (socket == NULL) {
+            socket = ServerSocket_accept(serverSocket);
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-                if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
-                    lowPrioQueue = NULL;
-                    highPrioQueue = NULL;
-                }
-#endif
+            if (socket == NULL) {
+                Thread_sleep(10);
+                continue;
+            }
 
-                MasterConnection connection = NULL;
+            DEBUG_PRINT("CS104 SLAVE: replication primary connected\n");
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-                if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
+            recvBufPos = 0;
+            self->replicationConnected = true;
+        }
 
-                    char ipAddress[60];
+        Handleset_reset(handleSet);
+        Handleset_addSocket(handleSet, socket);
 
-                    char* ipAddrStr = getPeerAddress(newSocket, ipAddress);
+        if (Handleset_waitReady(handleSet, 10) < 1)
+            continue;
 
-                    CS104_RedundancyGroup matchingGroup = getMatchingRedundancyGroup(self, ipAddrStr);
+        int readBytes = Socket_read(socket, recvBuffer + recvBufPos, sizeof(recvBuffer) - recvBufPos);
 
-                    if (matchingGroup != NULL) {
-                        connection = getFreeConnection(self);
+        if (readBytes < 0) {
+            DEBUG_PRINT("CS104 SLAVE: replication primary disconnected\n");
 
-                        if (connection) {
-                            if (MasterConnection_initEx(connection, newSocket, matchingGroup)) {
-                                if (matchingGroup->name) {
-                                    DEBUG_PRINT("CS104 SLAVE: Add connection to group: %s\n", matchingGroup->name);
-                                }
-                            }
-                            else {
-                                decreaseConnectionCounter(self);
-                                connection = NULL;
-                            }
-                        }
+            self->replicationConnected = false;
+            Socket_destroy(socket);
+            socket = NULL;
+            continue;
+        }
 
-                    }
-                    else {
-                        DEBUG_PRINT("CS104 SLAVE: Found no matching redundancy group -> close connection\n");
-                    }
+        recvBufPos += readBytes;
 
+        /* handle all complete records */
+        int bufPos = 0;
 
-                }
-                else {
-                    connection = getFreeConnection(self);
+        while (recvBufPos - bufPos >= QUEUE_REPLICATION_HEADER_SIZE) {
+            uint8_t* record = recvBuffer + bufPos;
+            int asduSize = record[18];
 
-                    if (connection) {
-                        if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue) == false) {
-                            decreaseConnectionCounter(self);
-                            connection = NULL;
-                        }
-                    }
+            if (recvBufPos - bufPos < QUEUE_REPLICATION_HEADER_SIZE + asduSize)
+                break;
 
-                }
-#else
-                connection = getFreeConnection(self);
+            uint64_t entryId = 0;
+            uint64_t expirationTime = 0;
+            int i;
 
-                if (connection) {
-                    if (MasterConnection_init(connection, newSocket, lowPrioQueue, highPrioQueue) == false) {
-                        decreaseConnectionCounter(self);
-                        connection = NULL;
-                    }
-                }
-#endif
+            for (i = 0; i < 8; i++) {
+                entryId = (entryId << 8) + record[2 + i];
+                expirationTime = (expirationTime << 8) + record[10 + i];
+            }
 
-                if (connection) {
-                    /* now start the connection handling (thread) */
-                    MasterConnection_start(connection);
-                }
-                else{
-                    Socket_destroy(newSocket);
+            handleReplicationRecord(self, record[0], record[1], entryId, expirationTime,
+                    record + QUEUE_REPLICATION_HEADER_SIZE, asduSize);
 
-                    DEBUG_PRINT("CS104 SLAVE: Connection attempt failed!");
-                }
+            bufPos += QUEUE_REPLICATION_HEADER_SIZE + asduSize;
+        }
 
-            }
-            else {
-                Socket_destroy(newSocket);
-            }
+        /* keep incomplete record for next read */
+        if (bufPos > 0) {
+            memmove(recvBuffer, recvBuffer + bufPos, recvBufPos - bufPos);
+            recvBufPos -= bufPos;
         }
-        else
-            Thread_sleep(10);
     }
 
-    if (self->serverSocket)
-        Socket_destroy((Socket) self->serverSocket);
+    if (socket)
+        Socket_destroy(socket);
 
-    self->isRunning = false;
-    self->stopRunning = false;
+    Handleset_destroy(handleSet);
+    ServerSocket_destroy(serverSocket);
+
+    self->replicationConnected = false;
 
-exit_function:
     return NULL;
 }
 
-void
-CS104_Slave_enqueueASDU(CS104_Slave self, CS101_ASDU asdu)
+static void
+startQueueReplication(CS104_Slave self)
 {
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1)
-    if (self->serverMode == CS104_MODE_SINGLE_REDUNDANCY_GROUP)
-        MessageQueue_enqueueASDU(self->asduQueue, asdu);
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
+    if ((self->replicationTargetAddress == NULL) && (self->replicationListenerEnabled == false))
+        return;
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
+    if ((self->serverMode != CS104_MODE_SINGLE_REDUNDANCY_GROUP) && (self->serverMode != CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS)) {
+        DEBUG_PRINT("CS104 SLAVE: queue replication not supported in this server mode\n");
+        return;
+    }
 
-    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
+    self->replicationRunning = true;
 
-        /************************************************
-         * Dispatch event to all redundancy groups
-         ************************************************/
+    if (self->replicationTargetAddress) {
 
-        LinkedList element = LinkedList_getNext(self->redundancyGroups);
+        self->replicator = QueueReplicator_create();
 
-        while (element) {
+        if (self->replicator == NULL) {
+            self->replicationRunning = false;
+            return;
+        }
 
-            CS104_RedundancyGroup group = (CS104_RedundancyGroup) LinkedList_getData(element);
+        int indexRange = getReplicationIndexRange(self);
+        int i;
+        MessageQueue queue;
 
-            MessageQueue_enqueueASDU(group->asduQueue, asdu);
+        for (i = 0; i < indexRange; i++) {
+            if ((queue = getReplicatedQueue(self, i)) != NULL) {
+                MessageQueue_lock(queue);
 
-            element = LinkedList_getNext(element);
-        }
-    }
+                queue->replicator = self->replicator;
+                queue->replicationIndex = i;
 
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+                MessageQueue_unlock(queue);
+            }
+        }
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_CONNECTION_IS_REDUNDANCY_GROUP == 1)
-    if (self->serverMode == CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP) {
+        self->replicationThread = Thread_createEx(replicationSenderThread, (void*) self, false,
+                self->useThreadAttributes ? &(self->threadAttributes) : NULL);
+    }
+    else {
+        self->replicationThread = Thread_createEx(replicationReceiverThread, (void*) self, false,
+                self->useThreadAttributes ? &(self->threadAttributes) : NULL);
+    }
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_wait(self->openConnectionsLock);
-#endif
+    if (self->replicationThread)
+        Thread_start(self->replicationThread);
+}
 
-        /************************************************
-         * Dispatch event to all open client connections
-         ************************************************/
+static void
+stopQueueReplication(CS104_Slave self)
+{
+    if (self->replicationRunning == false)
+        return;
 
-        int i;
+    self->replicationRunning = false;
 
-        for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+    if (self->replicator)
+        QueueReplicator_wakeUp(self->replicator);
 
-            MasterConnection con = self->masterConnections[i];
+    if (self->replicationThread) {
+        Thread_destroy(self->replicationThread);
+        self->replicationThread = NULL;
+    }
 
-            if (con)
-                MessageQueue_enqueueASDU(con->lowPrioQueue, asdu);
+    if (self->replicator) {
+        int indexRange = getReplicationIndexRange(self);
+        int i;
+        MessageQueue queue;
 
+        for (i = 0; i < indexRange; i++) {
+            if ((queue = getReplicatedQueue(self, i)) != NULL) {
+                MessageQueue_lock(queue);
+                queue->replicator = NULL;
+                MessageQueue_unlock(queue);
+            }
         }
 
-#if (CONFIG_USE_SEMAPHORES == 1)
-        Semaphore_post(self->openConnectionsLock);
-#endif
+        QueueReplicator_destroy(self->replicator);
+        self->replicator = NULL;
     }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP == 1) */
 }
 
+#endif /* (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1) */
+
 void
-CS104_Slave_addRedundancyGroup(CS104_Slave self, CS104_RedundancyGroup redundancyGroup)
+CS104_Slave_setQueueReplicationTarget(CS104_Slave self, const char* address, int port)
 {
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-    if (self->serverMode == CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS) {
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    if (self->replicationTargetAddress)
+        GLOBAL_FREEMEM(self->replicationTargetAddress);
 
-        if (self->redundancyGroups == NULL)
-            self->redundancyGroups = LinkedList_create();
+    self->replicationTargetAddress = (char*) GLOBAL_MALLOC(strlen(address) + 1);
 
-        LinkedList_add(self->redundancyGroups, redundancyGroup);
-    }
+    if (self->replicationTargetAddress)
+        strcpy(self->replicationTargetAddress, address);
 
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
+    self->replicationTargetPort = port;
+#else
+    DEBUG_PRINT("CS104 SLAVE: queue replication not supported (CONFIG_CS104_SLAVE_QUEUE_REPLICATION = 0)\n");
+#endif
 }
 
-#if (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1)
-static void
-initializeRedundancyGroups(CS104_Slave self, int lowPrioMaxQueueSize, int highPrioMaxQueueSize)
+void
+CS104_Slave_setQueueReplicationListener(CS104_Slave self, const char* localAddress, int port)
 {
-    if (self->redundancyGroups == NULL) {
-        CS104_RedundancyGroup redGroup = CS104_RedundancyGroup_create(NULL);
-        CS104_Slave_addRedundancyGroup(self, redGroup);
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    if (self->replicationLocalAddress) {
+        GLOBAL_FREEMEM(self->replicationLocalAddress);
+        self->replicationLocalAddress = NULL;
     }
 
-    LinkedList element = LinkedList_getNext(self->redundancyGroups);
-
-    while (element) {
+    if (localAddress) {
+        self->replicationLocalAddress = (char*) GLOBAL_MALLOC(strlen(localAddress) + 1);
 
-        CS104_RedundancyGroup redGroup = (CS104_RedundancyGroup) LinkedList_getData(element);
+        if (self->replicationLocalAddress)
+            strcpy(self->replicationLocalAddress, localAddress);
+    }
 
-        if (redGroup->asduQueue == NULL)
-            CS104_RedundancyGroup_initializeMessageQueues(redGroup, lowPrioMaxQueueSize, highPrioMaxQueueSize);
+    self->replicationLocalPort = port;
+    self->replicationListenerEnabled = true;
+#else
+    DEBUG_PRINT("CS104 SLAVE: queue replication not supported (CONFIG_CS104_SLAVE_QUEUE_REPLICATION = 0)\n");
+#endif
+}
 
-        element = LinkedList_getNext(element);
-    }
+bool
+CS104_Slave_isQueueReplicationConnected(CS104_Slave self)
+{
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    return self->replicationConnected;
+#else
+    return false;
+#endif
 }
-#endif /* (CONFIG_CS104_SUPPORT_SERVER_MODE_MULTIPLE_REDUNDANCY_GROUPS == 1) */
 
 void
 CS104_Slave_start(CS104_Slave self)
@@ -3519,12 +6815,18 @@ CS104_Slave_start(CS104_Slave self)
             initializeConnectionSpecificQueues(self);
 #endif
 
-        self->listeningThread = Thread_create(serverThread, (void*) self, false);
+        self->listeningThread = Thread_createEx(serverThread, (void*) self, false,
+                self->useThreadAttributes ? &(self->threadAttributes) : NULL);
 
         Thread_start(self->listeningThread);
 
         while (self->isStarting)
             Thread_sleep(1);
+
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+        if (self->isRunning)
+            startQueueReplication(self);
+#endif
     }
 #else
     DEBUG_PRINT("CS104 SLAVE: ERROR: CS104_Slave_start not supported when CONFIG_USE_TREADS = 0 or CONFIG_USE_SEMAPHORES = 0!\n");
@@ -3590,6 +6892,7 @@ CS104_Slave_startThreadless(CS104_Slave self)
             goto exit_function;
         }
 
+        ServerSocket_setBacklog(self->serverSocket, CONFIG_CS104_SLAVE_LISTEN_BACKLOG);
         ServerSocket_listen(self->serverSocket);
 
         self->isRunning = true;
@@ -3618,6 +6921,170 @@ CS104_Slave_tick(CS104_Slave self)
     handleConnectionsThreadless(self);
 }
 
+int
+CS104_Slave_getPollDescriptors(CS104_Slave self, CS104_SlavePollDescriptor* descriptors, int maxDescriptors)
+{
+    int count = 0;
+
+    if (self->isRunning == false)
+        return 0;
+
+    /* the server socket is only reported when new connections can be accepted */
+    if (self->serverSocket && isAcceptingConnections(self)) {
+        if (count < maxDescriptors) {
+            descriptors[count].fd = Socket_getFileDescriptor((Socket) self->serverSocket);
+            descriptors[count].events = CS104_SLAVE_POLL_READ;
+        }
+
+        count++;
+    }
+
+    int i;
+
+    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+        MasterConnection con = self->masterConnections[i];
+
+        if (con && con->isUsed && con->isRunning) {
+            if (count < maxDescriptors) {
+                descriptors[count].fd = Socket_getFileDescriptor(con->socket);
+                descriptors[count].events = CS104_SLAVE_POLL_READ;
+
+                if (MasterConnection_isOutputPending(con))
+                    descriptors[count].events |= CS104_SLAVE_POLL_WRITE;
+            }
+
+            count++;
+
+            int wakeUpFd = Handleset_getWakeUpDescriptor(con->handleSet);
+
+            if (wakeUpFd != -1) {
+                if (count < maxDescriptors) {
+                    descriptors[count].fd = wakeUpFd;
+                    descriptors[count].events = CS104_SLAVE_POLL_READ;
+                }
+
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+int
+CS104_Slave_getNextTimeout(CS104_Slave self)
+{
+    if (self->isRunning == false)
+        return -1;
+
+    uint64_t currentTime = Hal_getTimeInMs();
+    uint64_t nextDeadline = UINT64_MAX;
+
+    int i;
+
+    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+        MasterConnection con = self->masterConnections[i];
+
+        if (con && con->isUsed)
+            updateNextDeadline(&nextDeadline, MasterConnection_getNextDeadline(con, currentTime));
+    }
+
+    /* plugins expect to be called periodically */
+    if (self->plugins && (self->openConnections > 0))
+        updateNextDeadline(&nextDeadline, currentTime + CS104_SLAVE_PLUGIN_TASK_INTERVAL);
+
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    updateNextDeadline(&nextDeadline, getNextPeriodicCycleTime(self));
+#endif
+
+    if (nextDeadline == UINT64_MAX)
+        return -1;
+
+    if (nextDeadline <= currentTime)
+        return 0;
+
+    if ((nextDeadline - currentTime) > INT32_MAX)
+        return INT32_MAX;
+
+    return (int) (nextDeadline - currentTime);
+}
+
+void
+CS104_Slave_handleReadable(CS104_Slave self, int fd)
+{
+    if (self->isRunning == false)
+        return;
+
+    if (self->serverSocket && (fd == Socket_getFileDescriptor((Socket) self->serverSocket))) {
+        acceptConnectionThreadless(self);
+        return;
+    }
+
+    int i;
+
+    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+        MasterConnection con = self->masterConnections[i];
+
+        if (con && con->isUsed && con->isRunning) {
+
+            if (fd == Socket_getFileDescriptor(con->socket)) {
+
+                /* handle all complete messages that are available */
+                while (con->isRunning && (MasterConnection_handleTcpConnection(con) > 0));
+
+                break;
+            }
+
+            if (fd == Handleset_getWakeUpDescriptor(con->handleSet)) {
+
+                /* reset the wake-up and send the responses queued by other threads */
+                Handleset_reset(con->handleSet);
+                Handleset_waitReady(con->handleSet, 0);
+
+                MasterConnection_executePeriodicTasks(con);
+
+                break;
+            }
+        }
+    }
+}
+
+void
+CS104_Slave_handleWritable(CS104_Slave self, int fd)
+{
+    if (self->isRunning == false)
+        return;
+
+    int i;
+
+    for (i = 0; i < CONFIG_CS104_MAX_CLIENT_CONNECTIONS; i++) {
+        MasterConnection con = self->masterConnections[i];
+
+        if (con && con->isUsed && con->isRunning && (fd == Socket_getFileDescriptor(con->socket))) {
+
+            if (MasterConnection_flushOutputBuffer(con) == false)
+                con->isRunning = false;
+
+            break;
+        }
+    }
+}
+
+void
+CS104_Slave_handleTimers(CS104_Slave self)
+{
+    if (self->isRunning == false)
+        return;
+
+    removeClosedConnections(self);
+
+    executePeriodicTasks(self);
+
+#if (CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS > 0)
+    runPeriodicGroups(self, Hal_getTimeInMs());
+#endif
+}
+
 
 bool
 CS104_Slave_isRunning(CS104_Slave self)
@@ -3635,6 +7102,10 @@ CS104_Slave_stop(CS104_Slave self)
 #if (CONFIG_USE_THREADS == 1)
     }
     else {
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+        stopQueueReplication(self);
+#endif
+
         if (self->isRunning) {
             self->stopRunning = true;
 
@@ -3670,6 +7141,14 @@ CS104_Slave_destroy(CS104_Slave self)
         if (self->localAddress != NULL)
             GLOBAL_FREEMEM(self->localAddress);
 
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+        if (self->replicationTargetAddress != NULL)
+            GLOBAL_FREEMEM(self->replicationTargetAddress);
+
+        if (self->replicationLocalAddress != NULL)
+            GLOBAL_FREEMEM(self->replicationLocalAddress);
+#endif
+
         /*
          * Stop all connections
          * */
@@ -3731,9 +7210,15 @@ CS104_Slave_destroy(CS104_Slave self)
             }
         }
 
-        if (self->plugins) {
-            LinkedList_destroyStatic(self->plugins);
-        }
+        destroyPlugins(self);
+
+#if (CONFIG_CS104_SLAVE_EVENT_CLASSES > 1)
+        if (self->eventClassMappings)
+            LinkedList_destroy(self->eventClassMappings);
+#endif
+
+        if (self->timeToLiveMappings)
+            LinkedList_destroy(self->timeToLiveMappings);
 
         GLOBAL_FREEMEM(self);
     }
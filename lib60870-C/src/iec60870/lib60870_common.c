@@ -21,6 +21,7 @@
 
 #include "iec60870_common.h"
 #include "lib60870_internal.h"
+#include "lib_memory.h"
 
 #include <stdio.h>
 #include <stdarg.h>
@@ -0,0 +1,344 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#include <string.h>
+
+#include "iec60870_common.h"
+#include "lib60870_internal.h"
+#include "lib_memory.h"
+#include "hal_time.h"
+#include "hal_thread.h"
+
+#if (CONFIG_LIB60870_TRACING == 1)
+
+/*
+ * The ring buffer can be written by many threads (connection threads, application threads that
+ * enqueue events) without locking. Each writer reserves a slot by incrementing the write index. The
+ * sequence number of a slot is set after the event has been written so that the reader can detect
+ * slots that are incomplete or have been overwritten.
+ *
+ * Writers announce themselves in traceActiveWriters before they load the buffer pointer. A buffer that
+ * has been replaced by Lib60870_startTracing is released when no writer is active anymore.
+ */
+#if defined(__GNUC__)
+#define TRACE_FETCH_AND_INCREMENT(ptr) __atomic_fetch_add((ptr), 1, __ATOMIC_RELAXED)
+#define TRACE_STORE_RELEASE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define TRACE_LOAD_ACQUIRE(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define TRACE_ENTER_WRITER() __atomic_fetch_add(&traceActiveWriters, 1, __ATOMIC_SEQ_CST)
+#define TRACE_LEAVE_WRITER() __atomic_fetch_sub(&traceActiveWriters, 1, __ATOMIC_RELEASE)
+#define TRACE_LOAD_BUFFER() __atomic_load_n(&traceBuffer, __ATOMIC_SEQ_CST)
+#define TRACE_SWAP_BUFFER(newBuffer) __atomic_exchange_n(&traceBuffer, (newBuffer), __ATOMIC_SEQ_CST)
+#define TRACE_HAS_ACTIVE_WRITERS() (__atomic_load_n(&traceActiveWriters, __ATOMIC_SEQ_CST) != 0)
+#else
+/* no atomic operations available -> protect the write index and the buffer with a semaphore */
+#define TRACE_USE_LOCK 1
+#define TRACE_STORE_RELEASE(ptr, value) (*(ptr) = (value))
+#define TRACE_LOAD_ACQUIRE(ptr) (*(ptr))
+#define TRACE_ENTER_WRITER() Semaphore writerLock = traceLock_wait()
+#define TRACE_LEAVE_WRITER() traceLock_post(writerLock)
+#define TRACE_LOAD_BUFFER() (traceBuffer)
+#define TRACE_HAS_ACTIVE_WRITERS() (false)
+#endif
+
+struct sTraceSlot {
+    volatile uint32_t sequence; /* index of the event + 1 (0 = slot is being written) */
+    Lib60870TraceEvent event;
+};
+
+struct sTraceBuffer {
+    uint32_t mask; /* number of slots - 1 */
+    struct sTraceSlot slots[];
+};
+
+volatile bool lib60870_traceEnabled = false;
+
+static struct sTraceBuffer* traceBuffer = NULL;
+static volatile uint32_t traceWriteIndex = 0;
+static uint32_t traceReadIndex = 0;
+static uint32_t lostTraceEvents = 0;
+
+#if !defined(TRACE_USE_LOCK)
+static uint32_t traceActiveWriters = 0;
+#endif
+
+static Lib60870_TraceHandler traceHandler = NULL;
+static void* traceHandlerParameter = NULL;
+
+static volatile uint32_t nextConnectionId = 0;
+
+#if defined(TRACE_USE_LOCK)
+
+#if (CONFIG_USE_SEMAPHORES == 1)
+static Semaphore traceLock = NULL;
+#endif
+
+/* the lock is created by the first call of Lib60870_startTracing -> returns the lock to be released */
+static Semaphore
+traceLock_wait(void)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    Semaphore lock = traceLock;
+
+    if (lock)
+        Semaphore_wait(lock);
+
+    return lock;
+#else
+    return NULL;
+#endif
+}
+
+static void
+traceLock_post(Semaphore lock)
+{
+#if (CONFIG_USE_SEMAPHORES == 1)
+    if (lock)
+        Semaphore_post(lock);
+#else
+    UNUSED_PARAMETER(lock);
+#endif
+}
+
+#endif /* defined(TRACE_USE_LOCK) */
+
+/* has to be called between TRACE_ENTER_WRITER and TRACE_LEAVE_WRITER when TRACE_USE_LOCK is defined */
+static uint32_t
+reserveSlot(volatile uint32_t* index)
+{
+#if defined(TRACE_USE_LOCK)
+    uint32_t value = *index;
+
+    *index = value + 1;
+
+    return value;
+#else
+    return TRACE_FETCH_AND_INCREMENT(index);
+#endif
+}
+
+void
+lib60870_trace(int tracePoint, uint32_t connectionId, uint32_t arg1, uint32_t arg2)
+{
+    Lib60870TraceEvent event;
+
+    event.timestamp = Hal_getMonotonicTimeInNs();
+    event.connectionId = connectionId;
+    event.arg1 = arg1;
+    event.arg2 = arg2;
+    event.tracePoint = (uint32_t) tracePoint;
+
+    Lib60870_TraceHandler handler = traceHandler;
+
+    if (handler) {
+        handler(traceHandlerParameter, &event);
+    }
+    else {
+        TRACE_ENTER_WRITER();
+
+        struct sTraceBuffer* buffer = TRACE_LOAD_BUFFER();
+
+        if (buffer) {
+            uint32_t index = reserveSlot(&traceWriteIndex);
+
+            struct sTraceSlot* slot = &(buffer->slots[index & buffer->mask]);
+
+            TRACE_STORE_RELEASE(&(slot->sequence), 0);
+
+            slot->event = event;
+
+            TRACE_STORE_RELEASE(&(slot->sequence), index + 1);
+        }
+
+        TRACE_LEAVE_WRITER();
+    }
+}
+
+uint32_t
+lib60870_trace_newConnectionId(void)
+{
+    uint32_t id;
+
+#if defined(TRACE_USE_LOCK)
+    Semaphore lock = traceLock_wait();
+#endif
+
+    id = reserveSlot(&nextConnectionId) + 1;
+
+    /* 0 is reserved for events not related to a connection */
+    if (id == 0)
+        id = reserveSlot(&nextConnectionId) + 1;
+
+#if defined(TRACE_USE_LOCK)
+    traceLock_post(lock);
+#endif
+
+    return id;
+}
+
+#endif /* (CONFIG_LIB60870_TRACING == 1) */
+
+bool
+Lib60870_startTracing(int bufferSize)
+{
+#if (CONFIG_LIB60870_TRACING == 1)
+    uint32_t size = 1;
+
+    if (bufferSize < 1)
+        return false;
+
+    while ((size < (uint32_t) bufferSize) && (size < 0x80000000))
+        size = size << 1;
+
+#if (defined(TRACE_USE_LOCK) && (CONFIG_USE_SEMAPHORES == 1))
+    if (traceLock == NULL)
+        traceLock = Semaphore_create(1);
+#endif
+
+    if ((traceBuffer == NULL) || ((traceBuffer->mask + 1) != size)) {
+
+        struct sTraceBuffer* newBuffer = (struct sTraceBuffer*) GLOBAL_CALLOC(1,
+                sizeof(struct sTraceBuffer) + (size * sizeof(struct sTraceSlot)));
+
+        if (newBuffer == NULL)
+            return false;
+
+        newBuffer->mask = size - 1;
+
+        /* trace points must not use the old buffer */
+        lib60870_traceEnabled = false;
+
+#if defined(TRACE_USE_LOCK)
+        Semaphore lock = traceLock_wait();
+
+        struct sTraceBuffer* oldBuffer = traceBuffer;
+        traceBuffer = newBuffer;
+
+        traceLock_post(lock);
+#else
+        struct sTraceBuffer* oldBuffer = TRACE_SWAP_BUFFER(newBuffer);
+#endif
+
+        /* a writer that loaded the old buffer pointer is still active -> wait until it is finished */
+        if (oldBuffer) {
+            while (TRACE_HAS_ACTIVE_WRITERS())
+                Thread_sleep(0);
+
+            GLOBAL_FREEMEM(oldBuffer);
+        }
+    }
+
+    traceReadIndex = TRACE_LOAD_ACQUIRE(&traceWriteIndex);
+    lostTraceEvents = 0;
+
+    lib60870_traceEnabled = true;
+
+    return true;
+#else
+    UNUSED_PARAMETER(bufferSize);
+
+    return false;
+#endif
+}
+
+void
+Lib60870_setTraceHandler(Lib60870_TraceHandler handler, void* parameter)
+{
+#if (CONFIG_LIB60870_TRACING == 1)
+    traceHandler = NULL;
+    traceHandlerParameter = parameter;
+    traceHandler = handler;
+
+    if (handler)
+        lib60870_traceEnabled = true;
+    else if (traceBuffer == NULL)
+        lib60870_traceEnabled = false;
+#else
+    UNUSED_PARAMETER(handler);
+    UNUSED_PARAMETER(parameter);
+#endif
+}
+
+void
+Lib60870_stopTracing(void)
+{
+#if (CONFIG_LIB60870_TRACING == 1)
+    lib60870_traceEnabled = false;
+#endif
+}
+
+int
+Lib60870_readTraceEvents(Lib60870TraceEvent* events, int maxEvents)
+{
+    int count = 0;
+
+#if (CONFIG_LIB60870_TRACING == 1)
+    struct sTraceBuffer* buffer = traceBuffer;
+
+    if (buffer == NULL)
+        return 0;
+
+    while (count < maxEvents) {
+
+        struct sTraceSlot* slot = &(buffer->slots[traceReadIndex & buffer->mask]);
+
+        uint32_t sequence = TRACE_LOAD_ACQUIRE(&(slot->sequence));
+
+        if (sequence == traceReadIndex + 1) {
+            events[count] = slot->event;
+
+            /* check if the slot has been overwritten while reading */
+            if (TRACE_LOAD_ACQUIRE(&(slot->sequence)) != sequence)
+                continue;
+
+            count++;
+            traceReadIndex++;
+        }
+        else {
+            uint32_t writeIndex = TRACE_LOAD_ACQUIRE(&traceWriteIndex);
+
+            if ((writeIndex - traceReadIndex) > (buffer->mask + 1)) {
+                /* reader was too slow -> skip the overwritten events */
+                uint32_t newReadIndex = writeIndex - (buffer->mask + 1);
+
+                lostTraceEvents += (newReadIndex - traceReadIndex);
+                traceReadIndex = newReadIndex;
+            }
+            else
+                break; /* no more events or event is not complete */
+        }
+    }
+#else
+    UNUSED_PARAMETER(events);
+    UNUSED_PARAMETER(maxEvents);
+#endif
+
+    return count;
+}
+
+uint32_t
+Lib60870_getNumberOfLostTraceEvents(void)
+{
+#if (CONFIG_LIB60870_TRACING == 1)
+    return lostTraceEvents;
+#else
+    return 0;
+#endif
+}
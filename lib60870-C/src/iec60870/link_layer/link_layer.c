@@ -1049,7 +1049,7 @@ LinkLayerPrimaryBalanced_handleMessage(LinkLayerPrimaryBalanced self, uint8_t fc
 
             SendFixedFrame(self->linkLayer, LL_FC_00_RESET_REMOTE_LINK, self->otherStationAddress, true, self->linkLayer->dir, false, false);
 
-            self->lastSendTime = Hal_getTimeInMs();
+            self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->linkLayer->transceiver);
             self->waitingForResponse = true;
             newState = PLL_EXECUTE_RESET_REMOTE_LINK;
             llpb_setNewState(self, LL_STATE_BUSY);
@@ -1113,7 +1113,7 @@ LinkLayerPrimaryBalanced_runStateMachine(LinkLayerPrimaryBalanced self)
 
         if (self->waitingForResponse) {
 
-            if (self->lastSendTime > currentTime) {
+            if (self->lastSendTime > SerialTransceiverFT12_getTransmitEndTime(self->linkLayer->transceiver)) {
                 /* last sent time not plausible! */
                 self->lastSendTime = currentTime;
             }
@@ -1122,7 +1122,7 @@ LinkLayerPrimaryBalanced_runStateMachine(LinkLayerPrimaryBalanced self)
 
                 SendFixedFrame(self->linkLayer, LL_FC_09_REQUEST_LINK_STATUS, self->otherStationAddress, true, self->linkLayer->dir, false, false);
 
-                self->lastSendTime = currentTime;
+                self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->linkLayer->transceiver);
             }
 
         }
@@ -1131,7 +1131,7 @@ LinkLayerPrimaryBalanced_runStateMachine(LinkLayerPrimaryBalanced self)
 
             SendFixedFrame(self->linkLayer, LL_FC_00_RESET_REMOTE_LINK, self->otherStationAddress, true, self->linkLayer->dir, false, false);
 
-            self->lastSendTime = currentTime;
+            self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->linkLayer->transceiver);
             self->waitingForResponse = true;
             newState = PLL_EXECUTE_RESET_REMOTE_LINK;
         }
@@ -1172,7 +1172,7 @@ LinkLayerPrimaryBalanced_runStateMachine(LinkLayerPrimaryBalanced self)
             SendFixedFrame(self->linkLayer, LL_FC_02_TEST_FUNCTION_FOR_LINK, self->otherStationAddress, true, self->linkLayer->dir, self->nextFcb, true);
 
             self->nextFcb = !(self->nextFcb);
-            self->lastSendTime = currentTime;
+            self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->linkLayer->transceiver);
             self->originalSendTime = self->lastSendTime;
             newState = PLL_EXECUTE_SERVICE_SEND_CONFIRM;
         }
@@ -1190,7 +1190,7 @@ LinkLayerPrimaryBalanced_runStateMachine(LinkLayerPrimaryBalanced self)
                 SendVariableLengthFrame(self->linkLayer, LL_FC_03_USER_DATA_CONFIRMED, self->otherStationAddress, true, self->linkLayer->dir, self->nextFcb, true, asdu);
 
                 self->nextFcb = !(self->nextFcb);
-                self->lastSendTime = currentTime;
+                self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->linkLayer->transceiver);
                 self->originalSendTime = self->lastSendTime;
                 self->waitingForResponse = true;
 
@@ -1225,7 +1225,7 @@ LinkLayerPrimaryBalanced_runStateMachine(LinkLayerPrimaryBalanced self)
                     SendVariableLengthFrame(self->linkLayer, LL_FC_03_USER_DATA_CONFIRMED, self->otherStationAddress, true, self->linkLayer->dir, !(self->nextFcb), true, (Frame) &(self->lastSendAsdu));
                 }
 
-                self->lastSendTime = currentTime;
+                self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->linkLayer->transceiver);
             }
 
         }
@@ -1345,7 +1345,9 @@ LinkLayerBalanced_run(LinkLayerBalanced self)
 
     SerialTransceiverFT12_readNextMessage(ll->transceiver, ll->buffer, HandleMessageBalancedAndPrimaryUnbalanced, (void*) ll);
 
-    LinkLayerPrimaryBalanced_runStateMachine(&(self->primaryLinkLayer));
+    /* don't send the next frame before the line is idle (the state machine runs again with the next call) */
+    if (SerialTransceiverFT12_isReadyToSend(ll->transceiver))
+        LinkLayerPrimaryBalanced_runStateMachine(&(self->primaryLinkLayer));
 }
 
 /******************************************************
@@ -1611,7 +1613,7 @@ LinkLayerSlaveConnection_HandleMessage(LinkLayerSlaveConnection self, uint8_t fc
 
             SendFixedFrame(self->primaryLink->linkLayer, LL_FC_00_RESET_REMOTE_LINK, self->address, true, false, false, false);
 
-            self->lastSendTime = Hal_getTimeInMs();
+            self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->primaryLink->linkLayer->transceiver);
             self->waitingForResponse = true;
             newState = PLL_EXECUTE_RESET_REMOTE_LINK;
 
@@ -1744,7 +1746,7 @@ LinkLayerSlaveConnection_runStateMachine(LinkLayerSlaveConnection self)
 
                 SendFixedFrame(self->primaryLink->linkLayer, LL_FC_09_REQUEST_LINK_STATUS, self->address, true, false, false, false);
 
-                self->lastSendTime = currentTime;
+                self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->primaryLink->linkLayer->transceiver);
             }
 
         }
@@ -1753,7 +1755,7 @@ LinkLayerSlaveConnection_runStateMachine(LinkLayerSlaveConnection self)
 
             SendFixedFrame(self->primaryLink->linkLayer, LL_FC_00_RESET_REMOTE_LINK, self->address, true, false, false, false);
 
-            self->lastSendTime = currentTime;
+            self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->primaryLink->linkLayer->transceiver);
             self->waitingForResponse = true;
             self->nextFcb = true;
             newState = PLL_EXECUTE_RESET_REMOTE_LINK;
@@ -1787,8 +1789,8 @@ LinkLayerSlaveConnection_runStateMachine(LinkLayerSlaveConnection self)
             SendFixedFrame(self->primaryLink->linkLayer, LL_FC_02_TEST_FUNCTION_FOR_LINK, self->address, true, false, self->nextFcb, true);
 
             self->nextFcb = !(self->nextFcb);
-            self->lastSendTime = currentTime;
-            self->originalSendTime = currentTime;
+            self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->primaryLink->linkLayer->transceiver);
+            self->originalSendTime = self->lastSendTime;
             self->waitingForResponse = true;
 
             newState = PLL_EXECUTE_SERVICE_REQUEST_RESPOND;
@@ -1800,8 +1802,8 @@ LinkLayerSlaveConnection_runStateMachine(LinkLayerSlaveConnection self)
             SendVariableLengthFrame(self->primaryLink->linkLayer, LL_FC_03_USER_DATA_CONFIRMED, self->address, true, false, self->nextFcb, true, (Frame) &(self->nextMessage));
 
             self->nextFcb = !(self->nextFcb);
-            self->lastSendTime = currentTime;
-            self->originalSendTime = currentTime;
+            self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->primaryLink->linkLayer->transceiver);
+            self->originalSendTime = self->lastSendTime;
             self->waitingForResponse = true;
 
             newState = PLL_EXECUTE_SERVICE_SEND_CONFIRM;
@@ -1824,8 +1826,8 @@ LinkLayerSlaveConnection_runStateMachine(LinkLayerSlaveConnection self)
             }
 
             self->nextFcb = !(self->nextFcb);
-            self->lastSendTime = currentTime;
-            self->originalSendTime = currentTime;
+            self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->primaryLink->linkLayer->transceiver);
+            self->originalSendTime = self->lastSendTime;
             self->waitingForResponse = true;
             newState = PLL_EXECUTE_SERVICE_REQUEST_RESPOND;
         }
@@ -1860,7 +1862,7 @@ LinkLayerSlaveConnection_runStateMachine(LinkLayerSlaveConnection self)
 
                 }
 
-                self->lastSendTime = currentTime;
+                self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->primaryLink->linkLayer->transceiver);
             }
 
         }
@@ -1894,7 +1896,7 @@ LinkLayerSlaveConnection_runStateMachine(LinkLayerSlaveConnection self)
                     SendFixedFrame(self->primaryLink->linkLayer, LL_FC_11_REQUEST_USER_DATA_CLASS_2, self->address, true, false, !(self->nextFcb), true);
                 }
 
-                self->lastSendTime = currentTime;
+                self->lastSendTime = SerialTransceiverFT12_getTransmitEndTime(self->primaryLink->linkLayer->transceiver);
             }
 
         }
@@ -2109,5 +2111,7 @@ LinkLayerPrimaryUnbalanced_run(LinkLayerPrimaryUnbalanced self)
 
     SerialTransceiverFT12_readNextMessage(ll->transceiver, ll->buffer, HandleMessageBalancedAndPrimaryUnbalanced, (void*) ll);
 
-    LinkLayerPrimaryUnbalanced_runStateMachine(self);
+    /* don't send the next frame before the line is idle (the state machine runs again with the next call) */
+    if (SerialTransceiverFT12_isReadyToSend(ll->transceiver))
+        LinkLayerPrimaryUnbalanced_runStateMachine(self);
 }
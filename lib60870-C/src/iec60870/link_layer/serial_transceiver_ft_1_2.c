@@ -22,6 +22,7 @@
  */
 
 #include "hal_serial.h"
+#include "hal_time.h"
 #include "serial_transceiver_ft_1_2.h"
 #include "lib_memory.h"
 #include <stdlib.h>
@@ -35,6 +36,7 @@ struct sSerialTransceiverFT12 {
     SerialPort serialPort;
     IEC60870_RawMessageHandler rawMessageHandler;
     void* rawMessageHandlerParameter;
+    uint64_t lastFrameTimestamp; /* time when the start character of the last frame was received (ns since epoch) */
 };
 
 SerialTransceiverFT12
@@ -48,6 +50,7 @@ SerialTransceiverFT12_create(SerialPort serialPort, LinkLayerParameters linkLaye
         self->linkLayerParameters = linkLayerParameters;
         self->serialPort = serialPort;
         self->rawMessageHandler = NULL;
+        self->lastFrameTimestamp = 0;
     }
 
     return self;
@@ -89,6 +92,18 @@ SerialTransceiverFT12_sendMessage(SerialTransceiverFT12 self, uint8_t* msg, int
     SerialPort_write(self->serialPort, msg, 0, msgSize);
 }
 
+bool
+SerialTransceiverFT12_isReadyToSend(SerialTransceiverFT12 self)
+{
+    return (SerialPort_getTimeToIdle(self->serialPort) == 0);
+}
+
+uint64_t
+SerialTransceiverFT12_getTransmitEndTime(SerialTransceiverFT12 self)
+{
+    return Hal_getTimeInMs() + (uint64_t) ((SerialPort_getTimeToIdle(self->serialPort) + 999) / 1000);
+}
+
 static int
 readBytesWithTimeout(SerialTransceiverFT12 self, uint8_t* buffer, int startIndex, int count)
 {
@@ -107,6 +122,12 @@ readBytesWithTimeout(SerialTransceiverFT12 self, uint8_t* buffer, int startIndex
     return readBytes;
 }
 
+uint64_t
+SerialTransceiverFT12_getLastFrameTimestamp(SerialTransceiverFT12 self)
+{
+    return self->lastFrameTimestamp;
+}
+
 void
 SerialTransceiverFT12_readNextMessage(SerialTransceiverFT12 self, uint8_t* buffer,
         SerialTXMessageHandler messageHandler, void* parameter)
@@ -117,6 +138,8 @@ SerialTransceiverFT12_readNextMessage(SerialTransceiverFT12 self, uint8_t* buffe
 
     if (read != -1) {
 
+        self->lastFrameTimestamp = Hal_getTimeInNs();
+
         if (read == 0x68) {
 
             SerialPort_setTimeout(self->serialPort, self->characterTimeout);
@@ -0,0 +1,134 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_API_CS101_ASDU_DISPATCHER_H_
+#define SRC_INC_API_CS101_ASDU_DISPATCHER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "iec60870_common.h"
+#include "iec60870_master.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file cs101_asdu_dispatcher.h
+ * \brief Master side dispatching of received ASDUs to handlers by common address and type ID
+ */
+
+/**
+ * @addtogroup MASTER Master related functions
+ *
+ * @{
+ */
+
+/**
+ * @defgroup CS101_ASDU_DISPATCHER ASDU dispatcher (handlers per station and type ID)
+ *
+ * The dispatcher is installed as ASDU received handler of one or more connections and calls the handler
+ * that is registered for the common address (CA) and type ID of the received ASDU. The handler is found by a
+ * hash table lookup, independent of the number of registered handlers.
+ *
+ * When no handler is registered for the CA and type ID, the handler for the CA and \ref CS101_ASDU_DISPATCHER_ANY
+ * type ID is used, then the handler for \ref CS101_ASDU_DISPATCHER_ANY CA and the type ID, and finally the
+ * default handler.
+ *
+ * NOTE: The handlers have to be registered before the dispatcher receives ASDUs.
+ *
+ * @{
+ */
+
+/**
+ * \brief Wildcard for the common address or the type ID of a handler
+ */
+#define CS101_ASDU_DISPATCHER_ANY -1
+
+typedef struct sCS101_ASDUDispatcher* CS101_ASDUDispatcher;
+
+/**
+ * \brief Create a new ASDU dispatcher
+ *
+ * \param maxNumberOfHandlers maximum number of handlers that can be registered (memory: 48 bytes per handler)
+ *
+ * \return the new dispatcher instance
+ */
+CS101_ASDUDispatcher
+CS101_ASDUDispatcher_create(int maxNumberOfHandlers);
+
+/**
+ * \brief Destroy the dispatcher and release all resources
+ *
+ * NOTE: The dispatcher must not be in use by a connection.
+ */
+void
+CS101_ASDUDispatcher_destroy(CS101_ASDUDispatcher self);
+
+/**
+ * \brief Register a handler for ASDUs with the given common address and type ID
+ *
+ * An existing handler for the same common address and type ID is replaced.
+ *
+ * \param ca the common address of the station or \ref CS101_ASDU_DISPATCHER_ANY
+ * \param typeId the type ID or \ref CS101_ASDU_DISPATCHER_ANY
+ * \param handler the handler
+ * \param parameter user provided parameter that is passed to the handler
+ *
+ * \return true when the handler was registered, false when the maximum number of handlers is reached
+ */
+bool
+CS101_ASDUDispatcher_addHandler(CS101_ASDUDispatcher self, int ca, int typeId, CS101_ASDUReceivedHandler handler,
+        void* parameter);
+
+/**
+ * \brief Set the handler for ASDUs without a matching registered handler
+ *
+ * \param handler the handler or NULL to ignore these ASDUs
+ * \param parameter user provided parameter that is passed to the handler
+ */
+void
+CS101_ASDUDispatcher_setDefaultHandler(CS101_ASDUDispatcher self, CS101_ASDUReceivedHandler handler, void* parameter);
+
+/**
+ * \brief ASDU received handler to be installed at the connections
+ *
+ * Example: CS104_Connection_setASDUReceivedHandler(con, CS101_ASDUDispatcher_asduReceivedHandler, dispatcher);
+ *
+ * \param parameter the dispatcher instance
+ * \param address address of the sender (passed to the handler)
+ * \param asdu the received ASDU
+ *
+ * \return result of the called handler, or false when no handler is available
+ */
+bool
+CS101_ASDUDispatcher_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu);
+
+/*! @} */
+
+/*! @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_API_CS101_ASDU_DISPATCHER_H_ */
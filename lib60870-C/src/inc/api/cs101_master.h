@@ -30,6 +30,7 @@
 #ifndef SRC_INC_API_CS101_MASTER_H_
 #define SRC_INC_API_CS101_MASTER_H_
 
+#include "hal_thread.h"
 #include "iec60870_master.h"
 #include "link_layer_parameters.h"
 
@@ -327,6 +328,18 @@ CS101_Master_setRawMessageHandler(CS101_Master self, IEC60870_RawMessageHandler
 void
 CS101_Master_setIdleTimeout(CS101_Master self, int timeoutInMs);
 
+/**
+ * \brief Set the attributes (stack size, CPU affinity, priority, name) of the worker thread
+ *
+ * Has to be called before \ref CS101_Master_start. Not used when the master is driven by \ref CS101_Master_run.
+ *
+ * NOTE: The attributes (including the name string) are copied.
+ *
+ * \param attributes the thread attributes or NULL to use the platform defaults
+ */
+void
+CS101_Master_setThreadAttributes(CS101_Master self, ThreadAttributes attributes);
+
 /**
  * @}
  */
@@ -0,0 +1,203 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_API_CS101_POINT_CACHE_H_
+#define SRC_INC_API_CS101_POINT_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "iec60870_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file cs101_point_cache.h
+ * \brief Master side cache of the process image of the remote station(s)
+ */
+
+/**
+ * @addtogroup MASTER Master related functions
+ *
+ * @{
+ */
+
+/**
+ * @defgroup CS101_POINT_CACHE Point cache (process image of the remote station)
+ *
+ * The point cache stores the latest value of each monitoring direction information object
+ * (single/double points, step positions, bitstrings, measured values and integrated totals)
+ * identified by common address (CA) and information object address (IOA).
+ *
+ * The cache is updated by the receive thread of the connection(s) directly from the received
+ * ASDU buffers. Any number of application threads can read from the cache concurrently without
+ * blocking the writer (sequence lock per point).
+ *
+ * @{
+ */
+
+typedef struct sCS101_PointCache* CS101_PointCache;
+
+/**
+ * \brief Value of a single point stored in the point cache
+ */
+typedef struct {
+    int ca;                        /**< common address of the station */
+    int ioa;                       /**< information object address */
+    IEC60870_5_TypeID typeId;      /**< type ID of the last received update */
+    CS101_CauseOfTransmission cot; /**< COT of the last received update */
+    double value;                  /**< value (SP/DP state, step position, bitstring, measured value, counter reading) */
+    uint8_t quality;               /**< quality descriptor (or sequence/flags of integrated totals) */
+    bool hasTimestamp;             /**< the update contained a time tag */
+    uint64_t timestamp;            /**< time tag in ms (CP56Time2a: UTC timestamp, CP24Time2a: ms within the hour) */
+    uint64_t updateTime;           /**< local reception time in ms */
+    uint32_t updateCount;          /**< number of updates received for this point */
+} CS101_PointValue;
+
+/** \brief General interrogation state of a station */
+typedef enum {
+    /** no general interrogation has been observed */
+    CS101_GI_STATE_NONE = 0,
+
+    /** ACT_CON received, waiting for ACT_TERM */
+    CS101_GI_STATE_IN_PROGRESS = 1,
+
+    /** ACT_TERM received - all points of the station have been reported */
+    CS101_GI_STATE_COMPLETE = 2,
+
+    /** the general interrogation was rejected (negative ACT_CON) */
+    CS101_GI_STATE_FAILED = 3
+} CS101_GIState;
+
+/**
+ * \brief Handler that is called with a batch of changed points
+ *
+ * The handler is called by the thread that updates the cache (e.g. the connection thread) once
+ * for each received ASDU with at least one changed point.
+ *
+ * \param parameter user provided parameter
+ * \param changes array of the new values of the changed points (only valid during the call)
+ * \param numberOfChanges number of elements in the array
+ */
+typedef void (*CS101_PointCacheChangeHandler) (void* parameter, CS101_PointValue* changes, int numberOfChanges);
+
+/**
+ * \brief Create a new point cache
+ *
+ * The capacity is fixed. Points that do not fit into the cache are ignored.
+ *
+ * \param maxNumberOfPoints maximum number of points (CA/IOA combinations) that can be stored
+ *
+ * \return the new point cache instance
+ */
+CS101_PointCache
+CS101_PointCache_create(int maxNumberOfPoints);
+
+/**
+ * \brief Destroy the point cache and release all resources
+ *
+ * NOTE: The cache must not be in use by a connection.
+ */
+void
+CS101_PointCache_destroy(CS101_PointCache self);
+
+/**
+ * \brief Set a handler that is called with the changed points of each received ASDU
+ *
+ * \param handler the change handler or NULL to disable change notification
+ * \param parameter user provided parameter that is passed to the handler
+ * \param reportOnlyChanges when true only points whose value or quality changed are reported,
+ *        otherwise all updated points
+ *
+ * \return true on success, false when the change buffer cannot be allocated (no handler is installed)
+ */
+bool
+CS101_PointCache_setChangeHandler(CS101_PointCache self, CS101_PointCacheChangeHandler handler, void* parameter,
+        bool reportOnlyChanges);
+
+/**
+ * \brief Update the cache with the content of a received ASDU
+ *
+ * This function is called automatically when the cache is assigned to a connection. It
+ * can be used to feed the cache from a custom ASDU handler (e.g. for a CS101 master).
+ *
+ * NOTE: Updates are serialized. The same cache can be fed by multiple connections.
+ *
+ * \param asdu the received ASDU
+ */
+void
+CS101_PointCache_handleASDU(CS101_PointCache self, CS101_ASDU asdu);
+
+/**
+ * \brief Read the current value of a point
+ *
+ * This function can be called concurrently by many threads.
+ *
+ * \param ca common address of the station
+ * \param ioa information object address
+ * \param value the structure where the value is stored
+ *
+ * \return true when the point is in the cache, false otherwise
+ */
+bool
+CS101_PointCache_getValue(CS101_PointCache self, int ca, int ioa, CS101_PointValue* value);
+
+/**
+ * \brief Get the number of points stored in the cache
+ */
+int
+CS101_PointCache_getNumberOfPoints(CS101_PointCache self);
+
+/**
+ * \brief Get the general interrogation state of a station
+ *
+ * Only the station interrogation (QOI 20) is tracked. Group interrogations don't change the state.
+ * The state is tracked for up to CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS stations.
+ *
+ * \param ca common address of the station
+ * \param pointsReceived if not NULL the number of points received with COT INTERROGATED_BY_STATION
+ *        during the last (or running) general interrogation is stored here
+ *
+ * \return the general interrogation state
+ */
+CS101_GIState
+CS101_PointCache_getGIState(CS101_PointCache self, int ca, int* pointsReceived);
+
+/**
+ * \brief Get the number of station interrogation events that were ignored by the GI tracking
+ *
+ * The events are ignored when the GI state is already tracked for CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS
+ * other stations. A value > 0 indicates that the configured limit is too small.
+ */
+int
+CS101_PointCache_getNumberOfIgnoredGIStations(CS101_PointCache self);
+
+/*! @} */
+
+/*! @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_API_CS101_POINT_CACHE_H_ */
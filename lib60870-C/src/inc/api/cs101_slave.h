@@ -31,6 +31,7 @@
  */
 
 #include "hal_serial.h"
+#include "hal_thread.h"
 #include "iec60870_common.h"
 #include "iec60870_slave.h"
 #include "link_layer_parameters.h"
@@ -114,11 +115,26 @@ CS101_Slave_setDIR(CS101_Slave self, bool dir);
 /**
  * \brief Register a plugin instance with this slave instance
  *
+ * The plugin is called for all received ASDUs.
+ *
  * \param the plugin instance.
  */
 void
 CS101_Slave_addPlugin(CS101_Slave self, CS101_SlavePlugin plugin);
 
+/**
+ * \brief Register a plugin instance that is only called for received ASDUs of the given type ID
+ *
+ * The plugin is found by a table lookup. Plugins registered for the type ID are called before the
+ * plugins registered with \ref CS101_Slave_addPlugin. The function can be called multiple times to register
+ * the plugin for multiple type IDs. The task of the plugin is called once.
+ *
+ * \param plugin the plugin instance.
+ * \param typeId the type ID of the ASDUs handled by the plugin
+ */
+void
+CS101_Slave_addPluginForTypeID(CS101_Slave self, CS101_SlavePlugin plugin, IEC60870_5_TypeID typeId);
+
 /**
  * \brief Set the idle timeout
  *
@@ -130,6 +146,18 @@ CS101_Slave_addPlugin(CS101_Slave self, CS101_SlavePlugin plugin);
 void
 CS101_Slave_setIdleTimeout(CS101_Slave self, int timeoutInMs);
 
+/**
+ * \brief Set the attributes (stack size, CPU affinity, priority, name) of the worker thread
+ *
+ * Has to be called before \ref CS101_Slave_start. Not used when the slave is driven by \ref CS101_Slave_run.
+ *
+ * NOTE: The attributes (including the name string) are copied.
+ *
+ * \param attributes the thread attributes or NULL to use the platform defaults
+ */
+void
+CS101_Slave_setThreadAttributes(CS101_Slave self, ThreadAttributes attributes);
+
 /**
  * \brief Set a callback handler for link layer state changes
  */
@@ -174,6 +202,18 @@ CS101_Slave_isClass1QueueFull(CS101_Slave self);
 void
 CS101_Slave_enqueueUserDataClass1(CS101_Slave self, CS101_ASDU asdu);
 
+/**
+ * \brief Enqueue multiple ASDUs into the class 1 data queue
+ *
+ * The queue is locked only once for all ASDUs.
+ *
+ * \param self CS101_Slave instance
+ * \param asdus array of the ASDU instances to enqueue
+ * \param count number of ASDUs in the array
+ */
+void
+CS101_Slave_enqueueUserDataClass1ASDUs(CS101_Slave self, CS101_ASDU* asdus, int count);
+
 /**
  * \brief Check if the class 2 ASDU is full
  *
@@ -193,6 +233,47 @@ CS101_Slave_isClass2QueueFull(CS101_Slave self);
 void
 CS101_Slave_enqueueUserDataClass2(CS101_Slave self, CS101_ASDU asdu);
 
+/**
+ * \brief Enqueue multiple ASDUs into the class 2 data queue
+ *
+ * The queue is locked only once for all ASDUs.
+ *
+ * \param self CS101_Slave instance
+ * \param asdus array of the ASDU instances to enqueue
+ * \param count number of ASDUs in the array
+ */
+void
+CS101_Slave_enqueueUserDataClass2ASDUs(CS101_Slave self, CS101_ASDU* asdus, int count);
+
+/**
+ * \brief Callback handler to create class 2 data when the master requests class 2 data
+ *
+ * The ASDU is initialized with COT = periodic, the originator address of the application layer
+ * parameters, CA = 0, and without information objects. The handler sets the CA and adds the
+ * information objects (with the current values). The type ID is set by the first information object.
+ *
+ * \param parameter user provided parameter
+ * \param asdu the ASDU to fill
+ *
+ * \return true when the ASDU has to be sent, false when no class 2 data is available
+ */
+typedef bool (*CS101_Class2DataProvider) (void* parameter, CS101_ASDU asdu);
+
+/**
+ * \brief Set a provider for class 2 data (e.g. cyclic data)
+ *
+ * The provider is called when the master requests class 2 data and the class 2 data queue is empty.
+ * This way cyclic data is only created when it is requested and always contains the current values.
+ *
+ * NOTE: Only used in unbalanced mode. The provider is called by the thread that runs the link layer.
+ *
+ * \param self CS101_Slave instance
+ * \param provider the provider function or NULL to remove the provider
+ * \param parameter user provided parameter to be passed to the provider
+ */
+void
+CS101_Slave_setClass2DataProvider(CS101_Slave self, CS101_Class2DataProvider provider, void* parameter);
+
 /**
  * \brief Remove all ASDUs from the class 1/2 data queues
  *
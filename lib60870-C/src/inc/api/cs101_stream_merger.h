@@ -0,0 +1,136 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_API_CS101_STREAM_MERGER_H_
+#define SRC_INC_API_CS101_STREAM_MERGER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "iec60870_common.h"
+#include "iec60870_master.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file cs101_stream_merger.h
+ * \brief Master side merge of redundant data streams with duplicate suppression
+ */
+
+/**
+ * @addtogroup MASTER Master related functions
+ *
+ * @{
+ */
+
+/**
+ * @defgroup CS101_STREAM_MERGER Stream merger (duplicate suppression for redundant connections)
+ *
+ * The stream merger is used when the same events are received over multiple connections (e.g. from
+ * both stations of a redundant pair or over both channels of one station). It is installed as ASDU received
+ * handler of all connections and forwards a single stream to the application handler.
+ *
+ * Monitoring direction information objects (type IDs 1 - 44) are identified by CA, IOA, type ID, and
+ * the encoded value (including quality and time tag). An ASDU is forwarded when it contains at least one
+ * information object that has not been received within the duplicate window. Otherwise it is suppressed.
+ * All other ASDUs (e.g. command confirmations) are always forwarded.
+ *
+ * The application handler is never called concurrently. ASDUs are forwarded in the order of their arrival.
+ *
+ * @{
+ */
+
+typedef struct sCS101_StreamMerger* CS101_StreamMerger;
+
+/**
+ * \brief Counters of the stream merger
+ */
+typedef struct {
+    uint64_t receivedASDUs;   /**< ASDUs received from all connections */
+    uint64_t forwardedASDUs;  /**< ASDUs passed to the application handler */
+    uint64_t suppressedASDUs; /**< ASDUs dropped because all information objects were duplicates */
+} CS101_StreamMergerStatistics;
+
+/**
+ * \brief Create a new stream merger
+ *
+ * A received information object is recognized as duplicate when the same information object was received
+ * within the last windowTimeInMs milliseconds (at least) and not more than maxWindowSize other information
+ * objects have been received in the meantime.
+ *
+ * \param maxWindowSize number of information objects that are remembered (memory: 32 bytes per object)
+ * \param windowTimeInMs time in ms to remember the received information objects
+ *
+ * \return the new stream merger instance
+ */
+CS101_StreamMerger
+CS101_StreamMerger_create(int maxWindowSize, int windowTimeInMs);
+
+/**
+ * \brief Destroy the stream merger and release all resources
+ *
+ * NOTE: The stream merger must not be in use by a connection.
+ */
+void
+CS101_StreamMerger_destroy(CS101_StreamMerger self);
+
+/**
+ * \brief Set the handler for the merged stream
+ *
+ * \param handler the application handler
+ * \param parameter user provided parameter that is passed to the handler
+ */
+void
+CS101_StreamMerger_setASDUReceivedHandler(CS101_StreamMerger self, CS101_ASDUReceivedHandler handler, void* parameter);
+
+/**
+ * \brief ASDU received handler to be installed at each redundant connection
+ *
+ * Example: CS104_Connection_setASDUReceivedHandler(con, CS101_StreamMerger_asduReceivedHandler, merger);
+ *
+ * \param parameter the stream merger instance
+ * \param address address of the sender (passed to the application handler)
+ * \param asdu the received ASDU
+ *
+ * \return result of the application handler, or true when the ASDU is suppressed
+ */
+bool
+CS101_StreamMerger_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu);
+
+/**
+ * \brief Get the counters of the stream merger
+ *
+ * \param statistics the counters are stored here
+ */
+void
+CS101_StreamMerger_getStatistics(CS101_StreamMerger self, CS101_StreamMergerStatistics* statistics);
+
+/*! @} */
+
+/*! @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_API_CS101_STREAM_MERGER_H_ */
@@ -0,0 +1,250 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_API_CS104_CAMPAIGN_H_
+#define SRC_INC_API_CS104_CAMPAIGN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hal_thread.h"
+
+#include "cs104_connection.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file cs104_campaign.h
+ * \brief Execution of a procedure (GI, counter interrogation, clock synchronization) at many stations
+ */
+
+/**
+ * @addtogroup MASTER Master related functions
+ *
+ * @{
+ */
+
+/**
+ * @defgroup CS104_CAMPAIGN Campaigns (broadcast procedures over many connections)
+ *
+ * A campaign sends the same command to a set of stations (connection and common address) and collects the
+ * confirmations (ACT_CON) and, for interrogation commands, the terminations (ACT_TERM). The number of
+ * stations with a running procedure is limited by the maximum concurrency.
+ *
+ * For clock synchronization the campaign can compensate the transmission delay of each link. The round trip
+ * time of a test command with time tag (C_TS_TA_1) is measured before the clock synchronization command is sent,
+ * and half of the round trip time is added to the time of the command.
+ *
+ * The received ASDUs are still passed to the ASDU received handler of the connections.
+ *
+ * NOTE: Requires CONFIG_USE_THREADS = 1. A connection can only be used by one running campaign.
+ *
+ * @{
+ */
+
+typedef struct sCS104_Campaign* CS104_Campaign;
+
+/**
+ * \brief Result of the procedure at a station
+ */
+typedef enum {
+    CS104_CAMPAIGN_STATION_PENDING = 0,       /**< procedure not yet finished */
+    CS104_CAMPAIGN_STATION_SUCCESS = 1,       /**< positive ACT_CON (and ACT_TERM) received */
+    CS104_CAMPAIGN_STATION_NEGATIVE = 2,      /**< negative ACT_CON or unknown type ID/COT/CA/IOA received */
+    CS104_CAMPAIGN_STATION_TIMEOUT = 3,       /**< no ACT_CON or ACT_TERM received in time */
+    CS104_CAMPAIGN_STATION_NOT_CONNECTED = 4, /**< command could not be sent */
+    CS104_CAMPAIGN_STATION_CANCELED = 5       /**< campaign was stopped */
+} CS104_CampaignStationResult;
+
+/**
+ * \brief Summary of a campaign
+ *
+ * The completion times are measured per station from the start of the procedure at the station to
+ * the final confirmation (only stations with result CS104_CAMPAIGN_STATION_SUCCESS).
+ */
+typedef struct {
+    int numberOfStations;
+    int succeeded;
+    int negative;
+    int timeouts;
+    int notConnected;
+    int canceled;
+
+    int minCompletionTimeInUs;
+    int avgCompletionTimeInUs;
+    int p50CompletionTimeInUs; /**< median */
+    int p90CompletionTimeInUs;
+    int p99CompletionTimeInUs;
+    int maxCompletionTimeInUs;
+
+    int durationInMs; /**< duration of the whole campaign */
+} CS104_CampaignStatistics;
+
+/**
+ * \brief Handler that is called when all stations have finished the procedure (or the campaign was stopped)
+ *
+ * NOTE: Called by the campaign thread. The campaign must not be destroyed in the handler.
+ */
+typedef void (*CS104_CampaignCompletedHandler) (void* parameter, CS104_Campaign campaign);
+
+/**
+ * \brief Create a new campaign
+ *
+ * \param maxNumberOfStations maximum number of stations
+ *
+ * \return the new campaign instance
+ */
+CS104_Campaign
+CS104_Campaign_create(int maxNumberOfStations);
+
+/**
+ * \brief Stop a running campaign and release all resources
+ */
+void
+CS104_Campaign_destroy(CS104_Campaign self);
+
+/**
+ * \brief Add a station to the campaign
+ *
+ * NOTE: Has to be called before the campaign is started
+ *
+ * \param connection the connection to the station
+ * \param ca common address of the station
+ *
+ * \return index of the station, or -1 when the maximum number of stations is reached
+ */
+int
+CS104_Campaign_addStation(CS104_Campaign self, CS104_Connection connection, int ca);
+
+/**
+ * \brief Set the maximum number of stations with a running procedure (default: 100)
+ */
+void
+CS104_Campaign_setMaxConcurrency(CS104_Campaign self, int maxConcurrency);
+
+/**
+ * \brief Set the timeouts of the procedure
+ *
+ * \param actConTimeoutInMs maximum time to wait for the ACT_CON (default: 15000 ms)
+ * \param actTermTimeoutInMs maximum time after the ACT_CON to wait for the ACT_TERM (default: 60000 ms)
+ */
+void
+CS104_Campaign_setTimeouts(CS104_Campaign self, int actConTimeoutInMs, int actTermTimeoutInMs);
+
+/**
+ * \brief Enable or disable the compensation of the transmission delay for clock synchronization (default: enabled)
+ */
+void
+CS104_Campaign_setDelayCompensation(CS104_Campaign self, bool enable);
+
+/**
+ * \brief Set the handler that is called when the campaign is finished
+ */
+void
+CS104_Campaign_setCompletedHandler(CS104_Campaign self, CS104_CampaignCompletedHandler handler, void* parameter);
+
+/**
+ * \brief Set the attributes (stack size, CPU affinity, priority, name) of the campaign thread
+ *
+ * Has to be called before the campaign is started.
+ *
+ * NOTE: The attributes (including the name string) are copied.
+ *
+ * \param attributes the thread attributes or NULL to use the platform defaults
+ */
+void
+CS104_Campaign_setThreadAttributes(CS104_Campaign self, ThreadAttributes attributes);
+
+/**
+ * \brief Start an interrogation (C_IC_NA_1) at all stations
+ *
+ * \return true when the campaign was started, false when a campaign is already running
+ */
+bool
+CS104_Campaign_startInterrogation(CS104_Campaign self, QualifierOfInterrogation qoi);
+
+/**
+ * \brief Start a counter interrogation (C_CI_NA_1) at all stations
+ *
+ * \param qcc the qualifier of counter interrogation (e.g. for counter freeze)
+ *
+ * \return true when the campaign was started, false when a campaign is already running
+ */
+bool
+CS104_Campaign_startCounterInterrogation(CS104_Campaign self, uint8_t qcc);
+
+/**
+ * \brief Start a clock synchronization (C_CS_NA_1) at all stations
+ *
+ * The time of the command is the system time when the command is sent (plus the measured
+ * transmission delay). When a station rejects the test command (C_TS_TA_1) used to measure the
+ * delay, the clock synchronization command is sent without compensation (delay 0).
+ *
+ * \return true when the campaign was started, false when a campaign is already running
+ */
+bool
+CS104_Campaign_startClockSync(CS104_Campaign self);
+
+/**
+ * \brief Stop a running campaign
+ *
+ * Stations with a running procedure get the result CS104_CAMPAIGN_STATION_CANCELED.
+ */
+void
+CS104_Campaign_stop(CS104_Campaign self);
+
+/**
+ * \brief Check if the campaign is still running
+ */
+bool
+CS104_Campaign_isRunning(CS104_Campaign self);
+
+/**
+ * \brief Get the result of the procedure at a station
+ */
+CS104_CampaignStationResult
+CS104_Campaign_getStationResult(CS104_Campaign self, int stationIndex);
+
+/**
+ * \brief Get the measured transmission delay (half of the round trip time) of a station
+ *
+ * \return the delay in us, or -1 when no delay was measured
+ */
+int
+CS104_Campaign_getStationDelay(CS104_Campaign self, int stationIndex);
+
+/**
+ * \brief Get the summary of the last campaign
+ */
+void
+CS104_Campaign_getStatistics(CS104_Campaign self, CS104_CampaignStatistics* statistics);
+
+/*! @} */
+
+/*! @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_API_CS104_CAMPAIGN_H_ */
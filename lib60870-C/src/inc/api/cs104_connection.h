@@ -26,7 +26,10 @@
 #include <stdint.h>
 
 #include "tls_config.h"
+#include "hal_thread.h"
 #include "iec60870_master.h"
+#include "cs101_point_cache.h"
+#include "cs104_decode_pipeline.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -126,6 +129,54 @@ CS104_Connection_getAppLayerParameters(CS104_Connection self);
 void
 CS104_Connection_setConnectTimeout(CS104_Connection self, int millies);
 
+/**
+ * \brief Use receive time stamps for received messages
+ *
+ * When enabled the time when a message was received by the network stack (or network adapter) is requested
+ * from the operating system (e.g. SO_TIMESTAMPING on Linux) and can be accessed in the ASDU received handler
+ * with \ref CS101_ASDU_getReceiveTimestamp. When the platform doesn't provide receive time stamps
+ * the time when the library reads the message is used.
+ *
+ * NOTE: Has to be called before connecting. For TLS connections the time when the library reads the message is used.
+ *
+ * \param self
+ * \param enable true to enable receive time stamps
+ */
+void
+CS104_Connection_setReceiveTimestamps(CS104_Connection self, bool enable);
+
+/**
+ * \brief Set the attributes (stack size, CPU affinity, priority, name) of the connection handling thread
+ *
+ * Has to be called before \ref CS104_Connection_connect or \ref CS104_Connection_connectAsync.
+ *
+ * NOTE: The attributes (including the name string) are copied.
+ *
+ * \param self CS104_Connection instance
+ * \param attributes the thread attributes or NULL to use the platform defaults
+ */
+void
+CS104_Connection_setThreadAttributes(CS104_Connection self, ThreadAttributes attributes);
+
+/**
+ * \brief Handle the received ASDUs by the workers of a decode pipeline
+ *
+ * The connection handling thread only checks the APCI and passes the ASDUs to the pipeline. The point cache and
+ * the ASDU received handler are called by the worker threads. A received I message is confirmed when it and all
+ * I messages received before it have been handled by the workers.
+ *
+ * NOTE: The ASDU received handler (and the ASDU observer) is called concurrently by several worker threads
+ * for ASDUs with different common addresses and has to be thread-safe. ASDUs with the same common address
+ * are passed to the handler in the order of reception.
+ *
+ * Has to be called before \ref CS104_Connection_connect or \ref CS104_Connection_connectAsync.
+ *
+ * \param self CS104_Connection instance
+ * \param pipeline the decode pipeline or NULL to handle the ASDUs in the connection handling thread (default)
+ */
+void
+CS104_Connection_setDecodePipeline(CS104_Connection self, CS104_DecodePipeline pipeline);
+
 /**
  * \brief non-blocking connect.
  *
@@ -330,6 +381,17 @@ CS104_Connection_setConnectionHandler(CS104_Connection self, CS104_ConnectionHan
 void
 CS104_Connection_setRawMessageHandler(CS104_Connection self, IEC60870_RawMessageHandler handler, void* parameter);
 
+/**
+ * \brief Assign a point cache that is updated with all received monitoring information
+ *
+ * The cache is updated before the ASDU received handler is called. The same cache can be
+ * assigned to multiple connections.
+ *
+ * \param cache the point cache or NULL to remove the cache
+ */
+void
+CS104_Connection_setPointCache(CS104_Connection self, CS101_PointCache cache);
+
 /**
  * \brief Close the connection
  */
@@ -0,0 +1,121 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_API_CS104_DECODE_PIPELINE_H_
+#define SRC_INC_API_CS104_DECODE_PIPELINE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hal_thread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file cs104_decode_pipeline.h
+ * \brief Decoding of received ASDUs by a pool of worker threads (CS 104 master side)
+ */
+
+/**
+ * @addtogroup MASTER Master related functions
+ *
+ * @{
+ */
+
+/**
+ * @defgroup CS104_DECODE_PIPELINE Decode pipeline for masters with many connections
+ *
+ * By default the received ASDUs are decoded and passed to the point cache and the ASDU received handler by the
+ * connection handling thread. When a decode pipeline is assigned to a connection (\ref CS104_Connection_setDecodePipeline)
+ * the connection handling thread only checks the APCI (framing and sequence numbers) and passes the ASDU
+ * to a worker thread of the pipeline. The same pipeline can be used by many connections.
+ *
+ * All ASDUs of the same connection and common address are handled by the same worker in the order of reception.
+ * ASDUs of different stations can be handled in parallel. A received I message is only confirmed (S message or N(R)
+ * of a sent I message) when it and all I messages received before it have been handled. When the workers cannot
+ * keep up the outstation stops sending after k unconfirmed messages.
+ *
+ * NOTE: Requires CONFIG_USE_THREADS = 1. The ASDU received handler is called concurrently by several worker threads
+ * and has to be thread-safe.
+ *
+ * @{
+ */
+
+typedef struct sCS104_DecodePipeline* CS104_DecodePipeline;
+
+/**
+ * \brief Counters of the decode pipeline
+ */
+typedef struct {
+    uint64_t handledASDUs; /**< number of ASDUs handled by the workers */
+    uint64_t queueFull;    /**< number of times a connection had to wait for a free queue entry */
+} CS104_DecodePipelineStatistics;
+
+/**
+ * \brief Create a new decode pipeline and start the worker threads
+ *
+ * \param numberOfWorkers number of worker threads (e.g. number of CPU cores)
+ * \param queueSize maximum number of queued ASDUs per worker (memory: about 280 bytes per entry)
+ *
+ * \return the new decode pipeline instance or NULL when the workers cannot be started
+ */
+CS104_DecodePipeline
+CS104_DecodePipeline_create(int numberOfWorkers, int queueSize);
+
+/**
+ * \brief Create a new decode pipeline and start the worker threads with the given thread attributes
+ *
+ * \param numberOfWorkers number of worker threads (e.g. number of CPU cores)
+ * \param queueSize maximum number of queued ASDUs per worker (memory: about 280 bytes per entry)
+ * \param attributes attributes (stack size, CPU affinity, priority, name) of all worker threads or NULL to use the platform defaults
+ *
+ * \return the new decode pipeline instance or NULL when the workers cannot be started
+ */
+CS104_DecodePipeline
+CS104_DecodePipeline_createEx(int numberOfWorkers, int queueSize, ThreadAttributes attributes);
+
+/**
+ * \brief Stop the worker threads and release all resources
+ *
+ * NOTE: The pipeline must not be used by a connection anymore.
+ */
+void
+CS104_DecodePipeline_destroy(CS104_DecodePipeline self);
+
+/**
+ * \brief Get the counters of the decode pipeline
+ *
+ * \param statistics the counters are stored here
+ */
+void
+CS104_DecodePipeline_getStatistics(CS104_DecodePipeline self, CS104_DecodePipelineStatistics* statistics);
+
+/*! @} */
+
+/*! @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_API_CS104_DECODE_PIPELINE_H_ */
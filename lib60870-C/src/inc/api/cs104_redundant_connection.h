@@ -0,0 +1,184 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_API_CS104_REDUNDANT_CONNECTION_H_
+#define SRC_INC_API_CS104_REDUNDANT_CONNECTION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_connection.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file cs104_redundant_connection.h
+ * \brief CS 104 master side redundancy (hot-standby connections)
+ */
+
+/**
+ * @addtogroup MASTER Master related functions
+ *
+ * @{
+ */
+
+/**
+ * @defgroup CS104_REDUNDANT_CONNECTION CS 104 redundant connection (hot-standby)
+ *
+ * A redundant connection keeps TCP connections to all configured servers (or to all
+ * channels of a server) open. Only one connection is active (STARTDT). The other
+ * connections are kept in stopped state (STOPDT) and are supervised with TESTFR
+ * messages. When the active connection fails a connected standby connection is
+ * activated by sending STARTDT without having to wait for a new TCP/TLS connection.
+ *
+ * @{
+ */
+
+typedef struct sCS104_RedundantConnection* CS104_RedundantConnection;
+
+/**
+ * \brief Handler that is called when another server connection became active
+ *
+ * \param parameter user provided parameter
+ * \param oldServer index of the previously active server (-1 if no server was active)
+ * \param newServer index of the new active server
+ * \param switchoverTimeInMs time from detecting the failure of the active connection (or from the
+ *        switchover request) until the reception of STARTDT_CON from the new server
+ */
+typedef void (*CS104_SwitchoverHandler) (void* parameter, int oldServer, int newServer, int switchoverTimeInMs);
+
+/**
+ * \brief Create a new redundant connection object
+ *
+ * \return the new redundant connection instance
+ */
+CS104_RedundantConnection
+CS104_RedundantConnection_create(void);
+
+/**
+ * \brief Add a server (or server channel) address
+ *
+ * The order of the servers defines the preference when selecting the active connection.
+ *
+ * NOTE: Has to be called before \ref CS104_RedundantConnection_start
+ *
+ * \param hostname host name or IP address of the server
+ * \param tcpPort tcp port of the server. If set to -1 use default port (2404)
+ *
+ * \return index of the server, or -1 when the server cannot be added
+ */
+int
+CS104_RedundantConnection_addServer(CS104_RedundantConnection self, const char* hostname, int tcpPort);
+
+/**
+ * \brief Get the connection object of a server
+ *
+ * Can be used to configure APCI and application layer parameters or TLS before the
+ * connection is started.
+ *
+ * \param serverIndex index of the server (as returned by \ref CS104_RedundantConnection_addServer)
+ *
+ * \return the connection object or NULL if the index is invalid
+ */
+CS104_Connection
+CS104_RedundantConnection_getConnection(CS104_RedundantConnection self, int serverIndex);
+
+/**
+ * \brief Set the handler for received ASDUs
+ *
+ * Only ASDUs received from the active connection are forwarded to the handler.
+ */
+void
+CS104_RedundantConnection_setASDUReceivedHandler(CS104_RedundantConnection self, CS101_ASDUReceivedHandler handler, void* parameter);
+
+/**
+ * \brief Set the handler that is called after a switchover to another server
+ */
+void
+CS104_RedundantConnection_setSwitchoverHandler(CS104_RedundantConnection self, CS104_SwitchoverHandler handler, void* parameter);
+
+/**
+ * \brief Set the interval to retry failed server connections (default is 1000 ms)
+ */
+void
+CS104_RedundantConnection_setReconnectInterval(CS104_RedundantConnection self, int intervalInMs);
+
+/**
+ * \brief Connect to all servers and activate the first available connection
+ *
+ * A connection is activated when all preferred servers are connected or failed to connect within
+ * the reconnect interval.
+ */
+void
+CS104_RedundantConnection_start(CS104_RedundantConnection self);
+
+/**
+ * \brief Close all server connections
+ */
+void
+CS104_RedundantConnection_stop(CS104_RedundantConnection self);
+
+/**
+ * \brief Get the index of the active server
+ *
+ * \return the index of the active server or -1 if no connection is active
+ */
+int
+CS104_RedundantConnection_getActiveServer(CS104_RedundantConnection self);
+
+/**
+ * \brief Get the active connection (e.g. to send commands)
+ *
+ * \return the active connection or NULL if no connection is active
+ */
+CS104_Connection
+CS104_RedundantConnection_getActiveConnection(CS104_RedundantConnection self);
+
+/**
+ * \brief Switch to another server connection
+ *
+ * The active connection is stopped (STOPDT) and kept as standby connection. Then
+ * STARTDT is sent on the new connection.
+ *
+ * \param serverIndex index of the new server
+ *
+ * \return true if the server connection is available and STARTDT has been sent, false otherwise
+ */
+bool
+CS104_RedundantConnection_switchover(CS104_RedundantConnection self, int serverIndex);
+
+/**
+ * \brief Close all connections and release all resources
+ */
+void
+CS104_RedundantConnection_destroy(CS104_RedundantConnection self);
+
+/*! @} */
+
+/*! @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_API_CS104_REDUNDANT_CONNECTION_H_ */
@@ -25,6 +25,7 @@
 #define SRC_INC_API_CS104_SLAVE_H_
 
 #include "iec60870_slave.h"
+#include "hal_thread.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -90,6 +91,36 @@ typedef enum {
  */
 typedef void (*CS104_ConnectionEventHandler) (void* parameter, IMasterConnection connection, CS104_PeerConnectionEvent event);
 
+/**
+ * \brief Statistics of the output rate shaping of a client connection
+ */
+typedef struct {
+    uint64_t sentFrames;     /**< number of sent I messages */
+    uint64_t sentBytes;      /**< number of sent I message bytes (including APCI) */
+    uint64_t delayedFrames;  /**< number of I messages that were delayed by the rate limit */
+    uint64_t totalDelayInMs; /**< sum of all delays caused by the rate limit */
+    uint32_t maxDelayInMs;   /**< maximum delay caused by the rate limit */
+} CS104_OutputShapingStatistics;
+
+/**
+ * \brief Round trip time, window, and throughput measurements of a client connection
+ */
+typedef struct {
+    int rttInMs;                  /**< smoothed round trip time (I message to acknowledgement) in ms (-1 = not measured yet) */
+    int rttVariationInMs;         /**< round trip time variation in ms */
+    int minRttInMs;               /**< minimum measured round trip time in ms (-1 = not measured yet) */
+    int t1InMs;                   /**< t1 timeout currently used */
+    int k;                        /**< current send window (maximum number of unconfirmed I messages) */
+    int w;                        /**< current receive window (I messages received before an acknowledgement is sent) */
+    uint64_t confirmedFrames;     /**< number of I messages acknowledged by the peer */
+    int confirmedFramesPerSecond; /**< acknowledged I messages per second (last measurement period of ~1 s) */
+    int receiveDelayInUs;         /**< time between reception and ASDU handler call of the last received I message in us (-1 = not measured, see \ref CS104_Slave_setReceiveTimestamps) */
+    int maxReceiveDelayInUs;      /**< maximum time between reception and ASDU handler call in us (-1 = not measured) */
+    uint64_t commandResponses;    /**< number of control commands (type IDs 45-64) that have been confirmed */
+    int commandResponseTimeInUs;  /**< time between reception of the last confirmed control command and sending the confirmation in us (-1 = not measured yet) */
+    int maxCommandResponseTimeInUs; /**< maximum command response time in us (-1 = not measured yet) */
+} CS104_LinkStatistics;
+
 /**
  * \brief Callback handler for sent and received messages
  *
@@ -129,9 +160,29 @@ CS104_Slave_create(int maxLowPrioQueueSize, int maxHighPrioQueueSize);
 CS104_Slave
 CS104_Slave_createSecure(int maxLowPrioQueueSize, int maxHighPrioQueueSize, TLSConfiguration tlsConfig);
 
+/**
+ * \brief Register a plugin instance with this slave instance
+ *
+ * The plugin is called for all received ASDUs.
+ *
+ * \param plugin the plugin instance.
+ */
 void
 CS104_Slave_addPlugin(CS104_Slave self, CS101_SlavePlugin plugin);
 
+/**
+ * \brief Register a plugin instance that is only called for received ASDUs of the given type ID
+ *
+ * The plugin is found by a table lookup. Plugins registered for the type ID are called before the
+ * plugins registered with \ref CS104_Slave_addPlugin. The function can be called multiple times to register
+ * the plugin for multiple type IDs. The task of the plugin is called once.
+ *
+ * \param plugin the plugin instance.
+ * \param typeId the type ID of the ASDUs handled by the plugin
+ */
+void
+CS104_Slave_addPluginForTypeID(CS104_Slave self, CS101_SlavePlugin plugin, IEC60870_5_TypeID typeId);
+
 /**
  * \brief Set the local IP address to bind the server
  * use "0.0.0.0" to bind to all interfaces
@@ -179,6 +230,306 @@ CS104_Slave_setMaxOpenConnections(CS104_Slave self, int maxOpenConnections);
 void
 CS104_Slave_setServerMode(CS104_Slave self, CS104_ServerMode serverMode);
 
+/**
+ * \brief Set the attributes (stack size, CPU affinity, priority, name) of the internal threads
+ *
+ * The attributes are used for the server thread, for each client connection thread, and for the
+ * queue replication thread created by \ref CS104_Slave_start. They have no effect in threadless mode.
+ *
+ * NOTE: The attributes (including the name string) are copied.
+ *
+ * \param self the slave instance
+ * \param attributes the thread attributes or NULL to use the platform defaults
+ */
+void
+CS104_Slave_setThreadAttributes(CS104_Slave self, ThreadAttributes attributes);
+
+/**
+ * \brief Configure an event (priority) class of the event queue
+ *
+ * Each configured event class has its own event queue (FIFO) in each redundancy group (or connection).
+ * The ASDUs of the event classes are sent by weighted round robin: in each round up to "weight" ASDUs
+ * of each class are sent, higher event classes first. Event class 0 always exists and contains all
+ * ASDUs that are not mapped to another class (see \ref CS104_Slave_addEventClassMapping).
+ *
+ * Example: class 0 (weight 1) for periodic/background measurements and class 3 (weight 8) for alarms.
+ * Under load eight alarms are sent for each periodic measurement.
+ *
+ * NOTE: Has to be called before the slave is started. The number of event classes is limited by
+ * CONFIG_CS104_SLAVE_EVENT_CLASSES.
+ *
+ * \param self the slave instance
+ * \param eventClass the event class (0 to CONFIG_CS104_SLAVE_EVENT_CLASSES - 1)
+ * \param maxQueueSize the maximum number of queued ASDUs of the class (ignored for class 0; < 1 -> size of the
+ *        event queue)
+ * \param weight the number of ASDUs of the class sent in each scheduling round (minimum 1)
+ */
+void
+CS104_Slave_setEventClass(CS104_Slave self, int eventClass, int maxQueueSize, int weight);
+
+/**
+ * \brief Assign ASDUs with the given type ID and/or COT to an event class
+ *
+ * When multiple mappings match an ASDU the most specific mapping is used (type ID and COT, then type ID,
+ * then COT). ASDUs without matching mapping are assigned to event class 0. The order of the events is
+ * only kept within an event class.
+ *
+ * \param self the slave instance
+ * \param typeId the type ID of the ASDU or 0 for any type ID
+ * \param cot the cause of transmission of the ASDU or 0 for any COT
+ * \param eventClass the event class (configured with \ref CS104_Slave_setEventClass)
+ */
+void
+CS104_Slave_addEventClassMapping(CS104_Slave self, IEC60870_5_TypeID typeId, CS101_CauseOfTransmission cot, int eventClass);
+
+/**
+ * \brief Set a time to live for queued events with the given type ID and/or COT
+ *
+ * Events that could not be sent within the time to live (e.g. during a communication outage) are
+ * discarded. The most specific matching setting is used (see \ref CS104_Slave_addEventClassMapping).
+ * Events without matching setting never expire.
+ *
+ * \param self the slave instance
+ * \param typeId the type ID of the ASDU or 0 for any type ID
+ * \param cot the cause of transmission of the ASDU or 0 for any COT
+ * \param timeToLiveInMs the time to live in ms (0 = no expiration)
+ */
+void
+CS104_Slave_addEventTimeToLive(CS104_Slave self, IEC60870_5_TypeID typeId, CS101_CauseOfTransmission cot, int timeToLiveInMs);
+
+/**
+ * \brief Keep only the latest value of cyclic data in the event queue
+ *
+ * When enabled an ASDU with COT PERIODIC or BACKGROUND_SCAN replaces a queued ASDU of the same type,
+ * common address, and information object address(es) that is still waiting for transmission. After a
+ * communication outage only the latest values are sent instead of the complete history.
+ * Only ASDUs with a single information object or a sequence of information objects are replaced.
+ * Other ASDUs with multiple information objects are always queued.
+ *
+ * NOTE: Has to be called before the slave is started
+ *
+ * \param self the slave instance
+ * \param keepOnlyLatest true to keep only the latest waiting values, false to keep all values (default)
+ */
+void
+CS104_Slave_setKeepOnlyLatestCyclicValues(CS104_Slave self, bool keepOnlyLatest);
+
+/**
+ * \brief Reserve a part of the send window (k) for command responses
+ *
+ * Events from the event queue(s) (and background scan data) are only sent while more than the
+ * reserved number of I messages can be sent before the send window is full. Responses (e.g. ACT_CON
+ * and ACT_TERM of commands) can use the complete send window. A response that cannot be sent
+ * immediately wakes up the connection thread so that it is sent as soon as the window allows.
+ *
+ * The command response times are available with \ref CS104_Slave_getConnectionLinkStatistics.
+ *
+ * \param self the slave instance
+ * \param reservedFrames number of I messages of the send window that are reserved for responses (default: 0)
+ */
+void
+CS104_Slave_setCommandResponseReserve(CS104_Slave self, int reservedFrames);
+
+/**
+ * \brief Callback handler to create the ASDUs of a cyclic group
+ *
+ * The handler is called for each ASDU of a cycle with increasing asduIndex (starting with 0) until it returns
+ * false. The ASDU is initialized with the COT of the group, the originator address of the application layer
+ * parameters, CA = 0, and without information objects. The handler sets the CA and adds the information objects
+ * with the current values. ASDUs without information objects are not sent.
+ *
+ * \param parameter user provided parameter
+ * \param groupId the ID of the group (returned by \ref CS104_Slave_addCyclicGroup)
+ * \param asduIndex index of the ASDU in the current cycle
+ * \param asdu the ASDU to fill
+ *
+ * \return true when the ASDU was filled, false when the cycle is complete (the ASDU is not sent)
+ */
+typedef bool (*CS104_CyclicGroupHandler) (void* parameter, int groupId, int asduIndex, CS101_ASDU asdu);
+
+/**
+ * \brief Add a group of information objects that is transmitted cyclically
+ *
+ * Periodic groups (CS101_COT_PERIODIC) are created by the slave at fixed times (multiples of the cycle time). All
+ * groups that are due at the same time are put into the event queue(s) as one batch. No cycle is created when no
+ * client is connected. To avoid that periodic data delays spontaneous events map COT PERIODIC to a low
+ * priority event class (see \ref CS104_Slave_setEventClass) and/or use \ref CS104_Slave_setKeepOnlyLatestCyclicValues.
+ *
+ * Background scan groups (CS101_COT_BACKGROUND_SCAN) bypass the event queue. Each active connection runs its own scan
+ * cycles. The ASDUs are only created and sent when no other ASDUs are waiting for the connection and at least a quarter of
+ * the send window (k) is free. A new cycle starts at the next multiple of the cycle time after the start of the
+ * previous cycle.
+ *
+ * The handlers of periodic groups are called by the server thread (or by \ref CS104_Slave_tick and
+ * \ref CS104_Slave_handleTimers). The handlers of background scan groups are called by the connection
+ * threads and can be called concurrently for different connections.
+ *
+ * NOTE: Has to be called before the slave is started. The number of groups is limited by
+ * CONFIG_CS104_SLAVE_MAX_CYCLIC_GROUPS.
+ *
+ * \param self the slave instance
+ * \param cot CS101_COT_PERIODIC or CS101_COT_BACKGROUND_SCAN
+ * \param cycleTimeInMs the cycle time in ms
+ * \param handler the handler that creates the ASDUs of the group
+ * \param parameter user provided parameter to be passed to the handler
+ *
+ * \return the group ID, or -1 when the group cannot be added
+ */
+int
+CS104_Slave_addCyclicGroup(CS104_Slave self, CS101_CauseOfTransmission cot, int cycleTimeInMs, CS104_CyclicGroupHandler handler, void* parameter);
+
+/**
+ * \brief Set the default output rate limit for new client connections
+ *
+ * The sending of I messages is paced by a token bucket (per connection) instead of writing up to k messages
+ * at once into the TCP send buffer. This avoids buffer bloat and T1 timeouts on narrowband links (e.g. GPRS or radio).
+ * Waiting messages remain in the event queues until the rate limit allows sending.
+ *
+ * \param self the slave instance
+ * \param maxBytesPerSecond maximum number of I message bytes (including APCI) per second (0 = unlimited)
+ * \param maxFramesPerSecond maximum number of I messages per second (0 = unlimited)
+ * \param burstSize number of (maximum size) I messages that can be sent back to back (minimum 1)
+ */
+void
+CS104_Slave_setOutputRateLimit(CS104_Slave self, int maxBytesPerSecond, int maxFramesPerSecond, int burstSize);
+
+/**
+ * \brief Change the output rate limit of a client connection
+ *
+ * Can be used e.g. in the \ref CS104_ConnectionEventHandler to apply a link specific rate limit.
+ *
+ * \param self the slave instance
+ * \param connection the client connection
+ * \param maxBytesPerSecond maximum number of I message bytes (including APCI) per second (0 = unlimited)
+ * \param maxFramesPerSecond maximum number of I messages per second (0 = unlimited)
+ * \param burstSize number of (maximum size) I messages that can be sent back to back (minimum 1)
+ */
+void
+CS104_Slave_setConnectionOutputRateLimit(CS104_Slave self, IMasterConnection connection, int maxBytesPerSecond,
+        int maxFramesPerSecond, int burstSize);
+
+/**
+ * \brief Get the output rate shaping statistics of a client connection
+ *
+ * \param self the slave instance
+ * \param connection the client connection
+ * \param statistics the statistics are stored here
+ */
+void
+CS104_Slave_getConnectionOutputStatistics(CS104_Slave self, IMasterConnection connection, CS104_OutputShapingStatistics* statistics);
+
+/**
+ * \brief Enable the adaptive send and receive window for new connections
+ *
+ * Each connection starts with the configured k and w parameters (\ref CS104_APCIParameters).
+ * While the number of unconfirmed I messages limits the throughput and the peer acknowledges the
+ * messages without additional delay the send window is increased up to maxK. When the measured round
+ * trip time increases the window is reduced again (not below k).
+ *
+ * The receive window (number of received I messages before an acknowledgement is sent) is increased up
+ * to maxW. When the peer stops sending before the receive window is reached (because its own k
+ * is exhausted) the receive window is reduced to 2/3 of the observed peer window (not below w).
+ *
+ * NOTE: Only use with peers that accept more unconfirmed messages than the configured k!
+ *
+ * \param self the slave instance
+ * \param maxK maximum send window (0 = fixed k, maximum 32767)
+ * \param maxW maximum receive window (0 = fixed w, limited to 2/3 of the maximum send window)
+ */
+void
+CS104_Slave_setAdaptiveWindow(CS104_Slave self, int maxK, int maxW);
+
+/**
+ * \brief Adapt the t1 timeout to the measured round trip time (for new connections)
+ *
+ * When enabled t1 is extended to the retransmission timeout calculated from the measured round
+ * trip time (smoothed RTT + 4 * RTT variation) when this is larger than the configured t1.
+ *
+ * \param self the slave instance
+ * \param enable true to enable, false to always use the configured t1
+ */
+void
+CS104_Slave_setAdaptiveT1(CS104_Slave self, bool enable);
+
+/**
+ * \brief Use receive time stamps for received messages (for new connections)
+ *
+ * When enabled the time when a message was received by the network stack (or network adapter) is requested
+ * from the operating system (e.g. SO_TIMESTAMPING on Linux). When the platform doesn't provide receive time stamps
+ * the time when the library reads the message is used. The time is available in the ASDU handlers
+ * (\ref CS101_ASDU_getReceiveTimestamp), in the \ref CS104_LinkStatistics, and as trace event
+ * (LIB60870_TRACE_RECV_DELAY).
+ *
+ * NOTE: For TLS connections the time when the library reads the message is used.
+ *
+ * \param self the slave instance
+ * \param enable true to enable receive time stamps
+ */
+void
+CS104_Slave_setReceiveTimestamps(CS104_Slave self, bool enable);
+
+/**
+ * \brief Get the round trip time, window, and throughput measurements of a client connection
+ *
+ * \param self the slave instance
+ * \param connection the client connection
+ * \param statistics the measurements are stored here
+ */
+void
+CS104_Slave_getConnectionLinkStatistics(CS104_Slave self, IMasterConnection connection, CS104_LinkStatistics* statistics);
+
+/**
+ * \brief Replicate the event queue(s) to a standby server
+ *
+ * All enqueue and confirm operations of the low priority event queue(s) are forwarded in batches
+ * to a standby slave (configured with \ref CS104_Slave_setQueueReplicationListener) over a TCP
+ * connection. After a (re)connect the complete queue content is transferred first. When the standby
+ * takes over it sends all events that have not been confirmed by a master of this slave.
+ *
+ * Events with a time to live keep the expiration time of the primary. The system clocks of both
+ * servers should be synchronized.
+ *
+ * Replication is supported for the server modes CS104_MODE_SINGLE_REDUNDANCY_GROUP and
+ * CS104_MODE_MULTIPLE_REDUNDANCY_GROUPS (both servers have to use the same redundancy group and
+ * event class configuration) and only in threaded mode (\ref CS104_Slave_start).
+ *
+ * NOTE: Has to be called before the slave is started
+ *
+ * \param self the slave instance
+ * \param address IP address or hostname of the standby (e.g. "127.0.0.1" for a local standby process)
+ * \param port the TCP port of the standby replication listener
+ */
+void
+CS104_Slave_setQueueReplicationTarget(CS104_Slave self, const char* address, int port);
+
+/**
+ * \brief Receive the event queue(s) of a primary server (run as standby)
+ *
+ * The replicated events are stored in the queue(s) of this slave without being sent until a master
+ * connects to this slave.
+ *
+ * NOTE: The replication link is not authenticated. Only bind the listener to a trusted
+ * (e.g. dedicated redundancy) network interface.
+ *
+ * NOTE: Has to be called before the slave is started
+ *
+ * \param self the slave instance
+ * \param localAddress the local IP address to bind the listener (NULL for the loopback interface 127.0.0.1)
+ * \param port the TCP port of the replication listener
+ */
+void
+CS104_Slave_setQueueReplicationListener(CS104_Slave self, const char* localAddress, int port);
+
+/**
+ * \brief Check if the replication connection to the standby (or to the primary) is established
+ *
+ * \param self the slave instance
+ *
+ * \return true when the replication connection is established, false otherwise
+ */
+bool
+CS104_Slave_isQueueReplicationConnected(CS104_Slave self);
+
 /**
  * \brief Set the connection request handler
  *
@@ -305,6 +656,86 @@ CS104_Slave_stopThreadless(CS104_Slave self);
 void
 CS104_Slave_tick(CS104_Slave self);
 
+/** The descriptor has to be monitored for incoming data (or incoming connections) */
+#define CS104_SLAVE_POLL_READ 1
+
+/** The descriptor has to be monitored for write readiness */
+#define CS104_SLAVE_POLL_WRITE 2
+
+/**
+ * \brief Socket file descriptor and the events to monitor (for non-threaded mode with external event loop)
+ */
+typedef struct {
+    int fd;     /**< file descriptor of the socket */
+    int events; /**< bit mask of CS104_SLAVE_POLL_READ and CS104_SLAVE_POLL_WRITE */
+} CS104_SlavePollDescriptor;
+
+/**
+ * \brief Get the sockets that have to be monitored by an external event loop (non-threaded mode)
+ *
+ * The list contains the listening socket (only when another connection can be accepted)
+ * and the sockets of all open client connections. For each client connection it also contains a
+ * wake-up descriptor that becomes readable when another thread sends a response over the
+ * connection (e.g. \ref IMasterConnection_sendASDU from a worker thread). The list can change
+ * after each call of \ref CS104_Slave_handleReadable or \ref CS104_Slave_handleTimers.
+ *
+ * As an alternative to \ref CS104_Slave_tick the application can use this function together with
+ * \ref CS104_Slave_getNextTimeout, \ref CS104_Slave_handleReadable, and \ref CS104_Slave_handleTimers
+ * to integrate the slave into its own event loop (e.g. based on epoll or poll).
+ *
+ * \param descriptors array to store the descriptors
+ * \param maxDescriptors size of the descriptors array
+ *
+ * \return the number of descriptors to monitor (can be larger than maxDescriptors - then only maxDescriptors are stored)
+ */
+int
+CS104_Slave_getPollDescriptors(CS104_Slave self, CS104_SlavePollDescriptor* descriptors, int maxDescriptors);
+
+/**
+ * \brief Get the time until \ref CS104_Slave_handleTimers has to be called next (non-threaded mode)
+ *
+ * The time considers the protocol timeouts (t1, t2, t3) and ASDUs waiting for transmission.
+ *
+ * NOTE: After enqueuing new ASDUs (\ref CS104_Slave_enqueueASDU) the timeout has to be requested again.
+ *
+ * \return the timeout in ms, 0 when \ref CS104_Slave_handleTimers has to be called immediately, -1 when no timer is running
+ */
+int
+CS104_Slave_getNextTimeout(CS104_Slave self);
+
+/**
+ * \brief Handle a readable socket reported by the external event loop (non-threaded mode)
+ *
+ * Accepts a new connection (listening socket), handles the received messages of
+ * a client connection, or sends the responses queued by other threads (wake-up descriptor).
+ * The function doesn't block.
+ *
+ * \param fd the file descriptor of the readable socket
+ */
+void
+CS104_Slave_handleReadable(CS104_Slave self, int fd);
+
+/**
+ * \brief Handle a writable socket reported by the external event loop (non-threaded mode)
+ *
+ * Writes the buffered output data of the connection. A connection only requests
+ * \ref CS104_SLAVE_POLL_WRITE when data couldn't be written because the TCP send buffer was full.
+ * The function doesn't block.
+ *
+ * \param fd the file descriptor of the writable socket
+ */
+void
+CS104_Slave_handleWritable(CS104_Slave self, int fd);
+
+/**
+ * \brief Handle protocol timers, send waiting ASDUs, and release closed connections (non-threaded mode)
+ *
+ * The function doesn't block. It should be called when the timeout returned by
+ * \ref CS104_Slave_getNextTimeout elapsed and after \ref CS104_Slave_handleReadable.
+ */
+void
+CS104_Slave_handleTimers(CS104_Slave self);
+
 /*
  * \brief Gets the number of ASDU in the low-priority queue
  *
@@ -325,6 +756,19 @@ CS104_Slave_getNumberOfQueueEntries(CS104_Slave self, CS104_RedundancyGroup redG
 void
 CS104_Slave_enqueueASDU(CS104_Slave self, CS101_ASDU asdu);
 
+/**
+ * \brief Add multiple ASDUs to the low-priority queue(s) of the slave (use for periodic and spontaneous messages)
+ *
+ * Has the same effect as calling \ref CS104_Slave_enqueueASDU for each ASDU but each ASDU is encoded
+ * only once and each queue is locked only once for a chunk of up to 16 ASDUs. The order of the ASDUs
+ * is preserved. No memory is allocated, so the batch size is not limited.
+ *
+ * \param asdus array of the ASDUs to add
+ * \param count number of ASDUs in the array
+ */
+void
+CS104_Slave_enqueueASDUs(CS104_Slave self, CS101_ASDU* asdus, int count);
+
 /**
  * \brief Add a new redundancy group to the server.
  *
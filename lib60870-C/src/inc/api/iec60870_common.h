@@ -58,6 +58,56 @@ typedef struct {
     int patch;
 } Lib60870VersionInfo;
 
+/**
+ * \brief Usage information of a static memory pool (see CONFIG_LIB60870_STATIC_MEMORY)
+ */
+typedef struct {
+    int blockSize;            /**< size of a single block in bytes */
+    int capacity;             /**< number of blocks of the pool */
+    int used;                 /**< number of blocks currently in use */
+    int maxUsed;              /**< maximum number of blocks used at the same time */
+    uint32_t exhaustionCount; /**< number of requests that could not be served by this pool */
+} Lib60870MemoryPoolStatistics;
+
+/**
+ * \brief Trace points of the library (see CONFIG_LIB60870_TRACING)
+ */
+typedef enum {
+    LIB60870_TRACE_ENQUEUE = 1,       /**< ASDU added to an event queue (arg1: entry ID, arg2: type ID) */
+    LIB60870_TRACE_DEQUEUE = 2,       /**< ASDU taken from a queue for transmission (arg1: entry ID, arg2: type ID) */
+    LIB60870_TRACE_SEND_I = 3,        /**< I message sent (arg1: N(S), arg2: N(R)) */
+    LIB60870_TRACE_RECV_I = 4,        /**< I message received (arg1: N(S), arg2: N(R)) */
+    LIB60870_TRACE_SEND_S = 5,        /**< S message sent (arg1: N(R)) */
+    LIB60870_TRACE_ACK = 6,           /**< sent I messages confirmed by the peer (arg1: N(R), arg2: number of confirmed messages) */
+    LIB60870_TRACE_TIMEOUT = 7,       /**< timeout (arg1: 1 = T1, 2 = T2, 3 = T3 (TESTFR), arg2: N(S) of the message) */
+    LIB60870_TRACE_CONNECT = 8,       /**< connection established (arg1: 0 = server side, 1 = client side) */
+    LIB60870_TRACE_DISCONNECT = 9,    /**< connection closed (arg1: 0 = server side, 1 = client side) */
+    LIB60870_TRACE_HANDLER_ENTER = 10, /**< user callback for a received ASDU called (arg1: type ID, arg2: COT) */
+    LIB60870_TRACE_HANDLER_EXIT = 11,  /**< user callback returned (arg1: type ID, arg2: result of the ASDU handling, 1 = OK) */
+    LIB60870_TRACE_RECV_DELAY = 12     /**< received ASDU passed to the user callback (arg1: time since reception of the message in us, arg2: type ID) - requires receive time stamps */
+} Lib60870TracePoint;
+
+/**
+ * \brief Trace event created by a trace point
+ */
+typedef struct {
+    uint64_t timestamp;     /**< monotonic time stamp in ns */
+    uint32_t connectionId;  /**< ID of the connection (0 = not related to a connection) */
+    uint32_t arg1;          /**< first argument (depends on the trace point) */
+    uint32_t arg2;          /**< second argument (depends on the trace point) */
+    uint32_t tracePoint;    /**< the trace point (\ref Lib60870TracePoint) */
+} Lib60870TraceEvent;
+
+/**
+ * \brief Custom trace sink
+ *
+ * The handler is called by the thread that passes the trace point. It has to be thread-safe and fast.
+ *
+ * \param parameter user provided parameter
+ * \param event the trace event (only valid during the call)
+ */
+typedef void (*Lib60870_TraceHandler) (void* parameter, const Lib60870TraceEvent* event);
+
 /**
  * \brief link layer mode for serial link layers
  */
@@ -130,6 +180,7 @@ typedef struct {
     int asduHeaderLength;
     uint8_t* payload;
     int payloadSize;
+    uint64_t receiveTimestamp;
     uint8_t encodedData[256];
 } sCS101_StaticASDU;
 
@@ -244,6 +295,78 @@ Lib60870_enableDebugOutput(bool value);
 Lib60870VersionInfo
 Lib60870_getLibraryVersionInfo(void);
 
+/**
+ * \brief Get the number of static memory pools
+ *
+ * \return the number of pools, or 0 when the library is not compiled with CONFIG_LIB60870_STATIC_MEMORY
+ */
+int
+Lib60870_getNumberOfMemoryPools(void);
+
+/**
+ * \brief Get the usage information of a static memory pool
+ *
+ * \param poolIndex index of the pool (0 .. number of pools - 1)
+ * \param statistics structure to store the usage information
+ *
+ * \return true when the pool exists, false otherwise
+ */
+bool
+Lib60870_getMemoryPoolStatistics(int poolIndex, Lib60870MemoryPoolStatistics* statistics);
+
+/**
+ * \brief Start recording of trace events into a ring buffer
+ *
+ * The trace events of all connections are recorded into a lock-free ring buffer. When the buffer is full
+ * the oldest events are overwritten.
+ *
+ * NOTE: Only available when the library is compiled with CONFIG_LIB60870_TRACING. The ring buffer is
+ * not released by \ref Lib60870_stopTracing because other threads can still use it.
+ *
+ * \param bufferSize number of events that can be stored (rounded up to a power of two)
+ *
+ * \return true when tracing has been started, false otherwise
+ */
+bool
+Lib60870_startTracing(int bufferSize);
+
+/**
+ * \brief Set a custom trace sink
+ *
+ * When a handler is set the trace events are passed to the handler instead of the ring buffer.
+ * Tracing is enabled while a handler is set.
+ *
+ * \param handler the handler or NULL to remove the handler
+ * \param parameter user provided parameter that is passed to the handler
+ */
+void
+Lib60870_setTraceHandler(Lib60870_TraceHandler handler, void* parameter);
+
+/**
+ * \brief Stop recording of trace events
+ */
+void
+Lib60870_stopTracing(void);
+
+/**
+ * \brief Read (and remove) the oldest trace events from the ring buffer
+ *
+ * Has to be called by a single thread only.
+ *
+ * \param events array where the events are stored
+ * \param maxEvents size of the array
+ *
+ * \return number of events stored in the array
+ */
+int
+Lib60870_readTraceEvents(Lib60870TraceEvent* events, int maxEvents);
+
+/**
+ * \brief Get the number of trace events that were overwritten before they could be read
+ */
+uint32_t
+Lib60870_getNumberOfLostTraceEvents(void);
+
 /**
  * \brief Check if the test flag of the ASDU is set
  */
@@ -456,6 +579,18 @@ CS101_ASDU_addPayload(CS101_ASDU self, uint8_t* buffer, int size);
 int
 CS101_ASDU_getPayloadSize(CS101_ASDU self);
 
+/**
+ * \brief Get the time when the message containing the ASDU was received
+ *
+ * For CS 104 the time is provided by the operating system when receive time stamps are enabled
+ * (\ref CS104_Slave_setReceiveTimestamps, \ref CS104_Connection_setReceiveTimestamps). For CS 101
+ * it is the time when the start character of the frame was read from the serial port.
+ *
+ * \return receive time in nanoseconds since the UNIX epoch, or 0 when not available (e.g. for ASDUs created by the application)
+ */
+uint64_t
+CS101_ASDU_getReceiveTimestamp(CS101_ASDU self);
+
 /**
  * \brief Destroy the ASDU object (release all resources)
  */
@@ -38,6 +38,7 @@ struct sCS101_ASDU {
     int asduHeaderLength;
     uint8_t* payload;
     int payloadSize;
+    uint64_t receiveTimestamp; /* receive time of the frame in ns since epoch (0 = unknown) */
 };
 
 #ifdef __cplusplus
@@ -52,6 +53,9 @@ extern "C" {
 CS101_ASDU
 CS101_ASDU_createFromBuffer(CS101_AppLayerParameters parameters, uint8_t* msg, int msgLength);
 
+void
+CS101_ASDU_setReceiveTimestamp(CS101_ASDU self, uint64_t timestamp);
+
 #ifdef __cplusplus
 }
 #endif
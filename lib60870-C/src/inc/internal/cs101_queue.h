@@ -82,6 +82,9 @@ CS101_Queue_unlock(CS101_Queue self);
 void
 CS101_Queue_enqueue(CS101_Queue self, CS101_ASDU asdu);
 
+void
+CS101_Queue_enqueueMultiple(CS101_Queue self, CS101_ASDU* asdus, int count);
+
     /*
      * NOTE: Locking has to be done by caller!
      */
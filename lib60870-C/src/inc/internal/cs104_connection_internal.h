@@ -0,0 +1,50 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_INTERNAL_CS104_CONNECTION_INTERNAL_H_
+#define SRC_INC_INTERNAL_CS104_CONNECTION_INTERNAL_H_
+
+#include "cs104_connection.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Called for each received ASDU before the point cache and the ASDU received handler
+ */
+typedef void (*CS104_ASDUObserver) (void* parameter, CS104_Connection connection, CS101_ASDU asdu);
+
+/**
+ * \brief Set an observer for the received ASDUs (used by library modules like campaigns)
+ *
+ * When the function returns, a previous observer is not called anymore.
+ *
+ * \param observer the observer or NULL to remove the observer
+ */
+void
+CS104_Connection_setASDUObserver(CS104_Connection self, CS104_ASDUObserver observer, void* parameter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_INTERNAL_CS104_CONNECTION_INTERNAL_H_ */
@@ -0,0 +1,65 @@
+/*
+ *  Copyright 2016-2018 MZ Automation GmbH
+ *
+ *  This file is part of lib60870-C
+ *
+ *  lib60870-C is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  lib60870-C is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with lib60870-C.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  See COPYING file for the complete license text.
+ */
+
+#ifndef SRC_INC_INTERNAL_CS104_DECODE_PIPELINE_INTERNAL_H_
+#define SRC_INC_INTERNAL_CS104_DECODE_PIPELINE_INTERNAL_H_
+
+#include "cs104_decode_pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* maximum size of an ASDU in a CS 104 I message */
+#define CS104_DECODE_PIPELINE_MAX_ASDU_SIZE 249
+
+/**
+ * \brief Called by a worker thread to handle a queued ASDU
+ *
+ * \param sequenceNumber the receive sequence number of the I message that was passed to \ref CS104_DecodePipeline_enqueue
+ */
+typedef void (*CS104_DecodeJobHandler) (void* parameter, int sequenceNumber, uint8_t* asdu, int asduSize, uint64_t receiveTimestamp);
+
+/**
+ * \brief Add an ASDU to the queue of the worker that is responsible for the partition key
+ *
+ * The ASDU is copied into the queue.
+ *
+ * \param partitionKey ASDUs with the same key are handled in order by the same worker
+ * \param sequenceNumber receive sequence number of the I message (passed to the handler)
+ *
+ * \return true when the ASDU was queued, false when the queue of the worker is full
+ */
+bool
+CS104_DecodePipeline_enqueue(CS104_DecodePipeline self, uint32_t partitionKey, CS104_DecodeJobHandler handler,
+        void* parameter, int sequenceNumber, uint8_t* asdu, int asduSize, uint64_t receiveTimestamp);
+
+/**
+ * \brief Count a failed attempt to enqueue an ASDU (for the statistics)
+ */
+void
+CS104_DecodePipeline_countQueueFull(CS104_DecodePipeline self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_INC_INTERNAL_CS104_DECODE_PIPELINE_INTERNAL_H_ */
@@ -33,6 +33,37 @@ lib60870_debug_print(const char *format, ...);
 #define DEBUG_PRINT(...) do{ } while ( false )
 #endif
 
+#if (CONFIG_LIB60870_TRACING == 1)
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if (CONFIG_LIB60870_TRACING_USDT == 1)
+#include <sys/sdt.h>
+#define TRACE_USDT_PROBE(tracePoint, connectionId, arg1, arg2) DTRACE_PROBE4(lib60870, trace, tracePoint, connectionId, arg1, arg2)
+#else
+#define TRACE_USDT_PROBE(tracePoint, connectionId, arg1, arg2) do{ } while ( false )
+#endif
+
+extern volatile bool lib60870_traceEnabled;
+
+void
+lib60870_trace(int tracePoint, uint32_t connectionId, uint32_t arg1, uint32_t arg2);
+
+/* get a new (unique) ID for a connection that is used in the trace events */
+uint32_t
+lib60870_trace_newConnectionId(void);
+
+#define TRACE_POINT(tracePoint, connectionId, arg1, arg2) do { \
+        TRACE_USDT_PROBE(tracePoint, connectionId, arg1, arg2); \
+        if (lib60870_traceEnabled) lib60870_trace(tracePoint, (uint32_t) (connectionId), (uint32_t) (arg1), (uint32_t) (arg2)); \
+    } while ( false )
+
+#else
+#define TRACE_POINT(tracePoint, connectionId, arg1, arg2) do{ } while ( false )
+#define lib60870_trace_newConnectionId() 0
+#endif /* (CONFIG_LIB60870_TRACING == 1) */
+
 #define IEC60870_5_104_MAX_ASDU_LENGTH 249
 #define IEC60870_5_104_APCI_LENGTH 6
 
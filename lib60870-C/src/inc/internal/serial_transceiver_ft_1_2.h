@@ -50,10 +50,22 @@ SerialTransceiverFT12_getBaudRate(SerialTransceiverFT12 self);
 void
 SerialTransceiverFT12_sendMessage(SerialTransceiverFT12 self, uint8_t* msg, int msgSize);
 
+/* check if the previous frame is transmitted and the minimum line idle time is over */
+bool
+SerialTransceiverFT12_isReadyToSend(SerialTransceiverFT12 self);
+
+/* get the time (ms) when the last frame is transmitted and the minimum line idle time is over */
+uint64_t
+SerialTransceiverFT12_getTransmitEndTime(SerialTransceiverFT12 self);
+
 void
 SerialTransceiverFT12_readNextMessage(SerialTransceiverFT12 self, uint8_t* buffer,
         SerialTXMessageHandler, void* parameter);
 
+/* get the time when the start character of the last received frame was read (ns since epoch) */
+uint64_t
+SerialTransceiverFT12_getLastFrameTimestamp(SerialTransceiverFT12 self);
+
 #endif /* SRC_IEC60870_LINK_LAYER_SERIAL_TRANSCEIVER_FT_1_2_H_ */
 
 
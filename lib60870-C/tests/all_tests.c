@@ -1,12 +1,36 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for pthread_getattr_np and pthread_getname_np */
+#endif
+
 #include "unity.h"
 #include "iec60870_common.h"
 #include "cs104_slave.h"
 #include "cs104_connection.h"
+#include "cs104_redundant_connection.h"
+#include "cs101_stream_merger.h"
+#include "cs101_asdu_dispatcher.h"
+#include "cs104_campaign.h"
 #include "hal_time.h"
 #include "hal_thread.h"
+#include "hal_socket.h"
+#include "hal_serial.h"
+#include "cs101_master.h"
 #include "buffer_frame.h"
+#include "lib_memory.h"
+#include "lib60870_config.h"
 #include <string.h>
 #include <stdlib.h>
+#include <poll.h>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #if WIN32
 #define bzero(b,len) (memset((b), '\0', (len)), (void) 0) 
@@ -5166,246 +5190,3440 @@ test_CS104_Connection_UseAfterServerClosedConnection(void)
     CS104_Connection_destroy(con);
 }
 
-void
-test_CS101_ASDU_addObjectOfWrongType(void)
-{
-    CS101_ASDU asdu = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_PERIODIC, 0, 1, false, false);
-
-    InformationObject io1 = (InformationObject) SinglePointInformation_create(NULL, 101, true, IEC60870_QUALITY_GOOD);
+#if defined(__linux__) && defined(__GLIBC__)
+struct sTestThreadAttributesResult {
+    size_t stackSize;
+    char name[16];
+    int numberOfCpus;
+    bool cpu0;
+};
 
-    bool added = CS101_ASDU_addInformationObject(asdu, io1);
+static void*
+test_ThreadAttributes_thread(void* parameter)
+{
+    struct sTestThreadAttributesResult* result = (struct sTestThreadAttributesResult*) parameter;
 
-    TEST_ASSERT_TRUE(added);
+    pthread_attr_t attr;
 
-    InformationObject_destroy(io1);
+    pthread_getattr_np(pthread_self(), &attr);
+    pthread_attr_getstacksize(&attr, &(result->stackSize));
+    pthread_attr_destroy(&attr);
 
-    InformationObject io2 = (InformationObject) DoublePointInformation_create(NULL, 102, IEC60870_DOUBLE_POINT_OFF, IEC60870_QUALITY_GOOD);
+    pthread_getname_np(pthread_self(), result->name, sizeof(result->name));
 
-    added = CS101_ASDU_addInformationObject(asdu, io2);
+    cpu_set_t cpuSet;
 
-    TEST_ASSERT_FALSE(added);
+    pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
 
-    InformationObject_destroy(io2);
+    result->numberOfCpus = CPU_COUNT(&cpuSet);
+    result->cpu0 = CPU_ISSET(0, &cpuSet);
 
-    CS101_ASDU_destroy(asdu);
+    return NULL;
 }
 
-void
-test_CS101_ASDU_addUntilOverflow(void)
+/* count the threads of the process with the given name */
+static int
+test_ThreadAttributes_countThreads(const char* name)
 {
-    CS101_ASDU asdu = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_PERIODIC, 0, 1, false, false);
+    int count = 0;
 
-    int i = 0;
+    DIR* dir = opendir("/proc/self/task");
 
-    for (i = 0; i < 60; i++) {
-        InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 100 + i, true, IEC60870_QUALITY_GOOD);
+    if (dir) {
+        struct dirent* entry;
 
-        bool added = CS101_ASDU_addInformationObject(asdu, io);
+        while ((entry = readdir(dir)) != NULL) {
+            char path[300];
+            char threadName[32];
 
-        TEST_ASSERT_TRUE(added);
+            if (entry->d_name[0] == '.')
+                continue;
 
-        InformationObject_destroy(io);
+            snprintf(path, sizeof(path), "/proc/self/task/%s/comm", entry->d_name);
 
-        TEST_ASSERT_EQUAL_INT(i + 1, CS101_ASDU_getNumberOfElements(asdu));
-    }
+            FILE* file = fopen(path, "r");
 
-    InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 100 + i, true, IEC60870_QUALITY_GOOD);
+            if (file) {
+                if (fgets(threadName, sizeof(threadName), file)) {
+                    threadName[strcspn(threadName, "\n")] = 0;
 
-    bool added = CS101_ASDU_addInformationObject(asdu, io);
+                    if (strcmp(threadName, name) == 0)
+                        count++;
+                }
 
-    TEST_ASSERT_FALSE(added);
+                fclose(file);
+            }
+        }
 
-    InformationObject_destroy(io);
+        closedir(dir);
+    }
 
-    CS101_ASDU_destroy(asdu);
+    return count;
 }
+#endif /* defined(__linux__) && defined(__GLIBC__) */
 
 void
-test_CS104_MasterSlave_TLSConnectSuccess(void)
+test_CS104_MasterSlave_ThreadAttributes(void)
 {
-    TLSConfiguration tlsConfig1 = TLSConfiguration_create();
+    CS104_Slave slave = NULL;
+    CS104_Connection con = NULL;
 
-    TLSConfiguration_setChainValidation(tlsConfig1, true);
+    struct sThreadAttributes attributes;
+    char name[16];
 
-    TLSConfiguration_setOwnKeyFromFile(tlsConfig1, "server-key.pem", NULL);
-    TLSConfiguration_setOwnCertificateFromFile(tlsConfig1, "server.cer");
-    TLSConfiguration_addCACertificateFromFile(tlsConfig1, "root.cer");
+    strcpy(name, "iec104");
 
-    TLSConfiguration tlsConfig2 = TLSConfiguration_create();
+    attributes.stackSize = 64 * 1024;
+    attributes.cpuAffinity = 1;
+    attributes.priority = 0;
+    attributes.name = name;
 
-    TLSConfiguration_setChainValidation(tlsConfig2, true);
-    TLSConfiguration_setAllowOnlyKnownCertificates(tlsConfig2, true);
+#if defined(__linux__) && defined(__GLIBC__)
+    struct sTestThreadAttributesResult threadResult;
 
-    TLSConfiguration_setOwnKeyFromFile(tlsConfig2, "client1-key.pem", NULL);
-    TLSConfiguration_setOwnCertificateFromFile(tlsConfig2, "client1.cer");
-    TLSConfiguration_addCACertificateFromFile(tlsConfig2, "root.cer");
+    memset(&threadResult, 0, sizeof(threadResult));
 
-    TLSConfiguration_addAllowedCertificateFromFile(tlsConfig2, "server.cer");
+    Thread thread = Thread_createEx(test_ThreadAttributes_thread, &threadResult, false, &attributes);
 
-    CS104_Slave slave = CS104_Slave_createSecure(100, 100, tlsConfig1);
+    Thread_start(thread);
+    Thread_destroy(thread);
+
+    TEST_ASSERT_TRUE(threadResult.stackSize >= 64 * 1024);
+    TEST_ASSERT_TRUE(threadResult.stackSize < 1024 * 1024);
+    TEST_ASSERT_EQUAL_STRING("iec104", threadResult.name);
+    TEST_ASSERT_EQUAL_INT(1, threadResult.numberOfCpus);
+    TEST_ASSERT_TRUE(threadResult.cpu0);
+#endif
+
+    slave = CS104_Slave_create(100, 100);
 
     TEST_ASSERT_NOT_NULL(slave);
 
-    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setThreadAttributes(slave, &attributes);
 
+    /* the name is copied */
+    strcpy(name, "other");
+
+    CS104_Slave_setLocalPort(slave, 20004);
     CS104_Slave_start(slave);
 
-    CS104_Connection con = CS104_Connection_createSecure("127.0.0.1", 20004, tlsConfig2);
+    TEST_ASSERT_TRUE(CS104_Slave_isRunning(slave));
+
+    con = CS104_Connection_create("127.0.0.1", 20004);
 
     TEST_ASSERT_NOT_NULL(con);
 
+    CS104_Connection_setThreadAttributes(con, &attributes);
+
     bool result = CS104_Connection_connect(con);
 
     TEST_ASSERT_TRUE(result);
 
-    CS104_Slave_destroy(slave);
+    result = CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+    TEST_ASSERT_TRUE(result);
+
+#if defined(__linux__) && defined(__GLIBC__)
+    Thread_sleep(100);
+
+    /* server thread and connection thread of the slave */
+    TEST_ASSERT_TRUE(test_ThreadAttributes_countThreads("iec104") >= 2);
+#endif
 
     CS104_Connection_destroy(con);
 
-    TLSConfiguration_destroy(tlsConfig1);
-    TLSConfiguration_destroy(tlsConfig2);
+    CS104_Slave_destroy(slave);
 }
 
-
-void
-test_CS104_MasterSlave_TLSConnectFails(void)
+static bool
+test_CS104_Connection_PointCache_interrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, uint8_t qoi)
 {
-    TLSConfiguration tlsConfig1 = TLSConfiguration_create();
+    CS101_AppLayerParameters alParams = IMasterConnection_getApplicationLayerParameters(connection);
 
-    TLSConfiguration_setChainValidation(tlsConfig1, true);
+    IMasterConnection_sendACT_CON(connection, asdu, false);
 
-    TLSConfiguration tlsConfig2 = TLSConfiguration_create();
+    CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
 
-    TLSConfiguration_setChainValidation(tlsConfig2, true);
-    TLSConfiguration_setAllowOnlyKnownCertificates(tlsConfig2, true);
+    InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 100, true, IEC60870_QUALITY_GOOD);
+    CS101_ASDU_addInformationObject(newAsdu, io);
+    InformationObject_destroy(io);
 
-    TLSConfiguration_setOwnKeyFromFile(tlsConfig2, "client1-key.pem", NULL);
-    TLSConfiguration_setOwnCertificateFromFile(tlsConfig2, "client1.cer");
-    TLSConfiguration_addCACertificateFromFile(tlsConfig2, "root.cer");
+    io = (InformationObject) SinglePointInformation_create(NULL, 101, false, IEC60870_QUALITY_INVALID);
+    CS101_ASDU_addInformationObject(newAsdu, io);
+    InformationObject_destroy(io);
 
-    TLSConfiguration_addAllowedCertificateFromFile(tlsConfig2, "server.cer");
+    IMasterConnection_sendASDU(connection, newAsdu);
 
-    CS104_Slave slave = CS104_Slave_createSecure(100, 100, tlsConfig1);
+    CS101_ASDU_destroy(newAsdu);
 
-    TEST_ASSERT_NOT_NULL(slave);
+    newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
 
-    CS104_Slave_setLocalPort(slave, 20004);
+    io = (InformationObject) MeasuredValueShort_create(NULL, 200, 12.5f, IEC60870_QUALITY_GOOD);
+    CS101_ASDU_addInformationObject(newAsdu, io);
+    InformationObject_destroy(io);
+
+    IMasterConnection_sendASDU(connection, newAsdu);
+
+    CS101_ASDU_destroy(newAsdu);
+
+    IMasterConnection_sendACT_TERM(connection, asdu);
+
+    return true;
+}
+
+static void
+test_CS104_Connection_PointCache_changeHandler(void* parameter, CS101_PointValue* changes, int numberOfChanges)
+{
+    int* changeCount = (int*) parameter;
+
+    *changeCount += numberOfChanges;
+}
+
+void
+test_CS104_Connection_PointCache(void)
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
 
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_setInterrogationHandler(slave, test_CS104_Connection_PointCache_interrogationHandler, NULL);
     CS104_Slave_start(slave);
 
-    CS104_Connection con = CS104_Connection_createSecure("127.0.0.1", 20004, tlsConfig2);
+    CS101_PointCache cache = CS101_PointCache_create(100);
 
-    TEST_ASSERT_NOT_NULL(con);
+    TEST_ASSERT_NOT_NULL(cache);
+
+    int changeCount = 0;
+
+    TEST_ASSERT_TRUE(CS101_PointCache_setChangeHandler(cache, test_CS104_Connection_PointCache_changeHandler, &changeCount, true));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setPointCache(con, cache);
 
     bool result = CS104_Connection_connect(con);
+    TEST_ASSERT_TRUE(result);
 
-    TEST_ASSERT_FALSE(result);
+    CS104_Connection_sendStartDT(con);
 
-    CS104_Slave_destroy(slave);
+    TEST_ASSERT_EQUAL_INT(CS101_GI_STATE_NONE, CS101_PointCache_getGIState(cache, 1, NULL));
+
+    CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+    Thread_sleep(500);
+
+    int pointsReceived = 0;
+
+    TEST_ASSERT_EQUAL_INT(CS101_GI_STATE_COMPLETE, CS101_PointCache_getGIState(cache, 1, &pointsReceived));
+    TEST_ASSERT_EQUAL_INT(3, pointsReceived);
+    TEST_ASSERT_EQUAL_INT(3, CS101_PointCache_getNumberOfPoints(cache));
+    TEST_ASSERT_EQUAL_INT(3, changeCount);
+
+    CS101_PointValue value;
+
+    TEST_ASSERT_TRUE(CS101_PointCache_getValue(cache, 1, 100, &value));
+    TEST_ASSERT_EQUAL_INT(M_SP_NA_1, value.typeId);
+    TEST_ASSERT_EQUAL_INT(1, (int) value.value);
+    TEST_ASSERT_EQUAL_INT(IEC60870_QUALITY_GOOD, value.quality);
+
+    TEST_ASSERT_TRUE(CS101_PointCache_getValue(cache, 1, 101, &value));
+    TEST_ASSERT_EQUAL_INT(0, (int) value.value);
+    TEST_ASSERT_EQUAL_INT(IEC60870_QUALITY_INVALID, value.quality);
+
+    TEST_ASSERT_TRUE(CS101_PointCache_getValue(cache, 1, 200, &value));
+    TEST_ASSERT_EQUAL_INT(M_ME_NC_1, value.typeId);
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, (float) value.value);
+
+    TEST_ASSERT_FALSE(CS101_PointCache_getValue(cache, 2, 100, &value));
+
+    /* repeated GI with unchanged values -> no new change notifications */
+    CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(3, changeCount);
+
+    TEST_ASSERT_TRUE(CS101_PointCache_getValue(cache, 1, 100, &value));
+    TEST_ASSERT_EQUAL_INT(2, value.updateCount);
+
+    /* group interrogation doesn't change the station GI state */
+    CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_GROUP_1);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(CS101_GI_STATE_COMPLETE, CS101_PointCache_getGIState(cache, 1, &pointsReceived));
+    TEST_ASSERT_EQUAL_INT(3, pointsReceived);
+
+    TEST_ASSERT_TRUE(CS101_PointCache_getValue(cache, 1, 100, &value));
+    TEST_ASSERT_EQUAL_INT(3, value.updateCount);
+
+    TEST_ASSERT_EQUAL_INT(0, CS101_PointCache_getNumberOfIgnoredGIStations(cache));
 
     CS104_Connection_destroy(con);
 
-    TLSConfiguration_destroy(tlsConfig1);
-    TLSConfiguration_destroy(tlsConfig2);
+    CS104_Slave_destroy(slave);
+
+    CS101_PointCache_destroy(cache);
 }
 
-int
-main(int argc, char** argv)
+void
+test_CS101_PointCache_GIStationLimit(void)
 {
-    UNITY_BEGIN();
-    RUN_TEST(test_CS104_Slave_CreateDestroy);
-    RUN_TEST(test_CS104_MasterSlave_CreateDestroyLoop);
-    RUN_TEST(test_CS104_Connection_CreateDestroy);
-    RUN_TEST(test_CS104_MasterSlave_CreateDestroy);
-    RUN_TEST(test_CP56Time2a);
-    RUN_TEST(test_CP56Time2aToMsTimestamp);
-    RUN_TEST(test_CP56Time2aConversionFunctions);
-    RUN_TEST(test_StepPositionInformation);
-    RUN_TEST(test_addMaxNumberOfIOsToASDU);
-    RUN_TEST(test_SingleEventType);
+    CS101_PointCache cache = CS101_PointCache_create(10);
 
-    RUN_TEST(test_SinglePointInformation);
-    RUN_TEST(test_SinglePointWithCP24Time2a);
-    RUN_TEST(test_SinglePointWithCP56Time2a);
+    TEST_ASSERT_NOT_NULL(cache);
 
-    RUN_TEST(test_DoublePointInformation);
-    RUN_TEST(test_DoublePointWithCP24Time2a);
-    RUN_TEST(test_DoublePointWithCP56Time2a);
+    int ca;
 
-    RUN_TEST(test_NormalizeMeasureValueWithoutQuality);
-    RUN_TEST(test_NormalizeMeasureValue);
-    RUN_TEST(test_MeasuredValueNormalizedWithCP24Time2a);
-    RUN_TEST(test_MeasuredValueNormalizedWithCP56Time2a);
+    for (ca = 1; ca <= CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS + 1; ca++) {
+        CS101_ASDU asdu = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_ACTIVATION_CON, 0, ca, false, false);
 
-    RUN_TEST(test_MeasuredValueScaled);
-    RUN_TEST(test_MeasuredValueScaledWithCP24Time2a);
-    RUN_TEST(test_MeasuredValueScaledWithCP56Time2a);
+        InformationObject io = (InformationObject) InterrogationCommand_create(NULL, 0, IEC60870_QOI_STATION);
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
 
-    RUN_TEST(test_MeasuredValueShort);
-    RUN_TEST(test_MeasuredValueShortWithCP24Time2a);
-    RUN_TEST(test_MeasuredValueShortWithCP56Time2a);
+        CS101_PointCache_handleASDU(cache, asdu);
 
-    RUN_TEST(test_StepPositionInformation);
-    RUN_TEST(test_StepPositionWithCP24Time2a);
-    RUN_TEST(test_StepPositionWithCP56Time2a);
+        CS101_ASDU_destroy(asdu);
+    }
 
-    RUN_TEST(test_IntegratedTotals);
-    RUN_TEST(test_IntegratedTotalsWithCP24Time2a);
-    RUN_TEST(test_IntegratedTotalsWithCP56Time2a);
+    TEST_ASSERT_EQUAL_INT(CS101_GI_STATE_IN_PROGRESS, CS101_PointCache_getGIState(cache, 1, NULL));
+    TEST_ASSERT_EQUAL_INT(CS101_GI_STATE_IN_PROGRESS,
+            CS101_PointCache_getGIState(cache, CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS, NULL));
+    TEST_ASSERT_EQUAL_INT(CS101_GI_STATE_NONE,
+            CS101_PointCache_getGIState(cache, CONFIG_CS101_POINT_CACHE_MAX_GI_STATIONS + 1, NULL));
+    TEST_ASSERT_EQUAL_INT(1, CS101_PointCache_getNumberOfIgnoredGIStations(cache));
 
-    RUN_TEST(test_SingleCommand);
-    RUN_TEST(test_SingleCommandWithCP56Time2a);
+    CS101_PointCache_destroy(cache);
+}
 
-    RUN_TEST(test_DoubleCommand);
-    RUN_TEST(test_DoubleCommandWithCP56Time2a);
+struct sRedundantConnectionTestInfo {
+    int switchoverCount;
+    int oldServer;
+    int newServer;
+};
 
-    RUN_TEST(test_StepCommandValue);
-    RUN_TEST(test_StepCommandWithCP56Time2a);
+static void
+test_CS104_RedundantConnection_switchoverHandler(void* parameter, int oldServer, int newServer, int switchoverTimeInMs)
+{
+    struct sRedundantConnectionTestInfo* info = (struct sRedundantConnectionTestInfo*) parameter;
 
-    RUN_TEST(test_SetpointCommandNormalized);
-    RUN_TEST(test_SetpointCommandNormalizedWithCP56Time2a);
+    info->switchoverCount++;
+    info->oldServer = oldServer;
+    info->newServer = newServer;
+}
 
-    RUN_TEST(test_SetpointCommandScaled);
-    RUN_TEST(test_SetpointCommandScaledWithCP56Time2a);
+void
+test_CS104_RedundantConnection_Switchover(void)
+{
+    CS104_Slave slave1 = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave1, 20004);
+    CS104_Slave_start(slave1);
 
-    RUN_TEST(test_SetpointCommandShort);
-    RUN_TEST(test_SetpointCommandShortWithCP56Time2a);
+    CS104_Slave slave2 = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave2, 20005);
+    CS104_Slave_start(slave2);
 
-    RUN_TEST(test_InterrogationCommand);
-    RUN_TEST(test_CounterInterrogationCommand);
+    struct sRedundantConnectionTestInfo info;
+    memset(&info, 0, sizeof(info));
 
-    RUN_TEST(test_ReadCommand);
-    RUN_TEST(test_ClockSynchronizationCommand);
-    RUN_TEST(test_ResetProcessCommand);
-    RUN_TEST(test_DelayAcquisitionCommand);
+    CS104_RedundantConnection con = CS104_RedundantConnection_create();
 
-    RUN_TEST(test_BitString32);
-    RUN_TEST(test_Bitstring32CommandWithCP56Time2a);
+    TEST_ASSERT_EQUAL_INT(0, CS104_RedundantConnection_addServer(con, "127.0.0.1", 20004));
+    TEST_ASSERT_EQUAL_INT(1, CS104_RedundantConnection_addServer(con, "127.0.0.1", 20005));
 
-    RUN_TEST(test_QueryLog);
+    CS104_RedundantConnection_setSwitchoverHandler(con, test_CS104_RedundantConnection_switchoverHandler, &info);
 
-    RUN_TEST(test_BitString32xx_encodeDecode);
-    RUN_TEST(test_EventOfProtectionEquipmentWithTime);
-    RUN_TEST(test_IpAddressHandling);
+    CS104_RedundantConnection_start(con);
 
-    RUN_TEST(test_CS104SlaveConnectionIsRedundancyGroup);
-    RUN_TEST(test_CS104SlaveSingleRedundancyGroup);
+    Thread_sleep(500);
 
-    RUN_TEST(test_CS104SlaveEventQueue1);
-    RUN_TEST(test_CS104SlaveEventQueueOverflow);
-    RUN_TEST(test_CS104SlaveEventQueueOverflow2);
-    RUN_TEST(test_CS104SlaveEventQueueCheckCapacity);
-    RUN_TEST(test_CS104SlaveEventQueueOverflow3);
+    TEST_ASSERT_EQUAL_INT(0, CS104_RedundantConnection_getActiveServer(con));
+    TEST_ASSERT_EQUAL_INT(1, info.switchoverCount);
+    TEST_ASSERT_EQUAL_INT(-1, info.oldServer);
+    TEST_ASSERT_EQUAL_INT(0, info.newServer);
 
-    RUN_TEST(test_CS104_Connection_ConnectTimeout);
+    /* both connections are open, only one is active */
+    TEST_ASSERT_EQUAL_INT(2, CS104_Slave_getOpenConnections(slave1) + CS104_Slave_getOpenConnections(slave2));
 
-    RUN_TEST(test_CS104_Connection_UseAfterClose);
-    RUN_TEST(test_CS104_Connection_UseAfterServerClosedConnection);
+    /* failure of the active server -> standby connection is activated */
+    CS104_Slave_destroy(slave1);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(1, CS104_RedundantConnection_getActiveServer(con));
+    TEST_ASSERT_EQUAL_INT(2, info.switchoverCount);
+    TEST_ASSERT_EQUAL_INT(0, info.oldServer);
+    TEST_ASSERT_EQUAL_INT(1, info.newServer);
+    TEST_ASSERT_NOT_NULL(CS104_RedundantConnection_getActiveConnection(con));
+
+    CS104_RedundantConnection_destroy(con);
+
+    CS104_Slave_destroy(slave2);
+}
+
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+
+static bool
+test_CS104_Slave_QueueReplication_asduHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    int* receivedASDUs = (int*) parameter;
+
+    if (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1)
+        (*receivedASDUs)++;
+
+    return true;
+}
+
+static void
+test_CS104_Slave_QueueReplication_enqueueEvents(CS104_Slave slave, int count, int firstIoa)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, firstIoa + i, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+
+        CS101_ASDU_destroy(asdu);
+    }
+}
+
+void
+test_CS104_Slave_QueueReplication(void)
+{
+    CS104_Slave standby = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(standby, 20005);
+    CS104_Slave_setQueueReplicationListener(standby, "127.0.0.1", 20010);
+    CS104_Slave_start(standby);
+
+    CS104_Slave primary = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(primary, 20004);
+    CS104_Slave_setQueueReplicationTarget(primary, "127.0.0.1", 20010);
+    CS104_Slave_start(primary);
+
+    Thread_sleep(200);
+
+    TEST_ASSERT_TRUE(CS104_Slave_isQueueReplicationConnected(primary));
+    TEST_ASSERT_TRUE(CS104_Slave_isQueueReplicationConnected(standby));
+
+    int receivedASDUs = 0;
+
+    /* events sent and confirmed by the primary are removed from the standby queue */
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    struct sCS104_APCIParameters apciParameters = *CS104_Connection_getAPCIParameters(con);
+    apciParameters.w = 1;
+    CS104_Connection_setAPCIParameters(con, &apciParameters);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_QueueReplication_asduHandler, &receivedASDUs);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(100);
+
+    test_CS104_Slave_QueueReplication_enqueueEvents(primary, 3, 100);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(3, receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getNumberOfQueueEntries(primary, NULL));
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getNumberOfQueueEntries(standby, NULL));
+
+    CS104_Connection_destroy(con);
+
+    Thread_sleep(100);
+
+    /* events not sent by the primary are available at the standby */
+    test_CS104_Slave_QueueReplication_enqueueEvents(primary, 4, 200);
+
+    Thread_sleep(200);
+
+    TEST_ASSERT_EQUAL_INT(4, CS104_Slave_getNumberOfQueueEntries(standby, NULL));
+
+    CS104_Slave_destroy(primary);
+
+    receivedASDUs = 0;
+
+    con = CS104_Connection_create("127.0.0.1", 20005);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_QueueReplication_asduHandler, &receivedASDUs);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(4, receivedASDUs);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(standby);
+}
+
+void
+test_CS104_Slave_QueueReplication_TimeToLive(void)
+{
+    /* the standby has no time to live configuration - the expiration time of the primary is used */
+    CS104_Slave standby = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(standby, 20016);
+    CS104_Slave_setQueueReplicationListener(standby, "127.0.0.1", 20017);
+    CS104_Slave_start(standby);
+
+    CS104_Slave primary = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(primary, 20018);
+    CS104_Slave_addEventTimeToLive(primary, M_ME_NB_1, CS101_COT_SPONTANEOUS, 400);
+    CS104_Slave_setQueueReplicationTarget(primary, "127.0.0.1", 20017);
+    CS104_Slave_start(primary);
+
+    Thread_sleep(200);
+
+    TEST_ASSERT_TRUE(CS104_Slave_isQueueReplicationConnected(primary));
+
+    test_CS104_Slave_QueueReplication_enqueueEvents(primary, 3, 100);
+
+    Thread_sleep(200);
+
+    TEST_ASSERT_EQUAL_INT(3, CS104_Slave_getNumberOfQueueEntries(standby, NULL));
+
+    CS104_Slave_destroy(primary);
+
+    /* the events expire at the standby 400 ms after they were created at the primary */
+    Thread_sleep(300);
+
+    int receivedASDUs = 0;
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20016);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_QueueReplication_asduHandler, &receivedASDUs);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(0, receivedASDUs);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(standby);
+}
+
+#endif /* (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1) */
+
+struct sEventClassesTestInfo {
+    int receivedASDUs;
+    int lastAlarmPosition;
+    int lastMeasurementIoa;
+    bool measurementOrderOk;
+};
+
+static bool
+test_CS104_Slave_EventClasses_asduHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct sEventClassesTestInfo* info = (struct sEventClassesTestInfo*) parameter;
+
+    InformationObject io = CS101_ASDU_getElement(asdu, 0);
+
+    if (CS101_ASDU_getTypeID(asdu) == M_SP_NA_1) {
+        info->receivedASDUs++;
+        info->lastAlarmPosition = info->receivedASDUs;
+    }
+    else if (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1) {
+        info->receivedASDUs++;
+
+        if (InformationObject_getObjectAddress(io) <= info->lastMeasurementIoa)
+            info->measurementOrderOk = false;
+
+        info->lastMeasurementIoa = InformationObject_getObjectAddress(io);
+    }
+
+    InformationObject_destroy(io);
+
+    return true;
+}
+
+void
+test_CS104_Slave_EventClasses(void)
+{
+    int i;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_setEventClass(slave, 3, 50, 4);
+    CS104_Slave_addEventClassMapping(slave, M_SP_NA_1, CS101_COT_SPONTANEOUS, 3);
+
+    CS104_Slave_start(slave);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    /* bulk measurements first ... */
+    for (i = 0; i < 20; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_PERIODIC, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100 + i, i, IEC60870_QUALITY_GOOD);
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+        CS101_ASDU_destroy(asdu);
+    }
+
+    /* ... then the alarms */
+    for (i = 0; i < 5; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 200 + i, true, IEC60870_QUALITY_GOOD);
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+        CS101_ASDU_destroy(asdu);
+    }
+
+    TEST_ASSERT_EQUAL_INT(25, CS104_Slave_getNumberOfQueueEntries(slave, NULL));
+
+    struct sEventClassesTestInfo info;
+    info.receivedASDUs = 0;
+    info.lastAlarmPosition = 0;
+    info.lastMeasurementIoa = 0;
+    info.measurementOrderOk = true;
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_EventClasses_asduHandler, &info);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(25, info.receivedASDUs);
+
+    /* weight 4:1 -> 4 alarms, 1 measurement, 1 alarm */
+    TEST_ASSERT_EQUAL_INT(6, info.lastAlarmPosition);
+    TEST_ASSERT_TRUE(info.measurementOrderOk);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(slave);
+}
+
+struct sEventExpiryTestInfo {
+    int measurements;
+    int alarms;
+    int lastValue[2];
+};
+
+static bool
+test_CS104_Slave_EventExpiry_asduHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct sEventExpiryTestInfo* info = (struct sEventExpiryTestInfo*) parameter;
+
+    if (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1) {
+        MeasuredValueScaled mv = (MeasuredValueScaled) CS101_ASDU_getElement(asdu, 0);
+
+        int index = InformationObject_getObjectAddress((InformationObject) mv) - 100;
+
+        if ((index >= 0) && (index < 2))
+            info->lastValue[index] = MeasuredValueScaled_getValue(mv);
+
+        info->measurements++;
+
+        MeasuredValueScaled_destroy(mv);
+    }
+    else if (CS101_ASDU_getTypeID(asdu) == M_SP_NA_1)
+        info->alarms++;
+
+    return true;
+}
+
+static void
+test_CS104_Slave_EventExpiry_enqueue(CS104_Slave slave, CS101_CauseOfTransmission cot, int ioa, int value, bool alarm)
+{
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, cot, 0, 1, false, false);
+
+    InformationObject io;
+
+    if (alarm)
+        io = (InformationObject) SinglePointInformation_create(NULL, ioa, true, IEC60870_QUALITY_GOOD);
+    else
+        io = (InformationObject) MeasuredValueScaled_create(NULL, ioa, value, IEC60870_QUALITY_GOOD);
+
+    CS101_ASDU_addInformationObject(asdu, io);
+    InformationObject_destroy(io);
+
+    CS104_Slave_enqueueASDU(slave, asdu);
+    CS101_ASDU_destroy(asdu);
+}
+
+void
+test_CS104_Slave_EventExpiry(void)
+{
+    int i;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_addEventTimeToLive(slave, M_ME_NB_1, CS101_COT_SPONTANEOUS, 100);
+    CS104_Slave_setKeepOnlyLatestCyclicValues(slave, true);
+
+    CS104_Slave_start(slave);
+
+    /* periodic values of two points -> only the latest value of each point is kept */
+    for (i = 0; i < 10; i++) {
+        test_CS104_Slave_EventExpiry_enqueue(slave, CS101_COT_PERIODIC, 100, i, false);
+        test_CS104_Slave_EventExpiry_enqueue(slave, CS101_COT_PERIODIC, 101, 100 + i, false);
+    }
+
+    TEST_ASSERT_EQUAL_INT(2, CS104_Slave_getNumberOfQueueEntries(slave, NULL));
+
+    /* spontaneous measurements expire after 100 ms, alarms never expire */
+    for (i = 0; i < 10; i++)
+        test_CS104_Slave_EventExpiry_enqueue(slave, CS101_COT_SPONTANEOUS, 200 + i, i, false);
+
+    for (i = 0; i < 3; i++)
+        test_CS104_Slave_EventExpiry_enqueue(slave, CS101_COT_SPONTANEOUS, 300 + i, 0, true);
+
+    TEST_ASSERT_EQUAL_INT(15, CS104_Slave_getNumberOfQueueEntries(slave, NULL));
+
+    Thread_sleep(200);
+
+    struct sEventExpiryTestInfo info;
+    memset(&info, 0, sizeof(info));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_EventExpiry_asduHandler, &info);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(2, info.measurements);
+    TEST_ASSERT_EQUAL_INT(9, info.lastValue[0]);
+    TEST_ASSERT_EQUAL_INT(109, info.lastValue[1]);
+    TEST_ASSERT_EQUAL_INT(3, info.alarms);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(slave);
+}
+
+static void
+test_CS104_Slave_KeepOnlyLatestMultipleObjects_enqueue(CS104_Slave slave, bool isSequence, int firstIoa, int secondIoa)
+{
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), isSequence, CS101_COT_PERIODIC, 0, 1, false, false);
+
+    InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, firstIoa, 1, IEC60870_QUALITY_GOOD);
+    CS101_ASDU_addInformationObject(asdu, io);
+    InformationObject_destroy(io);
+
+    io = (InformationObject) MeasuredValueScaled_create(NULL, secondIoa, 2, IEC60870_QUALITY_GOOD);
+    CS101_ASDU_addInformationObject(asdu, io);
+    InformationObject_destroy(io);
+
+    CS104_Slave_enqueueASDU(slave, asdu);
+    CS101_ASDU_destroy(asdu);
+}
+
+/*
+ * ASDUs with multiple objects (no sequence) that share the first IOA contain different points and must not
+ * replace each other. Sequences with the same first IOA and size contain the same points.
+ */
+void
+test_CS104_Slave_KeepOnlyLatestMultipleObjects(void)
+{
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave, 20026);
+
+    CS104_Slave_setKeepOnlyLatestCyclicValues(slave, true);
+
+    CS104_Slave_start(slave);
+
+    test_CS104_Slave_KeepOnlyLatestMultipleObjects_enqueue(slave, false, 100, 101);
+    test_CS104_Slave_KeepOnlyLatestMultipleObjects_enqueue(slave, false, 100, 102);
+
+    TEST_ASSERT_EQUAL_INT(2, CS104_Slave_getNumberOfQueueEntries(slave, NULL));
+
+    test_CS104_Slave_KeepOnlyLatestMultipleObjects_enqueue(slave, true, 200, 201);
+    test_CS104_Slave_KeepOnlyLatestMultipleObjects_enqueue(slave, true, 200, 201);
+
+    TEST_ASSERT_EQUAL_INT(3, CS104_Slave_getNumberOfQueueEntries(slave, NULL));
+
+    CS104_Slave_destroy(slave);
+}
+
+struct sOutputRateLimitTestInfo {
+    int received;
+    uint64_t firstReceived;
+    uint64_t lastReceived;
+    IMasterConnection connection;
+};
+
+static bool
+test_CS104_Slave_OutputRateLimit_asduHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct sOutputRateLimitTestInfo* info = (struct sOutputRateLimitTestInfo*) parameter;
+
+    if (info->received == 0)
+        info->firstReceived = Hal_getTimeInMs();
+
+    info->lastReceived = Hal_getTimeInMs();
+    info->received++;
+
+    return true;
+}
+
+static void
+test_CS104_Slave_OutputRateLimit_connectionEventHandler(void* parameter, IMasterConnection connection, CS104_PeerConnectionEvent event)
+{
+    struct sOutputRateLimitTestInfo* info = (struct sOutputRateLimitTestInfo*) parameter;
+
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED)
+        info->connection = connection;
+    else if (event == CS104_CON_EVENT_CONNECTION_CLOSED)
+        info->connection = NULL;
+}
+
+void
+test_CS104_Slave_OutputRateLimit(void)
+{
+    int i;
+
+    struct sOutputRateLimitTestInfo info;
+    memset(&info, 0, sizeof(info));
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    /* 20 messages per second -> one message every 50 ms */
+    CS104_Slave_setOutputRateLimit(slave, 0, 20, 1);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104_Slave_OutputRateLimit_connectionEventHandler, &info);
+
+    CS104_Slave_start(slave);
+
+    for (i = 0; i < 10; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100 + i, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+        CS101_ASDU_destroy(asdu);
+    }
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_OutputRateLimit_asduHandler, &info);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(800);
+
+    TEST_ASSERT_EQUAL_INT(10, info.received);
+
+    /* 9 messages have to wait for the rate limit */
+    TEST_ASSERT_TRUE((info.lastReceived - info.firstReceived) >= 400);
+
+    TEST_ASSERT_NOT_NULL(info.connection);
+
+    CS104_OutputShapingStatistics statistics;
+
+    CS104_Slave_getConnectionOutputStatistics(slave, info.connection, &statistics);
+
+    TEST_ASSERT_EQUAL_INT(10, (int) statistics.sentFrames);
+    TEST_ASSERT_EQUAL_INT(9, (int) statistics.delayedFrames);
+    TEST_ASSERT_TRUE(statistics.maxDelayInMs >= 40);
+    TEST_ASSERT_TRUE(statistics.totalDelayInMs >= 400);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(slave);
+}
+
+static bool
+test_Tracing_asduHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    int* received = (int*) parameter;
+
+    (*received)++;
+
+    return true;
+}
+
+void
+test_Tracing(void)
+{
+    int i;
+    int received = 0;
+    int tracePoints[LIB60870_TRACE_HANDLER_EXIT + 1];
+
+    memset(tracePoints, 0, sizeof(tracePoints));
+
+    TEST_ASSERT_TRUE(Lib60870_startTracing(4096));
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_start(slave);
+
+    for (i = 0; i < 5; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100 + i, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+        CS101_ASDU_destroy(asdu);
+    }
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20004);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_Tracing_asduHandler, &received);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(200);
+
+    CS104_Connection_destroy(con);
+
+    Thread_sleep(100);
+
+    CS104_Slave_destroy(slave);
+
+    Lib60870_stopTracing();
+
+    TEST_ASSERT_EQUAL_INT(5, received);
+
+    Lib60870TraceEvent events[256];
+
+    int numberOfEvents = Lib60870_readTraceEvents(events, 256);
+
+    TEST_ASSERT_TRUE(numberOfEvents > 0);
+    TEST_ASSERT_TRUE(numberOfEvents < 256);
+
+    for (i = 0; i < numberOfEvents; i++) {
+        if (events[i].tracePoint <= LIB60870_TRACE_HANDLER_EXIT)
+            tracePoints[events[i].tracePoint]++;
+
+        if (i > 0) {
+            TEST_ASSERT_TRUE(events[i].timestamp >= events[i - 1].timestamp);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_INT(5, tracePoints[LIB60870_TRACE_ENQUEUE]);
+    TEST_ASSERT_EQUAL_INT(5, tracePoints[LIB60870_TRACE_DEQUEUE]);
+    TEST_ASSERT_EQUAL_INT(5, tracePoints[LIB60870_TRACE_SEND_I]);
+    TEST_ASSERT_EQUAL_INT(5, tracePoints[LIB60870_TRACE_RECV_I]);
+    TEST_ASSERT_EQUAL_INT(5, tracePoints[LIB60870_TRACE_HANDLER_ENTER]);
+    TEST_ASSERT_EQUAL_INT(5, tracePoints[LIB60870_TRACE_HANDLER_EXIT]);
+    TEST_ASSERT_EQUAL_INT(2, tracePoints[LIB60870_TRACE_CONNECT]);
+    TEST_ASSERT_EQUAL_INT(2, tracePoints[LIB60870_TRACE_DISCONNECT]);
+
+    /* no more events after stop */
+    TEST_ASSERT_EQUAL_INT(0, Lib60870_readTraceEvents(events, 256));
+
+    /* overwritten events are skipped by the reader */
+    slave = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave, 20004);
+    CS104_Slave_start(slave);
+
+    TEST_ASSERT_TRUE(Lib60870_startTracing(16));
+
+    for (i = 0; i < 20; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 100 + i, true, IEC60870_QUALITY_GOOD);
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+        CS101_ASDU_destroy(asdu);
+    }
+
+    Lib60870_stopTracing();
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(16, Lib60870_readTraceEvents(events, 256));
+    TEST_ASSERT_EQUAL_INT(4, (int) Lib60870_getNumberOfLostTraceEvents());
+}
+
+struct sTracingRestartInfo {
+    CS104_Slave slave;
+    volatile bool running;
+};
+
+static void*
+test_Tracing_restartWhileWriting_thread(void* parameter)
+{
+    struct sTracingRestartInfo* info = (struct sTracingRestartInfo*) parameter;
+
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(info->slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+    InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 100, true, IEC60870_QUALITY_GOOD);
+    CS101_ASDU_addInformationObject(asdu, io);
+    InformationObject_destroy(io);
+
+    while (info->running)
+        CS104_Slave_enqueueASDU(info->slave, asdu);
+
+    CS101_ASDU_destroy(asdu);
+
+    return NULL;
+}
+
+void
+test_Tracing_restartWhileWriting(void)
+{
+    Lib60870TraceEvent events[64];
+    struct sTracingRestartInfo info;
+    Thread threads[3];
+    int i;
+
+    info.slave = CS104_Slave_create(100, 100);
+    info.running = true;
+
+    CS104_Slave_setLocalPort(info.slave, 20019);
+    CS104_Slave_start(info.slave);
+
+    TEST_ASSERT_TRUE(Lib60870_startTracing(16));
+
+    for (i = 0; i < 3; i++) {
+        threads[i] = Thread_create(test_Tracing_restartWhileWriting_thread, &info, false);
+        Thread_start(threads[i]);
+    }
+
+    /* the replaced buffers must not be released while a writer uses them */
+    for (i = 0; i < 200; i++) {
+        TEST_ASSERT_TRUE(Lib60870_startTracing((i % 2) ? 16 : 64));
+
+        Lib60870_readTraceEvents(events, 64);
+    }
+
+    info.running = false;
+
+    for (i = 0; i < 3; i++)
+        Thread_destroy(threads[i]);
+
+    Lib60870_stopTracing();
+
+    CS104_Slave_destroy(info.slave);
+}
+
+static void
+test_CS104_Slave_ExternalEventLoop_run(CS104_Slave slave, int durationInMs)
+{
+    uint64_t endTime = Hal_getTimeInMs() + durationInMs;
+
+    while (Hal_getTimeInMs() < endTime) {
+        CS104_SlavePollDescriptor descriptors[10];
+        struct pollfd fds[10];
+        int i;
+
+        int count = CS104_Slave_getPollDescriptors(slave, descriptors, 10);
+
+        for (i = 0; i < count; i++) {
+            fds[i].fd = descriptors[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+
+            if (descriptors[i].events & CS104_SLAVE_POLL_WRITE)
+                fds[i].events |= POLLOUT;
+        }
+
+        int timeout = CS104_Slave_getNextTimeout(slave);
+
+        if ((timeout < 0) || (timeout > 10))
+            timeout = 10;
+
+        if (poll(fds, count, timeout) > 0) {
+            for (i = 0; i < count; i++) {
+                if (fds[i].revents & POLLOUT)
+                    CS104_Slave_handleWritable(slave, fds[i].fd);
+
+                if (fds[i].revents & ~POLLOUT)
+                    CS104_Slave_handleReadable(slave, fds[i].fd);
+            }
+        }
+
+        CS104_Slave_handleTimers(slave);
+    }
+}
+
+void
+test_CS104_Slave_ExternalEventLoop(void)
+{
+    int i;
+    int received = 0;
+    CS104_SlavePollDescriptor descriptors[10];
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave, 20005);
+
+    /* not started -> nothing to monitor */
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getPollDescriptors(slave, descriptors, 10));
+    TEST_ASSERT_EQUAL_INT(-1, CS104_Slave_getNextTimeout(slave));
+
+    CS104_Slave_startThreadless(slave);
+
+    /* only the listening socket and no timers */
+    TEST_ASSERT_EQUAL_INT(1, CS104_Slave_getPollDescriptors(slave, descriptors, 10));
+    TEST_ASSERT_EQUAL_INT(CS104_SLAVE_POLL_READ, descriptors[0].events);
+    TEST_ASSERT_EQUAL_INT(-1, CS104_Slave_getNextTimeout(slave));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20005);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_Tracing_asduHandler, &received);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    test_CS104_Slave_ExternalEventLoop_run(slave, 100);
+
+    TEST_ASSERT_EQUAL_INT(1, CS104_Slave_getOpenConnections(slave));
+
+    /* listening socket, connection socket, and wake-up descriptor of the connection */
+    TEST_ASSERT_EQUAL_INT(3, CS104_Slave_getPollDescriptors(slave, descriptors, 10));
+
+    /* the t3 timer is running */
+    TEST_ASSERT_TRUE(CS104_Slave_getNextTimeout(slave) > 1000);
+
+    CS104_Connection_sendStartDT(con);
+
+    test_CS104_Slave_ExternalEventLoop_run(slave, 100);
+
+    for (i = 0; i < 5; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100 + i, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+        CS101_ASDU_destroy(asdu);
+    }
+
+    /* waiting ASDUs have to be sent immediately */
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getNextTimeout(slave));
+
+    test_CS104_Slave_ExternalEventLoop_run(slave, 200);
+
+    TEST_ASSERT_EQUAL_INT(5, received);
+
+    /* all ASDUs sent -> only protocol timers are running */
+    TEST_ASSERT_TRUE(CS104_Slave_getNextTimeout(slave) > 1000);
+
+    CS104_Connection_destroy(con);
+
+    test_CS104_Slave_ExternalEventLoop_run(slave, 100);
+
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getOpenConnections(slave));
+    TEST_ASSERT_EQUAL_INT(1, CS104_Slave_getPollDescriptors(slave, descriptors, 10));
+
+    CS104_Slave_stopThreadless(slave);
+
+    CS104_Slave_destroy(slave);
+}
+
+static bool
+test_CS104_Slave_EnqueueASDUs_asduHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    int* lastValue = (int*) parameter;
+
+    MeasuredValueScaled io = (MeasuredValueScaled) CS101_ASDU_getElement(asdu, 0);
+
+    /* values have to be received in the enqueue order */
+    if (MeasuredValueScaled_getValue(io) == *lastValue + 1)
+        *lastValue = MeasuredValueScaled_getValue(io);
+
+    MeasuredValueScaled_destroy(io);
+
+    return true;
+}
+
+void
+test_CS104_Slave_EnqueueASDUs(void)
+{
+    int i;
+    int lastValue = -1;
+    CS101_ASDU asdus[200];
+
+    CS104_Slave slave = CS104_Slave_create(300, 100);
+    CS104_Slave_setLocalPort(slave, 20006);
+
+    CS104_Slave_start(slave);
+
+    for (i = 0; i < 200; i++) {
+        asdus[i] = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100 + i, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdus[i], io);
+        InformationObject_destroy(io);
+    }
+
+    CS104_Slave_enqueueASDUs(slave, asdus, 10);
+    /* larger than the encoding chunk and not a multiple of it */
+    CS104_Slave_enqueueASDUs(slave, asdus + 10, 190);
+
+    for (i = 0; i < 200; i++)
+        CS101_ASDU_destroy(asdus[i]);
+
+    TEST_ASSERT_EQUAL_INT(200, CS104_Slave_getNumberOfQueueEntries(slave, NULL));
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20006);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_EnqueueASDUs_asduHandler, &lastValue);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(1000);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(199, lastValue);
+}
+
+static void
+test_CS104_Slave_AdaptiveWindow_connectionEventHandler(void* parameter, IMasterConnection connection, CS104_PeerConnectionEvent event)
+{
+    IMasterConnection* connectionPtr = (IMasterConnection*) parameter;
+
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED)
+        *connectionPtr = connection;
+    else if (event == CS104_CON_EVENT_CONNECTION_CLOSED)
+        *connectionPtr = NULL;
+}
+
+void
+test_CS104_Slave_AdaptiveWindow(void)
+{
+    int i;
+    IMasterConnection connection = NULL;
+    CS104_LinkStatistics statistics;
+
+    uint8_t startDtAct[] = { 0x68, 0x04, 0x07, 0x00, 0x00, 0x00 };
+    uint8_t sMessage[] = { 0x68, 0x04, 0x01, 0x00, 0x00, 0x00 };
+
+    uint8_t buffer[4096];
+    int bufPos = 0;
+
+    /* receive times of the I messages - used to delay the acknowledgements */
+    static uint64_t receiveTimes[4000];
+    int receivedIMessages = 0;
+    int confirmedIMessages = 0;
+
+    CS104_Slave slave = CS104_Slave_create(100, 4000);
+    CS104_Slave_setLocalPort(slave, 20007);
+    CS104_Slave_setAdaptiveWindow(slave, 100, 0);
+    CS104_Slave_setAdaptiveT1(slave, true);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104_Slave_AdaptiveWindow_connectionEventHandler, &connection);
+
+    CS104_Slave_start(slave);
+
+    for (i = 0; i < 4000; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100, i % 1000, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+
+        CS101_ASDU_destroy(asdu);
+    }
+
+    Socket socket = TcpSocket_create();
+
+    TEST_ASSERT_TRUE(Socket_connect(socket, "127.0.0.1", 20007));
+
+    Socket_write(socket, startDtAct, sizeof(startDtAct));
+
+    /* emulate a link with 100 ms round trip time: acknowledge I messages 100 ms after reception */
+    uint64_t endTime = Hal_getTimeInMs() + 2000;
+
+    while (Hal_getTimeInMs() < endTime) {
+        int readBytes = Socket_read(socket, buffer + bufPos, sizeof(buffer) - bufPos);
+
+        if (readBytes < 0)
+            break;
+
+        bufPos += readBytes;
+
+        uint64_t currentTime = Hal_getTimeInMs();
+
+        int pos = 0;
+
+        while ((bufPos - pos >= 6) && (bufPos - pos >= buffer[pos + 1] + 2)) {
+            if (((buffer[pos + 2] & 0x01) == 0) && (receivedIMessages < 4000))
+                receiveTimes[receivedIMessages++] = currentTime;
+
+            pos += buffer[pos + 1] + 2;
+        }
+
+        memmove(buffer, buffer + pos, bufPos - pos);
+        bufPos -= pos;
+
+        int newConfirmed = confirmedIMessages;
+
+        while ((newConfirmed < receivedIMessages) && (receiveTimes[newConfirmed] + 100 <= currentTime))
+            newConfirmed++;
+
+        if (newConfirmed > confirmedIMessages) {
+            confirmedIMessages = newConfirmed;
+
+            int seqNo = confirmedIMessages % 32768;
+
+            sMessage[4] = (uint8_t) ((seqNo % 128) * 2);
+            sMessage[5] = (uint8_t) (seqNo / 128);
+
+            Socket_write(socket, sMessage, sizeof(sMessage));
+        }
+
+        Thread_sleep(2);
+    }
+
+    TEST_ASSERT_NOT_NULL(connection);
+
+    CS104_Slave_getConnectionLinkStatistics(slave, connection, &statistics);
+
+    Socket_destroy(socket);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_TRUE(statistics.confirmedFrames > 0);
+    TEST_ASSERT_TRUE(statistics.minRttInMs >= 100);
+    TEST_ASSERT_TRUE(statistics.rttInMs >= 100);
+    TEST_ASSERT_TRUE(statistics.t1InMs >= 15000);
+    TEST_ASSERT_TRUE(statistics.k > 12);
+    TEST_ASSERT_TRUE(statistics.k <= 100);
+    TEST_ASSERT_EQUAL_INT(8, statistics.w);
+
+    /* with the fixed window (k = 12) less than 240 messages can be received in 2 s */
+    TEST_ASSERT_TRUE(receivedIMessages > 240);
+}
+
+void
+test_CS104_Slave_ReuseConnections(void)
+{
+    int round, i;
+    CS104_Connection cons[4];
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+    CS104_Slave_setLocalPort(slave, 20008);
+    CS104_Slave_setServerMode(slave, CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP);
+    CS104_Slave_setMaxOpenConnections(slave, 3);
+
+    CS104_Slave_start(slave);
+
+    /* connection objects have to be returned to the pool when the clients disconnect */
+    for (round = 0; round < 3; round++) {
+        for (i = 0; i < 4; i++) {
+            cons[i] = CS104_Connection_create("127.0.0.1", 20008);
+            CS104_Connection_connect(cons[i]);
+        }
+
+        Thread_sleep(200);
+
+        TEST_ASSERT_EQUAL_INT(3, CS104_Slave_getOpenConnections(slave));
+
+        for (i = 0; i < 4; i++)
+            CS104_Connection_destroy(cons[i]);
+
+        Thread_sleep(300);
+
+        TEST_ASSERT_EQUAL_INT(0, CS104_Slave_getOpenConnections(slave));
+    }
+
+    CS104_Slave_destroy(slave);
+}
+
+static bool
+test_CS104_ReceiveTimestamps_interrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, uint8_t qoi)
+{
+    uint64_t* receiveTime = (uint64_t*) parameter;
+
+    *receiveTime = CS101_ASDU_getReceiveTimestamp(asdu);
+
+    IMasterConnection_sendACT_CON(connection, asdu, false);
+
+    return true;
+}
+
+static bool
+test_CS104_ReceiveTimestamps_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    uint64_t* receiveTime = (uint64_t*) parameter;
+
+    if (CS101_ASDU_getTypeID(asdu) == C_IC_NA_1)
+        *receiveTime = CS101_ASDU_getReceiveTimestamp(asdu);
+
+    return true;
+}
+
+void
+test_CS104_ReceiveTimestamps(void)
+{
+    uint64_t slaveReceiveTime = 0;
+    uint64_t masterReceiveTime = 0;
+    IMasterConnection connection = NULL;
+    CS104_LinkStatistics statistics;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20009);
+    CS104_Slave_setReceiveTimestamps(slave, true);
+    CS104_Slave_setInterrogationHandler(slave, test_CS104_ReceiveTimestamps_interrogationHandler, &slaveReceiveTime);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104_Slave_AdaptiveWindow_connectionEventHandler, &connection);
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20009);
+
+    CS104_Connection_setReceiveTimestamps(con, true);
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_ReceiveTimestamps_asduReceivedHandler, &masterReceiveTime);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(100);
+
+    uint64_t sendTime = Hal_getTimeInNs();
+
+    CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+    Thread_sleep(500);
+
+    uint64_t endTime = Hal_getTimeInNs();
+
+    TEST_ASSERT_NOT_NULL(connection);
+
+    CS104_Slave_getConnectionLinkStatistics(slave, connection, &statistics);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(slave);
+
+    /* the time stamps are taken when the messages are received */
+    TEST_ASSERT_TRUE(slaveReceiveTime >= sendTime);
+    TEST_ASSERT_TRUE(slaveReceiveTime <= endTime);
+    TEST_ASSERT_TRUE(masterReceiveTime >= slaveReceiveTime);
+    TEST_ASSERT_TRUE(masterReceiveTime <= endTime);
+
+    TEST_ASSERT_TRUE(statistics.receiveDelayInUs >= 0);
+    TEST_ASSERT_TRUE(statistics.maxReceiveDelayInUs >= statistics.receiveDelayInUs);
+}
+
+static int test_CS101_StreamMerger_forwarded = 0;
+
+static bool
+test_CS101_StreamMerger_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    test_CS101_StreamMerger_forwarded++;
+
+    return true;
+}
+
+static CS101_ASDU
+test_CS101_StreamMerger_createASDU(int ioa1, bool value1, int ioa2, bool value2)
+{
+    CS101_ASDU asdu = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+    InformationObject io = (InformationObject) SinglePointInformation_create(NULL, ioa1, value1, IEC60870_QUALITY_GOOD);
+    CS101_ASDU_addInformationObject(asdu, io);
+    InformationObject_destroy(io);
+
+    if (ioa2 > 0) {
+        io = (InformationObject) SinglePointInformation_create(NULL, ioa2, value2, IEC60870_QUALITY_GOOD);
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+    }
+
+    return asdu;
+}
+
+void
+test_CS101_StreamMerger(void)
+{
+    CS101_StreamMergerStatistics statistics;
+
+    test_CS101_StreamMerger_forwarded = 0;
+
+    CS101_StreamMerger merger = CS101_StreamMerger_create(100, 200);
+    TEST_ASSERT_NOT_NULL(merger);
+
+    CS101_StreamMerger_setASDUReceivedHandler(merger, test_CS101_StreamMerger_asduReceivedHandler, NULL);
+
+    CS101_ASDU asdu1 = test_CS101_StreamMerger_createASDU(100, true, 0, false);
+    CS101_ASDU asdu2 = test_CS101_StreamMerger_createASDU(100, false, 0, false);
+    CS101_ASDU asdu3 = test_CS101_StreamMerger_createASDU(100, true, 101, true);
+
+    /* same event received over two connections */
+    CS101_StreamMerger_asduReceivedHandler(merger, 0, asdu1);
+    CS101_StreamMerger_asduReceivedHandler(merger, 1, asdu1);
+    TEST_ASSERT_EQUAL_INT(1, test_CS101_StreamMerger_forwarded);
+
+    /* different value of the same point */
+    CS101_StreamMerger_asduReceivedHandler(merger, 0, asdu2);
+    TEST_ASSERT_EQUAL_INT(2, test_CS101_StreamMerger_forwarded);
+
+    /* ASDU with one new information object */
+    CS101_StreamMerger_asduReceivedHandler(merger, 1, asdu3);
+    CS101_StreamMerger_asduReceivedHandler(merger, 0, asdu3);
+    TEST_ASSERT_EQUAL_INT(3, test_CS101_StreamMerger_forwarded);
+
+    /* commands are never suppressed */
+    CS101_ASDU cmd = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_ACTIVATION_CON, 0, 1, false, false);
+    InformationObject sc = (InformationObject) SingleCommand_create(NULL, 5000, true, false, 0);
+    CS101_ASDU_addInformationObject(cmd, sc);
+    InformationObject_destroy(sc);
+
+    CS101_StreamMerger_asduReceivedHandler(merger, 0, cmd);
+    CS101_StreamMerger_asduReceivedHandler(merger, 1, cmd);
+    TEST_ASSERT_EQUAL_INT(5, test_CS101_StreamMerger_forwarded);
+
+    /* the same event is forwarded again after the window has expired */
+    Thread_sleep(450);
+
+    CS101_StreamMerger_asduReceivedHandler(merger, 0, asdu1);
+    TEST_ASSERT_EQUAL_INT(6, test_CS101_StreamMerger_forwarded);
+
+    CS101_StreamMerger_getStatistics(merger, &statistics);
+
+    TEST_ASSERT_EQUAL_UINT64(8, statistics.receivedASDUs);
+    TEST_ASSERT_EQUAL_UINT64(6, statistics.forwardedASDUs);
+    TEST_ASSERT_EQUAL_UINT64(2, statistics.suppressedASDUs);
+
+    CS101_ASDU_destroy(asdu1);
+    CS101_ASDU_destroy(asdu2);
+    CS101_ASDU_destroy(asdu3);
+    CS101_ASDU_destroy(cmd);
+
+    CS101_StreamMerger_destroy(merger);
+}
+
+typedef struct {
+    int received[3];
+    int lastIOA[3];
+    int orderErrors;
+} test_CS104_DecodePipeline_Context;
+
+static bool
+test_CS104_DecodePipeline_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    test_CS104_DecodePipeline_Context* context = (test_CS104_DecodePipeline_Context*) parameter;
+
+    int ca = CS101_ASDU_getCA(asdu);
+
+    if ((CS101_ASDU_getTypeID(asdu) == M_ME_NB_1) && (ca >= 1) && (ca <= 3)) {
+        InformationObject io = CS101_ASDU_getElement(asdu, 0);
+
+        /* the ASDUs of one station are always handled by the same worker */
+        if (InformationObject_getObjectAddress(io) <= context->lastIOA[ca - 1])
+            context->orderErrors++;
+
+        context->lastIOA[ca - 1] = InformationObject_getObjectAddress(io);
+        context->received[ca - 1]++;
+
+        InformationObject_destroy(io);
+
+        Thread_sleep(1);
+    }
+
+    return true;
+}
+
+void
+test_CS104_DecodePipeline(void)
+{
+    test_CS104_DecodePipeline_Context context;
+    CS104_DecodePipelineStatistics statistics;
+    int i;
+
+    memset(&context, 0, sizeof(context));
+
+    CS104_Slave slave = CS104_Slave_create(100, 400);
+
+    CS104_Slave_setLocalPort(slave, 20010);
+    CS104_Slave_start(slave);
+
+    CS104_DecodePipeline pipeline = CS104_DecodePipeline_create(3, 4);
+    TEST_ASSERT_NOT_NULL(pipeline);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20010);
+
+    CS104_Connection_setDecodePipeline(con, pipeline);
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_DecodePipeline_asduReceivedHandler, &context);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(100);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    for (i = 0; i < 300; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, (i % 3) + 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100 + i, i, IEC60870_QUALITY_GOOD);
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+
+        CS101_ASDU_destroy(asdu);
+    }
+
+    int waitTime = 0;
+
+    do {
+        Thread_sleep(10);
+        waitTime += 10;
+
+        CS104_DecodePipeline_getStatistics(pipeline, &statistics);
+    } while ((statistics.handledASDUs < 300) && (waitTime < 10000));
+
+    CS104_Connection_destroy(con);
+
+    CS104_DecodePipeline_destroy(pipeline);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(100, context.received[0]);
+    TEST_ASSERT_EQUAL_INT(100, context.received[1]);
+    TEST_ASSERT_EQUAL_INT(100, context.received[2]);
+    TEST_ASSERT_EQUAL_INT(0, context.orderErrors);
+    TEST_ASSERT_TRUE(statistics.handledASDUs >= 300);
+}
+
+typedef struct {
+    volatile int maxConfirmed; /* highest N(R) sent by the master */
+    volatile int confirmedBeforeHandled; /* N(R) sent before the first ASDU was handled */
+    volatile int handled;
+} test_CS104_DecodePipeline_Confirm_Context;
+
+static void
+test_CS104_DecodePipeline_Confirm_rawMessageHandler(void* parameter, uint8_t* msg, int msgSize, bool sent)
+{
+    test_CS104_DecodePipeline_Confirm_Context* context = (test_CS104_DecodePipeline_Confirm_Context*) parameter;
+
+    /* S message sent by the master */
+    if (sent && (msgSize == 6) && ((msg[2] & 0x03) == 0x01)) {
+        int recvSeqNo = (msg[4] + (msg[5] * 0x100)) / 2;
+
+        if (recvSeqNo > context->maxConfirmed)
+            context->maxConfirmed = recvSeqNo;
+    }
+}
+
+static bool
+test_CS104_DecodePipeline_Confirm_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    test_CS104_DecodePipeline_Confirm_Context* context = (test_CS104_DecodePipeline_Confirm_Context*) parameter;
+
+    /* the first ASDU (CA 1) is handled while the ASDUs of the other station are already finished */
+    if (CS101_ASDU_getCA(asdu) == 1) {
+        Thread_sleep(500);
+
+        context->confirmedBeforeHandled = context->maxConfirmed;
+    }
+
+    context->handled++;
+
+    return true;
+}
+
+/* I messages are only confirmed when all older I messages have been handled by the workers */
+void
+test_CS104_DecodePipeline_ConfirmInOrder(void)
+{
+    test_CS104_DecodePipeline_Confirm_Context context;
+    int i;
+
+    memset(&context, 0, sizeof(context));
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20023);
+    CS104_Slave_start(slave);
+
+    CS104_DecodePipeline pipeline = CS104_DecodePipeline_create(2, 20);
+    TEST_ASSERT_NOT_NULL(pipeline);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20023);
+
+    CS104_Connection_setDecodePipeline(con, pipeline);
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_DecodePipeline_Confirm_asduReceivedHandler, &context);
+    CS104_Connection_setRawMessageHandler(con, test_CS104_DecodePipeline_Confirm_rawMessageHandler, &context);
+
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    /* one ASDU of station 1 followed by ten ASDUs of station 2 (more than w = 8) */
+    for (i = 0; i < 11; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, (i == 0) ? 1 : 2, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100 + i, i, IEC60870_QUALITY_GOOD);
+        CS101_ASDU_addInformationObject(asdu, io);
+        InformationObject_destroy(io);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+
+        CS101_ASDU_destroy(asdu);
+    }
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    int waitTime = 0;
+
+    while (((context.handled < 11) || (context.maxConfirmed < 11)) && (waitTime < 3000)) {
+        Thread_sleep(10);
+        waitTime += 10;
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_DecodePipeline_destroy(pipeline);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(11, context.handled);
+
+    /* nothing was confirmed while the first ASDU was not handled */
+    TEST_ASSERT_EQUAL_INT(0, context.confirmedBeforeHandled);
+    TEST_ASSERT_EQUAL_INT(11, context.maxConfirmed);
+}
+
+void
+test_CS104_DecodePipeline_ThreadAttributes(void)
+{
+    struct sThreadAttributes attributes;
+
+    attributes.stackSize = 64 * 1024;
+    attributes.cpuAffinity = 0;
+    attributes.priority = 0;
+    attributes.name = "iec104decode";
+
+    CS104_DecodePipeline pipeline = CS104_DecodePipeline_createEx(3, 20, &attributes);
+    TEST_ASSERT_NOT_NULL(pipeline);
+
+#if defined(__linux__) && defined(__GLIBC__)
+    /* the workers set their name when they are running */
+    int waitTime = 0;
+
+    while ((test_ThreadAttributes_countThreads("iec104decode") < 3) && (waitTime < 1000)) {
+        Thread_sleep(10);
+        waitTime += 10;
+    }
+
+    TEST_ASSERT_EQUAL_INT(3, test_ThreadAttributes_countThreads("iec104decode"));
+#endif
+
+    CS104_DecodePipeline_destroy(pipeline);
+}
+
+static bool
+test_CS101_ASDUDispatcher_handler(void* parameter, int address, CS101_ASDU asdu)
+{
+    int* counter = (int*) parameter;
+
+    (*counter)++;
+
+    return true;
+}
+
+void
+test_CS101_ASDUDispatcher(void)
+{
+    int station1Measurements = 0;
+    int station1Other = 0;
+    int allStationsCommands = 0;
+    int unhandled = 0;
+
+    CS101_ASDUDispatcher dispatcher = CS101_ASDUDispatcher_create(3);
+    TEST_ASSERT_NOT_NULL(dispatcher);
+
+    TEST_ASSERT_TRUE(CS101_ASDUDispatcher_addHandler(dispatcher, 1, M_ME_NB_1, test_CS101_ASDUDispatcher_handler, &station1Measurements));
+    TEST_ASSERT_TRUE(CS101_ASDUDispatcher_addHandler(dispatcher, 1, CS101_ASDU_DISPATCHER_ANY, test_CS101_ASDUDispatcher_handler, &station1Other));
+    TEST_ASSERT_TRUE(CS101_ASDUDispatcher_addHandler(dispatcher, CS101_ASDU_DISPATCHER_ANY, C_SC_NA_1, test_CS101_ASDUDispatcher_handler, &allStationsCommands));
+
+    /* maximum number of handlers reached - replacing an existing handler is still possible */
+    TEST_ASSERT_FALSE(CS101_ASDUDispatcher_addHandler(dispatcher, 2, M_ME_NB_1, test_CS101_ASDUDispatcher_handler, &unhandled));
+    TEST_ASSERT_TRUE(CS101_ASDUDispatcher_addHandler(dispatcher, 1, M_ME_NB_1, test_CS101_ASDUDispatcher_handler, &station1Measurements));
+
+    CS101_ASDU measurement1 = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+    CS101_ASDU_setTypeID(measurement1, M_ME_NB_1);
+
+    CS101_ASDU singlePoint1 = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+    CS101_ASDU_setTypeID(singlePoint1, M_SP_NA_1);
+
+    CS101_ASDU command2 = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_ACTIVATION_CON, 0, 2, false, false);
+    CS101_ASDU_setTypeID(command2, C_SC_NA_1);
+
+    CS101_ASDU measurement2 = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_SPONTANEOUS, 0, 2, false, false);
+    CS101_ASDU_setTypeID(measurement2, M_ME_NB_1);
+
+    TEST_ASSERT_TRUE(CS101_ASDUDispatcher_asduReceivedHandler(dispatcher, 0, measurement1));
+    TEST_ASSERT_TRUE(CS101_ASDUDispatcher_asduReceivedHandler(dispatcher, 0, singlePoint1));
+    TEST_ASSERT_TRUE(CS101_ASDUDispatcher_asduReceivedHandler(dispatcher, 0, command2));
+
+    /* no default handler */
+    TEST_ASSERT_FALSE(CS101_ASDUDispatcher_asduReceivedHandler(dispatcher, 0, measurement2));
+
+    CS101_ASDUDispatcher_setDefaultHandler(dispatcher, test_CS101_ASDUDispatcher_handler, &unhandled);
+
+    TEST_ASSERT_TRUE(CS101_ASDUDispatcher_asduReceivedHandler(dispatcher, 0, measurement2));
+
+    TEST_ASSERT_EQUAL_INT(1, station1Measurements);
+    TEST_ASSERT_EQUAL_INT(1, station1Other);
+    TEST_ASSERT_EQUAL_INT(1, allStationsCommands);
+    TEST_ASSERT_EQUAL_INT(1, unhandled);
+
+    CS101_ASDU_destroy(measurement1);
+    CS101_ASDU_destroy(singlePoint1);
+    CS101_ASDU_destroy(command2);
+    CS101_ASDU_destroy(measurement2);
+
+    CS101_ASDUDispatcher_destroy(dispatcher);
+}
+
+typedef struct {
+    int handledASDUs;
+    int calls;
+} test_CS104_Slave_PluginForTypeID_Plugin;
+
+static CS101_SlavePlugin_Result
+test_CS104_Slave_PluginForTypeID_handleAsdu(void* parameter, IMasterConnection connection, CS101_ASDU asdu)
+{
+    test_CS104_Slave_PluginForTypeID_Plugin* plugin = (test_CS104_Slave_PluginForTypeID_Plugin*) parameter;
+
+    plugin->calls++;
+
+    if (CS101_ASDU_getTypeID(asdu) == C_SC_NA_1) {
+        plugin->handledASDUs++;
+
+        CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
+        IMasterConnection_sendASDU(connection, asdu);
+
+        return CS101_PLUGIN_RESULT_HANDLED;
+    }
+
+    return CS101_PLUGIN_RESULT_NOT_HANDLED;
+}
+
+static void
+test_CS104_Slave_PluginForTypeID_runTask(void* parameter, IMasterConnection connection)
+{
+}
+
+void
+test_CS104_Slave_PluginForTypeID(void)
+{
+    test_CS104_Slave_PluginForTypeID_Plugin commandPluginData;
+    test_CS104_Slave_PluginForTypeID_Plugin generalPluginData;
+
+    memset(&commandPluginData, 0, sizeof(commandPluginData));
+    memset(&generalPluginData, 0, sizeof(generalPluginData));
+
+    struct sCS101_SlavePlugin commandPlugin = {
+        test_CS104_Slave_PluginForTypeID_handleAsdu, test_CS104_Slave_PluginForTypeID_runTask, &commandPluginData
+    };
+
+    struct sCS101_SlavePlugin generalPlugin = {
+        test_CS104_Slave_PluginForTypeID_handleAsdu, test_CS104_Slave_PluginForTypeID_runTask, &generalPluginData
+    };
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20011);
+    CS104_Slave_addPluginForTypeID(slave, &commandPlugin, C_SC_NA_1);
+    CS104_Slave_addPluginForTypeID(slave, &commandPlugin, C_SC_TA_1);
+    CS104_Slave_addPlugin(slave, &generalPlugin);
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20011);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(100);
+
+    InformationObject sc = (InformationObject) SingleCommand_create(NULL, 5000, true, false, 0);
+
+    CS104_Connection_sendProcessCommandEx(con, CS101_COT_ACTIVATION, 1, sc);
+    CS104_Connection_sendProcessCommandEx(con, CS101_COT_ACTIVATION, 1, sc);
+
+    InformationObject_destroy(sc);
+
+    CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+    Thread_sleep(500);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(slave);
+
+    /* the command plugin is only called for commands */
+    TEST_ASSERT_EQUAL_INT(2, commandPluginData.calls);
+    TEST_ASSERT_EQUAL_INT(2, commandPluginData.handledASDUs);
+
+    /* the general plugin is not called for the commands handled by the command plugin */
+    TEST_ASSERT_EQUAL_INT(1, generalPluginData.calls);
+    TEST_ASSERT_EQUAL_INT(0, generalPluginData.handledASDUs);
+}
+
+static bool
+test_CS104_Campaign_interrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, uint8_t qoi)
+{
+    IMasterConnection_sendACT_CON(connection, asdu, false);
+    IMasterConnection_sendACT_TERM(connection, asdu);
+
+    return true;
+}
+
+static bool
+test_CS104_Campaign_clockSyncHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, CP56Time2a newTime)
+{
+    int* clockSyncs = (int*) parameter;
+
+    (*clockSyncs)++;
+
+    return true;
+}
+
+static void
+test_CS104_Campaign_completedHandler(void* parameter, CS104_Campaign campaign)
+{
+    int* completed = (int*) parameter;
+
+    (*completed)++;
+}
+
+void
+test_CS104_Campaign(void)
+{
+    int clockSyncs = 0;
+    int completed = 0;
+    int i;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20012);
+    CS104_Slave_setServerMode(slave, CS104_MODE_CONNECTION_IS_REDUNDANCY_GROUP);
+    CS104_Slave_setInterrogationHandler(slave, test_CS104_Campaign_interrogationHandler, NULL);
+    CS104_Slave_setClockSyncHandler(slave, test_CS104_Campaign_clockSyncHandler, &clockSyncs);
+    CS104_Slave_start(slave);
+
+    CS104_Connection connections[3];
+
+    for (i = 0; i < 3; i++) {
+        connections[i] = CS104_Connection_create("127.0.0.1", 20012);
+
+        TEST_ASSERT_TRUE(CS104_Connection_connect(connections[i]));
+
+        CS104_Connection_sendStartDT(connections[i]);
+    }
+
+    /* not connected */
+    CS104_Connection unconnected = CS104_Connection_create("127.0.0.1", 20012);
+
+    Thread_sleep(100);
+
+    CS104_Campaign campaign = CS104_Campaign_create(10);
+
+    for (i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_INT(i, CS104_Campaign_addStation(campaign, connections[i], 1));
+
+    TEST_ASSERT_EQUAL_INT(3, CS104_Campaign_addStation(campaign, connections[0], 2));
+    TEST_ASSERT_EQUAL_INT(4, CS104_Campaign_addStation(campaign, unconnected, 1));
+
+    CS104_Campaign_setMaxConcurrency(campaign, 2);
+    CS104_Campaign_setTimeouts(campaign, 2000, 2000);
+    CS104_Campaign_setCompletedHandler(campaign, test_CS104_Campaign_completedHandler, &completed);
+
+    TEST_ASSERT_TRUE(CS104_Campaign_startInterrogation(campaign, IEC60870_QOI_STATION));
+    TEST_ASSERT_FALSE(CS104_Campaign_startClockSync(campaign));
+
+    while (CS104_Campaign_isRunning(campaign))
+        Thread_sleep(10);
+
+    CS104_CampaignStatistics statistics;
+
+    CS104_Campaign_getStatistics(campaign, &statistics);
+
+    TEST_ASSERT_EQUAL_INT(1, completed);
+    TEST_ASSERT_EQUAL_INT(5, statistics.numberOfStations);
+    TEST_ASSERT_EQUAL_INT(4, statistics.succeeded);
+    TEST_ASSERT_EQUAL_INT(1, statistics.notConnected);
+    TEST_ASSERT_EQUAL_INT(0, statistics.timeouts);
+    TEST_ASSERT_TRUE(statistics.minCompletionTimeInUs <= statistics.p50CompletionTimeInUs);
+    TEST_ASSERT_TRUE(statistics.p50CompletionTimeInUs <= statistics.maxCompletionTimeInUs);
+    TEST_ASSERT_EQUAL_INT(CS104_CAMPAIGN_STATION_SUCCESS, CS104_Campaign_getStationResult(campaign, 3));
+    TEST_ASSERT_EQUAL_INT(CS104_CAMPAIGN_STATION_NOT_CONNECTED, CS104_Campaign_getStationResult(campaign, 4));
+    TEST_ASSERT_EQUAL_INT(-1, CS104_Campaign_getStationDelay(campaign, 0));
+
+    TEST_ASSERT_TRUE(CS104_Campaign_startClockSync(campaign));
+
+    while (CS104_Campaign_isRunning(campaign))
+        Thread_sleep(10);
+
+    CS104_Campaign_getStatistics(campaign, &statistics);
+
+    TEST_ASSERT_EQUAL_INT(2, completed);
+    TEST_ASSERT_EQUAL_INT(4, statistics.succeeded);
+    TEST_ASSERT_EQUAL_INT(1, statistics.notConnected);
+    TEST_ASSERT_EQUAL_INT(4, clockSyncs);
+
+    for (i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(CS104_Campaign_getStationDelay(campaign, i) >= 0);
+
+    CS104_Campaign_destroy(campaign);
+
+    for (i = 0; i < 3; i++)
+        CS104_Connection_destroy(connections[i]);
+
+    CS104_Connection_destroy(unconnected);
+
+    CS104_Slave_destroy(slave);
+}
+
+/* emulates a station that doesn't know the test command */
+static CS101_SlavePlugin_Result
+test_CS104_Campaign_rejectTestCommand(void* parameter, IMasterConnection connection, CS101_ASDU asdu)
+{
+    CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_TYPE_ID);
+    CS101_ASDU_setNegative(asdu, true);
+    IMasterConnection_sendASDU(connection, asdu);
+
+    return CS101_PLUGIN_RESULT_HANDLED;
+}
+
+static void
+test_CS104_Campaign_noTask(void* parameter, IMasterConnection connection)
+{
+}
+
+void
+test_CS104_Campaign_NoHandler(void)
+{
+    int completed = 0;
+
+    struct sCS101_SlavePlugin rejectPlugin = {
+        test_CS104_Campaign_rejectTestCommand, test_CS104_Campaign_noTask, NULL
+    };
+
+    /* slave without interrogation and clock sync handlers -> responds with COT 44 (unknown type ID) */
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20024);
+    CS104_Slave_addPluginForTypeID(slave, &rejectPlugin, C_TS_TA_1);
+    CS104_Slave_start(slave);
+
+    CS104_Connection connection = CS104_Connection_create("127.0.0.1", 20024);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(connection));
+
+    CS104_Connection_sendStartDT(connection);
+
+    Thread_sleep(100);
+
+    CS104_Campaign campaign = CS104_Campaign_create(1);
+
+    TEST_ASSERT_EQUAL_INT(0, CS104_Campaign_addStation(campaign, connection, 1));
+
+    CS104_Campaign_setTimeouts(campaign, 10000, 10000);
+    CS104_Campaign_setCompletedHandler(campaign, test_CS104_Campaign_completedHandler, &completed);
+
+    CS104_CampaignStatistics statistics;
+
+    TEST_ASSERT_TRUE(CS104_Campaign_startInterrogation(campaign, IEC60870_QOI_STATION));
+
+    while (CS104_Campaign_isRunning(campaign))
+        Thread_sleep(10);
+
+    CS104_Campaign_getStatistics(campaign, &statistics);
+
+    TEST_ASSERT_EQUAL_INT(1, completed);
+    TEST_ASSERT_EQUAL_INT(1, statistics.negative);
+    TEST_ASSERT_EQUAL_INT(0, statistics.timeouts);
+    TEST_ASSERT_TRUE(statistics.durationInMs < 5000);
+
+    TEST_ASSERT_TRUE(CS104_Campaign_startClockSync(campaign));
+
+    while (CS104_Campaign_isRunning(campaign))
+        Thread_sleep(10);
+
+    CS104_Campaign_getStatistics(campaign, &statistics);
+
+    /* test command rejected -> clock sync command sent without delay compensation */
+    TEST_ASSERT_EQUAL_INT(2, completed);
+    TEST_ASSERT_EQUAL_INT(1, statistics.negative);
+    TEST_ASSERT_EQUAL_INT(0, statistics.timeouts);
+    TEST_ASSERT_TRUE(statistics.durationInMs < 5000);
+    TEST_ASSERT_EQUAL_INT(0, CS104_Campaign_getStationDelay(campaign, 0));
+
+    CS104_Campaign_destroy(campaign);
+
+    CS104_Connection_destroy(connection);
+
+    CS104_Slave_destroy(slave);
+}
+
+#if defined(__linux__) && defined(__GLIBC__)
+/*
+ * The ACK timeout of the link layer has to start when the frame is completely transmitted. At 600 baud (8E1)
+ * the fixed frame (5 bytes) needs 92 ms plus 55 ms line idle time. Without an answer of the other station the
+ * master repeats the RESET REMOTE LINK request after this time plus the ACK timeout (100 ms).
+ */
+void
+test_CS101_Master_AckTimeoutAfterTransmission(void)
+{
+    int ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+
+    TEST_ASSERT_TRUE(ptyMaster >= 0);
+    TEST_ASSERT_EQUAL_INT(0, grantpt(ptyMaster));
+    TEST_ASSERT_EQUAL_INT(0, unlockpt(ptyMaster));
+
+    SerialPort port = SerialPort_create(ptsname(ptyMaster), 600, 8, 'E', 1);
+
+    TEST_ASSERT_TRUE(SerialPort_open(port));
+
+    CS101_Master master = CS101_Master_create(port, NULL, NULL, IEC60870_LINK_LAYER_BALANCED);
+
+    CS101_Master_getLinkLayerParameters(master)->timeoutForAck = 100;
+
+    CS101_Master_start(master);
+
+    uint64_t frameTimes[8];
+    int numberOfFrames = 0;
+    int framePos = 0;
+
+    uint64_t endTime = Hal_getTimeInMs() + 1500;
+
+    while ((numberOfFrames < 8) && (Hal_getTimeInMs() < endTime)) {
+        struct pollfd fds;
+        uint8_t buffer[64];
+
+        fds.fd = ptyMaster;
+        fds.events = POLLIN;
+
+        if (poll(&fds, 1, 10) > 0) {
+            uint64_t receiveTime = Hal_getTimeInMs();
+
+            int bytes = (int) read(ptyMaster, buffer, sizeof(buffer));
+            int i;
+
+            for (i = 0; i < bytes; i++) {
+                /* fixed frame: 0x10 C A CS 0x16 */
+                if ((framePos == 0) && (buffer[i] == 0x10) && (numberOfFrames < 8))
+                    frameTimes[numberOfFrames++] = receiveTime;
+
+                framePos = (framePos + 1) % 5;
+            }
+        }
+    }
+
+    CS101_Master_stop(master);
+    CS101_Master_destroy(master);
+
+    SerialPort_close(port);
+    SerialPort_destroy(port);
+
+    close(ptyMaster);
+
+    TEST_ASSERT_TRUE(numberOfFrames >= 3);
+
+    int i;
+
+    for (i = 1; i < numberOfFrames; i++)
+        TEST_ASSERT_TRUE((frameTimes[i] - frameTimes[i - 1]) >= 240);
+}
+#endif /* defined(__linux__) && defined(__GLIBC__) */
+
+static bool
+test_CS104_Slave_CyclicGroups_handler(void* parameter, int groupId, int asduIndex, CS101_ASDU asdu)
+{
+    if (asduIndex >= 3)
+        return false;
+
+    InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100 * (groupId + 1) + asduIndex, asduIndex, IEC60870_QUALITY_GOOD);
+
+    CS101_ASDU_addInformationObject(asdu, io);
+
+    InformationObject_destroy(io);
+
+    return true;
+}
+
+struct sTestCyclicGroupsCounters {
+    int periodic;
+    int backgroundScan;
+    int other;
+};
+
+static bool
+test_CS104_Slave_CyclicGroups_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    struct sTestCyclicGroupsCounters* counters = (struct sTestCyclicGroupsCounters*) parameter;
+
+    if (CS101_ASDU_getCOT(asdu) == CS101_COT_PERIODIC)
+        counters->periodic++;
+    else if (CS101_ASDU_getCOT(asdu) == CS101_COT_BACKGROUND_SCAN)
+        counters->backgroundScan++;
+    else
+        counters->other++;
+
+    return true;
+}
+
+void
+test_CS104_Slave_CyclicGroups(void)
+{
+    struct sTestCyclicGroupsCounters counters;
+
+    memset(&counters, 0, sizeof(counters));
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20013);
+
+    TEST_ASSERT_EQUAL_INT(-1, CS104_Slave_addCyclicGroup(slave, CS101_COT_SPONTANEOUS, 100, test_CS104_Slave_CyclicGroups_handler, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, CS104_Slave_addCyclicGroup(slave, CS101_COT_PERIODIC, 100, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, CS104_Slave_addCyclicGroup(slave, CS101_COT_PERIODIC, 100, test_CS104_Slave_CyclicGroups_handler, NULL));
+    TEST_ASSERT_EQUAL_INT(1, CS104_Slave_addCyclicGroup(slave, CS101_COT_BACKGROUND_SCAN, 60000, test_CS104_Slave_CyclicGroups_handler, NULL));
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20013);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_CyclicGroups_asduReceivedHandler, &counters);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(550);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    /* at least one complete background scan and four periodic cycles */
+    TEST_ASSERT_TRUE(counters.backgroundScan >= 3);
+    TEST_ASSERT_TRUE(counters.periodic >= 12);
+    TEST_ASSERT_EQUAL_INT(0, counters.other);
+}
+
+void
+test_Semaphore_waitTimeout(void)
+{
+    Semaphore semaphore = Semaphore_create(0);
+
+    uint64_t startTime = Hal_getTimeInMs();
+
+    TEST_ASSERT_FALSE(Semaphore_waitTimeout(semaphore, 50));
+    TEST_ASSERT_TRUE(Hal_getTimeInMs() - startTime >= 45);
+
+    Semaphore_post(semaphore);
+
+    startTime = Hal_getTimeInMs();
+
+    TEST_ASSERT_TRUE(Semaphore_waitTimeout(semaphore, 1000));
+    TEST_ASSERT_TRUE(Hal_getTimeInMs() - startTime < 500);
+
+    TEST_ASSERT_FALSE(Semaphore_waitTimeout(semaphore, 0));
+
+    Semaphore_destroy(semaphore);
+}
+
+void
+test_Handleset_wakeUp(void)
+{
+    HandleSet handleSet = Handleset_new();
+
+    TEST_ASSERT_TRUE(Handleset_enableWakeUp(handleSet));
+
+    Handleset_wakeUp(handleSet);
+
+    uint64_t startTime = Hal_getTimeInMs();
+
+    /* wake-up is pending -> returns immediately and is not counted */
+    TEST_ASSERT_EQUAL_INT(0, Handleset_waitReady(handleSet, 2000));
+    TEST_ASSERT_TRUE((Hal_getTimeInMs() - startTime) < 1000);
+
+    /* wake-up has been consumed */
+    startTime = Hal_getTimeInMs();
+
+    TEST_ASSERT_EQUAL_INT(0, Handleset_waitReady(handleSet, 50));
+    TEST_ASSERT_TRUE((Hal_getTimeInMs() - startTime) >= 40);
+
+    Handleset_destroy(handleSet);
+}
+
+static bool
+test_CS104_Slave_CommandResponseTime_asduHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu)
+{
+    if (CS101_ASDU_getTypeID(asdu) == C_SC_NA_1) {
+        IMasterConnection_sendACT_CON(connection, asdu, false);
+
+        return true;
+    }
+
+    return false;
+}
+
+void
+test_CS104_Slave_CommandResponseTime(void)
+{
+    IMasterConnection connection = NULL;
+    CS104_LinkStatistics statistics;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20014);
+    CS104_Slave_setCommandResponseReserve(slave, 2);
+    CS104_Slave_setASDUHandler(slave, test_CS104_Slave_CommandResponseTime_asduHandler, NULL);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104_Slave_AdaptiveWindow_connectionEventHandler, &connection);
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20014);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(100);
+
+    TEST_ASSERT_NOT_NULL(connection);
+
+    CS104_Slave_getConnectionLinkStatistics(slave, connection, &statistics);
+
+    TEST_ASSERT_EQUAL_UINT64(0, statistics.commandResponses);
+    TEST_ASSERT_EQUAL_INT(-1, statistics.commandResponseTimeInUs);
+
+    InformationObject sc = (InformationObject) SingleCommand_create(NULL, 5000, true, false, 0);
+
+    CS104_Connection_sendProcessCommandEx(con, CS101_COT_ACTIVATION, 1, sc);
+    CS104_Connection_sendProcessCommandEx(con, CS101_COT_ACTIVATION, 1, sc);
+
+    InformationObject_destroy(sc);
+
+    Thread_sleep(200);
+
+    CS104_Slave_getConnectionLinkStatistics(slave, connection, &statistics);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_UINT64(2, statistics.commandResponses);
+    TEST_ASSERT_TRUE(statistics.commandResponseTimeInUs >= 0);
+    TEST_ASSERT_TRUE(statistics.commandResponseTimeInUs < 100000);
+    TEST_ASSERT_TRUE(statistics.maxCommandResponseTimeInUs >= statistics.commandResponseTimeInUs);
+}
+
+/* more data than the socket buffers can take (up to 4 MB send buffer on Linux) */
+#define SLOW_READER_GI_RESPONSES 20000
+#define SLOW_READER_EVENTS 200
+
+static void
+test_CS104_Slave_SlowReader_fillASDU(CS101_ASDU asdu, MeasuredValueScaled io, int firstIoa)
+{
+    int i;
+
+    CS101_ASDU_removeAllElements(asdu);
+
+    /* 40 elements -> 246 byte ASDU */
+    for (i = 0; i < 40; i++) {
+        MeasuredValueScaled_create(io, firstIoa + i, i, IEC60870_QUALITY_GOOD);
+        CS101_ASDU_addInformationObject(asdu, (InformationObject) io);
+    }
+}
+
+static bool
+test_CS104_Slave_SlowReader_interrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, uint8_t qoi)
+{
+    CS101_AppLayerParameters alParams = IMasterConnection_getApplicationLayerParameters(connection);
+
+    int i;
+
+    IMasterConnection_sendACT_CON(connection, asdu, false);
+
+    CS101_ASDU newAsdu = CS101_ASDU_create(alParams, false, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
+    MeasuredValueScaled io = MeasuredValueScaled_create(NULL, 0, 0, IEC60870_QUALITY_GOOD);
+
+    for (i = 0; i < SLOW_READER_GI_RESPONSES; i++) {
+        test_CS104_Slave_SlowReader_fillASDU(newAsdu, io, (i + 1) * 64);
+
+        IMasterConnection_sendASDU(connection, newAsdu);
+    }
+
+    MeasuredValueScaled_destroy(io);
+    CS101_ASDU_destroy(newAsdu);
+
+    IMasterConnection_sendACT_TERM(connection, asdu);
+
+    *((bool*) parameter) = true;
+
+    return true;
+}
+
+static CS104_Slave
+test_CS104_Slave_SlowReader_createSlave(int tcpPort, bool* giDone)
+{
+    int i;
+
+    CS104_Slave slave = CS104_Slave_create(SLOW_READER_EVENTS, SLOW_READER_GI_RESPONSES + 10);
+    CS104_Slave_setLocalPort(slave, tcpPort);
+    CS104_Slave_setInterrogationHandler(slave, test_CS104_Slave_SlowReader_interrogationHandler, giDone);
+
+    /* the window doesn't limit the burst - only the TCP send buffer does */
+    CS104_Slave_getConnectionParameters(slave)->k = 32767;
+
+    /* the client doesn't confirm the messages while it is not reading */
+    CS104_Slave_getConnectionParameters(slave)->t1 = 60;
+
+    CS104_Slave_start(slave);
+
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+    MeasuredValueScaled io = MeasuredValueScaled_create(NULL, 0, 0, IEC60870_QUALITY_GOOD);
+
+    for (i = 0; i < SLOW_READER_EVENTS; i++) {
+        test_CS104_Slave_SlowReader_fillASDU(asdu, io, (i + 1) * 64);
+
+        CS104_Slave_enqueueASDU(slave, asdu);
+    }
+
+    MeasuredValueScaled_destroy(io);
+    CS101_ASDU_destroy(asdu);
+
+    return slave;
+}
+
+static Socket
+test_CS104_Slave_SlowReader_connect(int tcpPort)
+{
+    /* C_IC_NA_1, COT = ACTIVATION, CA = 1, IOA = 0, QOI = 20 */
+    uint8_t interrogationCommand[] = { 0x68, 0x0e, 0x00, 0x00, 0x00, 0x00,
+            0x64, 0x01, 0x06, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x14 };
+
+    uint8_t startDtAct[] = { 0x68, 0x04, 0x07, 0x00, 0x00, 0x00 };
+
+    Socket socket = TcpSocket_create();
+
+#if defined(__linux__) && defined(__GLIBC__)
+    /* small receive window to fill the send buffer of the server faster */
+    int receiveBufferSize = 4096;
+    setsockopt(Socket_getFileDescriptor(socket), SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+#endif
+
+    if (Socket_connect(socket, "127.0.0.1", tcpPort) == false) {
+        Socket_destroy(socket);
+        return NULL;
+    }
+
+    Socket_write(socket, startDtAct, sizeof(startDtAct));
+    Socket_write(socket, interrogationCommand, sizeof(interrogationCommand));
+
+    return socket;
+}
+
+/*
+ * The client stops reading during a GI burst. The TCP send buffer of the server runs full, messages are written
+ * partially and the remaining data is kept in the output buffer. After the client resumes reading the output
+ * buffer is drained when the socket becomes writable again and all messages have to arrive complete, in order
+ * and with consecutive send sequence numbers.
+ */
+void
+test_CS104_Slave_SlowReaderGIBurst(void)
+{
+    uint8_t sMessage[] = { 0x68, 0x04, 0x01, 0x00, 0x00, 0x00 };
+
+    uint8_t buffer[8192];
+    int bufPos = 0;
+
+    bool giDone = false;
+
+    CS104_Slave slave = test_CS104_Slave_SlowReader_createSlave(20021, &giDone);
+
+    Socket socket = test_CS104_Slave_SlowReader_connect(20021);
+    TEST_ASSERT_NOT_NULL(socket);
+
+    /* stop reading until all GI responses are queued and the send buffer of the server is full */
+    uint64_t endTime = Hal_getTimeInMs() + 30000;
+
+    while ((giDone == false) && (Hal_getTimeInMs() < endTime))
+        Thread_sleep(10);
+
+    TEST_ASSERT_TRUE(giDone);
+
+    Thread_sleep(1000);
+
+    /* the server keeps the connection */
+    TEST_ASSERT_EQUAL_INT(1, CS104_Slave_getOpenConnections(slave));
+
+    int receivedIMessages = 0;
+    int receivedEvents = 0;
+    int receivedGIResponses = 0;
+    bool actConReceived = false;
+    bool actTermReceived = false;
+    bool sequenceError = false;
+    bool orderError = false;
+
+    endTime = Hal_getTimeInMs() + 30000;
+
+    while (Hal_getTimeInMs() < endTime) {
+        int readBytes = Socket_read(socket, buffer + bufPos, sizeof(buffer) - bufPos);
+
+        if (readBytes < 0)
+            break;
+
+        bufPos += readBytes;
+
+        int pos = 0;
+
+        while ((bufPos - pos >= 6) && (bufPos - pos >= buffer[pos + 1] + 2)) {
+            uint8_t* msg = buffer + pos;
+
+            if ((msg[2] & 0x01) == 0) {
+                /* I message */
+                int sendSeqNo = (msg[2] + (msg[3] * 0x100)) / 2;
+
+                if (sendSeqNo != (receivedIMessages % 32768))
+                    sequenceError = true;
+
+                receivedIMessages++;
+
+                int typeId = msg[6];
+                int cot = msg[8] & 0x3f;
+                int ioa = msg[12] + (msg[13] * 0x100) + (msg[14] * 0x10000);
+
+                if (typeId == C_IC_NA_1) {
+                    if (cot == CS101_COT_ACTIVATION_CON)
+                        actConReceived = true;
+                    else if (cot == CS101_COT_ACTIVATION_TERMINATION) {
+                        if (receivedGIResponses != SLOW_READER_GI_RESPONSES)
+                            orderError = true;
+
+                        actTermReceived = true;
+                    }
+                }
+                else if (cot == CS101_COT_INTERROGATED_BY_STATION) {
+                    if ((actConReceived == false) || (ioa != (receivedGIResponses + 1) * 64))
+                        orderError = true;
+
+                    receivedGIResponses++;
+                }
+                else if (cot == CS101_COT_SPONTANEOUS) {
+                    if (ioa != (receivedEvents + 1) * 64)
+                        orderError = true;
+
+                    receivedEvents++;
+                }
+            }
+
+            pos += buffer[pos + 1] + 2;
+        }
+
+        memmove(buffer, buffer + pos, bufPos - pos);
+        bufPos -= pos;
+
+        if (readBytes > 0) {
+            int seqNo = receivedIMessages % 32768;
+
+            sMessage[4] = (uint8_t) ((seqNo % 128) * 2);
+            sMessage[5] = (uint8_t) (seqNo / 128);
+
+            Socket_write(socket, sMessage, sizeof(sMessage));
+        }
+        else
+            Thread_sleep(1);
+
+        if ((receivedEvents == SLOW_READER_EVENTS) && actTermReceived)
+            break;
+    }
+
+    int openConnections = CS104_Slave_getOpenConnections(slave);
+
+    Socket_destroy(socket);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(1, openConnections);
+    TEST_ASSERT_FALSE(sequenceError);
+    TEST_ASSERT_FALSE(orderError);
+    TEST_ASSERT_TRUE(actConReceived);
+    TEST_ASSERT_TRUE(actTermReceived);
+    TEST_ASSERT_EQUAL_INT(SLOW_READER_GI_RESPONSES, receivedGIResponses);
+    TEST_ASSERT_EQUAL_INT(SLOW_READER_EVENTS, receivedEvents);
+}
+
+/*
+ * The client stops reading during a GI burst but keeps sending TESTFR_ACT messages. The TESTFR_CON responses
+ * cannot be written and fill the output buffer of the server. The server has to close the connection when the
+ * output buffer overflows.
+ */
+void
+test_CS104_Slave_SlowReaderOutputOverflow(void)
+{
+    int i;
+
+    uint8_t testFrAct[] = { 0x68, 0x04, 0x43, 0x00, 0x00, 0x00 };
+
+    bool giDone = false;
+
+    CS104_Slave slave = test_CS104_Slave_SlowReader_createSlave(20022, &giDone);
+
+    Socket socket = test_CS104_Slave_SlowReader_connect(20022);
+    TEST_ASSERT_NOT_NULL(socket);
+
+    /* stop reading until all GI responses are queued and the send buffer of the server is full */
+    uint64_t endTime = Hal_getTimeInMs() + 30000;
+
+    while ((giDone == false) && (Hal_getTimeInMs() < endTime))
+        Thread_sleep(10);
+
+    TEST_ASSERT_TRUE(giDone);
+
+    Thread_sleep(1000);
+
+    TEST_ASSERT_EQUAL_INT(1, CS104_Slave_getOpenConnections(slave));
+
+    /* more TESTFR_CON responses than fit into the output buffer */
+    for (i = 0; i < (CONFIG_CS104_SLAVE_OUTPUT_BUFFER_SIZE / 6) + 50; i++) {
+        Socket_write(socket, testFrAct, sizeof(testFrAct));
+
+        if ((i % 10) == 0)
+            Thread_sleep(1);
+    }
+
+    endTime = Hal_getTimeInMs() + 2000;
+
+    while ((CS104_Slave_getOpenConnections(slave) > 0) && (Hal_getTimeInMs() < endTime))
+        Thread_sleep(10);
+
+    int openConnections = CS104_Slave_getOpenConnections(slave);
+
+    Socket_destroy(socket);
+
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(0, openConnections);
+}
+
+struct sTestConcurrentResponders {
+    IMasterConnection connection;
+    CS101_AppLayerParameters alParams;
+    int threadNumber;
+};
+
+static void*
+test_CS104_Slave_ConcurrentResponders_thread(void* parameter)
+{
+    struct sTestConcurrentResponders* responder = (struct sTestConcurrentResponders*) parameter;
+
+    int i;
+
+    for (i = 0; i < 50; i++) {
+        CS101_ASDU asdu = CS101_ASDU_create(responder->alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+        InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 1000 * responder->threadNumber + i, i, IEC60870_QUALITY_GOOD);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+
+        InformationObject_destroy(io);
+
+        /* retry while the high priority queue is full */
+        while (IMasterConnection_sendASDU(responder->connection, asdu) == false)
+            Thread_sleep(1);
+
+        CS101_ASDU_destroy(asdu);
+    }
+
+    return NULL;
+}
+
+static bool
+test_CS104_Slave_ConcurrentResponders_asduReceivedHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    int* received = (int*) parameter;
+
+    if (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1)
+        (*received)++;
+
+    return true;
+}
+
+void
+test_CS104_Slave_ConcurrentResponders(void)
+{
+    IMasterConnection connection = NULL;
+    int received = 0;
+    int i;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20015);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104_Slave_AdaptiveWindow_connectionEventHandler, &connection);
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20015);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_ConcurrentResponders_asduReceivedHandler, &received);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    Thread_sleep(100);
+
+    TEST_ASSERT_NOT_NULL(connection);
+
+    struct sTestConcurrentResponders responders[4];
+    Thread threads[4];
+
+    for (i = 0; i < 4; i++) {
+        responders[i].connection = connection;
+        responders[i].alParams = CS104_Slave_getAppLayerParameters(slave);
+        responders[i].threadNumber = i + 1;
+
+        threads[i] = Thread_create(test_CS104_Slave_ConcurrentResponders_thread, &(responders[i]), false);
+        Thread_start(threads[i]);
+    }
+
+    for (i = 0; i < 4; i++)
+        Thread_destroy(threads[i]);
+
+    int waitTime = 0;
+
+    while ((received < 200) && (waitTime < 3000)) {
+        Thread_sleep(10);
+        waitTime += 10;
+    }
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stop(slave);
+    CS104_Slave_destroy(slave);
+
+    /* a sequence error or corrupted frame would close the connection */
+    TEST_ASSERT_EQUAL_INT(200, received);
+}
+
+static void*
+test_CS104_Slave_ExternalEventLoopCrossThreadResponse_thread(void* parameter)
+{
+    struct sTestConcurrentResponders* responder = (struct sTestConcurrentResponders*) parameter;
+
+    /* let the event loop block in poll */
+    Thread_sleep(50);
+
+    CS101_ASDU asdu = CS101_ASDU_create(responder->alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+    InformationObject io = (InformationObject) MeasuredValueScaled_create(NULL, 100, 1, IEC60870_QUALITY_GOOD);
+
+    CS101_ASDU_addInformationObject(asdu, io);
+    InformationObject_destroy(io);
+
+    IMasterConnection_sendASDU(responder->connection, asdu);
+
+    CS101_ASDU_destroy(asdu);
+
+    return NULL;
+}
+
+void
+test_CS104_Slave_ExternalEventLoopCrossThreadResponse(void)
+{
+    IMasterConnection connection = NULL;
+    int received = 0;
+    int i;
+
+    CS104_Slave slave = CS104_Slave_create(100, 100);
+
+    CS104_Slave_setLocalPort(slave, 20027);
+    CS104_Slave_setConnectionEventHandler(slave, test_CS104_Slave_AdaptiveWindow_connectionEventHandler, &connection);
+    CS104_Slave_startThreadless(slave);
+
+    CS104_Connection con = CS104_Connection_create("127.0.0.1", 20027);
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_Slave_ConcurrentResponders_asduReceivedHandler, &received);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    test_CS104_Slave_ExternalEventLoop_run(slave, 100);
+
+    CS104_Connection_sendStartDT(con);
+
+    test_CS104_Slave_ExternalEventLoop_run(slave, 100);
+
+    TEST_ASSERT_NOT_NULL(connection);
+
+    struct sTestConcurrentResponders responder;
+
+    responder.connection = connection;
+    responder.alParams = CS104_Slave_getAppLayerParameters(slave);
+    responder.threadNumber = 1;
+
+    Thread thread = Thread_create(test_CS104_Slave_ExternalEventLoopCrossThreadResponse_thread, &responder, false);
+    Thread_start(thread);
+
+    uint64_t startTime = Hal_getTimeInMs();
+
+    /* only the t3 timer is running -> the loop blocks until a descriptor becomes ready */
+    while ((received == 0) && (Hal_getTimeInMs() < startTime + 2000)) {
+        CS104_SlavePollDescriptor descriptors[10];
+        struct pollfd fds[10];
+
+        int count = CS104_Slave_getPollDescriptors(slave, descriptors, 10);
+
+        for (i = 0; i < count; i++) {
+            fds[i].fd = descriptors[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        int timeout = CS104_Slave_getNextTimeout(slave);
+
+        if ((timeout < 0) || (timeout > 2000))
+            timeout = 2000;
+
+        if (poll(fds, count, timeout) > 0) {
+            for (i = 0; i < count; i++) {
+                if (fds[i].revents)
+                    CS104_Slave_handleReadable(slave, fds[i].fd);
+            }
+        }
+
+        CS104_Slave_handleTimers(slave);
+
+        Thread_sleep(1);
+    }
+
+    uint64_t responseTime = Hal_getTimeInMs() - startTime;
+
+    Thread_destroy(thread);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_stopThreadless(slave);
+    CS104_Slave_destroy(slave);
+
+    TEST_ASSERT_EQUAL_INT(1, received);
+
+    /* the response is sent when the thread queues it and not with the next timer */
+    TEST_ASSERT_TRUE(responseTime < 500);
+}
+
+#if (CONFIG_LIB60870_STATIC_MEMORY == 1)
+static void
+test_MemoryPools_exceptionHandler(void* parameter)
+{
+    int* failedAllocations = (int*) parameter;
+
+    (*failedAllocations)++;
+}
+#endif
+
+void
+test_MemoryPools(void)
+{
+    int numberOfPools = Lib60870_getNumberOfMemoryPools();
+
+#if (CONFIG_LIB60870_STATIC_MEMORY == 1)
+    Lib60870MemoryPoolStatistics statistics0;
+    Lib60870MemoryPoolStatistics statistics1;
+    Lib60870MemoryPoolStatistics statistics;
+    void* blocks[1024];
+    int i;
+
+    TEST_ASSERT_TRUE(numberOfPools > 1);
+
+    TEST_ASSERT_TRUE(Lib60870_getMemoryPoolStatistics(0, &statistics0));
+    TEST_ASSERT_TRUE(Lib60870_getMemoryPoolStatistics(1, &statistics1));
+    TEST_ASSERT_FALSE(Lib60870_getMemoryPoolStatistics(numberOfPools, &statistics));
+
+    /* exhaust the smallest pool */
+    int freeBlocks = statistics0.capacity - statistics0.used;
+
+    TEST_ASSERT_TRUE(freeBlocks <= 1024);
+
+    for (i = 0; i < freeBlocks; i++) {
+        blocks[i] = Memory_malloc(8);
+        TEST_ASSERT_NOT_NULL(blocks[i]);
+    }
+
+    Lib60870_getMemoryPoolStatistics(0, &statistics);
+
+    TEST_ASSERT_EQUAL_INT(statistics.capacity, statistics.used);
+    TEST_ASSERT_EQUAL_INT(statistics.capacity, statistics.maxUsed);
+
+    /* the next allocation falls back to the next larger pool */
+    void* fallbackBlock = Memory_malloc(8);
+
+    TEST_ASSERT_NOT_NULL(fallbackBlock);
+
+    Lib60870_getMemoryPoolStatistics(0, &statistics);
+    TEST_ASSERT_EQUAL_UINT32(statistics0.exhaustionCount + 1, statistics.exhaustionCount);
+
+    Lib60870_getMemoryPoolStatistics(1, &statistics);
+    TEST_ASSERT_EQUAL_INT(statistics1.used + 1, statistics.used);
+
+    Memory_free(fallbackBlock);
+
+    for (i = 0; i < freeBlocks; i++)
+        Memory_free(blocks[i]);
+
+    Lib60870_getMemoryPoolStatistics(0, &statistics);
+    TEST_ASSERT_EQUAL_INT(statistics0.used, statistics.used);
+
+    Lib60870_getMemoryPoolStatistics(1, &statistics);
+    TEST_ASSERT_EQUAL_INT(statistics1.used, statistics.used);
+
+    /* larger than the largest block */
+    Lib60870_getMemoryPoolStatistics(numberOfPools - 1, &statistics);
+
+    TEST_ASSERT_NULL(Memory_malloc(statistics.blockSize + 1));
+
+    /* the pools can hold the event queues of the configured size */
+    int failedAllocations = 0;
+
+    Memory_installExceptionHandler(test_MemoryPools_exceptionHandler, &failedAllocations);
+
+    CS104_Slave slave = CS104_Slave_create(CONFIG_CS104_MESSAGE_QUEUE_SIZE, CONFIG_CS104_MESSAGE_QUEUE_HIGH_PRIO_SIZE);
+
+    TEST_ASSERT_NOT_NULL(slave);
+
+    /* the queues are allocated when the slave is started */
+    CS104_Slave_setLocalPort(slave, 20028);
+    CS104_Slave_startThreadless(slave);
+    CS104_Slave_stopThreadless(slave);
+
+    CS104_Slave_destroy(slave);
+
+    Memory_installExceptionHandler(NULL, NULL);
+
+    TEST_ASSERT_EQUAL_INT(0, failedAllocations);
+#else
+    Lib60870MemoryPoolStatistics statistics;
+
+    TEST_ASSERT_EQUAL_INT(0, numberOfPools);
+    TEST_ASSERT_FALSE(Lib60870_getMemoryPoolStatistics(0, &statistics));
+#endif
+}
+
+void
+test_CS101_ASDU_addObjectOfWrongType(void)
+{
+    CS101_ASDU asdu = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_PERIODIC, 0, 1, false, false);
+
+    InformationObject io1 = (InformationObject) SinglePointInformation_create(NULL, 101, true, IEC60870_QUALITY_GOOD);
+
+    bool added = CS101_ASDU_addInformationObject(asdu, io1);
+
+    TEST_ASSERT_TRUE(added);
+
+    InformationObject_destroy(io1);
+
+    InformationObject io2 = (InformationObject) DoublePointInformation_create(NULL, 102, IEC60870_DOUBLE_POINT_OFF, IEC60870_QUALITY_GOOD);
+
+    added = CS101_ASDU_addInformationObject(asdu, io2);
+
+    TEST_ASSERT_FALSE(added);
+
+    InformationObject_destroy(io2);
+
+    CS101_ASDU_destroy(asdu);
+}
+
+void
+test_CS101_ASDU_addUntilOverflow(void)
+{
+    CS101_ASDU asdu = CS101_ASDU_create(&defaultAppLayerParameters, false, CS101_COT_PERIODIC, 0, 1, false, false);
+
+    int i = 0;
+
+    for (i = 0; i < 60; i++) {
+        InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 100 + i, true, IEC60870_QUALITY_GOOD);
+
+        bool added = CS101_ASDU_addInformationObject(asdu, io);
+
+        TEST_ASSERT_TRUE(added);
+
+        InformationObject_destroy(io);
+
+        TEST_ASSERT_EQUAL_INT(i + 1, CS101_ASDU_getNumberOfElements(asdu));
+    }
+
+    InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 100 + i, true, IEC60870_QUALITY_GOOD);
+
+    bool added = CS101_ASDU_addInformationObject(asdu, io);
+
+    TEST_ASSERT_FALSE(added);
+
+    InformationObject_destroy(io);
+
+    CS101_ASDU_destroy(asdu);
+}
+
+void
+test_CS104_MasterSlave_TLSConnectSuccess(void)
+{
+    TLSConfiguration tlsConfig1 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig1, true);
+
+    TLSConfiguration_setOwnKeyFromFile(tlsConfig1, "server-key.pem", NULL);
+    TLSConfiguration_setOwnCertificateFromFile(tlsConfig1, "server.cer");
+    TLSConfiguration_addCACertificateFromFile(tlsConfig1, "root.cer");
+
+    TLSConfiguration tlsConfig2 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig2, true);
+    TLSConfiguration_setAllowOnlyKnownCertificates(tlsConfig2, true);
+
+    TLSConfiguration_setOwnKeyFromFile(tlsConfig2, "client1-key.pem", NULL);
+    TLSConfiguration_setOwnCertificateFromFile(tlsConfig2, "client1.cer");
+    TLSConfiguration_addCACertificateFromFile(tlsConfig2, "root.cer");
+
+    TLSConfiguration_addAllowedCertificateFromFile(tlsConfig2, "server.cer");
+
+    CS104_Slave slave = CS104_Slave_createSecure(100, 100, tlsConfig1);
+
+    TEST_ASSERT_NOT_NULL(slave);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_createSecure("127.0.0.1", 20004, tlsConfig2);
+
+    TEST_ASSERT_NOT_NULL(con);
+
+    bool result = CS104_Connection_connect(con);
+
+    TEST_ASSERT_TRUE(result);
+
+    CS104_Slave_destroy(slave);
+
+    CS104_Connection_destroy(con);
+
+    TLSConfiguration_destroy(tlsConfig1);
+    TLSConfiguration_destroy(tlsConfig2);
+}
+
+
+void
+test_CS104_MasterSlave_TLSConnectFails(void)
+{
+    TLSConfiguration tlsConfig1 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig1, true);
+
+    TLSConfiguration tlsConfig2 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig2, true);
+    TLSConfiguration_setAllowOnlyKnownCertificates(tlsConfig2, true);
+
+    TLSConfiguration_setOwnKeyFromFile(tlsConfig2, "client1-key.pem", NULL);
+    TLSConfiguration_setOwnCertificateFromFile(tlsConfig2, "client1.cer");
+    TLSConfiguration_addCACertificateFromFile(tlsConfig2, "root.cer");
+
+    TLSConfiguration_addAllowedCertificateFromFile(tlsConfig2, "server.cer");
+
+    CS104_Slave slave = CS104_Slave_createSecure(100, 100, tlsConfig1);
+
+    TEST_ASSERT_NOT_NULL(slave);
+
+    CS104_Slave_setLocalPort(slave, 20004);
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_createSecure("127.0.0.1", 20004, tlsConfig2);
+
+    TEST_ASSERT_NOT_NULL(con);
+
+    bool result = CS104_Connection_connect(con);
+
+    TEST_ASSERT_FALSE(result);
+
+    CS104_Slave_destroy(slave);
+
+    CS104_Connection_destroy(con);
+
+    TLSConfiguration_destroy(tlsConfig1);
+    TLSConfiguration_destroy(tlsConfig2);
+}
+
+static bool
+test_CS104_MasterSlave_TLSKernelOffloadFallback_asduHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    int* receivedASDUs = (int*) parameter;
+
+    (*receivedASDUs)++;
+
+    return true;
+}
+
+/*
+ * Kernel TLS offload is requested by both sides. When the kernel doesn't provide kTLS (e.g. the tls module is not
+ * loaded) or rejects the keys, the record layer has to stay in user space and the connection has to work as without
+ * the option.
+ */
+void
+test_CS104_MasterSlave_TLSKernelOffloadFallback(void)
+{
+    TLSConfiguration tlsConfig1 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig1, true);
+    TLSConfiguration_setKernelTlsOffload(tlsConfig1, true);
+
+    TLSConfiguration_setOwnKeyFromFile(tlsConfig1, "server-key.pem", NULL);
+    TLSConfiguration_setOwnCertificateFromFile(tlsConfig1, "server.cer");
+    TLSConfiguration_addCACertificateFromFile(tlsConfig1, "root.cer");
+
+    TLSConfiguration tlsConfig2 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig2, true);
+    TLSConfiguration_setAllowOnlyKnownCertificates(tlsConfig2, true);
+    TLSConfiguration_setKernelTlsOffload(tlsConfig2, true);
+
+    TLSConfiguration_setOwnKeyFromFile(tlsConfig2, "client1-key.pem", NULL);
+    TLSConfiguration_setOwnCertificateFromFile(tlsConfig2, "client1.cer");
+    TLSConfiguration_addCACertificateFromFile(tlsConfig2, "root.cer");
+
+    TLSConfiguration_addAllowedCertificateFromFile(tlsConfig2, "server.cer");
+
+    CS104_Slave slave = CS104_Slave_createSecure(100, 100, tlsConfig1);
+
+    TEST_ASSERT_NOT_NULL(slave);
+
+    CS104_Slave_setLocalPort(slave, 20020);
+    CS104_Slave_setInterrogationHandler(slave, test_CS104_Connection_PointCache_interrogationHandler, NULL);
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_createSecure("127.0.0.1", 20020, tlsConfig2);
+
+    TEST_ASSERT_NOT_NULL(con);
+
+    int receivedASDUs = 0;
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_MasterSlave_TLSKernelOffloadFallback_asduHandler, &receivedASDUs);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+
+    /* data in both directions: command from the client, responses and events from the server */
+    CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+    Thread_sleep(500);
+
+    /* ACT_CON, two ASDUs with the points, ACT_TERM */
+    TEST_ASSERT_EQUAL_INT(4, receivedASDUs);
+
+    CS101_ASDU asdu = CS101_ASDU_create(CS104_Slave_getAppLayerParameters(slave), false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
+
+    InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 300, true, IEC60870_QUALITY_GOOD);
+    CS101_ASDU_addInformationObject(asdu, io);
+    InformationObject_destroy(io);
+
+    CS104_Slave_enqueueASDU(slave, asdu);
+    CS101_ASDU_destroy(asdu);
+
+    Thread_sleep(500);
+
+    TEST_ASSERT_EQUAL_INT(5, receivedASDUs);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(slave);
+
+    TLSConfiguration_destroy(tlsConfig1);
+    TLSConfiguration_destroy(tlsConfig2);
+}
+
+typedef struct {
+    int receivedASDUs;
+    int orderErrors;
+    bool stalled;
+    bool actTermReceived;
+} test_CS104_MasterSlave_TLSSlowReader_Info;
+
+static bool
+test_CS104_MasterSlave_TLSSlowReader_asduHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    test_CS104_MasterSlave_TLSSlowReader_Info* info = (test_CS104_MasterSlave_TLSSlowReader_Info*) parameter;
+
+    if (CS101_ASDU_getTypeID(asdu) == M_ME_NB_1) {
+
+        /* stop reading -> the send buffer of the server runs full */
+        if (info->stalled == false) {
+            info->stalled = true;
+            Thread_sleep(2000);
+        }
+
+        InformationObject io = CS101_ASDU_getElement(asdu, 0);
+
+        if ((io == NULL) || (InformationObject_getObjectAddress(io) != (info->receivedASDUs + 1) * 64))
+            info->orderErrors++;
+
+        if (io)
+            InformationObject_destroy(io);
+
+        info->receivedASDUs++;
+    }
+    else if ((CS101_ASDU_getTypeID(asdu) == C_IC_NA_1) && (CS101_ASDU_getCOT(asdu) == CS101_COT_ACTIVATION_TERMINATION))
+        info->actTermReceived = true;
+
+    return true;
+}
+
+/*
+ * The client stops reading during a GI burst over TLS. When the socket cannot take a record mbedtls keeps it and
+ * the same data has to be written again. No message must be lost or reordered.
+ */
+void
+test_CS104_MasterSlave_TLSSlowReader(void)
+{
+    bool giDone = false;
+
+    TLSConfiguration tlsConfig1 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig1, true);
+
+    TLSConfiguration_setOwnKeyFromFile(tlsConfig1, "server-key.pem", NULL);
+    TLSConfiguration_setOwnCertificateFromFile(tlsConfig1, "server.cer");
+    TLSConfiguration_addCACertificateFromFile(tlsConfig1, "root.cer");
+
+    TLSConfiguration tlsConfig2 = TLSConfiguration_create();
+
+    TLSConfiguration_setChainValidation(tlsConfig2, true);
+    TLSConfiguration_setAllowOnlyKnownCertificates(tlsConfig2, true);
+
+    TLSConfiguration_setOwnKeyFromFile(tlsConfig2, "client1-key.pem", NULL);
+    TLSConfiguration_setOwnCertificateFromFile(tlsConfig2, "client1.cer");
+    TLSConfiguration_addCACertificateFromFile(tlsConfig2, "root.cer");
+
+    TLSConfiguration_addAllowedCertificateFromFile(tlsConfig2, "server.cer");
+
+    CS104_Slave slave = CS104_Slave_createSecure(SLOW_READER_EVENTS, SLOW_READER_GI_RESPONSES + 10, tlsConfig1);
+
+    TEST_ASSERT_NOT_NULL(slave);
+
+    CS104_Slave_setLocalPort(slave, 20025);
+    CS104_Slave_setInterrogationHandler(slave, test_CS104_Slave_SlowReader_interrogationHandler, &giDone);
+
+    CS104_Slave_getConnectionParameters(slave)->k = 32767;
+    CS104_Slave_getConnectionParameters(slave)->t1 = 60;
+
+    CS104_Slave_start(slave);
+
+    CS104_Connection con = CS104_Connection_createSecure("127.0.0.1", 20025, tlsConfig2);
+
+    TEST_ASSERT_NOT_NULL(con);
+
+    test_CS104_MasterSlave_TLSSlowReader_Info info;
+
+    memset(&info, 0, sizeof(info));
+
+    CS104_Connection_setASDUReceivedHandler(con, test_CS104_MasterSlave_TLSSlowReader_asduHandler, &info);
+
+    TEST_ASSERT_TRUE(CS104_Connection_connect(con));
+
+    CS104_Connection_sendStartDT(con);
+    CS104_Connection_sendInterrogationCommand(con, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+    uint64_t endTime = Hal_getTimeInMs() + 30000;
+
+    while ((info.actTermReceived == false) && (Hal_getTimeInMs() < endTime))
+        Thread_sleep(10);
+
+    TEST_ASSERT_TRUE(giDone);
+    TEST_ASSERT_TRUE(info.actTermReceived);
+    TEST_ASSERT_EQUAL_INT(SLOW_READER_GI_RESPONSES, info.receivedASDUs);
+    TEST_ASSERT_EQUAL_INT(0, info.orderErrors);
+
+    CS104_Connection_destroy(con);
+
+    CS104_Slave_destroy(slave);
+
+    TLSConfiguration_destroy(tlsConfig1);
+    TLSConfiguration_destroy(tlsConfig2);
+}
+
+int
+main(int argc, char** argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_CS104_Slave_CreateDestroy);
+    RUN_TEST(test_CS104_MasterSlave_CreateDestroyLoop);
+    RUN_TEST(test_CS104_Connection_CreateDestroy);
+    RUN_TEST(test_CS104_MasterSlave_CreateDestroy);
+    RUN_TEST(test_CP56Time2a);
+    RUN_TEST(test_CP56Time2aToMsTimestamp);
+    RUN_TEST(test_CP56Time2aConversionFunctions);
+    RUN_TEST(test_StepPositionInformation);
+    RUN_TEST(test_addMaxNumberOfIOsToASDU);
+    RUN_TEST(test_SingleEventType);
+
+    RUN_TEST(test_SinglePointInformation);
+    RUN_TEST(test_SinglePointWithCP24Time2a);
+    RUN_TEST(test_SinglePointWithCP56Time2a);
+
+    RUN_TEST(test_DoublePointInformation);
+    RUN_TEST(test_DoublePointWithCP24Time2a);
+    RUN_TEST(test_DoublePointWithCP56Time2a);
+
+    RUN_TEST(test_NormalizeMeasureValueWithoutQuality);
+    RUN_TEST(test_NormalizeMeasureValue);
+    RUN_TEST(test_MeasuredValueNormalizedWithCP24Time2a);
+    RUN_TEST(test_MeasuredValueNormalizedWithCP56Time2a);
+
+    RUN_TEST(test_MeasuredValueScaled);
+    RUN_TEST(test_MeasuredValueScaledWithCP24Time2a);
+    RUN_TEST(test_MeasuredValueScaledWithCP56Time2a);
+
+    RUN_TEST(test_MeasuredValueShort);
+    RUN_TEST(test_MeasuredValueShortWithCP24Time2a);
+    RUN_TEST(test_MeasuredValueShortWithCP56Time2a);
+
+    RUN_TEST(test_StepPositionInformation);
+    RUN_TEST(test_StepPositionWithCP24Time2a);
+    RUN_TEST(test_StepPositionWithCP56Time2a);
+
+    RUN_TEST(test_IntegratedTotals);
+    RUN_TEST(test_IntegratedTotalsWithCP24Time2a);
+    RUN_TEST(test_IntegratedTotalsWithCP56Time2a);
+
+    RUN_TEST(test_SingleCommand);
+    RUN_TEST(test_SingleCommandWithCP56Time2a);
+
+    RUN_TEST(test_DoubleCommand);
+    RUN_TEST(test_DoubleCommandWithCP56Time2a);
+
+    RUN_TEST(test_StepCommandValue);
+    RUN_TEST(test_StepCommandWithCP56Time2a);
+
+    RUN_TEST(test_SetpointCommandNormalized);
+    RUN_TEST(test_SetpointCommandNormalizedWithCP56Time2a);
+
+    RUN_TEST(test_SetpointCommandScaled);
+    RUN_TEST(test_SetpointCommandScaledWithCP56Time2a);
+
+    RUN_TEST(test_SetpointCommandShort);
+    RUN_TEST(test_SetpointCommandShortWithCP56Time2a);
+
+    RUN_TEST(test_InterrogationCommand);
+    RUN_TEST(test_CounterInterrogationCommand);
+
+    RUN_TEST(test_ReadCommand);
+    RUN_TEST(test_ClockSynchronizationCommand);
+    RUN_TEST(test_ResetProcessCommand);
+    RUN_TEST(test_DelayAcquisitionCommand);
+
+    RUN_TEST(test_BitString32);
+    RUN_TEST(test_Bitstring32CommandWithCP56Time2a);
+
+    RUN_TEST(test_QueryLog);
+
+    RUN_TEST(test_BitString32xx_encodeDecode);
+    RUN_TEST(test_EventOfProtectionEquipmentWithTime);
+    RUN_TEST(test_IpAddressHandling);
+
+    RUN_TEST(test_CS104SlaveConnectionIsRedundancyGroup);
+    RUN_TEST(test_CS104SlaveSingleRedundancyGroup);
+
+    RUN_TEST(test_CS104SlaveEventQueue1);
+    RUN_TEST(test_CS104SlaveEventQueueOverflow);
+    RUN_TEST(test_CS104SlaveEventQueueOverflow2);
+    RUN_TEST(test_CS104SlaveEventQueueCheckCapacity);
+    RUN_TEST(test_CS104SlaveEventQueueOverflow3);
+
+    RUN_TEST(test_CS104_Connection_ConnectTimeout);
+
+    RUN_TEST(test_CS104_Connection_UseAfterClose);
+    RUN_TEST(test_CS104_Connection_UseAfterServerClosedConnection);
+    RUN_TEST(test_CS104_MasterSlave_ThreadAttributes);
+    RUN_TEST(test_CS104_Connection_PointCache);
+    RUN_TEST(test_CS101_PointCache_GIStationLimit);
+    RUN_TEST(test_CS104_RedundantConnection_Switchover);
+#if (CONFIG_CS104_SLAVE_QUEUE_REPLICATION == 1)
+    RUN_TEST(test_CS104_Slave_QueueReplication);
+    RUN_TEST(test_CS104_Slave_QueueReplication_TimeToLive);
+#endif
+    RUN_TEST(test_CS104_Slave_EventClasses);
+    RUN_TEST(test_CS104_Slave_EventExpiry);
+    RUN_TEST(test_CS104_Slave_KeepOnlyLatestMultipleObjects);
+    RUN_TEST(test_CS104_Slave_OutputRateLimit);
+    RUN_TEST(test_Tracing);
+    RUN_TEST(test_Tracing_restartWhileWriting);
+    RUN_TEST(test_CS104_Slave_ExternalEventLoop);
+    RUN_TEST(test_CS104_Slave_EnqueueASDUs);
+    RUN_TEST(test_CS104_Slave_AdaptiveWindow);
+    RUN_TEST(test_CS104_Slave_ReuseConnections);
+    RUN_TEST(test_CS104_ReceiveTimestamps);
+    RUN_TEST(test_CS101_StreamMerger);
+    RUN_TEST(test_CS104_DecodePipeline);
+    RUN_TEST(test_CS104_DecodePipeline_ConfirmInOrder);
+    RUN_TEST(test_CS104_DecodePipeline_ThreadAttributes);
+    RUN_TEST(test_CS101_ASDUDispatcher);
+    RUN_TEST(test_CS104_Slave_PluginForTypeID);
+    RUN_TEST(test_CS104_Campaign);
+    RUN_TEST(test_CS104_Campaign_NoHandler);
+#if defined(__linux__) && defined(__GLIBC__)
+    RUN_TEST(test_CS101_Master_AckTimeoutAfterTransmission);
+#endif
+    RUN_TEST(test_CS104_Slave_CyclicGroups);
+    RUN_TEST(test_Semaphore_waitTimeout);
+    RUN_TEST(test_Handleset_wakeUp);
+    RUN_TEST(test_CS104_Slave_CommandResponseTime);
+    RUN_TEST(test_CS104_Slave_ConcurrentResponders);
+    RUN_TEST(test_CS104_Slave_ExternalEventLoopCrossThreadResponse);
+    RUN_TEST(test_CS104_Slave_SlowReaderGIBurst);
+    RUN_TEST(test_CS104_Slave_SlowReaderOutputOverflow);
+    RUN_TEST(test_MemoryPools);
     RUN_TEST(test_CS101_ASDU_addObjectOfWrongType);
     RUN_TEST(test_CS101_ASDU_addUntilOverflow);
 
     RUN_TEST(test_CS104_MasterSlave_TLSConnectSuccess);
     RUN_TEST(test_CS104_MasterSlave_TLSConnectFails);
+    RUN_TEST(test_CS104_MasterSlave_TLSKernelOffloadFallback);
+    RUN_TEST(test_CS104_MasterSlave_TLSSlowReader);
 
     return UNITY_END();
 }